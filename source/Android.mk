@@ -122,12 +122,14 @@ LOCAL_SRC_FILES :=		achievements/prAchievementManager.cpp	\
 	Box2D/Dynamics/Joints/b2WeldJoint.cpp	\
 	Box2D/Dynamics/Joints/b2WheelJoint.cpp	\
 	Box2D/Rope/b2Rope.cpp	\
+	collision/prCollisionManager.cpp	\
 	collision/prLine.cpp	\
 	core/prApplication.cpp	\
 	core/prApplication_Android.cpp	\
 	core/prArgs.cpp	\
 	core/prATB.cpp	\
 	core/prBitArray.cpp	\
+	core/prClock.cpp	\
 	core/prCore.cpp	\
 	core/prCoreSystem.cpp	\
 	core/prGameTime.cpp	\
@@ -136,6 +138,7 @@ LOCAL_SRC_FILES :=		achievements/prAchievementManager.cpp	\
 	core/prMessageManager.cpp	\
 	core/prRegistry.cpp	\
 	core/prResource.cpp	\
+	core/prResourceLoader.cpp	\
 	core/prResourceManager.cpp	\
 	core/prSettings.cpp	\
 	core/prString.cpp	\
@@ -148,9 +151,11 @@ LOCAL_SRC_FILES :=		achievements/prAchievementManager.cpp	\
 	debug/prDebug.cpp	\
 	debug/prFps.cpp	\
 	debug/prFps_Android.cpp	\
+	debug/prLogWriter.cpp	\
 	debug/prOnScreenLogger.cpp	\
 	debug/prProfileEntry.cpp	\
 	debug/prProfileManager.cpp	\
+	debug/prProfiler.cpp	\
 	debug/prTrace.cpp	\
 	display/prBackground.cpp	\
 	display/prBackgroundLayer.cpp	\
@@ -170,9 +175,13 @@ LOCAL_SRC_FILES :=		achievements/prAchievementManager.cpp	\
 	display/prSprite.cpp	\
 	display/prSpriteAnimation.cpp	\
 	display/prSpriteAnimationSequence.cpp	\
+	display/prSpriteBatch.cpp	\
 	display/prSpriteManager.cpp	\
 	display/prTexture.cpp	\
 	display/prTrueTypeFont.cpp	\
+	file/prAssetCooker.cpp	\
+	file/prChunkFile.cpp	\
+	file/prCompression.cpp	\
 	file/prFile.cpp	\
 	file/prFileManager.cpp	\
 	file/prFileShared.cpp	\
@@ -209,10 +218,12 @@ LOCAL_SRC_FILES :=		achievements/prAchievementManager.cpp	\
 	math/prMatrix4.cpp	\
 	math/prPlane.cpp	\
 	math/prQuaternion.cpp	\
+	memory/prConcurrentPool.cpp	\
 	memory/prMemory.cpp	\
 	memory/prSpritePointerPool.cpp	\
 	memory/prLinkedHeap.cpp	\
 	memory/prStackHeap.cpp	\
+	memory/prTLSFHeap.cpp	\
 	mesh/prAnimation.cpp	\
 	mesh/prAnimation_MD2.cpp	\
 	mesh/prMesh.cpp	\
@@ -230,6 +241,7 @@ LOCAL_SRC_FILES :=		achievements/prAchievementManager.cpp	\
 	online/prWeb_android.cpp	\
 	particle/prEmitter.cpp	\
 	particle/prParticle.cpp	\
+	particle/prParticleBuffer.cpp	\
 	particle/prParticleManager.cpp	\
 	particle/prParticleShared.cpp	\
 	persistence/prEncryption.cpp	\
@@ -243,7 +255,9 @@ LOCAL_SRC_FILES :=		achievements/prAchievementManager.cpp	\
 	social/twitter/prTwitter.cpp	\
 	social/twitter/prTwitter_Android.cpp	\
 	system/prSystem.cpp	\
+	thread/prJobSystem.cpp	\
 	thread/prMutex.cpp	\
+	thread/prSemaphore.cpp	\
 	thread/prThread.cpp	\
 	tinyxml/tinystr.cpp	\
 	tinyxml/tinyxml.cpp	\
@@ -34,6 +34,9 @@
 #include "../display/prRenderer.h"
 #include "../display/prBitmapFont.h"
 #include "../display/prSpriteManager.h"
+#include "../file/prAssetCooker.h"
+#include "../file/prChunkFile.h"
+#include "../file/prFileShared.h"
 #include "../locale/prLanguage.h"
 #include "../persistence/prSave.h"
 #include "../tinyxml/tinyxml.h"
@@ -78,6 +81,23 @@ using namespace Proteus::Achievement;
 #define SHOW_ACHIEVEMENT_TIME       3000.0f                 // In milliseconds
 #define TEXT_DISPLAY_WIDTH          260.0f
 #define AWARDS_TEST_DELAY           60.f                    // One minute delay.
+#define ID_COUNT                    5                       // Number of platform identifiers
+
+
+// Platform identifier index. Matches platformIds below.
+#if defined(PLATFORM_PC)
+  #define ID_INDEX                  0
+#elif defined(PLATFORM_IOS)
+  #define ID_INDEX                  1
+#elif defined(PLATFORM_MAC)
+  #define ID_INDEX                  2
+#elif defined(PLATFORM_ANDROID)
+  #define ID_INDEX                  3
+#elif defined(PLATFORM_LINUX)
+  #define ID_INDEX                  4
+#else
+  #error No platform defined.
+#endif
 
 
 // Enums
@@ -123,6 +143,21 @@ typedef struct prAchievementDefinition
 } prAchievementDefinition;
 
 
+// Local data
+namespace
+{
+    // The platform identifier attributes, in cooked order.
+    const char *platformIds[ID_COUNT] =
+    {
+        "id_pc",
+        "id_ios",
+        "id_mac",
+        "id_android",
+        "id_linux",
+    };
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Ctor
 /// ---------------------------------------------------------------------------
@@ -808,6 +843,15 @@ void prAchievementManager::LoadAchievementDescriptions(const char *filename)
 {
     PRASSERT(filename && *filename);
 
+    // Cooked files are read directly.
+    prChunkReader reader;
+    if (reader.Load(filename, PRFILE_TYPE_AC, PRCOOKED_VERSION_AC))
+    {
+        LoadCooked(reader);
+        PRASSERT(mCorrectFile);
+        return;
+    }
+
     // Parse the document
     TiXmlDocument *doc = new TiXmlDocument(filename);
     if (doc)
@@ -917,6 +961,85 @@ void prAchievementManager::ParseAttribs_Achievement(TiXmlElement* pElement)
 }
 
 
+/// -----------------------------------------------------------------------
+/// Reads cooked descriptions of the achievements.
+/// -----------------------------------------------------------------------
+void prAchievementManager::LoadCooked(prChunkReader &reader)
+{
+    if (reader.FindChunk(PRCHUNK_ENTRY))
+    {
+        u32 count = reader.GetEntries();
+
+        for (u32 i=0; i<count; i++)
+        {
+            prAchievementDefinition d;
+            d.name          = reader.ReadString();
+            d.description   = reader.ReadString();
+            d.howTo         = reader.ReadString();
+            d.achieved      = reader.ReadString();
+            d.image         = reader.ReadString();
+
+            for (u32 id=0; id<ID_COUNT; id++)
+            {
+                const char *identifier = reader.ReadString();
+                if (id == ID_INDEX)
+                {
+                    d.identifier = identifier;
+                }
+            }
+
+            if (!reader.IsValid())
+            {
+                PRWARN("Invalid cooked achievement");
+                return;
+            }
+
+            PRASSERT(!d.identifier.empty());
+            d.hash = prStringHash(d.name.c_str());
+
+            mAchievementsList.push_back(d);
+        }
+
+        mCorrectFile = true;
+    }
+}
+
+
+/// -----------------------------------------------------------------------
+/// Writes an xml achievements file as a cooked achievements file.
+/// -----------------------------------------------------------------------
+bool prAchievementManager::Cook(TiXmlElement *pRoot, const char *destination)
+{
+    PRASSERT(pRoot);
+    PRASSERT(destination && *destination);
+
+    std::list<TiXmlElement *> achievements;
+    prCookFindElements(pRoot, "achievement", achievements);
+
+    prChunkWriter writer(PRFILE_TYPE_AC, PRCOOKED_VERSION_AC);
+    writer.BeginChunk(PRCHUNK_ENTRY, (u32)achievements.size());
+
+    for (auto it = achievements.begin(); it != achievements.end(); ++it)
+    {
+        TiXmlElement *pElement = *it;
+
+        PRASSERT(pElement->Attribute("name"));
+        writer.WriteString(pElement->Attribute("name"));
+        writer.WriteString(pElement->Attribute("desc_brief"));
+        writer.WriteString(pElement->Attribute("desc_howto"));
+        writer.WriteString(pElement->Attribute("desc_achieved"));
+        writer.WriteString(pElement->Attribute("badge"));
+
+        for (u32 id=0; id<ID_COUNT; id++)
+        {
+            writer.WriteString(pElement->Attribute(platformIds[id]));
+        }
+    }
+
+    return writer.Save(destination);
+}
+
+
 /// -----------------------------------------------------------------------
 /// Gets the identifer for the achievement.
 /// -----------------------------------------------------------------------
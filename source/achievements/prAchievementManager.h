@@ -130,6 +130,7 @@ class prColour;
 class prSpriteManager;
 class TiXmlNode;
 class TiXmlElement;
+class prChunkReader;
 
 
 // Class: prAchievementDisplayCallback
@@ -229,8 +230,26 @@ public:
 
     // Method: Load
     //      Loads the achievement definition file and the achievement status file.
+    //
+    // Parameters:
+    //      filename - Either a cooked file or an xml file
     void Load(const char *filename);
 
+    // Method: Cook
+    //      Writes an xml achievements file as a cooked achievements file.
+    //
+    // Parameters:
+    //      pRoot       - The files root element
+    //      destination - The file to write
+    //
+    // Returns:
+    //      true on success
+    //
+    // Notes:
+    //      The identifiers for every platform are cooked, so one file
+    //      serves all platforms. Normally called through <prCookAsset>.
+    static bool Cook(TiXmlElement *pRoot, const char *destination);
+
     // Method: Saves
     //      Saves the achievements states.
     //
@@ -364,6 +383,9 @@ private:
     // Attribute parser.
     void ParseAttribs_Achievement(TiXmlElement* pElement);
 
+    // Reads cooked descriptions of the achievements.
+    void LoadCooked(prChunkReader &reader);
+
     // Gets the identifer for the achievement.
     const char *GetIdentifierByIndex(u32 index);
 
@@ -54,6 +54,7 @@ prActor::prActor(s32 type) : prGameObject()
                            , m_onScreen (true)
                            , m_exp0     (false)
                            , m_exp1     (false)
+                           , m_handle   (PRACTOR_INVALID_HANDLE)
 {
 }
 
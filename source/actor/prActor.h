@@ -39,6 +39,19 @@ namespace Actor {
 //class prActorComponent;
 
 
+// Typedef: prActorHandle
+//      A generation checked handle to an actor. The low bits index the actor
+//      managers slot table and the high bits hold the slots generation, which
+//      changes whenever an actor is destroyed, so stale handles are detected.
+typedef u32 prActorHandle;
+
+
+// Handle defines
+#define PRACTOR_INVALID_HANDLE              0
+#define PRACTOR_HANDLE_INDEX_BITS           20
+#define PRACTOR_HANDLE_INDEX_MASK           ((1 << PRACTOR_HANDLE_INDEX_BITS) - 1)
+
+
 // Class: prActor
 //      Actor base class
 //
@@ -118,6 +131,16 @@ public:
     //      Unique ID.
     s32 GetID() const { return m_id; }
 
+    // Method: GetHandle
+    //      Returns the actors handle.
+    //
+    // Notes:
+    //      Only actors created by a <prActorManager> have a valid handle.
+    //
+    // See Also:
+    //      <prActorManager::Get>
+    prActorHandle GetHandle() const { return m_handle; }
+
     // Method: OnCollisionEnter2D
     //      Indicates a collision has started
     //
@@ -153,6 +176,14 @@ public:
     //      set by an actor before collision detection takes place.
     virtual void SetCollisionPosition2D() { m_colPos.x = -1; m_colPos.y = -1; }
 
+    // Method: GetCollisionPosition2D
+    //      Returns the collision rectangle start x, y, or -1, -1 if the
+    //      rectangle is centred on the actor.
+    //
+    // See Also:
+    //      <SetCollisionPosition2D>
+    const Proteus::Math::prVector2 &GetCollisionPosition2D() const { return m_colPos; }
+
     // Method: DebugDrawCollision2D
     //      An overrideable function which allows the collision to be drawn by the actor
     virtual void DebugDrawCollision2D() {}
@@ -209,6 +240,8 @@ protected:
     // Add colour
 
 private:
+    prActorHandle               m_handle;       // Set by the actor manager
+
     static s32                  m_baseid;
 };
 
@@ -25,23 +25,52 @@
 #include "../debug/prAssert.h"
 #include "../debug/prTrace.h"
 #include "../debug/prDebug.h"
+#include <string.h>
 
 
 using namespace Proteus::Core;
 
 
+// Defines
+#define ACTOR_NO_SLOT               0xFFFFFFFF
+#define ACTOR_GENERATION_MASK       ((1 << (32 - PRACTOR_HANDLE_INDEX_BITS)) - 1)
+#define ACTOR_SLOTS_MAX             (1 << PRACTOR_HANDLE_INDEX_BITS)
+#define ACTOR_SLOTS_INITIAL         64
+#define ACTOR_LIST_INITIAL          16
+
+
 // Namespaces
 namespace Proteus {
 namespace Actor {
 
 
+namespace
+{
+    /// -----------------------------------------------------------------------
+    /// Makes a handle. Generations start at 1, so a handle is never zero.
+    /// -----------------------------------------------------------------------
+    inline prActorHandle MakeHandle(u32 slot, u32 generation)
+    {
+        return (generation << PRACTOR_HANDLE_INDEX_BITS) | slot;
+    }
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Ctor
 /// ---------------------------------------------------------------------------
-prActorManager::prActorManager() 
-    : callback (nullptr)
+prActorManager::prActorManager()
+    : m_types        (nullptr)
+    , m_typeCount    (0)
+    , m_slots        (nullptr)
+    , m_slotCount    (0)
+    , m_slotCapacity (0)
+    , m_freeSlot     (ACTOR_NO_SLOT)
+    , m_count        (0)
+    , m_dead         (nullptr)
+    , m_deadCapacity (0)
+    , m_callback     (nullptr)
 {
-    TODO("Modify to add create/release for actor pools - via handler class")
 }
 
 
@@ -51,6 +80,15 @@ prActorManager::prActorManager()
 prActorManager::~prActorManager()
 {
     ReleaseAll();
+
+    for (s32 i = 0; i < m_typeCount; i++)
+    {
+        PRSAFE_DELETE_ARRAY(m_types[i].actors);
+    }
+
+    PRSAFE_DELETE_ARRAY(m_types);
+    PRSAFE_DELETE_ARRAY(m_slots);
+    PRSAFE_DELETE_ARRAY(m_dead);
 }
 
 
@@ -61,7 +99,46 @@ void prActorManager::Registerfactory(prFactoryCallback cb, s32 actorTypes)
 {
     PRASSERT(cb);
     PRASSERT(actorTypes > 0);
-    callback = cb;
+    m_callback = cb;
+
+    if (actorTypes != m_typeCount)
+    {
+        PRASSERT(m_count == 0, "Actor types cannot be changed while actors exist");
+        ReleaseAll();
+
+        for (s32 i = 0; i < m_typeCount; i++)
+        {
+            PRSAFE_DELETE_ARRAY(m_types[i].actors);
+        }
+
+        PRSAFE_DELETE_ARRAY(m_types);
+
+        m_types     = new Type[actorTypes];
+        m_typeCount = actorTypes;
+        memset(m_types, 0, actorTypes * sizeof(Type));
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Registers a pool.
+/// ---------------------------------------------------------------------------
+void prActorManager::RegisterPool(s32 type, u32 size, u32 pageSize, Constructor constructor)
+{
+    PRASSERT(m_types, "Register the factory before any pools");
+    PRASSERT(type >= 0 && type < m_typeCount);
+    PRASSERT(pageSize > 0);
+
+    if (m_types && type >= 0 && type < m_typeCount)
+    {
+        Type &t = m_types[type];
+        PRASSERT(t.count == 0, "Actors of the type already exist");
+        PRASSERT(t.constructor == nullptr || t.size == size, "The type is already pooled");
+
+        t.constructor = constructor;
+        t.size        = size;
+        t.pageSize    = PRMAX(pageSize, 1u);
+    }
 }
 
 
@@ -70,14 +147,55 @@ void prActorManager::Registerfactory(prFactoryCallback cb, s32 actorTypes)
 /// ---------------------------------------------------------------------------
 prActor *prActorManager::Create(s32 type)
 {
-    prActor *actor = nullptr;
+    if (m_types == nullptr || type < 0 || type >= m_typeCount)
+    {
+        PRWARN("Cannot create actor of type %i", type);
+        return nullptr;
+    }
+
+    prActor *actor  = nullptr;
+    Type    &t      = m_types[type];
+
+    if (t.constructor)
+    {
+        // Add a page of free actors.
+        if (t.pFree == nullptr)
+        {
+            u8 **pages = new u8 *[t.pageCount + 1];
+            if (t.pages)
+            {
+                memcpy(pages, t.pages, t.pageCount * sizeof(u8 *));
+                PRSAFE_DELETE_ARRAY(t.pages);
+            }
+
+            u8 *page = new u8[t.size * t.pageSize];
+            for (u32 i = t.pageSize; i > 0; i--)
+            {
+                void *pMemory = page + (i - 1) * t.size;
+                *(void **)pMemory = t.pFree;
+                t.pFree = pMemory;
+            }
+
+            t.pages = pages;
+            t.pages[t.pageCount++] = page;
+        }
+
+        void *pMemory = t.pFree;
+        t.pFree = *(void **)pMemory;
+        actor   = t.constructor(pMemory);
+
+        Add(actor, type);
 
-    if (callback)
+        // Pooled memory is returned by address, which may differ from the
+        // actor pointer if the actor has more than one base class.
+        m_slots[actor->m_handle & PRACTOR_HANDLE_INDEX_MASK].memory = pMemory;
+    }
+    else if (m_callback)
     {
-        actor = callback(type);
+        actor = m_callback(type);
         if (actor)
         {
-            actors.push_back(actor);
+            Add(actor, type);
         }
     }
 
@@ -86,20 +204,20 @@ prActor *prActorManager::Create(s32 type)
 
 
 /// ---------------------------------------------------------------------------
-/// Releases an actor
+/// Flags an actor for destruction
 /// ---------------------------------------------------------------------------
 void prActorManager::Release(prActor *actor)
 {
     if (actor)
     {
-        for (auto it = actors.begin(); it != actors.end(); ++it)
+        if (Get(actor->m_handle) == actor)
         {
-            if ((*it) == actor)
-            {
-                actors.remove(actor);
-                PRSAFE_DELETE(actor);
-                return;
-            }
+            actor->m_destroy = true;
+            m_types[actor->m_type].flush = true;
+        }
+        else
+        {
+            PRWARN("prActorManager::Release - Actor not found");
         }
     }
 }
@@ -110,12 +228,44 @@ void prActorManager::Release(prActor *actor)
 /// ---------------------------------------------------------------------------
 void prActorManager::ReleaseAll()
 {
-    for (auto it = actors.begin(); it != actors.end(); ++it)
+    // Destructors may create actors of any type, including types already
+    // cleared, so repeat until every type is empty.
+    bool destroyed;
+    do
     {
-        PRSAFE_DELETE(*it);
+        destroyed = false;
+
+        for (s32 i = 0; i < m_typeCount; i++)
+        {
+            Type &t = m_types[i];
+
+            while (t.count > 0)
+            {
+                Destroy(t.actors[--t.count]);
+                destroyed = true;
+            }
+
+            t.flush = false;
+        }
     }
+    while (destroyed);
+
+    PRASSERT(m_count == 0);
+
+    // Free the pools once all the actors have gone.
+    for (s32 i = 0; i < m_typeCount; i++)
+    {
+        Type &t = m_types[i];
+
+        for (u32 page = 0; page < t.pageCount; page++)
+        {
+            PRSAFE_DELETE_ARRAY(t.pages[page]);
+        }
 
-    actors.clear();
+        PRSAFE_DELETE_ARRAY(t.pages);
+        t.pageCount = 0;
+        t.pFree     = nullptr;
+    }
 }
 
 
@@ -124,28 +274,104 @@ void prActorManager::ReleaseAll()
 /// ---------------------------------------------------------------------------
 void prActorManager::Update(f32 time)
 {
-    for (auto it = actors.begin(); it != actors.end(); ++it)
+    PRUNUSED(time);
+
+    for (s32 i = 0; i < m_typeCount; i++)
     {
-        prActor *actor = *it;
-        if (actor)
+        Type &t = m_types[i];
+
+        // Actors created during the update are appended, so stop at the
+        // current count. The list may move, so index it afresh each time.
+        u32 count = t.count;
+        for (u32 index = 0; index < count; index++)
         {
-            // Active?
-            if (actor->IsActive())
+            prActor *actor = t.actors[index];
+
+            if (!actor->m_destroy && actor->IsActive())
             {
                 actor->Update();
 
-                // Destroy?
-                if (actor->m_destroy)
+                // Still active?
+                if (!actor->m_destroy)
                 {
-                    it = actors.erase(it);
-                    PRSAFE_DELETE(actor);
-                }
-                else
-                {
-                    // No, actor is still active
                     actor->UpdateOnScreen();
                 }
             }
+
+            // Flagged by itself or by another actor?
+            if (actor->m_destroy)
+            {
+                t.flush = true;
+            }
+        }
+    }
+
+    FlushTypes();
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Destroys the actors flagged for destruction
+/// ---------------------------------------------------------------------------
+void prActorManager::Flush()
+{
+    // SetDestroy doesn't tell the manager, so check every type.
+    for (s32 i = 0; i < m_typeCount; i++)
+    {
+        if (m_types[i].count > 0)
+        {
+            m_types[i].flush = true;
+        }
+    }
+
+    FlushTypes();
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Destroys the flagged actors of the types known to hold them
+/// ---------------------------------------------------------------------------
+void prActorManager::FlushTypes()
+{
+    for (s32 i = 0; i < m_typeCount; i++)
+    {
+        Type &t = m_types[i];
+        if (!t.flush)
+        {
+            continue;
+        }
+
+        t.flush = false;
+
+        if (m_deadCapacity < t.count)
+        {
+            PRSAFE_DELETE_ARRAY(m_dead);
+            m_dead         = new prActor *[t.capacity];
+            m_deadCapacity = t.capacity;
+        }
+
+        // Remove the destroyed actors and keep the survivors in order.
+        u32 count = 0;
+        u32 dead  = 0;
+        for (u32 index = 0; index < t.count; index++)
+        {
+            prActor *actor = t.actors[index];
+            if (actor->m_destroy)
+            {
+                m_dead[dead++] = actor;
+            }
+            else
+            {
+                t.actors[count++] = actor;
+            }
+        }
+
+        t.count = count;
+
+        // Destroy them once the list is consistent, as destructors may create actors.
+        for (u32 index = 0; index < dead; index++)
+        {
+            Destroy(m_dead[index]);
         }
     }
 }
@@ -156,123 +382,182 @@ void prActorManager::Update(f32 time)
 /// ---------------------------------------------------------------------------
 void prActorManager::Draw()
 {
-    for (auto it = actors.begin(); it != actors.end(); ++it)
+    for (s32 i = 0; i < m_typeCount; i++)
     {
-        prActor *actor = *it;
-        PRASSERT(actor);
+        const Type &t = m_types[i];
+
+        for (u32 index = 0; index < t.count; index++)
         {
-            if (actor->IsVisible() && actor->IsOnscreen())
+            prActor *actor = t.actors[index];
+            PRASSERT(actor);
+
+            if (!actor->m_destroy && actor->IsVisible() && actor->IsOnscreen())
             {
-                (*it)->Draw();
+                actor->Draw();
             }
         }
     }
 }
 
 
-///// ---------------------------------------------------------------------------
-///// Set the draw order priority.
-///// ---------------------------------------------------------------------------
-//void prActorManager::SetPriority(prActor *actor, s32 priority)
-//{
-//    PRASSERT(actor);
-//
-//    if (actor)
-//    {
-//        bool found = false;
-//
-//        std::list<prActor *>::iterator it  = actors.begin();
-//        std::list<prActor *>::iterator end = actors.end();
-//        for (; it != end; ++it)
-//        {
-//            if ((*it) == actor)
-//            {
-//                actors.remove(actor);
-//                found = true;
-//                break;
-//            }
-//        }
-//
-//        if (found)
-//        {
-//            it  = actors.begin();
-//            end = actors.end();
-//
-// /*           actor->m_priority = priority;
-//            
-//            for (; it != end; ++it)
-//            {
-//                if (priority < (*it)->m_priority)
-//                {
-//                    actors.insert(it, actor);
-//                    return;
-//                }
-//            }//*/
-//
-//            // Add last
-//            actors.push_back(actor);
-//        }
-//        else
-//        {
-//            PRWARN("prActorManager::SetPriority - Actor not found");
-//        }
-//    }
-//}
-
-
-/// ---------------------------------------------------------------------------
-/// Gets the number of actors
-/// ---------------------------------------------------------------------------
-int prActorManager::Count() const
+/// ---------------------------------------------------------------------------
+/// Counts the actors of a specific type
+/// ---------------------------------------------------------------------------
+u32 prActorManager::HowMany(s32 type) const
 {
-    return (int)actors.size();
+    if (type >= 0 && type < m_typeCount)
+    {
+        return m_types[type].count;
+    }
+
+    return 0;
 }
 
 
+/// ---------------------------------------------------------------------------
+/// Finds an actor of a specific type at index.
+/// ---------------------------------------------------------------------------
+prActor *prActorManager::FindByIndex(s32 type, u32 index) const
+{
+    if (type >= 0 && type < m_typeCount && index < m_types[type].count)
+    {
+        return m_types[type].actors[index];
+    }
+
+    return nullptr;
+}
+
 
 /// ---------------------------------------------------------------------------
-/// Counts the actors of a specific type
+/// Gets the actors of a specific type.
+/// ---------------------------------------------------------------------------
+prActor *const *prActorManager::GetActors(s32 type) const
+{
+    if (type >= 0 && type < m_typeCount)
+    {
+        return m_types[type].actors;
+    }
+
+    return nullptr;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Gets an actor from its handle.
 /// ---------------------------------------------------------------------------
-u32 prActorManager::HowMany(s32 type)
+prActor *prActorManager::Get(prActorHandle handle) const
 {
-    u32 count = 0;
+    u32 index      = handle & PRACTOR_HANDLE_INDEX_MASK;
+    u32 generation = handle >> PRACTOR_HANDLE_INDEX_BITS;
 
-    for (auto it = actors.begin(); it != actors.end(); ++it)
+    if (index < m_slotCount && m_slots[index].generation == generation)
     {
-        if (type == (*it)->m_type)
-        {
-            count++;
-        }
+        return m_slots[index].actor;
     }
 
-    return count;
+    return nullptr;
 }
 
 
 /// ---------------------------------------------------------------------------
-/// Finds an actor of a specific type at index.
+/// Adds an actor to its type list and the slot table.
 /// ---------------------------------------------------------------------------
-prActor *prActorManager::FindByIndex(s32 type, u32 index)
+void prActorManager::Add(prActor *actor, s32 type)
 {
-    prActor *actor = nullptr;
- 
-    u32 count = 0;
+    PRASSERT(actor);
+    PRASSERT(actor->m_type == type, "The factory created an actor of the wrong type");
+    actor->m_type = type;
 
-    for (auto it = actors.begin(); it != actors.end(); ++it)
+    // Take a slot.
+    u32 index = m_freeSlot;
+    if (index != ACTOR_NO_SLOT)
+    {
+        m_freeSlot = m_slots[index].nextFree;
+    }
+    else
     {
-        if (type == (*it)->m_type)
+        PRASSERT(m_slotCount < ACTOR_SLOTS_MAX, "Too many actors");
+
+        if (m_slotCount == m_slotCapacity)
         {
-            if (count == index)
+            u32   capacity = (m_slotCapacity > 0) ? m_slotCapacity * 2 : ACTOR_SLOTS_INITIAL;
+            Slot *slots    = new Slot[capacity];
+            if (m_slots)
             {
-                actor = (*it);
-                break;
+                memcpy(slots, m_slots, m_slotCount * sizeof(Slot));
+                PRSAFE_DELETE_ARRAY(m_slots);
             }
 
-            count++;
+            m_slots        = slots;
+            m_slotCapacity = capacity;
         }
+
+        index = m_slotCount++;
+        m_slots[index].generation = 1;
     }
 
-    return actor;
+    Slot &slot = m_slots[index];
+    slot.actor      = actor;
+    slot.memory     = nullptr;
+    slot.nextFree   = ACTOR_NO_SLOT;
+    actor->m_handle = MakeHandle(index, slot.generation);
+
+    // Append to the type list.
+    Type &t = m_types[type];
+    if (t.count == t.capacity)
+    {
+        u32       capacity = (t.capacity > 0) ? t.capacity * 2 : ACTOR_LIST_INITIAL;
+        prActor **actors   = new prActor *[capacity];
+        if (t.actors)
+        {
+            memcpy(actors, t.actors, t.count * sizeof(prActor *));
+            PRSAFE_DELETE_ARRAY(t.actors);
+        }
+
+        t.actors   = actors;
+        t.capacity = capacity;
+    }
+
+    t.actors[t.count++] = actor;
+    m_count++;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Destroys an actor which has been removed from its type list.
+/// ---------------------------------------------------------------------------
+void prActorManager::Destroy(prActor *actor)
+{
+    PRASSERT(actor);
+    PRASSERT(Get(actor->m_handle) == actor);
+
+    // Release the slot. Changing the generation invalidates existing handles.
+    u32   index   = actor->m_handle & PRACTOR_HANDLE_INDEX_MASK;
+    Slot &slot    = m_slots[index];
+    void *pMemory = slot.memory;
+
+    slot.actor      = nullptr;
+    slot.memory     = nullptr;
+    slot.generation = (slot.generation + 1) & ACTOR_GENERATION_MASK;
+    slot.generation = (slot.generation == 0) ? 1 : slot.generation;
+    slot.nextFree   = m_freeSlot;
+    m_freeSlot      = index;
+    m_count--;
+
+    actor->m_handle = PRACTOR_INVALID_HANDLE;
+
+    if (pMemory)
+    {
+        Type &t = m_types[actor->m_type];
+        actor->~prActor();
+
+        *(void **)pMemory = t.pFree;
+        t.pFree = pMemory;
+    }
+    else
+    {
+        PRSAFE_DELETE(actor);
+    }
 }
 
 
@@ -1,4 +1,11 @@
 // File: prActorManager.h
+//      Creates, updates, draws and destroys the games actors.
+//
+// Notes:
+//      Actors are kept in a dense list per type, so counting, indexing
+//      and iterating the actors of a type are all constant time. Actor
+//      types which are created and destroyed often, such as bullets, can
+//      be given a pool so their memory is recycled rather than allocated.
 /**
  *  Copyright 2016 Paul Michael McNab
  *
@@ -20,7 +27,8 @@
 
 
 #include "../core/prTypes.h"
-#include <list>
+#include "prActor.h"
+#include <new>
 
 
 // Namespaces
@@ -28,16 +36,20 @@ namespace Proteus {
 namespace Actor {
 
 
-// Forward references
-class prActor;
-
-
 // Callback
 typedef prActor *(*prFactoryCallback)(s32 type);
 
 
 // Class: prActorManager
 //      Actor management class
+//
+// Notes:
+//      Actors are updated and drawn by type, in ascending type order.
+//      Within a type actors keep the order in which they were created.
+//
+//      Destroying an actor is deferred. Actors flagged with
+//      <prActor::SetDestroy> or passed to <Release> are destroyed as
+//      a batch by <Flush>, which is called at the end of <Update>.
 class prActorManager
 {
 public:
@@ -54,9 +66,28 @@ public:
     //
     // Parameters:
     //      cb         - A function pointer
-    //      actorTypes - The number of supported actor types
+    //      actorTypes - The number of supported actor types. Types range from zero to actorTypes - 1
     void Registerfactory(prFactoryCallback cb, s32 actorTypes = 32);
 
+    // Method: RegisterPool
+    //      Creates the actors of a type from a pool rather than the factory.
+    //
+    // Parameters:
+    //      type     - A user defined type
+    //      pageSize - The number of actors allocated each time the pool grows
+    //
+    // Notes:
+    //      T must be default constructible. Pool memory is kept until
+    //      <ReleaseAll> is called.
+    //
+    //      Must be called after <Registerfactory> and before any actors
+    //      of the type are created.
+    template<typename T>
+    void RegisterPool(s32 type, u32 pageSize = 64)
+    {
+        RegisterPool(type, sizeof(T), pageSize, &Construct<T>);
+    }
+
     // Method: Create
     //      Creates an actor
     //
@@ -68,42 +99,54 @@ public:
     prActor *Create(s32 type);
 
     // Method: Release
-    //      Releases the passed actor
+    //      Flags the passed actor for destruction.
+    //
+    // Notes:
+    //      The actor is destroyed by the next <Flush>.
     void Release(prActor *actor);
 
     // Method: ReleaseAll
-    //      Releases all the actors
+    //      Destroys all the actors immediately and frees the pools.
     void ReleaseAll();
 
     // Method: Update
-    //      Updates all the actors
+    //      Updates all the actors, then destroys the flagged actors.
     //
     // Notes:
-    //      This is optional
+    //      This is optional. Actors created during the update are first
+    //      updated on the next frame.
     void Update(f32 time);
 
+    // Method: Flush
+    //      Destroys the actors flagged for destruction.
+    //
+    // Notes:
+    //      Called by <Update>, so only needed if <Update> is not used.
+    //      Every actor is checked, as actors flagged with <prActor::SetDestroy>
+    //      are only found by <Update>.
+    void Flush();
+
     // Method: Draw
     //      Draws the actors
     //
     // Notes:
-    //      This is optional. Though actors are drawn in the managers priority
-    //      list order
+    //      This is optional. Actors flagged for destruction are not drawn.
     void Draw();
 
-    //// Method: SetPriority
-    ////      Set the draw order priority.
-    //void SetPriority(prActor *actor, s32 priority);
-
     // Method: Count
     //      Gets the number of actors
-    s32 Count() const;
+    s32 Count() const { return (s32)m_count; }
+
+    // Method: GetTypeCount
+    //      Gets the number of actor types.
+    s32 GetTypeCount() const { return m_typeCount; }
 
     // Method: HowMany
     //      Counts the actors of a specific type
     //
     // Parameters:
     //      type - A user defined type
-    u32 HowMany(s32 type);
+    u32 HowMany(s32 type) const;
 
     // Method: FindByIndex
     //      Finds an actor of a specific type at index.
@@ -114,19 +157,96 @@ public:
     //
     // See Also:
     //      <HowMany>
-    prActor *FindByIndex(s32 type, u32 index);
+    prActor *FindByIndex(s32 type, u32 index) const;
+
+    // Method: GetActors
+    //      Gets the actors of a specific type.
+    //
+    // Parameters:
+    //      type - A user defined type
+    //
+    // Returns:
+    //      <HowMany> actor pointers, which stay valid until an actor of the type is created or destroyed
+    prActor *const *GetActors(s32 type) const;
+
+    // Method: Get
+    //      Gets an actor from its handle.
+    //
+    // Parameters:
+    //      handle - An actor handle
+    //
+    // Returns:
+    //      The actor, or nullptr if the handle is invalid or the actor has been destroyed
+    //
+    // Notes:
+    //      Holding handles rather than pointers allows destroyed actors to be detected.
+    prActor *Get(prActorHandle handle) const;
 
 
 private:
+    // Pool constructor
+    typedef prActor *(*Constructor)(void *pMemory);
+
+    // Constructs a pooled actor.
+    template<typename T>
+    static prActor *Construct(void *pMemory) { return new (pMemory) T(); }
+
+    // Registers a pool.
+    void RegisterPool(s32 type, u32 size, u32 pageSize, Constructor constructor);
+
+    // Adds an actor to its type list and the slot table.
+    void Add(prActor *actor, s32 type);
+
+    // Destroys an actor.
+    void Destroy(prActor *actor);
+
+    // Destroys the flagged actors of the types known to hold them.
+    void FlushTypes();
+
     // Stops passing by value and assignment.
     prActorManager(const prActorManager&);
     const prActorManager& operator = (const prActorManager&);
 
 
 private:
-    // Data
-    std::list<prActor *>    actors;
-    prFactoryCallback       callback;
+    // The actors of one type.
+    typedef struct Type
+    {
+        prActor       **actors;                 // Dense, in creation order
+        u32             count;
+        u32             capacity;
+        bool            flush;                  // Holds actors flagged for destruction
+        Constructor     constructor;            // Pooled types only
+        u32             size;                   // Pooled actor size
+        u32             pageSize;               // Pooled actors per page
+        u8            **pages;
+        u32             pageCount;
+        void           *pFree;                  // Free pooled actors, linked through their first bytes
+
+    } Type;
+
+    // Slot table entry. Slots are reused, so the generation identifies the current actor.
+    typedef struct Slot
+    {
+        prActor    *actor;
+        void       *memory;                     // Pooled actors only
+        u32         generation;
+        u32         nextFree;
+
+    } Slot;
+
+
+private:
+    Type               *m_types;
+    s32                 m_typeCount;
+    Slot               *m_slots;
+    u32                 m_slotCount;
+    u32                 m_slotCapacity;
+    u32                 m_freeSlot;
+    u32                 m_count;
+    prActor           **m_dead;                 // Actors being destroyed by Flush
+    u32                 m_deadCapacity;
+    prFactoryCallback   m_callback;
 };
 
 
@@ -0,0 +1,558 @@
+/**
+ * prCollisionManager.cpp
+ *
+ * Copyright 2014 Paul Michael McNab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "../prConfig.h"
+#include "prCollisionManager.h"
+#include "../actor/prActorManager.h"
+#include "../core/prMacros.h"
+#include "../debug/prAssert.h"
+#include "../Box2D/Collision/b2DynamicTree.h"
+#include <algorithm>
+#include <string.h>
+#include <stdint.h>
+
+
+using namespace Proteus::Actor;
+using namespace Proteus::Math;
+
+
+// Defines
+#define COLLISION_NO_PROXY          -1
+#define COLLISION_PROXIES_INITIAL   64
+#define COLLISION_PAIRS_INITIAL     64
+
+
+namespace
+{
+    // Box sides
+    enum
+    {
+        BOX_LEFT,
+        BOX_TOP,
+        BOX_RIGHT,
+        BOX_BOTTOM,
+    };
+
+
+    // Pair events
+    enum
+    {
+        EVENT_ENTER,
+        EVENT_LINGER,
+        EVENT_EXIT,
+    };
+
+
+    /// -----------------------------------------------------------------------
+    /// Converts a box to tree units.
+    /// -----------------------------------------------------------------------
+    inline b2AABB TreeBox(const f32 *pBox, f32 scale)
+    {
+        b2AABB aabb;
+        aabb.lowerBound.Set(pBox[BOX_LEFT]  * scale, pBox[BOX_TOP]    * scale);
+        aabb.upperBound.Set(pBox[BOX_RIGHT] * scale, pBox[BOX_BOTTOM] * scale);
+        return aabb;
+    }
+
+
+    /// -----------------------------------------------------------------------
+    /// Tests if two boxes overlap. Touching boxes do not.
+    /// -----------------------------------------------------------------------
+    inline bool Overlap(const f32 *a, const f32 *b)
+    {
+        return a[BOX_LEFT] < b[BOX_RIGHT]  && b[BOX_LEFT] < a[BOX_RIGHT] &&
+               a[BOX_TOP]  < b[BOX_BOTTOM] && b[BOX_TOP]  < a[BOX_BOTTOM];
+    }
+
+
+    /// -----------------------------------------------------------------------
+    /// Clips a segment against a box, one axis at a time.
+    ///
+    /// Returns the fraction at which the segment enters the box, or a
+    /// negative value if it misses within the maximum fraction.
+    /// -----------------------------------------------------------------------
+    f32 Clip(const prCollisionSegment &segment, const f32 *pBox, f32 maxFraction)
+    {
+        f32 start[2] = { segment.x1, segment.y1 };
+        f32 delta[2] = { segment.x2 - segment.x1, segment.y2 - segment.y1 };
+        f32 tmin     = 0.0f;
+        f32 tmax     = maxFraction;
+
+        for (s32 axis = 0; axis < 2; axis++)
+        {
+            f32 lower = pBox[BOX_LEFT  + axis];
+            f32 upper = pBox[BOX_RIGHT + axis];
+
+            if (delta[axis] == 0.0f)
+            {
+                // Parallel. Either inside the slab for the whole segment, or never.
+                if (start[axis] < lower || start[axis] > upper)
+                {
+                    return -1.0f;
+                }
+            }
+            else
+            {
+                f32 inv = 1.0f / delta[axis];
+                f32 t0  = (lower - start[axis]) * inv;
+                f32 t1  = (upper - start[axis]) * inv;
+                if (t0 > t1)
+                {
+                    std::swap(t0, t1);
+                }
+
+                tmin = PRMAX(tmin, t0);
+                tmax = PRMIN(tmax, t1);
+                if (tmin > tmax)
+                {
+                    return -1.0f;
+                }
+            }
+        }
+
+        return tmin;
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Collects the pairs for one proxy.
+/// ---------------------------------------------------------------------------
+struct prCollisionManager::PairQuery
+{
+    prCollisionManager *pManager;
+    u32                 slot;
+
+    bool QueryCallback(s32 proxyId)
+    {
+        u32 other = (u32)(uintptr_t)pManager->m_tree->GetUserData(proxyId);
+
+        // Each pair is found from both sides, so keep the lower slot's.
+        if (other > slot)
+        {
+            const Proxy &a = pManager->m_proxies[slot];
+            const Proxy &b = pManager->m_proxies[other];
+
+            if (Overlap(a.box, b.box))
+            {
+                pManager->AddPair(a.handle, b.handle);
+            }
+        }
+
+        return true;
+    }
+};
+
+
+/// ---------------------------------------------------------------------------
+/// Finds the nearest proxy hit by a segment.
+/// ---------------------------------------------------------------------------
+struct prCollisionManager::LineCast
+{
+    const prCollisionManager   *pManager;
+    const prCollisionSegment   *pSegment;
+    u32                         slot;
+    f32                         fraction;
+
+    f32 RayCastCallback(const b2RayCastInput &input, s32 proxyId)
+    {
+        u32 other = (u32)(uintptr_t)pManager->m_tree->GetUserData(proxyId);
+        f32 t     = Clip(*pSegment, pManager->m_proxies[other].box, input.maxFraction);
+
+        // Ignore misses. Hits clip the rest of the cast.
+        if (t < 0.0f)
+        {
+            return -1.0f;
+        }
+
+        slot     = other;
+        fraction = t;
+        return t;
+    }
+};
+
+
+/// ---------------------------------------------------------------------------
+/// Ctor
+/// ---------------------------------------------------------------------------
+prCollisionManager::prCollisionManager(f32 scale)
+    : m_tree          (new b2DynamicTree())
+    , m_proxies       (nullptr)
+    , m_proxyCapacity (0)
+    , m_tracked       (nullptr)
+    , m_proxyCount    (0)
+    , m_pairs         (nullptr)
+    , m_pairCount     (0)
+    , m_oldPairs      (nullptr)
+    , m_oldPairCount  (0)
+    , m_pairCapacity  (0)
+    , m_frame         (0)
+    , m_scale         (scale)
+{
+    PRASSERT(scale > 0.0f);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Dtor
+/// ---------------------------------------------------------------------------
+prCollisionManager::~prCollisionManager()
+{
+    PRSAFE_DELETE(m_tree);
+    PRSAFE_DELETE_ARRAY(m_proxies);
+    PRSAFE_DELETE_ARRAY(m_tracked);
+    PRSAFE_DELETE_ARRAY(m_pairs);
+    PRSAFE_DELETE_ARRAY(m_oldPairs);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Refits the actors and dispatches their collision events.
+/// ---------------------------------------------------------------------------
+void prCollisionManager::Update(prActorManager &actors)
+{
+    m_frame++;
+
+    // Refit the proxies.
+    for (s32 type = 0; type < actors.GetTypeCount(); type++)
+    {
+        prActor *const *list  = actors.GetActors(type);
+        u32             count = actors.HowMany(type);
+
+        for (u32 i = 0; i < count; i++)
+        {
+            prActor *actor = list[i];
+
+            f32 box[4];
+            if (!GetBox(actor, box))
+            {
+                continue;
+            }
+
+            prActorHandle handle = actor->GetHandle();
+            u32           slot   = handle & PRACTOR_HANDLE_INDEX_MASK;
+
+            if (slot >= m_proxyCapacity)
+            {
+                u32    capacity = PRMAX(m_proxyCapacity * 2, COLLISION_PROXIES_INITIAL);
+                capacity        = PRMAX(capacity, slot + 1);
+                Proxy *proxies  = new Proxy[capacity];
+                u32   *tracked  = new u32[capacity];
+
+                if (m_proxies)
+                {
+                    memcpy(proxies, m_proxies, m_proxyCapacity * sizeof(Proxy));
+                    memcpy(tracked, m_tracked, m_proxyCount * sizeof(u32));
+                    PRSAFE_DELETE_ARRAY(m_proxies);
+                    PRSAFE_DELETE_ARRAY(m_tracked);
+                }
+
+                for (u32 index = m_proxyCapacity; index < capacity; index++)
+                {
+                    proxies[index].proxyId = COLLISION_NO_PROXY;
+                }
+
+                m_proxies       = proxies;
+                m_tracked       = tracked;
+                m_proxyCapacity = capacity;
+            }
+
+            Proxy &proxy = m_proxies[slot];
+
+            // The slot has been reused by a new actor.
+            if (proxy.proxyId != COLLISION_NO_PROXY && proxy.handle != handle)
+            {
+                Remove(proxy.tracked);
+            }
+
+            b2AABB aabb = TreeBox(box, m_scale);
+            if (proxy.proxyId == COLLISION_NO_PROXY)
+            {
+                proxy.proxyId = m_tree->CreateProxy(aabb, (void *)(uintptr_t)slot);
+                proxy.handle  = handle;
+                proxy.tracked = m_proxyCount;
+                m_tracked[m_proxyCount++] = slot;
+            }
+            else
+            {
+                b2AABB previous = TreeBox(proxy.box, m_scale);
+                m_tree->MoveProxy(proxy.proxyId, aabb, aabb.GetCenter() - previous.GetCenter());
+            }
+
+            proxy.frame = m_frame;
+            memcpy(proxy.box, box, sizeof(box));
+        }
+    }
+
+    // Remove actors which were destroyed or no longer collide.
+    for (u32 i = 0; i < m_proxyCount;)
+    {
+        if (m_proxies[m_tracked[i]].frame != m_frame)
+        {
+            Remove(i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    // Find the pairs.
+    std::swap(m_pairs, m_oldPairs);
+    m_oldPairCount = m_pairCount;
+    m_pairCount    = 0;
+
+    PairQuery query;
+    query.pManager = this;
+
+    for (u32 i = 0; i < m_proxyCount; i++)
+    {
+        query.slot = m_tracked[i];
+        m_tree->Query(&query, TreeBox(m_proxies[query.slot].box, m_scale));
+    }
+
+    // Sorted pairs make the events repeatable and are easily compared.
+    std::sort(m_pairs, m_pairs + m_pairCount);
+
+    Dispatch(actors);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Finds the nearest actor hit by each of a batch of segments.
+/// ---------------------------------------------------------------------------
+u32 prCollisionManager::LineQuery(prActorManager &actors, const prCollisionSegment *pSegments, u32 count, prCollisionHit *pHits, bool notify)
+{
+    PRASSERT(pSegments);
+    PRASSERT(pHits);
+
+    u32 hits = 0;
+
+    for (u32 i = 0; i < count; i++)
+    {
+        const prCollisionSegment &segment = pSegments[i];
+        prCollisionHit           &hit     = pHits[i];
+
+        hit.actor    = nullptr;
+        hit.point.x  = segment.x2;
+        hit.point.y  = segment.y2;
+        hit.fraction = 1.0f;
+
+        // The tree cannot cast a zero length segment.
+        if (segment.x1 == segment.x2 && segment.y1 == segment.y2)
+        {
+            continue;
+        }
+
+        LineCast cast;
+        cast.pManager = this;
+        cast.pSegment = &segment;
+        cast.slot     = m_proxyCapacity;
+        cast.fraction = 1.0f;
+
+        b2RayCastInput input;
+        input.p1.Set(segment.x1 * m_scale, segment.y1 * m_scale);
+        input.p2.Set(segment.x2 * m_scale, segment.y2 * m_scale);
+        input.maxFraction = 1.0f;
+        m_tree->RayCast(&cast, input);
+
+        if (cast.slot < m_proxyCapacity)
+        {
+            hit.fraction = cast.fraction;
+            hit.point.x  = segment.x1 + (segment.x2 - segment.x1) * cast.fraction;
+            hit.point.y  = segment.y1 + (segment.y2 - segment.y1) * cast.fraction;
+
+            // The proxy holds a handle, so the actor may have gone since the last update.
+            prActor *actor = actors.Get(m_proxies[cast.slot].handle);
+            if (actor)
+            {
+                hit.actor = actor;
+                hits++;
+
+                if (notify)
+                {
+                    actor->OnLineIntersect2D(hit.point);
+                }
+            }
+        }
+    }
+
+    return hits;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Removes all the proxies and pairs without sending events.
+/// ---------------------------------------------------------------------------
+void prCollisionManager::Clear()
+{
+    while (m_proxyCount > 0)
+    {
+        Remove(m_proxyCount - 1);
+    }
+
+    m_pairCount    = 0;
+    m_oldPairCount = 0;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Makes an actors box. Returns false if the actor does not collide.
+/// ---------------------------------------------------------------------------
+bool prCollisionManager::GetBox(prActor *actor, f32 *pBox)
+{
+    if (!actor->IsActive() || actor->IsDestroyed())
+    {
+        return false;
+    }
+
+    f32 width  = (f32)actor->GetActorWidth();
+    f32 height = (f32)actor->GetActorHeight();
+    if (width <= 0.0f || height <= 0.0f)
+    {
+        return false;
+    }
+
+    // Let the actor position its box, otherwise centre it.
+    actor->SetCollisionPosition2D();
+
+    const prVector2 &corner = actor->GetCollisionPosition2D();
+    if (corner.x == -1.0f && corner.y == -1.0f)
+    {
+        pBox[BOX_LEFT] = actor->transform.position.x - width  * 0.5f;
+        pBox[BOX_TOP]  = actor->transform.position.y - height * 0.5f;
+    }
+    else
+    {
+        pBox[BOX_LEFT] = corner.x;
+        pBox[BOX_TOP]  = corner.y;
+    }
+
+    pBox[BOX_RIGHT]  = pBox[BOX_LEFT] + width;
+    pBox[BOX_BOTTOM] = pBox[BOX_TOP]  + height;
+    return true;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Removes a tracked actor.
+/// ---------------------------------------------------------------------------
+void prCollisionManager::Remove(u32 index)
+{
+    PRASSERT(index < m_proxyCount);
+
+    Proxy &proxy = m_proxies[m_tracked[index]];
+    m_tree->DestroyProxy(proxy.proxyId);
+    proxy.proxyId = COLLISION_NO_PROXY;
+
+    // Fill the gap with the last tracked actor.
+    u32 last = m_tracked[--m_proxyCount];
+    if (index < m_proxyCount)
+    {
+        m_tracked[index]        = last;
+        m_proxies[last].tracked = index;
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Adds a pair found by the query.
+/// ---------------------------------------------------------------------------
+void prCollisionManager::AddPair(prActorHandle a, prActorHandle b)
+{
+    if (m_pairCount == m_pairCapacity)
+    {
+        u32  capacity = PRMAX(m_pairCapacity * 2, COLLISION_PAIRS_INITIAL);
+        u64 *pairs    = new u64[capacity];
+        u64 *oldPairs = new u64[capacity];
+
+        if (m_pairs)
+        {
+            memcpy(pairs,    m_pairs,    m_pairCount    * sizeof(u64));
+            memcpy(oldPairs, m_oldPairs, m_oldPairCount * sizeof(u64));
+            PRSAFE_DELETE_ARRAY(m_pairs);
+            PRSAFE_DELETE_ARRAY(m_oldPairs);
+        }
+
+        m_pairs        = pairs;
+        m_oldPairs     = oldPairs;
+        m_pairCapacity = capacity;
+    }
+
+    m_pairs[m_pairCount++] = ((u64)PRMIN(a, b) << 32) | PRMAX(a, b);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Sends the events for the new and old pairs.
+/// ---------------------------------------------------------------------------
+void prCollisionManager::Dispatch(prActorManager &actors)
+{
+    u32 o = 0;
+    u32 n = 0;
+
+    while (o < m_oldPairCount || n < m_pairCount)
+    {
+        u64 pair;
+        s32 event;
+
+        if (n == m_pairCount || (o < m_oldPairCount && m_oldPairs[o] < m_pairs[n]))
+        {
+            pair  = m_oldPairs[o++];
+            event = EVENT_EXIT;
+        }
+        else if (o == m_oldPairCount || m_pairs[n] < m_oldPairs[o])
+        {
+            pair  = m_pairs[n++];
+            event = EVENT_ENTER;
+        }
+        else
+        {
+            pair  = m_pairs[n++];
+            event = EVENT_LINGER;
+            o++;
+        }
+
+        // Exits may refer to actors destroyed since the previous update.
+        prActor *a = actors.Get((prActorHandle)(pair >> 32));
+        prActor *b = actors.Get((prActorHandle)(pair & 0xFFFFFFFF));
+        if (a == nullptr || b == nullptr)
+        {
+            continue;
+        }
+
+        switch (event)
+        {
+        case EVENT_ENTER:
+            a->OnCollisionEnter2D(b);
+            b->OnCollisionEnter2D(a);
+            break;
+
+        case EVENT_LINGER:
+            a->OnCollisionLinger2D(b);
+            b->OnCollisionLinger2D(a);
+            break;
+
+        default:
+            a->OnCollisionExit2D(b);
+            b->OnCollisionExit2D(a);
+            break;
+        }
+    }
+}
@@ -0,0 +1,182 @@
+// File: prCollisionManager.h
+//      A 2D broadphase for actor collisions and line queries.
+//
+// Notes:
+//      Each collidable actor owns a proxy in a dynamic AABB tree, which is
+//      refitted from the actors transform and size every update. Overlapping
+//      pairs are found by querying the tree rather than testing every actor
+//      against every other, then compared with the previous update's pairs
+//      to produce enter, linger and exit events.
+/**
+ * Copyright 2014 Paul Michael McNab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+
+#include "../core/prTypes.h"
+#include "../math/prPoint.h"
+#include "../actor/prActor.h"
+
+
+// Forward declarations
+class b2DynamicTree;
+namespace Proteus {
+namespace Actor {
+    class prActorManager;
+}}
+
+
+// Struct: prCollisionSegment
+//      A line segment used by <prCollisionManager::LineQuery>.
+typedef struct prCollisionSegment
+{
+    f32     x1, y1;                                 // Start
+    f32     x2, y2;                                 // End
+
+} prCollisionSegment;
+
+
+// Struct: prCollisionHit
+//      The nearest actor hit by a line segment.
+typedef struct prCollisionHit
+{
+    Proteus::Actor::prActor    *actor;              // The actor, or nullptr if nothing was hit
+    Proteus::Math::prPoint2F    point;              // Where the segment enters the actor
+    f32                         fraction;           // Distance along the segment, from zero at the start to one at the end
+
+} prCollisionHit;
+
+
+// Class: prCollisionManager
+//      Dispatches actor collision events and answers line queries.
+//
+// Notes:
+//      An actor collides when it is active, is not flagged for destruction,
+//      and has a non zero <prActor::GetActorWidth> and <prActor::GetActorHeight>.
+//      Its box is centred on the transform position, unless
+//      <prActor::SetCollisionPosition2D> sets the top left corner.
+//
+//      Events are not reported for an actor which has been destroyed.
+class prCollisionManager
+{
+public:
+    // Method: prCollisionManager
+    //      Ctor
+    //
+    // Parameters:
+    //      scale - Converts actor units to tree units
+    //
+    // Notes:
+    //      The tree pads each box by a tenth of a tree unit, so actors
+    //      which move less than that are not reinserted. The default
+    //      suits actors measured in pixels.
+    explicit prCollisionManager(f32 scale = 1.0f / 32.0f);
+
+    // Method: ~prCollisionManager
+    //      Dtor
+    ~prCollisionManager();
+
+    // Method: Update
+    //      Refits the actors and dispatches their collision events.
+    //
+    // Parameters:
+    //      actors - The actors
+    //
+    // Notes:
+    //      Call after the actors have moved. Events are sent to both
+    //      actors of each pair, in a consistent order from run to run.
+    void Update(Proteus::Actor::prActorManager &actors);
+
+    // Method: LineQuery
+    //      Finds the nearest actor hit by each of a batch of segments.
+    //
+    // Parameters:
+    //      actors    - The actors passed to <Update>
+    //      pSegments - The segments
+    //      count     - The number of segments
+    //      pHits     - Receives one hit per segment
+    //      notify    - Calls <prActor::OnLineIntersect2D> on each actor hit
+    //
+    // Returns:
+    //      The number of segments which hit an actor
+    //
+    // Notes:
+    //      Queries the actors as of the last <Update>.
+    u32 LineQuery(Proteus::Actor::prActorManager &actors, const prCollisionSegment *pSegments, u32 count, prCollisionHit *pHits, bool notify = true);
+
+    // Method: Clear
+    //      Removes all the proxies and pairs without sending events.
+    void Clear();
+
+    // Method: GetProxyCount
+    //      Returns the number of collidable actors.
+    u32 GetProxyCount() const { return m_proxyCount; }
+
+    // Method: GetPairCount
+    //      Returns the number of overlapping pairs found by the last <Update>.
+    u32 GetPairCount() const { return m_pairCount; }
+
+
+private:
+    // Called by the tree queries.
+    struct PairQuery;
+    struct LineCast;
+
+    // Makes an actors box. Returns false if the actor does not collide.
+    static bool GetBox(Proteus::Actor::prActor *actor, f32 *pBox);
+
+    // Removes a tracked actor.
+    void Remove(u32 index);
+
+    // Adds a pair found by the query.
+    void AddPair(Proteus::Actor::prActorHandle a, Proteus::Actor::prActorHandle b);
+
+    // Sends the events for the new and old pairs.
+    void Dispatch(Proteus::Actor::prActorManager &actors);
+
+    // Stops passing by value and assignment.
+    prCollisionManager(const prCollisionManager&);
+    const prCollisionManager& operator = (const prCollisionManager&);
+
+
+private:
+    // A collidable actor.
+    typedef struct Proxy
+    {
+        Proteus::Actor::prActorHandle   handle;
+        s32                             proxyId;    // The tree proxy, or -1 if unused
+        u32                             tracked;    // Index into the tracked list
+        u32                             frame;      // The last update which saw the actor
+        f32                             box[4];     // Tight box. Left, top, right, bottom
+
+    } Proxy;
+
+
+private:
+    b2DynamicTree      *m_tree;
+    Proxy              *m_proxies;                  // Indexed by actor handle slot
+    u32                 m_proxyCapacity;
+    u32                *m_tracked;                  // Slots with proxies
+    u32                 m_proxyCount;
+    u64                *m_pairs;                    // Sorted pairs of this update
+    u32                 m_pairCount;
+    u64                *m_oldPairs;                 // Sorted pairs of the previous update
+    u32                 m_oldPairCount;
+    u32                 m_pairCapacity;
+    u32                 m_frame;
+    f32                 m_scale;
+};
@@ -19,6 +19,8 @@
 
 #include "prApplication.h"
 #include "prDefines.h"
+#include "prGameTime.h"
+#include "prMacros.h"
 #include "../debug/prTrace.h"
 
 
@@ -32,8 +34,18 @@ namespace Core {
 /// ---------------------------------------------------------------------------
 prApplication::prApplication() : m_running(PRFALSE)
                                , m_pWindow(nullptr)
+                               , m_pGameTime(new prGameTime())
 {
 }
 
 
+/// ---------------------------------------------------------------------------
+/// Dtor
+/// ---------------------------------------------------------------------------
+prApplication::~prApplication()
+{
+    PRSAFE_DELETE(m_pGameTime);
+}
+
+
 }}// Namespaces
@@ -25,6 +25,7 @@
 
 // Forward declarations
 class prWindow;
+class prGameTime;
 
 
 // Namespaces
@@ -54,7 +55,7 @@ public:
 
     // Method: ~prApplication
     //      Dtor    
-    virtual ~prApplication() {}
+    virtual ~prApplication();
 
     // Method: DisplayCreate
     //      Creates the application display.
@@ -81,10 +82,18 @@ public:
     //
     // Parameters:
     //      dt - Delta time
+    //
+    // Notes:
+    //      Called at a fixed rate, so dt is always the game time's fixed step.
+    //      A frame may call it several times or not at all.
     virtual void Update(f32 dt) = 0;
 
     // Method: Draw
     //      Draws the application.
+    //
+    // Notes:
+    //      Called once per frame. The game time's <prGameTime::GetAlpha> gives
+    //      the time since the last update, for interpolation.
     virtual void Draw() = 0;
 
     // Method: Run
@@ -137,6 +146,13 @@ public:
     //      PRFALSE if the game is NOT running.
     PRBOOL GetIsRunning() const { return m_running; }
 
+    // Method: GetGameTime
+    //      Gets the game time, which controls the update rate.
+    //
+    // Notes:
+    //      Set the fixed update step and frame rate through this.
+    prGameTime *GetGameTime() const { return m_pGameTime; }
+
     // Method: BackKeyPressed
     //      Lets the application know the back key was pressed.
     //
@@ -155,6 +171,7 @@ public:
 protected:    
     prWindow   *m_pWindow;              // The applications window
     PRBOOL      m_running;              // Whether the app is running or not
+    prGameTime *m_pGameTime;            // Times the frames and fixed updates
 };
 
 
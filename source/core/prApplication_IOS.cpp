@@ -29,6 +29,7 @@
 #include "prRegistry.h"
 #include "prVersion.h"
 #include "prMacros.h"
+#include "prGameTime.h"
 #include "../debug/prDebug.h"
 #include "../debug/prTrace.h"
 #include "../debug/prOnScreenLogger.h"
@@ -37,6 +38,8 @@
 #include "../display/prRenderer.h"
 #include "../core/prStringUtil.h"
 #include "../audio/prSoundManager.h"
+#include "../core/prResourceManager.h"
+#include "../core/prMessageManager.h"
 #include "../prVerNum.h"
 
 
@@ -183,34 +186,39 @@ PRBOOL prApplication_Ios::Run()
           //prMouse         *pMouse = static_cast<prMouse *>       (prCoreGetComponent(PRSYSTEM_MOUSE));
           //prSoundManager  *pSound = static_cast<prSoundManager *>(prCoreGetComponent(PRSYSTEM_AUDIO));
           prTouch         *pTouch = static_cast<prTouch *>       (prCoreGetComponent(PRSYSTEM_TOUCH));
+          prResourceManager *pRM  = static_cast<prResourceManager *>(prCoreGetComponent(PRSYSTEM_RESOURCEMANAGER));
+          prMessageManager  *pMM  = static_cast<prMessageManager *> (prCoreGetComponent(PRSYSTEM_MESSAGEMANAGER));
 //          prFps           *pFps   = static_cast<prFps *>         (prCoreGetComponent(PRSYSTEM_FPS));
 
 
-//            GameTime::GetInstance()->Update();
+          m_pGameTime->Update();
           //static int c=0;
           //prTrace(LogError, "Update: %i\n", c++);
 
           // Update game
           if (m_pWindow && m_pWindow->GetActive())
           {
-//                float dt = GameTime::GetInstance()->ElapsedTime();
+              // Input is only read by the game update, so leave it for the
+              // next frame with an update, or presses would be missed.
+              bool update = (m_pGameTime->StepsDue() > 0);
 
               // System updates
               //if (pMouse) { pMouse->Update(); }
-              //if (pSound) { pSound->Update(16.0f); }
-              if (pTouch) { pTouch->Update(); }
+              //if (pSound) { pSound->Update(m_pGameTime->ElapsedTime()); }
+              if (pTouch && update) { pTouch->Update(); }
+              if (pRM)    { pRM->Update(); }
 //              if (pFps)   { pFps->Begin(); }
 
-              // Update and draw the game
-              Update(16.0f);// dt);
+              // Update the game at a fixed rate, and draw it once per frame
+              while (m_pGameTime->Step())
+              {
+                  Update(m_pGameTime->GetFixedStep());
+                  if (pMM) { pMM->Flush(); }
+              }
+
               Draw();
           }
 
-          // Needs modified to track game speed!
-//          Sleep(14);
-//          TODO("Needs modified to track game speed!")
-          //Sleep(1);
-
 //          if (pFps)   { pFps->End(); }
       }
 
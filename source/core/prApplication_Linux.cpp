@@ -29,6 +29,7 @@
 #include "prRegistry.h"
 #include "prVersion.h"
 #include "prMacros.h"
+#include "prGameTime.h"
 #include "../debug/prDebug.h"
 #include "../debug/prTrace.h"
 #include "../debug/prConsoleWindow.h"
@@ -41,6 +42,9 @@
 #include "../core/prStringUtil.h"
 #include "../linux/prLinux.h"
 #include "../audio/prSoundManager.h"
+#include "../core/prResourceManager.h"
+#include "../core/prMessageManager.h"
+#include "../debug/prProfiler.h"
 #include "../prVerNum.h"
 
 
@@ -68,6 +72,9 @@ namespace Core {
 /// ---------------------------------------------------------------------------
 prApplication_Linux::prApplication_Linux() : prApplication()
 {
+    // Pace the frames, as the display may not wait for vertical sync
+    m_pGameTime->SetFrameRate(60);
+
     // Write startup info.
     prRegistry *reg = static_cast<prRegistry *>(prCoreGetComponent(PRSYSTEM_REGISTRY));
     if (reg)
@@ -184,6 +191,8 @@ PRBOOL prApplication_Linux::DisplayCreate(u32 width, u32 height, const char *pWi
 /// ---------------------------------------------------------------------------
 PRBOOL prApplication_Linux::Run()
 {
+	PRPROFILE_THREAD_NAME("Main");
+
 	while (1)
 	{
 		prLinuxLoop();
@@ -194,25 +203,48 @@ PRBOOL prApplication_Linux::Run()
 		prTouch         *pTouch    = static_cast<prTouch *>       (prCoreGetComponent(PRSYSTEM_TOUCH));
 		prFps           *pFps      = static_cast<prFps *>         (prCoreGetComponent(PRSYSTEM_FPS));
 		prKeyboard      *pKeyboard = static_cast<prKeyboard *>    (prCoreGetComponent(PRSYSTEM_KEYBOARD));
+		prResourceManager *pRM     = static_cast<prResourceManager *>(prCoreGetComponent(PRSYSTEM_RESOURCEMANAGER));
+		prMessageManager  *pMM     = static_cast<prMessageManager *> (prCoreGetComponent(PRSYSTEM_MESSAGEMANAGER));
+
+		m_pGameTime->Update();
 
 		// Update game
-		if (m_pWindow && m_pWindow->GetActive())
+		bool active = (m_pWindow && m_pWindow->GetActive());
+		if (active)
 		{
+			// Input is only read by the game update, so leave it for the
+			// next frame with an update, or presses would be missed.
+			bool update = (m_pGameTime->StepsDue() > 0);
+
 			// System updates
-			if (pMouse)    { pMouse->Update(); }
-			if (pSound)    { pSound->Update(16.0f); }
-			if (pTouch)    { pTouch->Update(); }
-			if (pKeyboard) { pKeyboard->Update(); }
+			if (pMouse    && update) { pMouse->Update(); }
+			if (pSound)    { pSound->Update(m_pGameTime->ElapsedTime()); }
+			if (pTouch    && update) { pTouch->Update(); }
+			if (pKeyboard && update) { pKeyboard->Update(); }
+			if (pRM)       { pRM->Update(); }
 			if (pFps)      { pFps->Begin(); }
 
-			// Update and draw the game
-			Update(16.0f);
-			Draw();
+			// Update the game at a fixed rate, and draw it once per frame
+			while (m_pGameTime->Step())
+			{
+				PRPROFILE_ZONE("Update");
+				Update(m_pGameTime->GetFixedStep());
+				if (pMM) { pMM->Flush(); }
+
+				// Only the first step sees the presses, or they'd be acted on once per step.
+				if (pMouse)    { pMouse->ClearPresses(); }
+				if (pKeyboard) { pKeyboard->ClearPresses(); }
+			}
+			{
+				PRPROFILE_ZONE("Draw");
+				Draw();
+			}
 	    }
 
-	  //Sleep(1);
+	  // Wait for the next frame, if pacing.
+	  m_pGameTime->Pace();
 
-	  if (pFps)   { pFps->End(); }
+	  if (pFps && active) { pFps->End(); }
 	}
 
     return PRFALSE;
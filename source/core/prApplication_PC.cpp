@@ -40,6 +40,9 @@
 #include "../display/prRenderer.h"
 #include "../core/prStringUtil.h"
 #include "../audio/prSoundManager.h"
+#include "../core/prResourceManager.h"
+#include "../core/prMessageManager.h"
+#include "../debug/prProfiler.h"
 #include "../input/prTouch.h"
 #include "../prVerNum.h"
 #include "../lua/lua.h"
@@ -93,8 +96,8 @@ prApplication_PC::prApplication_PC() : prApplication()
 
     #endif
 
-    // Game timer
-    pGameTime  = new prGameTime();
+    // Pace the frames, as the display may not wait for vertical sync
+    m_pGameTime->SetFrameRate(60);
 
     // Init data
     m_hAccel   = nullptr;
@@ -173,7 +176,6 @@ prApplication_PC::~prApplication_PC()
 {
     PRSAFE_DELETE(m_pCW);
     PRSAFE_DELETE(m_pWindow);
-    PRSAFE_DELETE(pGameTime);
 }
 
 
@@ -365,6 +367,8 @@ PRBOOL prApplication_PC::DisplayCreateTool(u32 width, u32 height, u32 menuID, u3
 /// ---------------------------------------------------------------------------
 PRBOOL prApplication_PC::Run()
 {
+    PRPROFILE_THREAD_NAME("Main");
+
     // Game loop
     MSG msg;
     while(m_running)
@@ -413,46 +417,64 @@ PRBOOL prApplication_PC::Run()
             prTouch         *pTouch = static_cast<prTouch *>       (prCoreGetComponent(PRSYSTEM_TOUCH));
             prKeyboard      *pKeyb  = static_cast<prKeyboard *>    (prCoreGetComponent(PRSYSTEM_KEYBOARD));
             prFps           *pFps   = static_cast<prFps *>         (prCoreGetComponent(PRSYSTEM_FPS));
+            prResourceManager *pRM  = static_cast<prResourceManager *>(prCoreGetComponent(PRSYSTEM_RESOURCEMANAGER));
+            prMessageManager  *pMM  = static_cast<prMessageManager *> (prCoreGetComponent(PRSYSTEM_MESSAGEMANAGER));
 
-            if (pGameTime)
+            if (m_pGameTime)
             {
-                pGameTime->Update();
+                m_pGameTime->Update();
 
                 // Update game
-                if (m_pWindow && m_pWindow->GetActive())
+                bool active = (m_pWindow && m_pWindow->GetActive());
+                if (active)
                 {
-                    float dt = pGameTime->ElapsedTime();
+                    // Input is only read by the game update, so leave it for the
+                    // next frame with an update, or presses would be missed.
+                    bool update = (m_pGameTime->StepsDue() > 0);
 
                     // System updates
-                    if (pMouse) { pMouse->Update(); }
-                    if (pSound) { pSound->Update(dt); }
-                    if (pTouch) { pTouch->Update(); }
+                    if (pMouse && update) { pMouse->Update(); }
+                    if (pSound) { pSound->Update(m_pGameTime->ElapsedTime()); }
+                    if (pTouch && update) { pTouch->Update(); }
+                    if (pRM)    { pRM->Update(); }
                     if (pFps)   { pFps->Begin(); }
 
-                    // Update and draw the game
-                    Update(dt);
-                    Draw();
+                    // First check for keyboard back. Most PC games will ignore this as its really
+                    // just here so we can test the functionality on the PC debug versions
+                    // of any game
+                    if (pKeyb && update && pKeyb->IsKeyPressed(VK_BACK))
+                    {
+                        BackKeyPressed();
+                    }
+
+                    // Update the game at a fixed rate, and draw it once per frame
+                    while (m_pGameTime->Step())
+                    {
+                        PRPROFILE_ZONE("Update");
+                        Update(m_pGameTime->GetFixedStep());
+                        if (pMM) { pMM->Flush(); }
 
-                    // Clears keyboard, so do after game update.
-                    if (pKeyb)
+                        // Only the first step sees the presses, or they'd be acted on once per step.
+                        if (pMouse) { pMouse->ClearPresses(); }
+                        if (pKeyb)  { pKeyb->ClearPresses(); }
+                    }
                     {
-                        // First check for keyboard back. Most PC games will ignore this as its really
-                        // just here so we can test the functionality on the PC debug versions
-                        // of any game
-                        if (pKeyb->IsKeyPressed(VK_BACK))
-                        {
-                            BackKeyPressed();
-                        }
+                        PRPROFILE_ZONE("Draw");
+                        Draw();
+                    }
 
+                    // Clears keyboard, so do after game update.
+                    if (pKeyb && update)
+                    {
                         pKeyb->Update();
                     }
                 }
-            }
 
-            // Needs modified to track game speed!
-            Sleep(1);
+                // Wait for the next frame, if pacing.
+                m_pGameTime->Pace();
 
-            if (pFps) { pFps->End(); }
+                if (pFps && active) { pFps->End(); }
+            }
         }
     }
 
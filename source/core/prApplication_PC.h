@@ -36,7 +36,6 @@
 
 // Forward declarations
 class prConsoleWindow;
-class prGameTime;
 
 
 // Namespaces
@@ -151,7 +150,6 @@ private:
 
 
 private:
-    prGameTime         *pGameTime;
     prConsoleWindow    *m_pCW;
     HACCEL              m_hAccel;
 };
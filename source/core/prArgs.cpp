@@ -29,6 +29,7 @@
 #include "../debug/prTrace.h"
 #include "../debug/prAssert.h"
 #include "../debug/prAlert.h"
+#include "../file/prAssetCooker.h"
 
 
 //using namespace Proteus::Core;
@@ -136,6 +137,7 @@ bool prArgsParseCommandLine(LPTSTR lpCmdLine)
                                 reg->SetValue("LogToFile", "true");
                                 prTraceEnable(true);
                                 prTraceRemoveDuplicates(true);
+                                prTraceLogToFile(true);
                             }
                             // Log level
                             else if (_tcsicmp(L"-prloglev", pArgv[paramIndex]) == 0)
@@ -168,6 +170,28 @@ bool prArgsParseCommandLine(LPTSTR lpCmdLine)
                                     }
                                 }
                             }
+                            // Cook an xml data file?
+                            else if (_tcsicmp(L"-prcook", pArgv[paramIndex]) == 0)
+                            {
+                                // Needs two args
+                                if (prArgsGetRemainingArgCount() >= 2)
+                                {
+                                    char source[256];
+                                    char destination[256];
+                                    prArgsPopNextArg(source, sizeof(source));
+                                    prArgsPopNextArg(destination, sizeof(destination));
+
+                                    if (!prCookAsset(source, destination))
+                                    {
+                                        parseFailed = true;
+                                    }
+                                }
+                                else
+                                {
+                                    prTrace(prLogLevel::LogError, "-prcook needs a source and a destination file\n");
+                                    parseFailed = true;
+                                }
+                            }
                             // Show help?
                             else if (_tcsicmp(L"-prhelp", pArgv[paramIndex]) == 0)
                             {
@@ -347,6 +371,8 @@ void prArgsShowHelp()
                                 "\t\t    info = Information or above\r\n"
                                 "\t\t    warn = Warnings or above\r\n"
                                 "\t\t    error = Errors\r\n"
+                                "-prcook src dst\t- Cooks the xml data file src to dst\r\n"
+                                "\t\t    Parsing fails if it can't be cooked\r\n"
                                 "-prhelp\t\t- Displays the help text\r\n"
                                 "-prnoarc\t\t- Disables archives\r\n";
 
@@ -364,6 +390,8 @@ void prArgsShowHelp()
                                 "                  info  = Information or above\n"
                                 "                  warn  = Warnings or above\n"
                                 "                  error = Errors\n"
+                                "-prcook src dst - Cooks the xml data file src to dst\n"
+                                "                  Parsing fails if it can't be cooked\n"
                                 "-prhelp         - Displays the help text\n"
                                 "-prnoarc        - Disables archives\n";
 
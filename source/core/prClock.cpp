@@ -0,0 +1,96 @@
+/**
+ * prClock.cpp
+ *
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "../prConfig.h"
+
+
+#if defined(PLATFORM_PC)
+  #include <windows.h>
+
+#elif (defined(PLATFORM_IOS) || defined(PLATFORM_MAC))
+  #include <mach/mach_time.h>
+
+#elif (defined(PLATFORM_ANDROID) || defined(PLATFORM_LINUX))
+  #include <time.h>
+
+#else
+  #error No platform defined.
+
+#endif
+
+
+#include "prClock.h"
+
+
+/// ---------------------------------------------------------------------------
+/// Defines
+/// ---------------------------------------------------------------------------
+#define BILLION                     1000000000ULL
+
+
+/// ---------------------------------------------------------------------------
+/// Gets a high resolution time stamp in nanoseconds.
+/// ---------------------------------------------------------------------------
+u64 prClockNanoseconds()
+{
+#if defined(PLATFORM_PC)
+
+    static LARGE_INTEGER frequency = { 0 };
+    if (frequency.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+
+    LARGE_INTEGER timenow;
+    QueryPerformanceCounter(&timenow);
+
+    // Split to avoid overflowing the multiply.
+    u64 ticks   = (u64)timenow.QuadPart;
+    u64 freq    = (u64)frequency.QuadPart;
+    u64 seconds = ticks / freq;
+    u64 remain  = ticks % freq;
+    return (seconds * BILLION) + ((remain * BILLION) / freq);
+
+#elif (defined(PLATFORM_IOS) || defined(PLATFORM_MAC))
+
+    static mach_timebase_info_data_t info = { 0, 0 };
+    if (info.denom == 0)
+    {
+        mach_timebase_info(&info);
+    }
+
+    return (mach_absolute_time() * info.numer) / info.denom;
+
+#elif (defined(PLATFORM_ANDROID) || defined(PLATFORM_LINUX))
+
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return ((u64)time.tv_sec * BILLION) + (u64)time.tv_nsec;
+
+#endif
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Gets a high resolution time stamp in milliseconds.
+/// ---------------------------------------------------------------------------
+f64 prClockMilliseconds()
+{
+    return (f64)prClockNanoseconds() / 1000000.0;
+}
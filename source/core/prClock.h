@@ -0,0 +1,46 @@
+// File: prClock.h
+/**
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+
+#include "prTypes.h"
+
+
+// Function: prClockNanoseconds
+//      Gets a high resolution time stamp from a monotonic clock.
+//
+// Notes:
+//      The time stamp is only useful for measuring time periods, as
+//      the start point is undefined. The clock is wall time, not CPU time,
+//      and can be read from any thread.
+//
+// Returns:
+//      The time in nanoseconds
+u64 prClockNanoseconds();
+
+
+// Function: prClockMilliseconds
+//      Gets a high resolution time stamp from a monotonic clock.
+//
+// Notes:
+//      See <prClockNanoseconds>
+//
+// Returns:
+//      The time in milliseconds
+f64 prClockMilliseconds();
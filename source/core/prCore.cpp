@@ -49,6 +49,7 @@
 #include "../audio/prSoundManager_Linux.h"
 #include "../input/prTouch.h"
 #include "../input/prAccelerometer.h"
+#include "../thread/prJobSystem.h"
 
 
 #if defined(PLATFORM_PC)
@@ -85,6 +86,7 @@ namespace
     coreSystemNames[] = 
     {
         // Core systems
+        { PRSYSTEM_JOBSYSTEM,           "PRSYSTEM_JOBSYSTEM"            },
         { PRSYSTEM_RESOURCEMANAGER,     "PRSYSTEM_RESOURCEMANAGER"      },
         { PRSYSTEM_TOUCH,               "PRSYSTEM_TOUCH"                },
         { PRSYSTEM_MESSAGEMANAGER,      "PRSYSTEM_MESSAGEMANAGER"       },
@@ -160,6 +162,7 @@ void prCoreInit(const char *saveDataPath)
         memset(pSystems, 0, sizeof(prCoreSystem*) * PRSYSTEM_MAX);
 
         // Create the core systems
+        pSystems[PRSYSTEM_JOBSYSTEM]        = new prJobSystem();
         pSystems[PRSYSTEM_RESOURCEMANAGER]  = new prResourceManager();
         pSystems[PRSYSTEM_TOUCH]            = new prTouch();
         pSystems[PRSYSTEM_MESSAGEMANAGER]   = new prMessageManager();
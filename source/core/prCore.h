@@ -57,6 +57,7 @@ typedef enum
 // Enum: prSystems
 //      Contains core systems as well the optional systems
 //
+//  PRSYSTEM_JOBSYSTEM             - The job scheduler. (Core system)
 //  PRSYSTEM_RESOURCEMANAGER       - The resource handling system. (Core system)
 //  PRSYSTEM_RENDERER              - The rendering system. (Core system)
 //  PRSYSTEM_TOUCH                 - The touch system. (Core system)
@@ -78,6 +79,7 @@ typedef enum
 enum prSystems
 {
     // Core systems
+    PRSYSTEM_JOBSYSTEM,                 // First, so it's destroyed after the systems that use it
     PRSYSTEM_RESOURCEMANAGER,  
     PRSYSTEM_TOUCH,            
     PRSYSTEM_MESSAGEMANAGER,   
@@ -120,6 +122,7 @@ enum prSystems
 //
 // Notes:
 //      These are;
+//      - The job system
 //      - The resource manager
 //      - Touch support
 //      - The message manager
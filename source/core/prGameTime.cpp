@@ -18,56 +18,44 @@
 
 
 #include "../prConfig.h"
-
-
-#if defined(PLATFORM_PC)
-
-
-#include <windows.h>
+#include <algorithm>
 #include "prGameTime.h"
-#include "../debug/prTrace.h"
-#include "../debug/prDebug.h"
+#include "prClock.h"
+#include "prMacros.h"
 #include "../debug/prAssert.h"
+#include "../thread/prThread.h"
 
 
-//using namespace Proteus::Core;
-
-
-//#define MILLISECONDS    1000.0f
-const float MILLISECONDS    = 1000.0f;
+// Defines
+#define NANOSECONDS_PER_MS      1000000ULL
+#define SLEEP_MARGIN            (2 * NANOSECONDS_PER_MS)    // Yield rather than sleep for waits shorter than this
 
 
 // Implementation data.
 typedef struct GameTimeImplementation
 {
     // Ctor
-    GameTimeImplementation() : timePrev    (0LL)
-                             , frequency   (0.0f)
-                             , runTime     (0.0f)
+    GameTimeImplementation() : timePrev    (prClockNanoseconds())
+                             , runTime     (0)
                              , elapsedTime (0.0f)
+                             , accumulator (0)
+                             , step        ((u64)(PRGAMETIME_DEFAULT_STEP * NANOSECONDS_PER_MS))
+                             , period      (0)
+                             , nextFrame   (0)
+                             , frames      (0)
     {
-        LARGE_INTEGER countsPerSecond;
-
-        if (QueryPerformanceFrequency(&countsPerSecond))
-        {
-            u64 ticksPerSecond = countsPerSecond.QuadPart;
-
-            frequency = (float)(ticksPerSecond / MILLISECONDS);
-
-            // Set base time.
-            LARGE_INTEGER timenow;
-            if (QueryPerformanceCounter(&timenow))
-            {
-                timePrev = timenow.QuadPart;
-            }
-        }
     }
 
     // Data
     u64     timePrev;
-    float   frequency;
-    float   runTime;
-    float   elapsedTime;
+    u64     runTime;                                    // Nanoseconds
+    f32     elapsedTime;                                // Milliseconds
+    u64     accumulator;                                // Nanoseconds not yet consumed by a fixed step
+    u64     step;                                       // Nanoseconds per fixed step
+    u64     period;                                     // Nanoseconds per paced frame. Zero if not pacing
+    u64     nextFrame;                                  // When the next paced frame is due
+    u32     frames;                                     // Frames measured, used to index the frame times
+    f32     frameTimes[PRGAMETIME_STATS_FRAMES];
 
 } GameTimeImplementation;
 
@@ -97,19 +85,23 @@ void prGameTime::Update()
 {
     PRASSERT(pImpl);
 
-    LARGE_INTEGER timenow;
-    if (QueryPerformanceCounter(&timenow))
-    {
-        u64 currTime = timenow.QuadPart;
+    u64 currTime = prClockNanoseconds();
+    u64 diff     = currTime - imp.timePrev;
 
-        float diff = (float)((currTime - imp.timePrev) / imp.frequency);
+    imp.timePrev    = currTime;
+    imp.elapsedTime = (f32)((f64)diff / NANOSECONDS_PER_MS);
+    imp.runTime    += diff;
 
-        imp.elapsedTime = diff;
-        imp.runTime    += diff;
+    // Record the real frame time.
+    imp.frameTimes[imp.frames % PRGAMETIME_STATS_FRAMES] = imp.elapsedTime;
+    imp.frames++;
 
-        imp.timePrev = currTime;
-        //prTrace(LogError, "%0.2f, %0.2f\n", imp.runTime, imp.elapsedTime);
-    }
+    // But clamp the simulated time, as the game can't catch up with long stalls.
+    // The unconsumed time is clamped too, as the loop stops stepping while
+    // the window is inactive, and would otherwise catch up when reactivated.
+    u64 maxFrame = PRMAX((u64)(PRGAMETIME_MAX_FRAME * NANOSECONDS_PER_MS), imp.step);
+
+    imp.accumulator = PRMIN(imp.accumulator + PRMIN(diff, maxFrame), maxFrame);
 }
 
 
@@ -119,7 +111,7 @@ void prGameTime::Update()
 f32 prGameTime::RunTime() const
 {
     PRASSERT(pImpl);
-    return imp.runTime;
+    return (f32)((f64)imp.runTime / NANOSECONDS_PER_MS);
 }
 
 
@@ -129,9 +121,158 @@ f32 prGameTime::RunTime() const
 f32 prGameTime::ElapsedTime() const
 {
     PRASSERT(pImpl);
-    //prTrace(LogError, "%0.2f\n", imp.elapsedTime);
     return imp.elapsedTime;
 }
 
 
-#endif
+/// ---------------------------------------------------------------------------
+/// Consumes one fixed step from the accumulated frame time.
+/// ---------------------------------------------------------------------------
+bool prGameTime::Step()
+{
+    PRASSERT(pImpl);
+
+    if (imp.accumulator >= imp.step)
+    {
+        imp.accumulator -= imp.step;
+        return true;
+    }
+
+    return false;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Gets the number of fixed steps Step will return this frame.
+/// ---------------------------------------------------------------------------
+u32 prGameTime::StepsDue() const
+{
+    PRASSERT(pImpl);
+    return (u32)(imp.accumulator / imp.step);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Gets how far the game is between the last fixed step and the next.
+/// ---------------------------------------------------------------------------
+f32 prGameTime::GetAlpha() const
+{
+    PRASSERT(pImpl);
+    return PRMIN((f32)((f64)imp.accumulator / imp.step), 1.0f);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Sets the time of each fixed step.
+/// ---------------------------------------------------------------------------
+void prGameTime::SetFixedStep(f32 milliseconds)
+{
+    PRASSERT(pImpl);
+    PRASSERT(milliseconds > 0.0f);
+
+    if (milliseconds > 0.0f)
+    {
+        imp.step = PRMAX((u64)(milliseconds * NANOSECONDS_PER_MS), 1ULL);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Gets the time of each fixed step in milliseconds.
+/// ---------------------------------------------------------------------------
+f32 prGameTime::GetFixedStep() const
+{
+    PRASSERT(pImpl);
+    return (f32)((f64)imp.step / NANOSECONDS_PER_MS);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Sets the frame rate Pace holds the game to.
+/// ---------------------------------------------------------------------------
+void prGameTime::SetFrameRate(u32 fps)
+{
+    PRASSERT(pImpl);
+
+    imp.period    = (fps > 0) ? (1000ULL * NANOSECONDS_PER_MS) / fps : 0;
+    imp.nextFrame = 0;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Waits until the next frame is due.
+/// ---------------------------------------------------------------------------
+void prGameTime::Pace()
+{
+    PRASSERT(pImpl);
+
+    if (imp.period == 0)
+    {
+        return;
+    }
+
+    u64 now = prClockNanoseconds();
+
+    // Start pacing from now if just enabled, or if the game has fallen
+    // more than a frame behind, rather than rushing frames to catch up.
+    if (imp.nextFrame == 0 || now > imp.nextFrame + imp.period)
+    {
+        imp.nextFrame = now;
+    }
+    else
+    {
+        while (now < imp.nextFrame)
+        {
+            u64 remaining = imp.nextFrame - now;
+
+            if (remaining > SLEEP_MARGIN)
+            {
+                prThreadSleep((u32)((remaining - SLEEP_MARGIN) / NANOSECONDS_PER_MS) + 1);
+            }
+            else
+            {
+                prThreadYield();
+            }
+
+            now = prClockNanoseconds();
+        }
+    }
+
+    imp.nextFrame += imp.period;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Gets the statistics of the most recent frame times.
+/// ---------------------------------------------------------------------------
+void prGameTime::GetFrameStats(prFrameStats &stats) const
+{
+    PRASSERT(pImpl);
+
+    u32 count = PRMIN(imp.frames, (u32)PRGAMETIME_STATS_FRAMES);
+
+    stats.frames  = count;
+    stats.minimum = 0.0f;
+    stats.average = 0.0f;
+    stats.p99     = 0.0f;
+    stats.maximum = 0.0f;
+
+    if (count > 0)
+    {
+        f32 sorted[PRGAMETIME_STATS_FRAMES];
+        f64 total = 0.0;
+
+        for (u32 i=0; i<count; i++)
+        {
+            sorted[i] = imp.frameTimes[i];
+            total    += imp.frameTimes[i];
+        }
+
+        std::sort(sorted, sorted + count);
+
+        stats.minimum = sorted[0];
+        stats.average = (f32)(total / count);
+        stats.p99     = sorted[((count * 99) + 99) / 100 - 1];
+        stats.maximum = sorted[count - 1];
+    }
+}
@@ -22,12 +22,50 @@
 #include "../core/prTypes.h"
 
 
+// Defines
+#define PRGAMETIME_DEFAULT_STEP     (1000.0f / 60.0f)   // Milliseconds per fixed update
+#define PRGAMETIME_MAX_FRAME        250.0f              // Longer frames and unconsumed time are clamped, so a stall can't cause a burst of updates
+#define PRGAMETIME_STATS_FRAMES     256                 // Frame times kept for the frame statistics
+
+
 // Forward declarations
 struct GameTimeImplementation;
 
 
+// Struct: prFrameStats
+//      Frame time statistics, in milliseconds.
+typedef struct prFrameStats
+{
+    f32     minimum;
+    f32     average;
+    f32     p99;                // 99th percentile. The frame time 99% of frames were at or under
+    f32     maximum;
+    u32     frames;             // The number of frames measured
+
+} prFrameStats;
+
+
 // Class: prGameTime
 //      Cross platform game timing.
+//
+// Notes:
+//      The time is taken from a monotonic high resolution clock. Each
+//      frame's time is added to an accumulator, which <Step> consumes in
+//      fixed steps, so the game updates at the same rate whatever the
+//      frame rate.
+//
+// Notes:
+//      A typical frame looks like this
+//
+// (start code)
+//      gameTime.Update();
+//      while (gameTime.Step())
+//      {
+//          Update(gameTime.GetFixedStep());
+//      }
+//      Draw();                                 // Interpolate by gameTime.GetAlpha()
+//      gameTime.Pace();
+// (end)
 class prGameTime
 {
 public:
@@ -40,7 +78,7 @@ public:
     ~prGameTime();
 
     // Method: Update
-    //      Update the game time
+    //      Update the game time. Call once per frame.
     void Update();
 
     // Method: RunTime
@@ -51,6 +89,64 @@ public:
     //      Gets the elapsed time bewteen 1 frame and the next.
     f32 ElapsedTime() const;
 
+    // Method: Step
+    //      Consumes one fixed step from the accumulated frame time.
+    //
+    // Returns:
+    //      true if a fixed update is due, false once the accumulated time is used up
+    bool Step();
+
+    // Method: StepsDue
+    //      Gets the number of fixed steps <Step> will return this frame.
+    u32 StepsDue() const;
+
+    // Method: GetAlpha
+    //      Gets how far the game is between the last fixed step and the next.
+    //
+    // Notes:
+    //      Ranges from 0 to 1. Drawing can blend the previous and current
+    //      update states by this amount to hide the fixed update rate.
+    f32 GetAlpha() const;
+
+    // Method: SetFixedStep
+    //      Sets the time of each fixed step.
+    //
+    // Parameters:
+    //      milliseconds - The step time. The default is <PRGAMETIME_DEFAULT_STEP>
+    void SetFixedStep(f32 milliseconds);
+
+    // Method: GetFixedStep
+    //      Gets the time of each fixed step in milliseconds.
+    f32 GetFixedStep() const;
+
+    // Method: SetFrameRate
+    //      Sets the frame rate <Pace> holds the game to.
+    //
+    // Parameters:
+    //      fps - The frames per second. Zero disables pacing, which is the default
+    //
+    // Notes:
+    //      Pacing isn't needed when the display waits for vertical sync.
+    void SetFrameRate(u32 fps);
+
+    // Method: Pace
+    //      Waits until the next frame is due. Call at the end of each frame.
+    //
+    // Notes:
+    //      Sleeps for most of the wait, then yields for the remainder, as
+    //      sleeps are not accurate enough on their own.
+    void Pace();
+
+    // Method: GetFrameStats
+    //      Gets the statistics of the most recent frame times.
+    //
+    // Parameters:
+    //      stats - Receives the statistics
+    //
+    // Notes:
+    //      Covers up to <PRGAMETIME_STATS_FRAMES> frames.
+    void GetFrameStats(prFrameStats &stats) const;
+
     
 private:
     // Stops passing by value and assignment.
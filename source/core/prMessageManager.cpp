@@ -18,14 +18,67 @@
 
 #include "prMessageManager.h"
 #include "prCore.h"
+#include "prMacros.h"
 #include "../debug/prAssert.h"
+#include <string.h>
+
+
+// Defines
+#define MESSAGE_EMPTY_BUCKET        0xFFFFFFFF
+#define MESSAGE_ALL_LIST            0
+#define MESSAGE_BUCKETS_INITIAL     64
+#define MESSAGE_LISTS_INITIAL       16
+#define MESSAGE_HANDLERS_INITIAL    4
+
+
+namespace
+{
+    /// -----------------------------------------------------------------------
+    /// Spreads message types, which are often small sequential values.
+    /// -----------------------------------------------------------------------
+    inline u32 HashType(u32 type)
+    {
+        return type * 0x9E3779B9u;
+    }
+}
 
 
 /// ---------------------------------------------------------------------------
 /// Ctor.
 /// ---------------------------------------------------------------------------
 prMessageManager::prMessageManager() : prCoreSystem(PRSYSTEM_MESSAGEMANAGER, "prMessageManager")
+                                     , m_enqueue(0)
+                                     , m_overflowing(false)
 {
+    m_lists         = new HandlerList[MESSAGE_LISTS_INITIAL];
+    m_listCount     = 1;
+    m_listCapacity  = MESSAGE_LISTS_INITIAL;
+    memset(m_lists, 0, MESSAGE_LISTS_INITIAL * sizeof(HandlerList));
+
+    m_buckets       = new Bucket[MESSAGE_BUCKETS_INITIAL];
+    m_bucketCount   = MESSAGE_BUCKETS_INITIAL;
+    memset(m_buckets, 0xFF, MESSAGE_BUCKETS_INITIAL * sizeof(Bucket));
+
+    m_sending       = 0;
+    m_removed       = false;
+    m_flushing      = false;
+
+    m_queue         = new prGameMessage[PRMESSAGE_QUEUE_SIZE];
+    m_queueHead     = 0;
+    m_queueTail     = 0;
+    m_queueCapacity = PRMESSAGE_QUEUE_SIZE;
+
+    // A cell is free for the producer whose position equals its sequence.
+    m_cells         = new Cell[PRMESSAGE_CONCURRENT_SIZE];
+    m_dequeue       = 0;
+    for (u32 i = 0; i < PRMESSAGE_CONCURRENT_SIZE; i++)
+    {
+        m_cells[i].sequence.store(i);
+    }
+
+    m_overflow          = nullptr;
+    m_overflowCount     = 0;
+    m_overflowCapacity  = 0;
 }
 
 
@@ -34,55 +87,444 @@ prMessageManager::prMessageManager() : prCoreSystem(PRSYSTEM_MESSAGEMANAGER, "pr
 /// ---------------------------------------------------------------------------
 prMessageManager::~prMessageManager()
 {
+    for (u32 i = 0; i < m_listCount; i++)
+    {
+        PRSAFE_DELETE_ARRAY(m_lists[i].handlers);
+    }
+
+    PRSAFE_DELETE_ARRAY(m_lists);
+    PRSAFE_DELETE_ARRAY(m_buckets);
+    PRSAFE_DELETE_ARRAY(m_queue);
+    PRSAFE_DELETE_ARRAY(m_cells);
+    PRSAFE_DELETE_ARRAY(m_overflow);
 }
 
 
 /// ---------------------------------------------------------------------------
-/// Registers a handler with the message manager.
+/// Registers a handler to receive every message.
 /// ---------------------------------------------------------------------------
 void prMessageManager::Register(prMessageHandler *handler)
 {
     PRASSERT(handler);
+    Add(MESSAGE_ALL_LIST, handler);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Unregisters a handler with the message manager.
+/// ---------------------------------------------------------------------------
+void prMessageManager::Unregister(prMessageHandler *handler)
+{
+    PRASSERT(handler);
+
+    for (u32 i = 0; i < m_listCount; i++)
+    {
+        Remove(i, handler);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Registers a handler to receive messages of one type.
+/// ---------------------------------------------------------------------------
+void prMessageManager::Subscribe(prMessageHandler *handler, u32 type)
+{
+    PRASSERT(handler);
+    Add(FindList(type, true), handler);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Stops a handler receiving messages of one type.
+/// ---------------------------------------------------------------------------
+void prMessageManager::Unsubscribe(prMessageHandler *handler, u32 type)
+{
+    PRASSERT(handler);
+
+    u32 list = FindList(type, false);
+    if (list != MESSAGE_EMPTY_BUCKET)
+    {
+        Remove(list, handler);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Instantly sends a message to the receivers.
+/// ---------------------------------------------------------------------------
+void prMessageManager::Send(prGameMessage &msg)
+{
+    m_sending++;
+
+    u32 list = FindList(msg.type, false);
+    if (list == MESSAGE_EMPTY_BUCKET || !Dispatch(list, msg))
+    {
+        Dispatch(MESSAGE_ALL_LIST, msg);
+    }
+
+    m_sending--;
+
+    if (m_sending == 0 && m_removed)
+    {
+        Compact();
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Queues a message to be sent by the next flush.
+/// ---------------------------------------------------------------------------
+void prMessageManager::Post(const prGameMessage &msg)
+{
+    // Grow, keeping each message at its counter position.
+    if (m_queueTail - m_queueHead == m_queueCapacity)
+    {
+        u32            capacity = m_queueCapacity * 2;
+        prGameMessage *queue    = new prGameMessage[capacity];
+
+        for (u32 i = m_queueHead; i != m_queueTail; i++)
+        {
+            queue[i & (capacity - 1)] = m_queue[i & (m_queueCapacity - 1)];
+        }
+
+        PRSAFE_DELETE_ARRAY(m_queue);
+        m_queue         = queue;
+        m_queueCapacity = capacity;
+    }
+
+    m_queue[m_queueTail & (m_queueCapacity - 1)] = msg;
+    m_queueTail++;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Queues a message to be sent by the next flush. Thread safe.
+/// ---------------------------------------------------------------------------
+void prMessageManager::PostConcurrent(const prGameMessage &msg)
+{
+    // Once a thread has overflowed, everyone uses the overflow list until
+    // the next flush, otherwise a later message could overtake it.
+    if (!m_overflowing.load() && Push(msg))
+    {
+        return;
+    }
+
+    m_overflowLock.Lock();
+
+    if (m_overflowCount == m_overflowCapacity)
+    {
+        u32            capacity = PRMAX(m_overflowCapacity * 2, (u32)PRMESSAGE_QUEUE_SIZE);
+        prGameMessage *overflow = new prGameMessage[capacity];
+
+        for (u32 i = 0; i < m_overflowCount; i++)
+        {
+            overflow[i] = m_overflow[i];
+        }
+
+        PRSAFE_DELETE_ARRAY(m_overflow);
+        m_overflow         = overflow;
+        m_overflowCapacity = capacity;
+    }
+
+    m_overflow[m_overflowCount++] = msg;
+    m_overflowing.store(true);
+
+    m_overflowLock.Unlock();
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Sends the posted messages.
+/// ---------------------------------------------------------------------------
+void prMessageManager::Flush()
+{
+    if (m_flushing)
+    {
+        return;
+    }
+
+    m_flushing = true;
+
+    // Gather the messages posted by other threads.
+    prGameMessage msg;
+    while (Pop(msg))
+    {
+        Post(msg);
+    }
+
+    // The overflow holds newer messages than the queue, so leave it if a
+    // thread is still writing a queued message.
+    if (m_overflowing.load() && m_dequeue == m_enqueue.load())
+    {
+        m_overflowLock.Lock();
+
+        for (u32 i = 0; i < m_overflowCount; i++)
+        {
+            Post(m_overflow[i]);
+        }
+
+        m_overflowCount = 0;
+        m_overflowing.store(false);
+
+        m_overflowLock.Unlock();
+    }
+
+    // Messages posted from here on wait for the next flush. Each message is
+    // copied out, as the queue may grow while it is being sent.
+    u32 end = m_queueTail;
+    while (m_queueHead != end)
+    {
+        msg = m_queue[m_queueHead & (m_queueCapacity - 1)];
+        m_queueHead++;
+        Send(msg);
+    }
+
+    m_flushing = false;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Finds the handler list for a type. Optionally adds one.
+/// ---------------------------------------------------------------------------
+u32 prMessageManager::FindList(u32 type, bool add)
+{
+    u32 mask  = m_bucketCount - 1;
+    u32 index = HashType(type) & mask;
+
+    while (m_buckets[index].list != MESSAGE_EMPTY_BUCKET)
+    {
+        if (m_buckets[index].type == type)
+        {
+            return m_buckets[index].list;
+        }
+
+        index = (index + 1) & mask;
+    }
+
+    if (!add)
+    {
+        return MESSAGE_EMPTY_BUCKET;
+    }
+
+    // Keep the load factor below 3/4, so probes stay short.
+    if ((m_listCount + 1) * 4 > m_bucketCount * 3)
+    {
+        Grow();
+        return FindList(type, add);
+    }
+
+    if (m_listCount == m_listCapacity)
+    {
+        HandlerList *lists = new HandlerList[m_listCapacity * 2];
+        memcpy(lists, m_lists, m_listCount * sizeof(HandlerList));
+        PRSAFE_DELETE_ARRAY(m_lists);
+        m_lists         = lists;
+        m_listCapacity *= 2;
+    }
+
+    u32 list = m_listCount++;
+    memset(&m_lists[list], 0, sizeof(HandlerList));
+
+    m_buckets[index].type = type;
+    m_buckets[index].list = list;
+    return list;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Doubles the hash table size.
+/// ---------------------------------------------------------------------------
+void prMessageManager::Grow()
+{
+    Bucket *buckets = m_buckets;
+    u32     count   = m_bucketCount;
+
+    m_bucketCount = count * 2;
+    m_buckets     = new Bucket[m_bucketCount];
+    memset(m_buckets, 0xFF, m_bucketCount * sizeof(Bucket));
+
+    u32 mask = m_bucketCount - 1;
+    for (u32 i = 0; i < count; i++)
+    {
+        if (buckets[i].list != MESSAGE_EMPTY_BUCKET)
+        {
+            u32 index = HashType(buckets[i].type) & mask;
+            while (m_buckets[index].list != MESSAGE_EMPTY_BUCKET)
+            {
+                index = (index + 1) & mask;
+            }
+
+            m_buckets[index] = buckets[i];
+        }
+    }
+
+    PRSAFE_DELETE_ARRAY(buckets);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Adds a handler to a list.
+/// ---------------------------------------------------------------------------
+void prMessageManager::Add(u32 list, prMessageHandler *handler)
+{
+    HandlerList &hl = m_lists[list];
 
     // Check for duplicate entry.
-    //std::list<prMessageHandler *>::iterator itr = m_handlers.begin();
-    //std::list<prMessageHandler *>::iterator end = m_handlers.end();
-    //for (; itr != end; ++itr)
-    for (auto it = m_handlers.begin(); it != m_handlers.end(); ++it)
+    for (u32 i = 0; i < hl.count; i++)
+    {
+        if (hl.handlers[i] == handler)
+        {
+            return;
+        }
+    }
+
+    if (hl.count == hl.capacity)
     {
-        if ((*it) == handler)
+        u32                capacity = PRMAX(hl.capacity * 2, (u32)MESSAGE_HANDLERS_INITIAL);
+        prMessageHandler **handlers = new prMessageHandler *[capacity];
+        if (hl.handlers)
         {
+            memcpy(handlers, hl.handlers, hl.count * sizeof(prMessageHandler *));
+            PRSAFE_DELETE_ARRAY(hl.handlers);
+        }
+
+        hl.handlers = handlers;
+        hl.capacity = capacity;
+    }
+
+    hl.handlers[hl.count++] = handler;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Removes a handler from a list.
+/// ---------------------------------------------------------------------------
+void prMessageManager::Remove(u32 list, prMessageHandler *handler)
+{
+    HandlerList &hl = m_lists[list];
+
+    for (u32 i = 0; i < hl.count; i++)
+    {
+        if (hl.handlers[i] == handler)
+        {
+            // Sending walks the lists by index, so leave a gap until it has finished.
+            if (m_sending > 0)
+            {
+                hl.handlers[i] = nullptr;
+                m_removed      = true;
+            }
+            else
+            {
+                memmove(&hl.handlers[i], &hl.handlers[i + 1], (hl.count - i - 1) * sizeof(prMessageHandler *));
+                hl.count--;
+            }
+
             return;
         }
     }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Sends a message to a list. Returns true if handled.
+/// ---------------------------------------------------------------------------
+bool prMessageManager::Dispatch(u32 list, prGameMessage &msg)
+{
+    // Handlers added while sending are appended, so stop at the current
+    // count. The lists may move, so index them afresh each time.
+    u32 count = m_lists[list].count;
+
+    for (u32 i = 0; i < count; i++)
+    {
+        prMessageHandler *handler = m_lists[list].handlers[i];
+        if (handler && handler->Receive(msg))
+        {
+            return true;
+        }
+    }
 
-    m_handlers.push_back(handler);
+    return false;
 }
 
 
 /// ---------------------------------------------------------------------------
-/// Unregisters a handler with the message manager.
+/// Removes the handlers removed while sending.
 /// ---------------------------------------------------------------------------
-void prMessageManager::Unregister(prMessageHandler *handler)
+void prMessageManager::Compact()
 {
-    PRASSERT(handler);
-    m_handlers.remove(handler);
+    for (u32 list = 0; list < m_listCount; list++)
+    {
+        HandlerList &hl    = m_lists[list];
+        u32          count = 0;
+
+        for (u32 i = 0; i < hl.count; i++)
+        {
+            if (hl.handlers[i])
+            {
+                hl.handlers[count++] = hl.handlers[i];
+            }
+        }
+
+        hl.count = count;
+    }
+
+    m_removed = false;
 }
 
 
 /// ---------------------------------------------------------------------------
-/// Instantly sends a message to all registered receivers.
+/// Queues a message from another thread. Returns false if the queue is full.
 /// ---------------------------------------------------------------------------
-void prMessageManager::Send(prGameMessage &msg)
+bool prMessageManager::Push(const prGameMessage &msg)
 {
-    //std::list<prMessageHandler *>::iterator itr = m_handlers.begin();
-    //std::list<prMessageHandler *>::iterator end = m_handlers.end();
-    //for (; itr != end; ++itr)
-    for (auto it = m_handlers.begin(); it != m_handlers.end(); ++it)
+    u32 position = m_enqueue.load(std::memory_order_relaxed);
+
+    for (;;)
     {
-        if ((*it)->Receive(msg))
+        Cell *cell     = &m_cells[position & (PRMESSAGE_CONCURRENT_SIZE - 1)];
+        u32   sequence = cell->sequence.load(std::memory_order_acquire);
+        s32   diff     = (s32)(sequence - position);
+
+        if (diff == 0)
         {
-            break;
+            // The cell is free. Claim it.
+            if (m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                cell->msg = msg;
+                cell->sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            // Still holds a message from the previous lap.
+            return false;
+        }
+        else
+        {
+            // Another thread claimed it.
+            position = m_enqueue.load(std::memory_order_relaxed);
         }
     }
 }
+
+
+/// ---------------------------------------------------------------------------
+/// Takes a message queued from another thread. Returns false if the queue is empty.
+/// ---------------------------------------------------------------------------
+bool prMessageManager::Pop(prGameMessage &msg)
+{
+    Cell *cell     = &m_cells[m_dequeue & (PRMESSAGE_CONCURRENT_SIZE - 1)];
+    u32   sequence = cell->sequence.load(std::memory_order_acquire);
+
+    // Empty, or claimed but not yet written.
+    if ((s32)(sequence - (m_dequeue + 1)) < 0)
+    {
+        return false;
+    }
+
+    msg = cell->msg;
+    cell->sequence.store(m_dequeue + PRMESSAGE_CONCURRENT_SIZE, std::memory_order_release);
+    m_dequeue++;
+    return true;
+}
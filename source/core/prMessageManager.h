@@ -1,13 +1,20 @@
 // File: prMessageManager.h
+//      Global message passing.
+//
+// Notes:
+//      Handlers either subscribe to individual message types, which are
+//      found through a flat hash table, or register for every message.
+//      Messages can be sent immediately, or posted and sent as a batch
+//      by <prMessageManager::Flush> once a frame.
 /**
  * Copyright 2014 Paul Michael McNab
- * 
+ *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
  * You may obtain a copy of the License at
  *
  *      http://www.apache.org/licenses/LICENSE-2.0
- * 
+ *
  * Unless required by applicable law or agreed to in writing, software
  * distributed under the License is distributed on an "AS IS" BASIS,
  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
@@ -19,16 +26,30 @@
 #pragma once
 
 
-#include <list>
+#include <atomic>
 #include "prMessage.h"
 #include "prCoreSystem.h"
+#include "../thread/prMutex.h"
+
+
+// Defines
+#define PRMESSAGE_QUEUE_SIZE            256             // Initial posted messages per frame. Grows as needed. Must be a power of two.
+#define PRMESSAGE_CONCURRENT_SIZE       1024            // Messages posted by other threads before they overflow to a locked list. Must be a power of two.
 
 
 // Class: prMessageManager
 //          The message manager, which allows for global message passing.
 //
-// Motes:
+// Notes:
 //      Can be used locally as well
+//
+//      A message is passed to the handlers subscribed to its type, then to
+//      the handlers registered for all messages, each in the order they were
+//      added, until one returns true.
+//
+//      Handlers may be added and removed while a message is being sent.
+//      Removed handlers receive no further messages, and added handlers
+//      receive the next message.
 class prMessageManager : public prCoreSystem
 {
 public:
@@ -41,7 +62,7 @@ public:
     virtual ~prMessageManager();
 
     // Method: Register
-    //      Registers a handler with the message manager.
+    //      Registers a handler to receive every message.
     //
     // Parameters:
     //      handler - The handler
@@ -49,6 +70,9 @@ public:
     // Notes:
     //      The passed handler must not be NULL.
     //      This will assert in the debug build.
+    //
+    //      Prefer <Subscribe> where possible, as these handlers are passed
+    //      every message.
     void Register(prMessageHandler *handler);
 
     // Method: Unregister
@@ -60,15 +84,142 @@ public:
     // Notes:
     //      The passed handler must not be NULL.
     //      This will assert in the debug build.
+    //
+    //      Also removes all of the handler's subscriptions.
     void Unregister(prMessageHandler *handler);
 
+    // Method: Subscribe
+    //      Registers a handler to receive messages of one type.
+    //
+    // Parameters:
+    //      handler - The handler
+    //      type    - The message type
+    void Subscribe(prMessageHandler *handler, u32 type);
+
+    // Method: Unsubscribe
+    //      Stops a handler receiving messages of one type.
+    //
+    // Parameters:
+    //      handler - The handler
+    //      type    - The message type
+    void Unsubscribe(prMessageHandler *handler, u32 type);
+
     // Method: Send
-    //      Instantly sends a message to all registered receivers.
+    //      Instantly sends a message to the receivers.
     //
     // Parameters:
     //      msg - The message
     void Send(prGameMessage &msg);
 
+    // Method: Post
+    //      Queues a message to be sent by the next <Flush>.
+    //
+    // Parameters:
+    //      msg - The message
+    //
+    // Notes:
+    //      Must be called on the thread which calls <Flush>.
+    //      Use <PostConcurrent> from other threads.
+    void Post(const prGameMessage &msg);
+
+    // Method: PostConcurrent
+    //      Queues a message to be sent by the next <Flush>.
+    //
+    // Parameters:
+    //      msg - The message
+    //
+    // Notes:
+    //      Can be called from any thread, such as job system workers.
+    //      Messages from one thread are sent in the order posted.
+    void PostConcurrent(const prGameMessage &msg);
+
+    // Method: Flush
+    //      Sends the posted messages.
+    //
+    // Notes:
+    //      Called once a frame by the application, after the game update.
+    //      Messages posted while flushing are sent by the next flush.
+    void Flush();
+
+
+private:
+    // A list of handlers.
+    typedef struct HandlerList
+    {
+        prMessageHandler  **handlers;
+        u32                 count;
+        u32                 capacity;
+
+    } HandlerList;
+
+    // Hash table entry. Open addressing with linear probing.
+    typedef struct Bucket
+    {
+        u32 type;
+        u32 list;                                       // Index into the handler lists, or MESSAGE_EMPTY_BUCKET
+
+    } Bucket;
+
+    // Concurrent queue entry.
+    typedef struct Cell
+    {
+        std::atomic<u32>    sequence;                   // Tracks whether the cell is free or filled
+        prGameMessage       msg;
+
+    } Cell;
+
+
 private:
-    std::list<prMessageHandler*>    m_handlers;
+    // Finds the handler list for a type. Optionally adds one.
+    u32 FindList(u32 type, bool add);
+
+    // Doubles the hash table size.
+    void Grow();
+
+    // Adds a handler to a list.
+    void Add(u32 list, prMessageHandler *handler);
+
+    // Removes a handler from a list.
+    void Remove(u32 list, prMessageHandler *handler);
+
+    // Sends a message to a list. Returns true if handled.
+    bool Dispatch(u32 list, prGameMessage &msg);
+
+    // Removes the handlers removed while sending.
+    void Compact();
+
+    // Queues a message from another thread. Returns false if the queue is full.
+    bool Push(const prGameMessage &msg);
+
+    // Takes a message queued from another thread. Returns false if the queue is empty.
+    bool Pop(prGameMessage &msg);
+
+    // Stops passing by value and assignment.
+    prMessageManager(const prMessageManager&);
+    const prMessageManager& operator = (const prMessageManager&);
+
+
+private:
+    HandlerList            *m_lists;                // List zero receives all messages
+    u32                     m_listCount;
+    u32                     m_listCapacity;
+    Bucket                 *m_buckets;
+    u32                     m_bucketCount;
+    u32                     m_sending;              // Send depth
+    bool                    m_removed;              // Handlers were removed while sending
+    bool                    m_flushing;
+
+    prGameMessage          *m_queue;                // Posted messages. Indexed by the counters modulo the capacity
+    u32                     m_queueHead;
+    u32                     m_queueTail;
+    u32                     m_queueCapacity;
+
+    Cell                   *m_cells;                // Messages posted by other threads
+    std::atomic<u32>        m_enqueue;
+    u32                     m_dequeue;
+    std::atomic<bool>       m_overflowing;          // Set while other threads post to the overflow list, which keeps their messages in order
+    prMutex                 m_overflowLock;
+    prGameMessage          *m_overflow;
+    u32                     m_overflowCount;
+    u32                     m_overflowCapacity;
 };
@@ -37,12 +37,17 @@ prResource::prResource(const char *filename)
     prStringReplaceChar(m_filename, '\\', '/');
 
     // Hash name for quick searching.
-    m_hash = prStringHash(m_filename);
+    m_hash = prStringHash64(m_filename);
+
+    // Not managed yet.
+    m_handle     = PRRESOURCE_INVALID_HANDLE;
 
     // Initial reference count.
     m_references = 1;
     m_locked     = false;
     m_size       = 0;
+    m_state      = PRRESOURCE_STATE_READY;
+    m_priority   = PRRESOURCE_PRIORITY_NORMAL;
     m_exp0		 = false;
     m_exp1		 = false;
     m_exp2		 = false;
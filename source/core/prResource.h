@@ -23,6 +23,78 @@
 #include "../file/prFileShared.h"
 
 
+// Forward declarations
+class prResource;
+
+
+// Enum: prResourceState
+//      The load state of a resource
+//
+//  PRRESOURCE_STATE_LOADING - The resource is being loaded asynchronously
+//  PRRESOURCE_STATE_READY   - The resource is ready for use
+//  PRRESOURCE_STATE_FAILED  - The resource failed to load asynchronously
+typedef enum prResourceState
+{
+    PRRESOURCE_STATE_LOADING,
+    PRRESOURCE_STATE_READY,
+    PRRESOURCE_STATE_FAILED,
+
+} prResourceState;
+
+
+// Enum: prResourceClass
+//      Resource classes. Each class has its own memory budget.
+//
+//  PRRESOURCE_CLASS_TEXTURE - Textures. (Includes font pages)
+//  PRRESOURCE_CLASS_AUDIO   - Audio
+//  PRRESOURCE_CLASS_FONT    - Fonts
+//  PRRESOURCE_CLASS_OTHER   - Anything else
+typedef enum prResourceClass
+{
+    PRRESOURCE_CLASS_TEXTURE,
+    PRRESOURCE_CLASS_AUDIO,
+    PRRESOURCE_CLASS_FONT,
+    PRRESOURCE_CLASS_OTHER,
+    PRRESOURCE_CLASS_MAX,
+
+} prResourceClass;
+
+
+// Enum: prResourcePriority
+//      Cache priority hints. When a budget is exceeded unreferenced resources
+//      are evicted lowest priority first, then least recently used first.
+//
+//  PRRESOURCE_PRIORITY_LOW    - Evicted first
+//  PRRESOURCE_PRIORITY_NORMAL - The default
+//  PRRESOURCE_PRIORITY_HIGH   - Evicted last
+typedef enum prResourcePriority
+{
+    PRRESOURCE_PRIORITY_LOW,
+    PRRESOURCE_PRIORITY_NORMAL,
+    PRRESOURCE_PRIORITY_HIGH,
+    PRRESOURCE_PRIORITY_MAX,
+
+} prResourcePriority;
+
+
+// Typedef: prResourceHandle
+//      A generation checked handle to a resource. The low bits index the resource
+//      managers slot table and the high bits hold the slots generation, which changes
+//      whenever a resource is unloaded, so stale handles are detected.
+typedef u32 prResourceHandle;
+
+
+// Handle defines
+#define PRRESOURCE_INVALID_HANDLE           0
+#define PRRESOURCE_HANDLE_INDEX_BITS        20
+#define PRRESOURCE_HANDLE_INDEX_MASK        ((1 << PRRESOURCE_HANDLE_INDEX_BITS) - 1)
+
+
+// Typedef: prResourceCallback
+//      Called on the main thread when an asynchronous load completes or fails.
+typedef void (*prResourceCallback)(prResource *pResource, void *pUserData);
+
+
 // Class: prResource
 //      Class which represents an engine resource.
 //
@@ -33,6 +105,7 @@ class prResource
 public:
     // Friend
     friend class prResourceManager;
+    friend class prResourceLoader;
 
 
     // Method: prResource
@@ -56,12 +129,39 @@ public:
     
     // Method: Hash
     //      Gets the resouces hash value
-    const u32 Hash() const { return m_hash; }
+    const u64 Hash() const { return m_hash; }
 
     // Method: Size
     //      Gets the resouces file size
     const u32 Size() const { return m_size; }
 
+    // Method: State
+    //      Gets the resources load state
+    prResourceState State() const { return m_state; }
+
+    // Method: IsReady
+    //      Is the resource loaded and ready for use?
+    bool IsReady() const { return m_state == PRRESOURCE_STATE_READY; }
+
+    // Method: Handle
+    //      Gets the resources handle. See <prResourceManager::Get>
+    prResourceHandle Handle() const { return m_handle; }
+
+    // Method: Class
+    //      Gets the resources class, which selects its memory budget
+    virtual prResourceClass Class() const { return PRRESOURCE_CLASS_OTHER; }
+
+    // Method: Priority
+    //      Gets the resources cache priority
+    prResourcePriority Priority() const { return m_priority; }
+
+    // Method: SetPriority
+    //      Sets the resources cache priority.
+    //
+    // Parameters:
+    //      priority - The priority hint
+    void SetPriority(prResourcePriority priority) { m_priority = priority; }
+
 
 private:
 
@@ -73,6 +173,23 @@ private:
     //      Unload resource
     virtual void Unload() = 0;
 
+    // Method: LoadAsync
+    //      Called on a loader thread to read and decode the resource.
+    //
+    // Notes:
+    //      Must not use the renderer or call <SetSize>, as the resource manager
+    //      reads the size on the main thread. The default does nothing, so
+    //      resources without asynchronous support are loaded by <LoadAsyncComplete>
+    //
+    // Returns:
+    //      false if the resource failed to load
+    virtual bool LoadAsync(s32 /*extra*/) { return true; }
+
+    // Method: LoadAsyncComplete
+    //      Called on the main thread to complete an asynchronous load. e.g. Upload
+    //      a texture to the GPU.
+    virtual void LoadAsyncComplete(s32 extra) { Load(extra); }
+
     // Method: References
     //      Gets the number of references to this resource
     const u32 References() const { return m_references; }
@@ -108,9 +225,12 @@ protected:
 
 private:
     char    m_filename[FILE_MAX_FILENAME_SIZE];
-    u32     m_hash;
+    u64     m_hash;
+    prResourceHandle m_handle;
     u32     m_references;
     u32     m_size;
+    prResourceState m_state;
+    prResourcePriority m_priority;
     bool    m_locked;
     bool    m_exp0;
     bool    m_exp1;
@@ -0,0 +1,338 @@
+/**
+ * prResourceLoader.cpp
+ *
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "prResourceLoader.h"
+#include "prClock.h"
+#include "prMacros.h"
+#include "../debug/prAssert.h"
+#include "../debug/prTrace.h"
+#include "../debug/prProfiler.h"
+
+
+/// ---------------------------------------------------------------------------
+/// Ctor
+/// ---------------------------------------------------------------------------
+prResourceLoader::prResourceLoader(u32 threadCount) : m_work(0)
+{
+    m_exit        = false;
+    m_threadCount = PRCLAMP(threadCount, 1, RESOURCE_LOADER_MAX_THREADS);
+
+    for (u32 i=0; i<RESOURCE_LOADER_MAX_THREADS; i++)
+    {
+        m_threads[i] = nullptr;
+    }
+
+    for (u32 i=0; i<m_threadCount; i++)
+    {
+        m_threads[i] = new prThread(LoaderThread, this, false);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Dtor
+/// ---------------------------------------------------------------------------
+prResourceLoader::~prResourceLoader()
+{
+    // Stop the threads. Any work still queued is dropped.
+    m_mutex.Lock();
+    m_exit = true;
+    m_mutex.Unlock();
+
+    m_work.Signal(m_threadCount);
+
+    for (u32 i=0; i<m_threadCount; i++)
+    {
+        m_threads[i]->Join();
+        PRSAFE_DELETE(m_threads[i]);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Queues a resource for loading.
+/// ---------------------------------------------------------------------------
+void prResourceLoader::Queue(prResource *pResource, s32 extra, prResourceCallback callback, void *pUserData)
+{
+    PRASSERT(pResource);
+
+    pResource->m_state = PRRESOURCE_STATE_LOADING;
+
+    AddListener(pResource, callback, pUserData);
+
+    prResourceRequest request;
+    request.pResource = pResource;
+    request.extra     = extra;
+    request.result    = false;
+
+    m_mutex.Lock();
+    m_queued.push_back(request);
+    m_mutex.Unlock();
+
+    m_work.Signal();
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Adds a completion callback for a resource that is already loading.
+/// ---------------------------------------------------------------------------
+void prResourceLoader::AddListener(prResource *pResource, prResourceCallback callback, void *pUserData)
+{
+    PRASSERT(pResource);
+
+    if (callback)
+    {
+        prResourceListener listener;
+        listener.pResource = pResource;
+        listener.callback  = callback;
+        listener.pUserData = pUserData;
+        m_listeners.push_back(listener);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Completes loaded resources on the main thread.
+/// ---------------------------------------------------------------------------
+void prResourceLoader::Update(f32 budget)
+{
+    PRPROFILE_ZONE("Resource complete");
+
+    f64 start = prClockMilliseconds();
+
+    do
+    {
+        m_mutex.Lock();
+        if (m_loaded.empty())
+        {
+            m_mutex.Unlock();
+            break;
+        }
+
+        prResourceRequest request = m_loaded.front();
+        m_loaded.pop_front();
+        m_mutex.Unlock();
+
+        Finish(request);
+    }
+    while ((prClockMilliseconds() - start) < budget);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Waits for a resource to load and completes it.
+/// ---------------------------------------------------------------------------
+void prResourceLoader::Complete(prResource *pResource)
+{
+    PRASSERT(pResource);
+
+    for (;;)
+    {
+        m_mutex.Lock();
+
+        // Not started? Then load it here rather than wait
+        std::list<prResourceRequest>::iterator it  = m_queued.begin();
+        std::list<prResourceRequest>::iterator end = m_queued.end();
+        for (; it != end; ++it)
+        {
+            if (it->pResource == pResource)
+            {
+                prResourceRequest request = *it;
+                m_queued.erase(it);
+                m_mutex.Unlock();
+
+                request.result = pResource->LoadAsync(request.extra);
+                Finish(request);
+                return;
+            }
+        }
+
+        // Loaded?
+        it  = m_loaded.begin();
+        end = m_loaded.end();
+        for (; it != end; ++it)
+        {
+            if (it->pResource == pResource)
+            {
+                prResourceRequest request = *it;
+                m_loaded.erase(it);
+                m_mutex.Unlock();
+
+                Finish(request);
+                return;
+            }
+        }
+
+        // Still loading?
+        bool loading = false;
+        std::list<prResource*>::iterator itActive  = m_active.begin();
+        std::list<prResource*>::iterator endActive = m_active.end();
+        for (; itActive != endActive; ++itActive)
+        {
+            if (*itActive == pResource)
+            {
+                loading = true;
+                break;
+            }
+        }
+
+        m_mutex.Unlock();
+
+        if (!loading)
+        {
+            break;
+        }
+
+        prThreadYield();
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Waits for all resources to load and completes them.
+/// ---------------------------------------------------------------------------
+void prResourceLoader::Flush()
+{
+    for (;;)
+    {
+        m_mutex.Lock();
+
+        prResource *pResource = nullptr;
+        if (!m_queued.empty())
+        {
+            pResource = m_queued.front().pResource;
+        }
+        else if (!m_loaded.empty())
+        {
+            pResource = m_loaded.front().pResource;
+        }
+        else if (!m_active.empty())
+        {
+            pResource = m_active.front();
+        }
+
+        m_mutex.Unlock();
+
+        if (pResource == nullptr)
+        {
+            break;
+        }
+
+        Complete(pResource);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Gets the number of resources waiting to be completed.
+/// ---------------------------------------------------------------------------
+u32 prResourceLoader::Pending()
+{
+    m_mutex.Lock();
+    u32 count = (u32)(m_queued.size() + m_loaded.size() + m_active.size());
+    m_mutex.Unlock();
+
+    return count;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// The loader thread function.
+/// ---------------------------------------------------------------------------
+PRTHREAD_RETVAL PRTHREAD_CALLCONV prResourceLoader::LoaderThread(void *pData)
+{
+    PRASSERT(pData);
+    prResourceLoader *pLoader = static_cast<prResourceLoader *>(pData);
+
+    PRPROFILE_THREAD_NAME("Resource loader");
+
+    for (;;)
+    {
+        pLoader->m_work.Wait();
+
+        pLoader->m_mutex.Lock();
+        if (pLoader->m_exit)
+        {
+            pLoader->m_mutex.Unlock();
+            break;
+        }
+
+        // The main thread may have taken the work already.
+        if (pLoader->m_queued.empty())
+        {
+            pLoader->m_mutex.Unlock();
+            continue;
+        }
+
+        prResourceRequest request = pLoader->m_queued.front();
+        pLoader->m_queued.pop_front();
+        pLoader->m_active.push_back(request.pResource);
+        pLoader->m_mutex.Unlock();
+
+        // Read and decode
+        {
+            PRPROFILE_ZONE("Resource load");
+            request.result = request.pResource->LoadAsync(request.extra);
+        }
+
+        pLoader->m_mutex.Lock();
+        pLoader->m_active.remove(request.pResource);
+        pLoader->m_loaded.push_back(request);
+        pLoader->m_mutex.Unlock();
+    }
+
+    return 0;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Finishes a request on the main thread.
+/// ---------------------------------------------------------------------------
+void prResourceLoader::Finish(prResourceRequest &request)
+{
+    prResource *pResource = request.pResource;
+    PRASSERT(pResource);
+
+    if (request.result)
+    {
+        pResource->LoadAsyncComplete(request.extra);
+        pResource->m_state = PRRESOURCE_STATE_READY;
+    }
+    else
+    {
+        prTrace(prLogLevel::LogError, "Failed to load resource: %s\n", pResource->Filename());
+        pResource->m_state = PRRESOURCE_STATE_FAILED;
+    }
+
+    // Tell any listeners
+    std::list<prResourceListener>::iterator it = m_listeners.begin();
+    while (it != m_listeners.end())
+    {
+        if (it->pResource == pResource)
+        {
+            prResourceListener listener = *it;
+            it = m_listeners.erase(it);
+            listener.callback(pResource, listener.pUserData);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
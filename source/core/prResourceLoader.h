@@ -0,0 +1,134 @@
+// File: prResourceLoader.h
+/**
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+
+#include <list>
+#include "prTypes.h"
+#include "prResource.h"
+#include "../thread/prMutex.h"
+#include "../thread/prSemaphore.h"
+#include "../thread/prThread.h"
+
+
+// Defines
+#define RESOURCE_LOADER_MAX_THREADS     4
+
+
+// Class: prResourceLoader
+//      Loads resources on worker threads for the resource manager.
+//
+// Notes:
+//      Loader threads call <prResource::LoadAsync> to perform file reads and decoding,
+//      then the main thread calls <prResource::LoadAsyncComplete> from <Update> within
+//      a time budget.
+//
+// Notes:
+//      This class is managed by the resource manager. You do not need to use it
+class prResourceLoader
+{
+public:
+    // Method: prResourceLoader
+    //      Ctor
+    //
+    // Parameters:
+    //      threadCount - The number of loader threads to create
+    explicit prResourceLoader(u32 threadCount);
+
+    // Method: ~prResourceLoader
+    //      Dtor
+    ~prResourceLoader();
+
+    // Method: Queue
+    //      Queues a resource for loading.
+    //
+    // Parameters:
+    //      pResource - The resource
+    //      extra     - Resource specific load settings
+    //      callback  - Optional completion callback
+    //      pUserData - Optional callback data
+    void Queue(prResource *pResource, s32 extra, prResourceCallback callback, void *pUserData);
+
+    // Method: AddListener
+    //      Adds a completion callback for a resource that is already loading.
+    void AddListener(prResource *pResource, prResourceCallback callback, void *pUserData);
+
+    // Method: Update
+    //      Completes loaded resources on the main thread.
+    //
+    // Parameters:
+    //      budget - Time budget in milliseconds. At least one resource is always completed if available
+    void Update(f32 budget);
+
+    // Method: Complete
+    //      Waits for a resource to load and completes it.
+    void Complete(prResource *pResource);
+
+    // Method: Flush
+    //      Waits for all resources to load and completes them.
+    void Flush();
+
+    // Method: Pending
+    //      Gets the number of resources waiting to be completed.
+    u32 Pending();
+
+
+private:
+    // Request data
+    typedef struct prResourceRequest
+    {
+        prResource *pResource;
+        s32         extra;
+        bool        result;
+
+    } prResourceRequest;
+
+    // Callback data
+    typedef struct prResourceListener
+    {
+        prResource         *pResource;
+        prResourceCallback  callback;
+        void               *pUserData;
+
+    } prResourceListener;
+
+    // The loader thread function.
+    static PRTHREAD_RETVAL PRTHREAD_CALLCONV LoaderThread(void *pData);
+
+    // Finishes a request on the main thread.
+    void Finish(prResourceRequest &request);
+
+
+private:
+    // Stops passing by value and assignment.
+    prResourceLoader(const prResourceLoader&);
+    const prResourceLoader& operator = (const prResourceLoader&);
+
+
+private:
+    std::list<prResourceRequest>    m_queued;           // Waiting for a loader thread. (Locked)
+    std::list<prResourceRequest>    m_loaded;           // Waiting for the main thread. (Locked)
+    std::list<prResource*>          m_active;           // Being loaded by a loader thread. (Locked)
+    std::list<prResourceListener>   m_listeners;        // Completion callbacks. (Main thread only)
+    prMutex                         m_mutex;
+    prSemaphore                     m_work;
+    prThread                       *m_threads[RESOURCE_LOADER_MAX_THREADS];
+    u32                             m_threadCount;
+    bool                            m_exit;
+};
@@ -17,27 +17,74 @@
  */
 
 
+#include <string.h>
 #include "prResourceManager.h"
+#include "prResourceLoader.h"
 #include "prStringUtil.h"
 #include "../debug/prAssert.h"
 #include "../debug/prTrace.h"
 #include "../debug/prDebug.h"
 #include "../debug/prAssert.h"
 #include "../file/prFileShared.h"
+#include "../thread/prThread.h"
 #include "prCore.h"
 
 
 //using namespace Proteus::Core;
 
 
+// Defines
+#define RESOURCE_EMPTY_BUCKET       0xFFFFFFFF
+#define RESOURCE_NO_SLOT            0xFFFFFFFF
+#define RESOURCE_GENERATION_MASK    ((1 << (32 - PRRESOURCE_HANDLE_INDEX_BITS)) - 1)
+#define RESOURCE_SLOTS_MAX          (1 << PRRESOURCE_HANDLE_INDEX_BITS)
+
+
+namespace
+{
+    /// -----------------------------------------------------------------------
+    /// Makes a handle. Generations start at 1, so a handle is never zero.
+    /// -----------------------------------------------------------------------
+    inline prResourceHandle MakeHandle(u32 slot, u32 generation)
+    {
+        return (generation << PRRESOURCE_HANDLE_INDEX_BITS) | slot;
+    }
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Ctor
 /// ---------------------------------------------------------------------------
 prResourceManager::prResourceManager() : prCoreSystem(PRSYSTEM_RESOURCEMANAGER, "prResourceManager")
 {
-    TODO("Perhaps add handles to resource manager? Access pointers by handles?")
-    TODO("Perhaps give priorities to resources? for automatic unload/load of resources")
-    TODO("Add more binary data types, so Less xml parsing for the bigger games to improve loading times")
+    m_pLoader      = nullptr;
+    m_bucketCount  = RESOURCE_TABLE_SIZE;
+    m_pBuckets     = new Bucket[m_bucketCount];
+    m_slotCount    = 0;
+    m_slotCapacity = RESOURCE_TABLE_SIZE;
+    m_pSlots       = new Slot[m_slotCapacity];
+    m_freeSlot     = RESOURCE_NO_SLOT;
+    m_count        = 0;
+    m_usageDirty   = false;
+
+    for (u32 i=0; i<m_bucketCount; i++)
+    {
+        m_pBuckets[i].hash = 0;
+        m_pBuckets[i].slot = RESOURCE_EMPTY_BUCKET;
+    }
+
+    for (s32 i=0; i<PRRESOURCE_CLASS_MAX; i++)
+    {
+        m_budget[i] = 0;
+        m_usage[i]  = 0;
+    }
+
+    for (s32 i=0; i<PRRESOURCE_CLASS_MAX * PRRESOURCE_PRIORITY_MAX; i++)
+    {
+        m_cacheHead[i] = RESOURCE_NO_SLOT;
+        m_cacheTail[i] = RESOURCE_NO_SLOT;
+    }
+
     TODO("Add clipboard trick - page 111 to 113 gems 1")
     TODO("Complete quaternion")
 }
@@ -49,6 +96,9 @@ prResourceManager::prResourceManager() : prCoreSystem(PRSYSTEM_RESOURCEMANAGER,
 prResourceManager::~prResourceManager()
 {
     Clear();
+    PRSAFE_DELETE(m_pLoader);
+    PRSAFE_DELETE_ARRAY(m_pSlots);
+    PRSAFE_DELETE_ARRAY(m_pBuckets);
 }
 
 
@@ -70,16 +120,59 @@ void prResourceManager::Unload(prResource *resource)
             return;
         }
 
-        u32 hash = resource->Hash();
+        // Can't delete while a loader thread is using it.
+        Wait(resource);
 
-        std::list<prResource*>& list = m_resources[hash % RESOURCE_TABLE_SIZE];
+        // Keep the resource cached if its class has a budget.
+        prResourceClass resourceClass = resource->Class();
+        if (m_budget[resourceClass] > 0 && resource->State() == PRRESOURCE_STATE_READY && Get(resource->Handle()) == resource)
+        {
+            u32 index = resource->Handle() & PRRESOURCE_HANDLE_INDEX_MASK;
 
-        list.remove(resource);
+            resource->DecrementReferenceCount();
+            Account(index);
+            CacheLink(index);
+            Trim(resourceClass);
+        }
+        else
+        {
+            Destroy(resource);
+        }
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Removes a resource from the manager and deletes it
+/// ---------------------------------------------------------------------------
+void prResourceManager::Destroy(prResource *resource)
+{
+    PRASSERT(resource);
 
-        resource->Unload();
+    // Release the slot. Changing the generation invalidates existing handles.
+    prResourceHandle handle = resource->Handle();
+    if (Get(handle) == resource)
+    {
+        u32   index = handle & PRRESOURCE_HANDLE_INDEX_MASK;
+        Slot &slot  = m_pSlots[index];
 
-        delete resource;
+        CacheUnlink(index);
+        Remove(resource->Hash(), index);
+
+        m_usage[resource->Class()] -= slot.size;
+
+        slot.pResource  = nullptr;
+        slot.size       = 0;
+        slot.generation = (slot.generation + 1) & RESOURCE_GENERATION_MASK;
+        slot.generation = (slot.generation == 0) ? 1 : slot.generation;
+        slot.nextFree   = m_freeSlot;
+        m_freeSlot      = index;
+        m_count--;
     }
+
+    resource->Unload();
+
+    delete resource;
 }
 
 
@@ -87,6 +180,15 @@ void prResourceManager::Unload(prResource *resource)
 /// Finds a resource by name.
 /// ---------------------------------------------------------------------------
 prResource *prResourceManager::Find(const char *filename)
+{
+    return Get(FindHandle(filename));
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Finds a resources handle by name.
+/// ---------------------------------------------------------------------------
+prResourceHandle prResourceManager::FindHandle(const char *filename) const
 {
     PRASSERT(filename && *filename);
     
@@ -95,25 +197,49 @@ prResource *prResourceManager::Find(const char *filename)
     prStringCopySafe(buffer, filename, sizeof(buffer));
     prStringToLower(buffer);
     prStringReplaceChar(buffer, '\\', '/');
-    u32 hash = prStringHash(buffer);
+    u64 hash = prStringHash64(buffer);
 
 
-    // Search list for entry.
-    std::list<prResource*>& list = m_resources[hash % RESOURCE_TABLE_SIZE];
-    if (!list.empty())
-    {
-        std::list<prResource*>::iterator it  = list.begin();
-        std::list<prResource*>::iterator end = list.end();
+    // Probe for the entry. The name is checked too, so a collision can't return the wrong resource.
+    u32 mask  = m_bucketCount - 1;
+    u32 index = (u32)hash & mask;
 
-        for (; it != end; ++it)
+    while (m_pBuckets[index].slot != RESOURCE_EMPTY_BUCKET)
+    {
+        const Bucket &bucket = m_pBuckets[index];
+        if (bucket.hash == hash)
         {
-            prResource* resource = *it;
-            PRASSERT(resource);
-            if (resource->Hash() == hash)
+            const Slot &slot = m_pSlots[bucket.slot];
+            PRASSERT(slot.pResource);
+
+            if (strcmp(slot.pResource->Filename(), buffer) == 0)
             {
-                return resource;
+                return MakeHandle(bucket.slot, slot.generation);
             }
         }
+
+        index = (index + 1) & mask;
+    }
+
+    return PRRESOURCE_INVALID_HANDLE;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Gets a resource from its handle.
+/// ---------------------------------------------------------------------------
+prResource *prResourceManager::Get(prResourceHandle handle) const
+{
+    u32 index      = handle & PRRESOURCE_HANDLE_INDEX_MASK;
+    u32 generation = handle >> PRRESOURCE_HANDLE_INDEX_BITS;
+
+    if (handle != PRRESOURCE_INVALID_HANDLE && index < m_slotCount)
+    {
+        const Slot &slot = m_pSlots[index];
+        if (slot.generation == generation)
+        {
+            return slot.pResource;
+        }
     }
 
     return nullptr;
@@ -131,38 +257,37 @@ void prResourceManager::DisplayUsage()
 
     u64 size = 0;
 
-    for (s32 i=0; i<RESOURCE_TABLE_SIZE; i++)
+    for (u32 i=0; i<m_slotCount; i++)
     {
-        std::list<prResource*>& list = m_resources[i];
-        if (list.size() > 0)
+        if (m_pSlots[i].pResource)
         {
-            std::list<prResource*>::iterator it  = list.begin();
-            std::list<prResource*>::iterator end = list.end();
-
-            for (; it != end; ++it)
-            {
-                PRASSERT(*it);
-                prResource& resource = **it;
-
-                prTrace
-                (
-                    prLogLevel::LogError,
-                    "Table: %03i, Hash: %08x, Refs %03i, Locked %s, Size: %*i, File: %s\n",
-                    i,                                                  // Hash table index
-                    resource.Hash(),                                    // Hash key
-                    resource.References(),                              // References
-                    resource.IsLocked() ? "Yes" : "No ",                // Locked status
-                    10, resource.Size(),                                // prResource size.
-                    resource.Filename()                                 // Entries file name
-                );
-
-                size += resource.Size();
-            }
+            prResource& resource = *m_pSlots[i].pResource;
+
+            prTrace
+            (
+                prLogLevel::LogError,
+                "Slot: %04i, Hash: %016llx, Refs %03i%s, Locked %s, Size: %*i, File: %s\n",
+                i,                                                  // Slot table index
+                (unsigned long long)resource.Hash(),                // Hash key
+                resource.References(),                              // References
+                resource.References() == 0 ? " (Cached)" : "",      // Cached status
+                resource.IsLocked() ? "Yes" : "No ",                // Locked status
+                10, resource.Size(),                                // prResource size.
+                resource.Filename()                                 // Entries file name
+            );
+
+            size += resource.Size();
         }
     }
 
     prTrace(prLogLevel::LogError, "------------------\n");
     prTrace(prLogLevel::LogError, "Number of entries: %i, Total size: %.02fKB or %.02fMB\n", Count(), ((float)size)/1024, ((float)size)/1024/1024);
+
+    for (s32 i=0; i<PRRESOURCE_CLASS_MAX; i++)
+    {
+        prTrace(prLogLevel::LogError, "Class %i: Usage %.02fKB, Budget %.02fKB\n", i, ((float)m_usage[i])/1024, ((float)m_budget[i])/1024);
+    }
+
     prTrace(prLogLevel::LogError, "Note: The total size is approximate\n");
     prTrace(prLogLevel::LogError, "================================================================================\n");
 
@@ -175,43 +300,228 @@ void prResourceManager::DisplayUsage()
 /// ---------------------------------------------------------------------------
 u32 prResourceManager::Count() const
 {
-    u32 count = 0;
+    return m_count;
+}
+
 
-    for (s32 i=0; i<RESOURCE_TABLE_SIZE; i++)
+/// ---------------------------------------------------------------------------
+/// Clears the resource manager of all entries
+/// ---------------------------------------------------------------------------
+void prResourceManager::Clear()
+{
+    // Finish loading first, as the loader threads may be using the resources
+    if (m_pLoader)
     {
-        count += (u32)m_resources[i].size();
+        m_pLoader->Flush();
     }
 
-    return count;
+    // Delete the resources and invalidate their handles
+    m_freeSlot = RESOURCE_NO_SLOT;
+
+    for (u32 i=m_slotCount; i>0; i--)
+    {
+        Slot &slot = m_pSlots[i - 1];
+
+        if (slot.pResource)
+        {
+            slot.pResource->Unload();
+            delete slot.pResource;
+            slot.pResource  = nullptr;
+            slot.size       = 0;
+            slot.cacheList  = RESOURCE_NO_SLOT;
+            slot.generation = (slot.generation + 1) & RESOURCE_GENERATION_MASK;
+            slot.generation = (slot.generation == 0) ? 1 : slot.generation;
+        }
+
+        slot.nextFree = m_freeSlot;
+        m_freeSlot    = i - 1;
+    }
+
+    for (u32 i=0; i<m_bucketCount; i++)
+    {
+        m_pBuckets[i].slot = RESOURCE_EMPTY_BUCKET;
+    }
+
+    for (s32 i=0; i<PRRESOURCE_CLASS_MAX * PRRESOURCE_PRIORITY_MAX; i++)
+    {
+        m_cacheHead[i] = RESOURCE_NO_SLOT;
+        m_cacheTail[i] = RESOURCE_NO_SLOT;
+    }
+
+    for (s32 i=0; i<PRRESOURCE_CLASS_MAX; i++)
+    {
+        m_usage[i] = 0;
+    }
+
+    m_count      = 0;
+    m_usageDirty = false;
 }
 
 
 /// ---------------------------------------------------------------------------
-/// Clears the resource manager of all entries
+/// Sets the memory budget for a resource class.
 /// ---------------------------------------------------------------------------
-void prResourceManager::Clear()
+void prResourceManager::SetBudget(prResourceClass resourceClass, u64 bytes)
+{
+    PRASSERT(resourceClass >= 0 && resourceClass < PRRESOURCE_CLASS_MAX);
+
+    m_budget[resourceClass] = bytes;
+    Trim(resourceClass);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Gets the memory budget for a resource class.
+/// ---------------------------------------------------------------------------
+u64 prResourceManager::GetBudget(prResourceClass resourceClass) const
+{
+    PRASSERT(resourceClass >= 0 && resourceClass < PRRESOURCE_CLASS_MAX);
+    return m_budget[resourceClass];
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Gets the resident size of a resource class.
+/// ---------------------------------------------------------------------------
+u64 prResourceManager::Usage(prResourceClass resourceClass) const
+{
+    PRASSERT(resourceClass >= 0 && resourceClass < PRRESOURCE_CLASS_MAX);
+    return m_usage[resourceClass];
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Deletes all cached unreferenced resources.
+/// ---------------------------------------------------------------------------
+void prResourceManager::Purge()
+{
+    for (s32 i=0; i<PRRESOURCE_CLASS_MAX * PRRESOURCE_PRIORITY_MAX; i++)
+    {
+        while (m_cacheHead[i] != RESOURCE_NO_SLOT)
+        {
+            Destroy(m_pSlots[m_cacheHead[i]].pResource);
+        }
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Adds a reference, reviving the resource if its cached.
+/// ---------------------------------------------------------------------------
+void prResourceManager::Acquire(prResource *resource)
 {
-    prResource *resource;
+    PRASSERT(resource);
 
-    for (s32 i=0; i<RESOURCE_TABLE_SIZE; i++)
+    if (resource->References() == 0)
     {
-        std::list<prResource*>& list = m_resources[i];
+        CacheUnlink(resource->Handle() & PRRESOURCE_HANDLE_INDEX_MASK);
+    }
 
-        if (!list.empty())
+    resource->IncrementReferenceCount();
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Evicts cached resources until the class is within budget.
+/// ---------------------------------------------------------------------------
+void prResourceManager::Trim(prResourceClass resourceClass)
+{
+    PRASSERT(resourceClass >= 0 && resourceClass < PRRESOURCE_CLASS_MAX);
+
+    u32 *pHeads = &m_cacheHead[resourceClass * PRRESOURCE_PRIORITY_MAX];
+    s32  list   = 0;
+
+    while (m_usage[resourceClass] > m_budget[resourceClass] && list < PRRESOURCE_PRIORITY_MAX)
+    {
+        if (pHeads[list] == RESOURCE_NO_SLOT)
         {
-            std::list<prResource*>::iterator it  = list.begin();
-            std::list<prResource*>::iterator end = list.end();
+            list++;
+        }
+        else
+        {
+            Destroy(m_pSlots[pHeads[list]].pResource);
+        }
+    }
+}
 
-            for (; it != end; ++it)
-            {
-                resource = *it;
-                PRASSERT(resource);
-                resource->Unload();
-                delete resource;
-            }
 
-            list.clear();
+/// ---------------------------------------------------------------------------
+/// Updates the memory accounting of a slot.
+/// ---------------------------------------------------------------------------
+void prResourceManager::Account(u32 slot)
+{
+    Slot &entry = m_pSlots[slot];
+    PRASSERT(entry.pResource);
+
+    u32 size = entry.pResource->Size();
+    if (size != entry.size)
+    {
+        m_usage[entry.pResource->Class()] += size;
+        m_usage[entry.pResource->Class()] -= entry.size;
+        entry.size = size;
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Adds a slot to the end of its cache list, as the most recently used.
+/// ---------------------------------------------------------------------------
+void prResourceManager::CacheLink(u32 slot)
+{
+    Slot &entry = m_pSlots[slot];
+    PRASSERT(entry.pResource);
+    PRASSERT(entry.cacheList == RESOURCE_NO_SLOT);
+
+    u32 list = (entry.pResource->Class() * PRRESOURCE_PRIORITY_MAX) + entry.pResource->Priority();
+
+    entry.cacheList = list;
+    entry.cachePrev = m_cacheTail[list];
+    entry.cacheNext = RESOURCE_NO_SLOT;
+
+    if (m_cacheTail[list] != RESOURCE_NO_SLOT)
+    {
+        m_pSlots[m_cacheTail[list]].cacheNext = slot;
+    }
+    else
+    {
+        m_cacheHead[list] = slot;
+    }
+
+    m_cacheTail[list] = slot;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Removes a slot from its cache list.
+/// ---------------------------------------------------------------------------
+void prResourceManager::CacheUnlink(u32 slot)
+{
+    Slot &entry = m_pSlots[slot];
+
+    u32 list = entry.cacheList;
+    if (list != RESOURCE_NO_SLOT)
+    {
+        if (entry.cachePrev != RESOURCE_NO_SLOT)
+        {
+            m_pSlots[entry.cachePrev].cacheNext = entry.cacheNext;
+        }
+        else
+        {
+            m_cacheHead[list] = entry.cacheNext;
+        }
+
+        if (entry.cacheNext != RESOURCE_NO_SLOT)
+        {
+            m_pSlots[entry.cacheNext].cachePrev = entry.cachePrev;
+        }
+        else
+        {
+            m_cacheTail[list] = entry.cachePrev;
         }
+
+        entry.cacheList = RESOURCE_NO_SLOT;
+        entry.cachePrev = RESOURCE_NO_SLOT;
+        entry.cacheNext = RESOURCE_NO_SLOT;
     }
 }
 
@@ -223,9 +533,256 @@ void prResourceManager::Add(prResource *resource)
 {
     PRASSERT(resource);
 
-    u32 hash = resource->Hash();
+    // Detect hash collisions
+    #if defined(_DEBUG) || defined(DEBUG)
+    {
+        prResource *pExisting = Get(FindHandle(resource->Filename()));
+        if (pExisting == nullptr)
+        {
+            u32 mask  = m_bucketCount - 1;
+            u32 index = (u32)resource->Hash() & mask;
+
+            for (; m_pBuckets[index].slot != RESOURCE_EMPTY_BUCKET; index = (index + 1) & mask)
+            {
+                if (m_pBuckets[index].hash == resource->Hash())
+                {
+                    PRWARN("Resource hash collision: '%s' and '%s'", m_pSlots[m_pBuckets[index].slot].pResource->Filename(), resource->Filename());
+                }
+            }
+        }
+    }
+    #endif
+
+
+    // Get a slot
+    u32 index = m_freeSlot;
+    if (index != RESOURCE_NO_SLOT)
+    {
+        m_freeSlot = m_pSlots[index].nextFree;
+    }
+    else
+    {
+        PRASSERT(m_slotCount < RESOURCE_SLOTS_MAX, "Too many resources");
+
+        if (m_slotCount == m_slotCapacity)
+        {
+            Slot *pSlots = new Slot[m_slotCapacity * 2];
+            memcpy(pSlots, m_pSlots, m_slotCapacity * sizeof(Slot));
+            PRSAFE_DELETE_ARRAY(m_pSlots);
+            m_pSlots        = pSlots;
+            m_slotCapacity *= 2;
+        }
+
+        index = m_slotCount++;
+        m_pSlots[index].generation = 1;
+    }
+
+    Slot &slot = m_pSlots[index];
+    slot.pResource = resource;
+    slot.nextFree  = RESOURCE_NO_SLOT;
+    slot.cachePrev = RESOURCE_NO_SLOT;
+    slot.cacheNext = RESOURCE_NO_SLOT;
+    slot.cacheList = RESOURCE_NO_SLOT;
+    slot.size      = 0;
+    resource->m_handle = MakeHandle(index, slot.generation);
+
+
+    // Keep the load factor below 3/4, so probes stay short.
+    if ((m_count + 1) * 4 > m_bucketCount * 3)
+    {
+        Grow();
+    }
+
+    Insert(resource->Hash(), index);
+    m_count++;
+
+    // Loading may push the class over budget.
+    Account(index);
+    Trim(resource->Class());
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Inserts a hash table entry
+/// ---------------------------------------------------------------------------
+void prResourceManager::Insert(u64 hash, u32 slot)
+{
+    u32 mask  = m_bucketCount - 1;
+    u32 index = (u32)hash & mask;
+
+    while (m_pBuckets[index].slot != RESOURCE_EMPTY_BUCKET)
+    {
+        index = (index + 1) & mask;
+    }
+
+    m_pBuckets[index].hash = hash;
+    m_pBuckets[index].slot = slot;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Removes a hash table entry. Following entries are shifted back rather
+/// than leaving a tombstone, so probe lengths don't grow over time.
+/// ---------------------------------------------------------------------------
+void prResourceManager::Remove(u64 hash, u32 slot)
+{
+    u32 mask  = m_bucketCount - 1;
+    u32 index = (u32)hash & mask;
+
+    // Find the entry
+    while (m_pBuckets[index].slot != slot)
+    {
+        if (m_pBuckets[index].slot == RESOURCE_EMPTY_BUCKET)
+        {
+            PRWARN("Resource is not in the hash table");
+            return;
+        }
+
+        index = (index + 1) & mask;
+    }
+
+    // Shift back any entries which would no longer be reachable
+    u32 next = index;
+    for (;;)
+    {
+        next = (next + 1) & mask;
+        if (m_pBuckets[next].slot == RESOURCE_EMPTY_BUCKET)
+        {
+            break;
+        }
+
+        // Skip entries whose home lies cyclically within (index, next]
+        u32  home = (u32)m_pBuckets[next].hash & mask;
+        bool stay = (index <= next) ? (index < home && home <= next) : (index < home || home <= next);
+        if (!stay)
+        {
+            m_pBuckets[index] = m_pBuckets[next];
+            index = next;
+        }
+    }
+
+    m_pBuckets[index].slot = RESOURCE_EMPTY_BUCKET;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Doubles the hash table size
+/// ---------------------------------------------------------------------------
+void prResourceManager::Grow()
+{
+    Bucket *pOld     = m_pBuckets;
+    u32     oldCount = m_bucketCount;
+
+    m_bucketCount *= 2;
+    m_pBuckets     = new Bucket[m_bucketCount];
+
+    for (u32 i=0; i<m_bucketCount; i++)
+    {
+        m_pBuckets[i].hash = 0;
+        m_pBuckets[i].slot = RESOURCE_EMPTY_BUCKET;
+    }
+
+    for (u32 i=0; i<oldCount; i++)
+    {
+        if (pOld[i].slot != RESOURCE_EMPTY_BUCKET)
+        {
+            Insert(pOld[i].hash, pOld[i].slot);
+        }
+    }
+
+    PRSAFE_DELETE_ARRAY(pOld);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Completes asynchronous loads.
+/// ---------------------------------------------------------------------------
+void prResourceManager::Update(f32 budget)
+{
+    if (m_pLoader)
+    {
+        m_pLoader->Update(budget);
+    }
+
+    // Account for the sizes of completed loads.
+    if (m_usageDirty)
+    {
+        for (u32 i=0; i<m_slotCount; i++)
+        {
+            if (m_pSlots[i].pResource)
+            {
+                Account(i);
+            }
+        }
+
+        for (s32 i=0; i<PRRESOURCE_CLASS_MAX; i++)
+        {
+            Trim((prResourceClass)i);
+        }
+
+        m_usageDirty = (Pending() > 0);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Waits for an asynchronous load to complete.
+/// ---------------------------------------------------------------------------
+void prResourceManager::Wait(prResource *resource)
+{
+    PRASSERT(resource);
+
+    if (m_pLoader && resource->State() == PRRESOURCE_STATE_LOADING)
+    {
+        m_pLoader->Complete(resource);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Gets the number of asynchronous loads which have not completed
+/// ---------------------------------------------------------------------------
+u32 prResourceManager::Pending() const
+{
+    return m_pLoader ? m_pLoader->Pending() : 0;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Queues a resource for asynchronous loading
+/// ---------------------------------------------------------------------------
+void prResourceManager::QueueAsync(prResource *resource, s32 extra, prResourceCallback callback, void *pUserData)
+{
+    PRASSERT(resource);
+
+    // Leave a core for the main thread.
+    if (m_pLoader == nullptr)
+    {
+        u32 threads = prThreadHardwareCount();
+        m_pLoader   = new prResourceLoader(threads > 1 ? threads - 1 : 1);
+    }
+
+    m_pLoader->Queue(resource, extra, callback, pUserData);
+    m_usageDirty = true;
+}
 
-    std::list<prResource*>& list = m_resources[hash % RESOURCE_TABLE_SIZE];
 
-    list.push_back(resource);
+/// ---------------------------------------------------------------------------
+/// Calls back when a resource is loaded. Immediately if its already loaded
+/// ---------------------------------------------------------------------------
+void prResourceManager::AddListener(prResource *resource, prResourceCallback callback, void *pUserData)
+{
+    PRASSERT(resource);
+
+    if (callback)
+    {
+        if (m_pLoader && resource->State() == PRRESOURCE_STATE_LOADING)
+        {
+            m_pLoader->AddListener(resource, callback, pUserData);
+        }
+        else
+        {
+            callback(resource, pUserData);
+        }
+    }
 }
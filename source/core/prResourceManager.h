@@ -19,12 +19,16 @@
 #pragma once
 
 
-#include <list>
 #include "prResource.h"
 #include "prCoreSystem.h"
 
 
-#define RESOURCE_TABLE_SIZE     64
+#define RESOURCE_TABLE_SIZE     64                              // Initial hash table size. Must be a power of 2
+#define RESOURCE_UPLOAD_BUDGET  2.0f
+
+
+// Forward declarations
+class prResourceLoader;
 
 
 // Class: prResourceManager
@@ -61,7 +65,8 @@ public:
         prResource *pRes = Find(filename);
         if (pRes)
         {
-            pRes->IncrementReferenceCount();
+            Acquire(pRes);
+            Wait(pRes);
             return (T*)pRes;
         }
 
@@ -77,6 +82,47 @@ public:
         return resource;
     }
 
+    // Method: LoadAsync
+    //      Loads a resource into the resource manager asynchronously.
+    //
+    // Parameters:
+    //      filename  - A char pointer to a filename string
+    //      locked    - Is this a locked resource?
+    //      extra     - Resource specific load settings
+    //      callback  - Optional callback, called on the main thread when loading completes or fails
+    //      pUserData - Optional data passed to the callback
+    //
+    // Notes:
+    //      The resource is returned immediately. File reads and decoding are performed by
+    //      loader threads, then the load is completed by <Update> on the main thread.
+    //      Use <prResource::State> or the callback to find when the resource is ready.
+    //
+    // Returns:
+    //      A resource
+    template<typename T>
+    T* LoadAsync(const char *filename, bool locked = false, s32 extra = 0, prResourceCallback callback = nullptr, void *pUserData = nullptr)
+    {
+        // Created resource?
+        prResource *pRes = Find(filename);
+        if (pRes)
+        {
+            Acquire(pRes);
+            AddListener(pRes, callback, pUserData);
+            return (T*)pRes;
+        }
+
+        // Create new resource and store it.
+        T *resource = new T(filename);
+        if (resource)
+        {
+            resource->Lock(locked);
+            Add(resource);
+            QueueAsync(resource, extra, callback, pUserData);
+        }
+
+        return resource;
+    }
+
     // Method: LoadFromMemory
     //      Creates a resource from data in memory. This is to
     //      allow embedded textures to be used
@@ -95,7 +141,7 @@ public:
         prResource *pRes = Find(name);
         if (pRes)
         {
-            pRes->IncrementReferenceCount();
+            Acquire(pRes);
             return (T*)pRes;
         }
 
@@ -144,6 +190,24 @@ public:
     //      resource - A pointer to a resource
     void Unload(prResource *resource);
 
+    // Method: Update
+    //      Completes asynchronous loads. Called once per frame on the main thread.
+    //
+    // Parameters:
+    //      budget - Time budget in milliseconds
+    void Update(f32 budget = RESOURCE_UPLOAD_BUDGET);
+
+    // Method: Wait
+    //      Waits for an asynchronous load to complete.
+    //
+    // Parameters:
+    //      resource - A pointer to a resource
+    void Wait(prResource *resource);
+
+    // Method: Pending
+    //      Gets the number of asynchronous loads which have not completed
+    u32 Pending() const;
+
     // Method: Find
     //      Finds a resource by name.
     //
@@ -153,6 +217,29 @@ public:
     // Returns:
     //      A resource or NULL
     prResource *Find(const char *filename);
+
+    // Method: FindHandle
+    //      Finds a resources handle by name.
+    //
+    // Parameters:
+    //      filename - A char pointer to a filename string
+    //
+    // Returns:
+    //      A handle or PRRESOURCE_INVALID_HANDLE
+    prResourceHandle FindHandle(const char *filename) const;
+
+    // Method: Get
+    //      Gets a resource from its handle.
+    //
+    // Parameters:
+    //      handle - A resource handle
+    //
+    // Returns:
+    //      The resource, or NULL if the handle is invalid or the resource has been unloaded
+    //
+    // Notes:
+    //      Holding handles rather than pointers allows unloaded resources to be detected.
+    prResource *Get(prResourceHandle handle) const;
     
     // Method: DisplayUsage
     //      Shows all entries
@@ -172,6 +259,36 @@ public:
     //      This will clear locked resources, so beware
     void Clear();
 
+    // Method: SetBudget
+    //      Sets the memory budget for a resource class.
+    //
+    // Parameters:
+    //      resourceClass - The resource class
+    //      bytes         - The budget in bytes. Zero disables caching
+    //
+    // Notes:
+    //      With a budget, resources stay resident after their last reference is
+    //      unloaded, so they can be reused without reloading. Once the classes
+    //      resident size exceeds the budget, unreferenced resources are evicted
+    //      lowest priority first, then least recently used first.
+    //
+    // Notes:
+    //      Referenced and locked resources are never evicted. The default budget
+    //      is zero, so resources are deleted as soon as they're unreferenced.
+    void SetBudget(prResourceClass resourceClass, u64 bytes);
+
+    // Method: GetBudget
+    //      Gets the memory budget for a resource class.
+    u64 GetBudget(prResourceClass resourceClass) const;
+
+    // Method: Usage
+    //      Gets the resident size of a resource class in bytes, including cached resources.
+    u64 Usage(prResourceClass resourceClass) const;
+
+    // Method: Purge
+    //      Deletes all cached unreferenced resources.
+    void Purge();
+
 
 private:
 
@@ -179,11 +296,81 @@ private:
     //      Adds a resource
     void Add(prResource *resource);
 
+    // Method: QueueAsync
+    //      Queues a resource for asynchronous loading
+    void QueueAsync(prResource *resource, s32 extra, prResourceCallback callback, void *pUserData);
+
+    // Method: AddListener
+    //      Calls back when a resource is loaded. Immediately if its already loaded
+    void AddListener(prResource *resource, prResourceCallback callback, void *pUserData);
+
     /// @brief      Adds a resource
     /*void ClearLocked();*/
 
+    // Adds a reference, reviving the resource if its cached
+    void Acquire(prResource *resource);
+
+    // Removes a resource from the manager and deletes it
+    void Destroy(prResource *resource);
+
+    // Evicts cached resources until the class is within budget
+    void Trim(prResourceClass resourceClass);
+
+    // Updates the memory accounting of a slot
+    void Account(u32 slot);
+
+    // Adds a slot to the end of its cache list
+    void CacheLink(u32 slot);
+
+    // Removes a slot from its cache list
+    void CacheUnlink(u32 slot);
+
+    // Inserts a hash table entry
+    void Insert(u64 hash, u32 slot);
+
+    // Removes a hash table entry
+    void Remove(u64 hash, u32 slot);
+
+    // Doubles the hash table size
+    void Grow();
+
+
+private:
+    // Hash table entry. Open addressing with linear probing.
+    typedef struct Bucket
+    {
+        u64 hash;
+        u32 slot;                                   // Index into the slot table, or RESOURCE_EMPTY_BUCKET
+
+    } Bucket;
+
+    // Slot table entry. Slots are reused, so the generation identifies the current resource.
+    typedef struct Slot
+    {
+        prResource *pResource;
+        u32         generation;
+        u32         nextFree;
+        u32         cachePrev;                      // Cache list links. Unreferenced resources only
+        u32         cacheNext;
+        u32         cacheList;                      // Cache list index, or RESOURCE_NO_SLOT if not cached
+        u32         size;                           // The size accounted to the resources class
+
+    } Slot;
+
 
 private:
 
-    std::list<prResource*>    m_resources[RESOURCE_TABLE_SIZE];
+    Bucket                   *m_pBuckets;
+    u32                       m_bucketCount;
+    Slot                     *m_pSlots;
+    u32                       m_slotCount;
+    u32                       m_slotCapacity;
+    u32                       m_freeSlot;
+    u32                       m_count;
+    u64                       m_budget[PRRESOURCE_CLASS_MAX];
+    u64                       m_usage[PRRESOURCE_CLASS_MAX];
+    u32                       m_cacheHead[PRRESOURCE_CLASS_MAX * PRRESOURCE_PRIORITY_MAX];     // Least recently used
+    u32                       m_cacheTail[PRRESOURCE_CLASS_MAX * PRRESOURCE_PRIORITY_MAX];     // Most recently used
+    bool                      m_usageDirty;                                                     // Asynchronous loads may have changed sizes
+    prResourceLoader         *m_pLoader;
 };
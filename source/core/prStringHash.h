@@ -0,0 +1,98 @@
+// File: prStringHash.h
+//      64 bit string hashing, with a compile time version for string literals.
+/**
+ * Copyright 2014 Paul Michael McNab
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+
+#include "prTypes.h"
+
+
+// Hash constants
+#define PRHASH64_SEED       0x27D4EB2F165667C5ULL
+#define PRHASH64_PRIME1     0x9E3779B185EBCA87ULL
+#define PRHASH64_PRIME2     0xC2B2AE3D27D4EB4FULL
+#define PRHASH64_PRIME3     0x165667B19E3779F9ULL
+
+
+// Namespace: prStringHashImpl
+//      The hash is built from single expression constexpr functions, so the
+//      same code can be used at compile time (C++11) and run time. Strings are
+//      consumed in little endian 8 byte words.
+namespace prStringHashImpl
+{
+    // Rotates left
+    constexpr u64 Rotl(u64 x, u32 r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    // Mixes a word into the accumulator
+    constexpr u64 Round(u64 acc, u64 word)
+    {
+        return Rotl(acc + word * PRHASH64_PRIME2, 31) * PRHASH64_PRIME1;
+    }
+
+    // Shift xor
+    constexpr u64 ShiftXor(u64 h, u32 s)
+    {
+        return h ^ (h >> s);
+    }
+
+    // Final mix, so every input bit affects every output bit
+    constexpr u64 Avalanche(u64 h)
+    {
+        return ShiftXor(ShiftXor(ShiftXor(h, 33) * PRHASH64_PRIME2, 29) * PRHASH64_PRIME3, 32);
+    }
+
+    // Number of bytes in the next word. (0 to 8)
+    constexpr u32 WordLength(const char *s, u32 i)
+    {
+        return (i == 8 || s[i] == '\0') ? i : WordLength(s, i + 1);
+    }
+
+    // Reads the next word. Bytes after the terminator are zero.
+    constexpr u64 Word(const char *s, u32 i)
+    {
+        return (i == 8 || s[i] == '\0') ? 0 : ((u64)(u8)s[i] << (i * 8)) | Word(s, i + 1);
+    }
+
+    // Hashes the remaining words
+    constexpr u64 Hash(const char *s, u64 acc, u64 length)
+    {
+        return (*s == '\0') ? Avalanche(acc + length)
+                            : Hash(s + WordLength(s, 0), Round(acc, Word(s, 0)), length + WordLength(s, 0));
+    }
+}
+
+
+// Function: prStringHash64Const
+//      Turns a string into a 64 bit hash at compile time.
+//
+// Parameters:
+//      string - The string to convert
+//
+// Returns:
+//      The same value as <prStringHash64>
+//
+// Notes:
+//      For string literals. Use <prStringHash64> for run time strings, as its faster.
+constexpr u64 prStringHash64Const(const char *string)
+{
+    return prStringHashImpl::Hash(string, PRHASH64_SEED, 0);
+}
@@ -60,6 +60,46 @@ u32 prStringHash(const char* string)
 }
 
 
+/// ---------------------------------------------------------------------------
+/// Turns a string into a 64 bit hash. Must match prStringHash64Const.
+/// ---------------------------------------------------------------------------
+u64 prStringHash64(const char* string)
+{
+    PRASSERT(string);
+
+    u64 acc    = PRHASH64_SEED;
+    u64 length = 0;
+
+    for (;;)
+    {
+        // Read the next word
+        u64 word = 0;
+        u32 size = 0;
+        while (size < 8 && string[size] != '\0')
+        {
+            word |= (u64)(u8)string[size] << (size * 8);
+            size++;
+        }
+
+        if (size == 0)
+        {
+            break;
+        }
+
+        acc     = prStringHashImpl::Round(acc, word);
+        length += size;
+        string += size;
+
+        if (size < 8)
+        {
+            break;
+        }
+    }
+
+    return prStringHashImpl::Avalanche(acc + length);
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Changes every occurrence of the search character with the replace character.
 /// ---------------------------------------------------------------------------
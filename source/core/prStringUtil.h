@@ -21,6 +21,7 @@
 
 #include "prTypes.h"
 #include "prStringShared.h"
+#include "prStringHash.h"
 
 
 // Function: prStringHash
@@ -31,8 +32,25 @@
 //
 // Returns:
 //      The string as a number
+//
+// Notes:
+//      This hash collides readily, so <prStringHash64> should be used for
+//      lookups. It's kept as its values are stored in existing data.
 u32 prStringHash(const char* string);
 
+// Function: prStringHash64
+//      Turns a string into a well distributed 64 bit hash.
+//
+// Parameters:
+//      string - The string to convert
+//
+// Returns:
+//      The string as a number
+//
+// Notes:
+//      <prStringHash64Const> returns the same value at compile time.
+u64 prStringHash64(const char* string);
+
 // Function: prStringReplaceChar
 //      Changes every occurrence of the search character with the replace character.
 //
@@ -35,6 +35,7 @@
 #include <windows.h>
 #include <stdio.h>
 #include "prAssert.h"
+#include "prTrace.h"
 
 
 #define TEXT_BUFFER_SIZE    2048
@@ -76,6 +77,9 @@ int prAssertPrint(const char *cond, const char *file, const char *function, int
     // Create dialog message
     sprintf_s(buffer, sizeof(buffer), format, cond, message, file, line, function);
 
+    // Make sure the log is complete, in case the program is stopped.
+    prTraceFlush();
+
     // Create dialog
     int result = MessageBoxA(HWND_DESKTOP, buffer, "Assertion failure", MB_ABORTRETRYIGNORE | MB_ICONERROR | MB_TASKMODAL);
 
@@ -126,6 +130,9 @@ void prPanicPrint(const char *file, const char *function, int line, const char *
     // Create dialog message
     sprintf_s(buffer, sizeof(buffer), format, message, file, line, function);
 
+    // Make sure the log is complete, in case the program is stopped.
+    prTraceFlush();
+
     // Create dialog
     MessageBoxA(HWND_DESKTOP, buffer, "Panic", MB_OK | MB_ICONERROR | MB_TASKMODAL);
 }
@@ -164,6 +171,9 @@ int prWarnPrint(const char *file, const char *function, int line, const char *fm
     // Create dialog message
     sprintf_s(buffer, sizeof(buffer), format, message, file, line, function);
 
+    // Make sure the log is complete, in case the program is stopped.
+    prTraceFlush();
+
     // Create dialog
     int result = MessageBoxA(HWND_DESKTOP, buffer, "Warning", MB_YESNO | MB_ICONWARNING | MB_TASKMODAL);
 
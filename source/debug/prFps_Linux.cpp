@@ -23,9 +23,13 @@
 #if defined(PLATFORM_LINUX)
 
 
-#include <time.h>
 #include "prFps_Linux.h"
 #include "prTrace.h"
+#include "../core/prClock.h"
+
+
+// Defines
+#define NANOSECONDS_PER_SECOND  1000000000ULL
 
 
 /// ---------------------------------------------------------------------------
@@ -50,10 +54,10 @@ prFps_Linux::~prFps_Linux()
 /// ---------------------------------------------------------------------------
 void prFps_Linux::Reset()
 {
-    ticksPerSecond = 0LL;
+    ticksPerSecond = NANOSECONDS_PER_SECOND;
     timeTotal      = 0LL;
     timeEnd        = 0LL;
-    timeStart      = clock();
+    timeStart      = prClockNanoseconds();
     frames         = 0;
     frameRate      = 0;
     frameRateMin   = 1000000;
@@ -66,21 +70,18 @@ void prFps_Linux::Reset()
 /// ---------------------------------------------------------------------------
 void prFps_Linux::Begin()
 {
-    // Find the time taken.
-    timeTotal = (clock() - timeStart);
+    // Find the time taken. This is wall time, as clock() measures CPU time.
+    timeTotal = (prClockNanoseconds() - timeStart);
 
     // Exceeded one second?
-    if (timeTotal >= CLOCKS_PER_SEC)
+    if (timeTotal >= ticksPerSecond)
     {
         frameRate  = frames;                // Sets the number of frames completed.
         frames     = 0;                     // Resets the frame count.
-        timeStart  = clock();               // Reset the start time.
+        timeStart  = prClockNanoseconds();  // Reset the start time.
 
         // Remove seconds from the total time taken.
-        while (timeTotal >= CLOCKS_PER_SEC)
-        {
-            timeTotal -= CLOCKS_PER_SEC;
-        }
+        timeTotal %= ticksPerSecond;
 
         // Set min/max
         if (frameRate < frameRateMin)
@@ -0,0 +1,310 @@
+/**
+ * prLogWriter.cpp
+ *
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "../prConfig.h"
+#include <string.h>
+#include "prLogWriter.h"
+#include "prAssert.h"
+#include "prTrace.h"
+#include "../core/prMacros.h"
+
+
+// Defines
+#define RING_MASK       (PRLOGWRITER_RING_SIZE - 1)
+
+
+PRCOMPILER_ASSERT((PRLOGWRITER_RING_SIZE & RING_MASK) == 0);
+
+
+prLogWriter prLogWriter::m_instance;
+
+
+// Local data
+namespace
+{
+    // The calling thread's buffer, and whether it failed to get one.
+    thread_local void  *threadBuffer = nullptr;
+    thread_local bool   threadFull   = false;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Ctor
+/// ---------------------------------------------------------------------------
+prLogWriter::prLogWriter() : m_bufferCount  (0)
+                           , m_open         (false)
+                           , m_pending      (false)
+                           , m_exit         (false)
+                           , m_pThread      (nullptr)
+                           , m_wake         (0)
+                           , m_fp           (nullptr)
+{
+    for (u32 i=0; i<PRLOGWRITER_MAX_THREADS; i++)
+    {
+        m_buffers[i].store(nullptr);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Dtor
+/// ---------------------------------------------------------------------------
+prLogWriter::~prLogWriter()
+{
+    Close();
+
+    for (u32 i=0; i<PRLOGWRITER_MAX_THREADS; i++)
+    {
+        ThreadBuffer *pBuffer = m_buffers[i].load();
+        PRSAFE_DELETE(pBuffer);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Opens a log file to append to, and starts the writer thread.
+/// ---------------------------------------------------------------------------
+bool prLogWriter::Open(const char *filename)
+{
+    PRASSERT(filename && *filename);
+
+    Close();
+
+    FILE *fp = fopen(filename, "a");
+    if (fp == nullptr)
+    {
+        PRWARN("Failed to open log file '%s'", filename);
+        return false;
+    }
+
+    m_drain.Lock();
+    m_fp = fp;
+    m_drain.Unlock();
+
+    m_exit.store(false);
+    m_pThread = new prThread(WriterThread, this, false);
+    m_open.store(true);
+
+    return true;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Writes the buffered text, then closes the log file.
+/// ---------------------------------------------------------------------------
+void prLogWriter::Close()
+{
+    if (m_pThread)
+    {
+        m_open.store(false);
+        m_exit.store(true);
+        m_wake.Signal();
+
+        m_pThread->Join();
+        PRSAFE_DELETE(m_pThread);
+    }
+
+    m_drain.Lock();
+
+    if (m_fp)
+    {
+        Drain();
+        fclose(m_fp);
+        m_fp = nullptr;
+    }
+
+    m_drain.Unlock();
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Appends text to the log.
+/// ---------------------------------------------------------------------------
+void prLogWriter::Write(const char *text, u32 length)
+{
+    PRASSERT(text);
+
+    if (!IsOpen() || length == 0)
+    {
+        return;
+    }
+
+    ThreadBuffer *pBuffer = GetThreadBuffer();
+    if (pBuffer == nullptr)
+    {
+        return;
+    }
+
+    length = PRMIN(length, (u32)PRLOGWRITER_RING_SIZE);
+
+    // Wait for the writer to make room.
+    u32 written = pBuffer->written.load(std::memory_order_relaxed);
+
+    while ((written - pBuffer->read.load(std::memory_order_acquire)) + length > PRLOGWRITER_RING_SIZE)
+    {
+        if (!IsOpen())
+        {
+            return;
+        }
+
+        Wake();
+        prThreadYield();
+    }
+
+    // Copy, wrapping around the end of the ring.
+    u32 start = written & RING_MASK;
+    u32 first = PRMIN(length, (u32)PRLOGWRITER_RING_SIZE - start);
+
+    memcpy(&pBuffer->text[start], text, first);
+    memcpy(&pBuffer->text[0], text + first, length - first);
+
+    pBuffer->written.store(written + length);
+
+    Wake();
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Writes the buffered text now, and waits until it is written.
+/// ---------------------------------------------------------------------------
+void prLogWriter::Flush()
+{
+    m_drain.Lock();
+
+    if (m_fp)
+    {
+        Drain();
+    }
+
+    m_drain.Unlock();
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Gets the calling thread's buffer, creating it if needed.
+/// ---------------------------------------------------------------------------
+prLogWriter::ThreadBuffer *prLogWriter::GetThreadBuffer()
+{
+    ThreadBuffer *pBuffer = static_cast<ThreadBuffer *>(threadBuffer);
+
+    if (pBuffer == nullptr && !threadFull)
+    {
+        u32 index = m_bufferCount.fetch_add(1);
+        if (index >= PRLOGWRITER_MAX_THREADS)
+        {
+            // Can't log this, as logging is what failed.
+            threadFull = true;
+            return nullptr;
+        }
+
+        pBuffer = new ThreadBuffer;
+        pBuffer->written.store(0);
+        pBuffer->read.store(0);
+
+        threadBuffer = pBuffer;
+        m_buffers[index].store(pBuffer, std::memory_order_release);
+    }
+
+    return pBuffer;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Wakes the writer thread, unless it has already been woken.
+/// ---------------------------------------------------------------------------
+void prLogWriter::Wake()
+{
+    // The writer clears the flag before it drains, so any text added
+    // after that either gets drained or wakes it again.
+    if (!m_pending.exchange(true))
+    {
+        m_wake.Signal();
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Writes the buffered text to the file. The drain mutex must be held.
+/// ---------------------------------------------------------------------------
+void prLogWriter::Drain()
+{
+    PRASSERT(m_fp);
+
+    u32  count = PRMIN(m_bufferCount.load(), (u32)PRLOGWRITER_MAX_THREADS);
+    bool wrote = false;
+
+    for (u32 i=0; i<count; i++)
+    {
+        ThreadBuffer *pBuffer = m_buffers[i].load(std::memory_order_acquire);
+        if (pBuffer == nullptr)
+        {
+            continue;
+        }
+
+        u32 read    = pBuffer->read.load(std::memory_order_relaxed);
+        u32 written = pBuffer->written.load();
+
+        if (read != written)
+        {
+            u32 start  = read & RING_MASK;
+            u32 length = written - read;
+            u32 first  = PRMIN(length, (u32)PRLOGWRITER_RING_SIZE - start);
+
+            fwrite(&pBuffer->text[start], 1, first, m_fp);
+            fwrite(&pBuffer->text[0], 1, length - first, m_fp);
+
+            pBuffer->read.store(written, std::memory_order_release);
+            wrote = true;
+        }
+    }
+
+    if (wrote)
+    {
+        fflush(m_fp);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// The writer thread.
+/// ---------------------------------------------------------------------------
+PRTHREAD_RETVAL PRTHREAD_CALLCONV prLogWriter::WriterThread(void *pData)
+{
+    PRASSERT(pData);
+    prLogWriter *pWriter = static_cast<prLogWriter *>(pData);
+
+    while (!pWriter->m_exit.load())
+    {
+        pWriter->m_wake.Wait();
+
+        // Let more text build up, so it's written in fewer, larger writes.
+        if (!pWriter->m_exit.load())
+        {
+            prThreadSleep(PRLOGWRITER_BATCH_TIME);
+        }
+
+        pWriter->m_pending.store(false);
+
+        pWriter->m_drain.Lock();
+        pWriter->Drain();
+        pWriter->m_drain.Unlock();
+    }
+
+    return 0;
+}
@@ -0,0 +1,144 @@
+// File: prLogWriter.h
+//      Writes log text to a file from a background thread.
+//
+// Notes:
+//      Log text is appended to a ring buffer owned by each thread, so
+//      logging takes no locks and never waits on the file.
+/**
+ * Copyright 2014 Paul Michael McNab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+
+#include <atomic>
+#include <stdio.h>
+#include "../core/prTypes.h"
+#include "../thread/prMutex.h"
+#include "../thread/prSemaphore.h"
+#include "../thread/prThread.h"
+
+
+// Defines
+#define PRLOGWRITER_MAX_THREADS     64              // Threads which can write to the log
+#define PRLOGWRITER_RING_SIZE       65536           // Bytes buffered per thread. Must be a power of two
+#define PRLOGWRITER_BATCH_TIME      10              // Milliseconds the writer waits to gather more text before writing
+
+
+// Class: prLogWriter
+//      Writes log text to a file from a background thread.
+//
+// Notes:
+//      The file stays open while logging, and the writer thread writes
+//      whatever text has built up in one batch.
+//
+//      Text from one thread is written in order, but text from different
+//      threads may be written out of order with each other.
+//
+//      A thread whose ring buffer is full waits for the writer to drain it.
+//
+// Notes:
+//      This class is a singleton
+class prLogWriter
+{
+public:
+    // Method: GetInstance
+    //      Returns a reference to the log writer instance.
+    static prLogWriter& GetInstance() { return m_instance; }
+
+    // Method: Open
+    //      Opens a log file to append to, and starts the writer thread.
+    //
+    // Parameters:
+    //      filename - The log file
+    //
+    // Returns:
+    //      true on success, false if the file could not be opened
+    //
+    // Notes:
+    //      Closes the previous log file.
+    bool Open(const char *filename);
+
+    // Method: Close
+    //      Writes the buffered text, then closes the log file.
+    void Close();
+
+    // Method: IsOpen
+    //      Determines if a log file is open.
+    bool IsOpen() const { return m_open.load(std::memory_order_relaxed); }
+
+    // Method: Write
+    //      Appends text to the log. Can be called from any thread.
+    //
+    // Parameters:
+    //      text   - The text to write
+    //      length - The length of the text
+    void Write(const char *text, u32 length);
+
+    // Method: Flush
+    //      Writes the buffered text now, and waits until it is written.
+    //
+    // Notes:
+    //      Only text which has been completely written by its thread is
+    //      written.
+    void Flush();
+
+
+private:
+    // The text of one thread. Only the owning thread adds text to it.
+    typedef struct ThreadBuffer
+    {
+        char                    text[PRLOGWRITER_RING_SIZE];
+        std::atomic<u32>        written;            // Bytes added. Indexes the ring modulo its size
+        std::atomic<u32>        read;               // Bytes written to the file
+
+    } ThreadBuffer;
+
+
+private:
+    // This class is true singleton. You cannot create an instance.
+    prLogWriter();
+    ~prLogWriter();
+
+    // Gets the calling thread's buffer, creating it if needed.
+    ThreadBuffer *GetThreadBuffer();
+
+    // Wakes the writer thread, unless it has already been woken.
+    void Wake();
+
+    // Writes the buffered text to the file.
+    void Drain();
+
+    // The writer thread.
+    static PRTHREAD_RETVAL PRTHREAD_CALLCONV WriterThread(void *pData);
+
+    // Stop passing by value and assignment.
+    prLogWriter(const prLogWriter&);
+    const prLogWriter& operator = (const prLogWriter&);
+
+
+private:
+    static prLogWriter              m_instance;
+    std::atomic<ThreadBuffer *>     m_buffers[PRLOGWRITER_MAX_THREADS];
+    std::atomic<u32>                m_bufferCount;
+    std::atomic<bool>               m_open;
+    std::atomic<bool>               m_pending;          // Set when text has been added since the writer was woken
+    std::atomic<bool>               m_exit;
+    prThread                       *m_pThread;
+    prSemaphore                     m_wake;
+    prMutex                         m_drain;            // Held while writing to the file
+    FILE                           *m_fp;
+};
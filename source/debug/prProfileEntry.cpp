@@ -20,29 +20,8 @@
 #include "../prConfig.h"
 
 
-#if defined(PLATFORM_PC)
-  // Exclude MFC
-  #ifndef WIN32_LEAN_AND_MEAN
-  #define WIN32_LEAN_AND_MEAN
-  #endif
-  #ifndef WIN32_EXTRA_LEAN
-  #define WIN32_EXTRA_LEAN
-  #endif
-
-  #include <windows.h>
-
-
-#elif defined (PLATFORM_IOS)
-  #include <mach/mach_time.h>
-
-#elif defined(PLATFORM_ANDROID)
-  #include <string.h>
-  #include <time.h>
-
-#endif
-
-
 #include "prProfileEntry.h"
+#include "../core/prClock.h"
 
 
 //using namespace Proteus::Core;
@@ -52,7 +31,6 @@
 /// Defines
 /// ---------------------------------------------------------------------------
 #define INITIAL_TIME                999999.0f
-#define BILLION                     1000000000LL
 
 
 /// ---------------------------------------------------------------------------
@@ -87,32 +65,8 @@ prProfileEntry::~prProfileEntry()
 /// ---------------------------------------------------------------------------
 void prProfileEntry::Start()
 {
-#if defined(PLATFORM_PC)
-
-    // Get start time
-    LARGE_INTEGER timenow;
-    if (QueryPerformanceCounter(&timenow))
-    {
-        m_timeStart = timenow.QuadPart;
-    }
-    
-#elif defined (PLATFORM_IOS)
-    
     // Get start time
-    m_timeStart = mach_absolute_time();
-
-#elif defined(PLATFORM_ANDROID)
-
-    // Get start time
-    m_startTime.tv_sec  = 0;
-    m_startTime.tv_nsec = 0;
-    m_endTime.tv_sec    = 0;
-    m_endTime.tv_nsec   = 0;
-//    clock_gettime(CLOCK_MONOTONIC_HR, &m_startTime);
-//    clock_gettime(CLOCK_MONOTONIC_RAW, &m_startTime);
-    clock_gettime(CLOCK_MONOTONIC, &m_startTime);
-
-#endif
+    m_timeStart = prClockNanoseconds();
 }
 
 
@@ -121,44 +75,8 @@ void prProfileEntry::Start()
 /// ---------------------------------------------------------------------------
 void prProfileEntry::Stop()
 {
-#if defined(PLATFORM_PC)
-
     // Get stop time
-    LARGE_INTEGER timenow;
-    if (QueryPerformanceCounter(&timenow))
-    {
-        u64 timeEnd = timenow.QuadPart;
-        Update(timeEnd - m_timeStart);
-    }
-    
-#elif defined (PLATFORM_IOS)
-    
-    // Get stop time
-    u64 timeEnd = mach_absolute_time();
-    u64 time    = timeEnd - m_timeStart;
-    
-    // Get the timebase info
-    mach_timebase_info_data_t info;
-    mach_timebase_info(&info);
-
-    // Convert to nanoseconds
-    time *= info.numer;
-    time /= info.denom;
-    
-    Update(time);
-    
-#elif defined(PLATFORM_ANDROID)
-
-    // Get stop time
-    if (clock_gettime(CLOCK_MONOTONIC, &m_endTime) == 0)
-    {
-        // Calculate time it took
-        u64 start  = (m_startTime.tv_sec * BILLION) + m_startTime.tv_nsec;
-        u64 finish = (m_endTime.tv_sec   * BILLION) + m_endTime.tv_nsec;
-        u64 period = finish - start;
-        Update(period);
-    }
-#endif
+    Update(prClockNanoseconds() - m_timeStart);
 }
 
 
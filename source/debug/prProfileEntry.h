@@ -24,11 +24,6 @@
 #include "../core/prString.h"
 
 
-#if defined(PLATFORM_ANDROID)
-#include <time.h>
-#endif
-
-
 // Class: prProfileEntry
 //      Contains a class that is used to update a profiling entry in the profile manager.
 //
@@ -75,11 +70,4 @@ public:
     f32         m_total;
     f32         m_frequency;
     u64         m_timeStart;
-
-#if defined(PLATFORM_ANDROID)
-    
-    timespec    m_startTime;
-    timespec    m_endTime;
-
-#endif
 };
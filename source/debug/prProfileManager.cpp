@@ -25,20 +25,6 @@
 #define PROFILE                     // Do not remove or we won't get the class definition.
 
 
-#if defined(PLATFORM_PC)
-  // Exclude MFC
-  #ifndef WIN32_LEAN_AND_MEAN
-  #define WIN32_LEAN_AND_MEAN
-  #endif
-  #ifndef WIN32_EXTRA_LEAN
-  #define WIN32_EXTRA_LEAN
-  #endif
-
-  #include <windows.h>
-
-#endif
-
-
 #include <stdio.h>
 #include "prProfileManager.h"
 #include "prProfileEntry.h"
@@ -70,32 +56,8 @@ prProfileManager::prProfileManager()
         m_entries[i] = nullptr;
     }
 
-#if defined(PLATFORM_PC)
-
-    // Calculate frequency here, so we only do it once
-    LARGE_INTEGER countsPerSecond;
-    if (QueryPerformanceFrequency(&countsPerSecond))
-    {
-        // Get the timers counts per millisecond.
-        m_frequency = ((float)countsPerSecond.QuadPart) / 1000.0f;
-    }
-    else
-    {
-        PRWARN("High performance timer not supported. Profiling will not work.");    
-        m_frequency = 0.0f;
-    }
-
-#elif defined(PLATFORM_IOS)
-
-    // Its fixed for IOS.
+    // Entries are timed in nanoseconds, and displayed in milliseconds.
     m_frequency = 1000000.0f;
-    
-#elif defined(PLATFORM_ANDROID)
-
-    // Its fixed for android.
-    m_frequency = 1000000.0f;
-    
-#endif
 
     m_update    = false;
     m_enabled   = (m_frequency > 0.0f);
@@ -29,7 +29,7 @@ class prProfileEntry;
 
 
 // Shortcut defines as you shouldn't add the profiling code without them
-#if (defined(PLATFORM_PC) || defined(PLATFORM_IOS) || defined(PLATFORM_ANDROID)) && defined(PROFILE)
+#if defined(PROFILE)
     #define ProfileCreate(name)                     prProfileManager::GetInstance().Create((name))
     #define ProfileEnable(state)                    prProfileManager::GetInstance().Enable((state))
     #define ProfileIsEnabled()                      prProfileManager::GetInstance().IsEnabled()
@@ -0,0 +1,368 @@
+/**
+ * prProfiler.cpp
+ *
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "../prConfig.h"
+#include <stdio.h>
+#include <string.h>
+#include "prProfiler.h"
+#include "prAssert.h"
+#include "prTrace.h"
+#include "../core/prClock.h"
+#include "../core/prMacros.h"
+#include "../core/prStringUtil.h"
+#include "../thread/prThread.h"
+
+
+// Defines
+#define RING_MASK       (PRPROFILER_RING_SIZE - 1)
+
+
+PRCOMPILER_ASSERT((PRPROFILER_RING_SIZE & RING_MASK) == 0);
+
+
+prProfiler prProfiler::m_instance;
+
+
+// Local data
+namespace
+{
+    // The calling thread's buffer, and whether it failed to get one.
+    thread_local void  *threadBuffer = nullptr;
+    thread_local bool   threadFull   = false;
+
+
+    // Writes a string as a JSON string.
+    void WriteJsonString(FILE *fp, const char *string)
+    {
+        fputc('"', fp);
+
+        for (const char *c = string; *c; c++)
+        {
+            switch (*c)
+            {
+            case '"':   fputs("\\\"", fp);  break;
+            case '\\':  fputs("\\\\", fp);  break;
+            case '\n':  fputs("\\n",  fp);  break;
+            case '\r':  fputs("\\r",  fp);  break;
+            case '\t':  fputs("\\t",  fp);  break;
+
+            default:
+                if ((u8)*c < 0x20)
+                {
+                    fprintf(fp, "\\u%04x", (u8)*c);
+                }
+                else
+                {
+                    fputc(*c, fp);
+                }
+                break;
+            }
+        }
+
+        fputc('"', fp);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Ctor
+/// ---------------------------------------------------------------------------
+prProfiler::prProfiler() : m_bufferCount  (0)
+                         , m_capturing    (false)
+                         , m_captureStart (0)
+{
+    for (u32 i=0; i<PRPROFILER_MAX_THREADS; i++)
+    {
+        m_buffers[i].store(nullptr);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Dtor
+/// ---------------------------------------------------------------------------
+prProfiler::~prProfiler()
+{
+    for (u32 i=0; i<PRPROFILER_MAX_THREADS; i++)
+    {
+        ThreadBuffer *pBuffer = m_buffers[i].load();
+        PRSAFE_DELETE(pBuffer);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Starts a capture, discarding the previous capture.
+/// ---------------------------------------------------------------------------
+void prProfiler::Start()
+{
+    Stop();
+
+    // No zones are being written, so each ring can be emptied.
+    u32 count = PRMIN(m_bufferCount.load(), (u32)PRPROFILER_MAX_THREADS);
+
+    for (u32 i=0; i<count; i++)
+    {
+        ThreadBuffer *pBuffer = m_buffers[i].load(std::memory_order_acquire);
+        if (pBuffer)
+        {
+            pBuffer->first = pBuffer->written.load(std::memory_order_acquire);
+        }
+    }
+
+    m_captureStart = prClockNanoseconds();
+    m_capturing.store(true);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Stops the capture.
+/// ---------------------------------------------------------------------------
+void prProfiler::Stop()
+{
+    m_capturing.store(false);
+
+    // A thread which saw the capture running may still be writing a zone.
+    u32 count = PRMIN(m_bufferCount.load(), (u32)PRPROFILER_MAX_THREADS);
+
+    for (u32 i=0; i<count; i++)
+    {
+        ThreadBuffer *pBuffer = m_buffers[i].load(std::memory_order_acquire);
+        if (pBuffer)
+        {
+            while (pBuffer->recording.load() != 0)
+            {
+                prThreadYield();
+            }
+        }
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Begins a zone on the calling thread.
+/// ---------------------------------------------------------------------------
+void prProfiler::Begin(const char *name)
+{
+    PRASSERT(name);
+
+    ThreadBuffer *pBuffer = GetThreadBuffer();
+    if (pBuffer == nullptr)
+    {
+        return;
+    }
+
+    // Zones begun outside a capture are tracked but not recorded.
+    if (pBuffer->depth < PRPROFILER_MAX_DEPTH)
+    {
+        pBuffer->stack[pBuffer->depth] = IsCapturing() ? prClockNanoseconds() : 0;
+        pBuffer->names[pBuffer->depth] = name;
+    }
+
+    pBuffer->depth++;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Ends the calling thread's innermost zone.
+/// ---------------------------------------------------------------------------
+void prProfiler::End()
+{
+    ThreadBuffer *pBuffer = static_cast<ThreadBuffer *>(threadBuffer);
+    if (pBuffer == nullptr)
+    {
+        return;
+    }
+
+    PRASSERT(pBuffer->depth > 0);
+
+    u32 depth = --pBuffer->depth;
+    if (depth >= PRPROFILER_MAX_DEPTH || pBuffer->stack[depth] == 0)
+    {
+        return;
+    }
+
+    u64 end = prClockNanoseconds();
+
+    // Announce the write before checking the capture, so Stop waits for it.
+    pBuffer->recording.store(1);
+
+    if (m_capturing.load())
+    {
+        u32   written = pBuffer->written.load(std::memory_order_relaxed);
+        Zone &zone    = pBuffer->zones[written & RING_MASK];
+
+        zone.name  = pBuffer->names[depth];
+        zone.start = pBuffer->stack[depth];
+        zone.end   = end;
+
+        pBuffer->written.store(written + 1, std::memory_order_release);
+    }
+
+    pBuffer->recording.store(0, std::memory_order_release);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Names the calling thread in the exported trace.
+/// ---------------------------------------------------------------------------
+void prProfiler::SetThreadName(const char *name)
+{
+    PRASSERT(name);
+
+    ThreadBuffer *pBuffer = GetThreadBuffer();
+    if (pBuffer)
+    {
+        prStringCopySafe(pBuffer->threadName, name, sizeof(pBuffer->threadName));
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Writes the capture as Chrome trace event JSON.
+/// ---------------------------------------------------------------------------
+bool prProfiler::ExportChromeTrace(const char *filename)
+{
+    PRASSERT(filename && *filename);
+
+    Stop();
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == nullptr)
+    {
+        PRWARN("Failed to write profile trace '%s'", filename);
+        return false;
+    }
+
+    fputs("{\"traceEvents\":[\n", fp);
+
+    bool first = true;
+    u32  count = PRMIN(m_bufferCount.load(), (u32)PRPROFILER_MAX_THREADS);
+
+    for (u32 i=0; i<count; i++)
+    {
+        ThreadBuffer *pBuffer = m_buffers[i].load(std::memory_order_acquire);
+        if (pBuffer == nullptr)
+        {
+            continue;
+        }
+
+        // Thread name
+        if (pBuffer->threadName[0])
+        {
+            fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", i);
+            WriteJsonString(fp, pBuffer->threadName);
+            fputs("}}", fp);
+            first = false;
+        }
+
+        // Zones. The oldest have been overwritten if the ring wrapped.
+        u32 written = pBuffer->written.load(std::memory_order_acquire);
+        u32 zone    = pBuffer->first;
+
+        if (written - zone > PRPROFILER_RING_SIZE)
+        {
+            zone = written - PRPROFILER_RING_SIZE;
+        }
+
+        for (; zone != written; zone++)
+        {
+            const Zone &z = pBuffer->zones[zone & RING_MASK];
+
+            // Skip zones begun before the capture.
+            if (z.start < m_captureStart)
+            {
+                continue;
+            }
+
+            fprintf(fp, "%s{\"name\":", first ? "" : ",\n");
+            WriteJsonString(fp, z.name);
+            fprintf(fp, ",\"cat\":\"proteus\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                    (f64)(z.start - m_captureStart) / 1000.0,
+                    (f64)(z.end - z.start) / 1000.0,
+                    i);
+            first = false;
+        }
+    }
+
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", fp);
+
+    bool result = (ferror(fp) == 0);
+    fclose(fp);
+
+    if (!result)
+    {
+        PRWARN("Failed to write profile trace '%s'", filename);
+    }
+
+    return result;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Returns the number of zones held by the capture.
+/// ---------------------------------------------------------------------------
+u32 prProfiler::GetZoneCount() const
+{
+    u32 total = 0;
+    u32 count = PRMIN(m_bufferCount.load(), (u32)PRPROFILER_MAX_THREADS);
+
+    for (u32 i=0; i<count; i++)
+    {
+        ThreadBuffer *pBuffer = m_buffers[i].load(std::memory_order_acquire);
+        if (pBuffer)
+        {
+            total += PRMIN(pBuffer->written.load(std::memory_order_acquire) - pBuffer->first, (u32)PRPROFILER_RING_SIZE);
+        }
+    }
+
+    return total;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Gets the calling thread's buffer, creating it if needed.
+/// ---------------------------------------------------------------------------
+prProfiler::ThreadBuffer *prProfiler::GetThreadBuffer()
+{
+    ThreadBuffer *pBuffer = static_cast<ThreadBuffer *>(threadBuffer);
+
+    if (pBuffer == nullptr && !threadFull)
+    {
+        u32 index = m_bufferCount.fetch_add(1);
+        if (index >= PRPROFILER_MAX_THREADS)
+        {
+            PRWARN("Too many threads are being profiled. Increase PRPROFILER_MAX_THREADS");
+            threadFull = true;
+            return nullptr;
+        }
+
+        pBuffer = new ThreadBuffer;
+        pBuffer->written.store(0);
+        pBuffer->recording.store(0);
+        pBuffer->first         = 0;
+        pBuffer->depth         = 0;
+        pBuffer->threadName[0] = '\0';
+
+        threadBuffer = pBuffer;
+        m_buffers[index].store(pBuffer, std::memory_order_release);
+    }
+
+    return pBuffer;
+}
@@ -0,0 +1,197 @@
+// File: prProfiler.h
+//      A hierarchical CPU profiler which records timed zones from any thread.
+//
+// Notes:
+//      Zones are recorded into a ring buffer owned by each thread, so
+//      recording takes no locks. Captures can be exported as a Chrome
+//      trace, which can be viewed with chrome://tracing or Perfetto.
+/**
+ * Copyright 2014 Paul Michael McNab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+
+#include <atomic>
+#include "../core/prTypes.h"
+
+
+// Shortcut defines as you shouldn't add the profiling code without them
+#if defined(PROFILE)
+    #define PRPROFILE_JOIN2(a, b)                   a##b
+    #define PRPROFILE_JOIN(a, b)                    PRPROFILE_JOIN2(a, b)
+    #define PRPROFILE_ZONE(name)                    prProfileZone PRPROFILE_JOIN(profileZone, __LINE__)(name)
+    #define PRPROFILE_THREAD_NAME(name)             prProfiler::GetInstance().SetThreadName((name))
+
+#else
+    #define PRPROFILE_ZONE(name)
+    #define PRPROFILE_THREAD_NAME(name)
+
+#endif
+
+
+// Defines
+#define PRPROFILER_MAX_THREADS      64              // Threads which can record zones
+#define PRPROFILER_MAX_DEPTH        64              // Deepest zone nesting per thread
+#define PRPROFILER_RING_SIZE        16384           // Zones kept per thread. Must be a power of two
+#define PRPROFILER_NAME_SIZE        32
+
+
+// Class: prProfiler
+//      Records nested, timed zones on any thread.
+//
+// Notes:
+//      Use <PRPROFILE_ZONE> to time the rest of a scope, which is
+//      compiled out unless PROFILE is defined.
+//
+//      Zones are only recorded between <Start> and <Stop>. Each thread
+//      keeps its most recent <PRPROFILER_RING_SIZE> zones.
+//
+//      Zone names are stored by pointer, so must be string literals or
+//      otherwise outlive the capture.
+//
+// Notes:
+//      This class is a singleton
+class prProfiler
+{
+public:
+    // Method: GetInstance
+    //      Returns a reference to the profiler instance.
+    static prProfiler& GetInstance() { return m_instance; }
+
+    // Method: Start
+    //      Starts a capture, discarding the previous capture.
+    void Start();
+
+    // Method: Stop
+    //      Stops the capture.
+    //
+    // Notes:
+    //      Returns once no thread is recording a zone.
+    void Stop();
+
+    // Method: IsCapturing
+    //      Determines if zones are being recorded.
+    bool IsCapturing() const { return m_capturing.load(std::memory_order_relaxed); }
+
+    // Method: Begin
+    //      Begins a zone on the calling thread.
+    //
+    // Parameters:
+    //      name - The zone name
+    //
+    // Notes:
+    //      Prefer <PRPROFILE_ZONE>, which ends the zone automatically.
+    void Begin(const char *name);
+
+    // Method: End
+    //      Ends the calling thread's innermost zone.
+    void End();
+
+    // Method: SetThreadName
+    //      Names the calling thread in the exported trace.
+    //
+    // Parameters:
+    //      name - The thread name. Copied
+    void SetThreadName(const char *name);
+
+    // Method: ExportChromeTrace
+    //      Writes the capture as Chrome trace event JSON.
+    //
+    // Parameters:
+    //      filename - The file to write
+    //
+    // Returns:
+    //      true on success, false if the file could not be written
+    //
+    // Notes:
+    //      Stops the capture if needed.
+    bool ExportChromeTrace(const char *filename);
+
+    // Method: GetZoneCount
+    //      Returns the number of zones held by the capture.
+    u32 GetZoneCount() const;
+
+
+private:
+    // A completed zone.
+    typedef struct Zone
+    {
+        const char     *name;
+        u64             start;                      // Nanoseconds
+        u64             end;
+
+    } Zone;
+
+    // The zones of one thread. Only the owning thread writes to it.
+    typedef struct ThreadBuffer
+    {
+        Zone                    zones[PRPROFILER_RING_SIZE];
+        std::atomic<u32>        written;            // Zones written. Indexes the ring modulo its size
+        std::atomic<u32>        recording;          // Set while a zone is being written
+        u32                     first;              // The first zone of the current capture
+        u64                     stack[PRPROFILER_MAX_DEPTH];
+        const char             *names[PRPROFILER_MAX_DEPTH];
+        u32                     depth;              // Can exceed PRPROFILER_MAX_DEPTH, in which case the deeper zones aren't recorded
+        char                    threadName[PRPROFILER_NAME_SIZE];
+
+    } ThreadBuffer;
+
+
+private:
+    // This class is true singleton. You cannot create an instance.
+    prProfiler();
+    ~prProfiler();
+
+    // Gets the calling thread's buffer, creating it if needed.
+    ThreadBuffer *GetThreadBuffer();
+
+    // Stop passing by value and assignment.
+    prProfiler(const prProfiler&);
+    const prProfiler& operator = (const prProfiler&);
+
+
+private:
+    static prProfiler               m_instance;
+    std::atomic<ThreadBuffer *>     m_buffers[PRPROFILER_MAX_THREADS];
+    std::atomic<u32>                m_bufferCount;
+    std::atomic<bool>               m_capturing;
+    u64                             m_captureStart;
+};
+
+
+// Class: prProfileZone
+//      Times the scope it is declared in.
+//
+// Notes:
+//      Use through <PRPROFILE_ZONE>.
+class prProfileZone
+{
+public:
+    // Method: prProfileZone
+    //      Ctor. Begins the zone.
+    explicit prProfileZone(const char *name) { prProfiler::GetInstance().Begin(name); }
+
+    // Method: ~prProfileZone
+    //      Dtor. Ends the zone.
+    ~prProfileZone() { prProfiler::GetInstance().End(); }
+
+
+private:
+    // Stop passing by value and assignment.
+    prProfileZone(const prProfileZone&);
+    const prProfileZone& operator = (const prProfileZone&);
+};
@@ -20,14 +20,13 @@
 #include "../prConfig.h"
 
 
+#include <atomic>
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
 #include "prTrace.h"
 #include "prDebug.h"
-#include "../core/prCore.h"
-#include "../core/prCoreSystem.h"
-#include "../core/prRegistry.h"
+#include "prLogWriter.h"
 #include "../core/prStringUtil.h"
 #include "../core/prDefines.h"
 #include "../file/prFileSystem.h"
@@ -39,6 +38,7 @@
 #define MSG_BUFFER_SIZE     1024
 #define RPT_BUFFER_SIZE     128
 #define TRACE_LOG_NAME      "trace.txt"
+#define LOG_LEVEL_OFF       ((int)prLogLevel::LogError + 1)
 
 
 //#define TRACE_TEST
@@ -61,50 +61,40 @@ namespace
 
 #endif
 
-    int  outputted    = 0;                                  // Specifies the number of unique messages output
-    int  outputLength = 0;                                  // Length of the previously output message
-    char output[MSG_BUFFER_SIZE] = { '\0' };                // Buffer to store the previously output message
+    // The lowest level logged. Combines the enabled state and log level, so filtered messages cost one test.
+    // Atomic as any thread may trace. Relaxed, as nothing else is published with it.
+    std::atomic<int>  threshold(enabled ? (int)logLevel : LOG_LEVEL_OFF);
+
+    // Duplicates are removed per thread, as threads would interleave their messages
+    thread_local int  outputted    = 0;                     // Specifies the number of unique messages output
+    thread_local int  outputLength = 0;                     // Length of the previously output message
+    thread_local char output[MSG_BUFFER_SIZE] = { '\0' };   // Buffer to store the previously output message
+
+
+    // Updates the threshold after a change of state.
+    void UpdateThreshold()
+    {
+        threshold.store(enabled ? (int)logLevel : LOG_LEVEL_OFF, std::memory_order_relaxed);
+    }
 }
 
 
 /// ---------------------------------------------------------------------------
 /// Write a trace message to file if enabled.
 /// ---------------------------------------------------------------------------
-void prTraceWriteToFile(int repeat, const char *bufferRpt, const char *bufferMsg)
+void prTraceWriteToFile(int repeat, const char *bufferRpt, const char *bufferMsg, int length)
 {
-#if defined(PLATFORM_PC)
+    prLogWriter &writer = prLogWriter::GetInstance();
 
-    if (bufferMsg && *bufferMsg)
+    if (writer.IsOpen() && length > 0)
     {
-        prRegistry *reg = static_cast<prRegistry *>(prCoreGetComponent(PRSYSTEM_REGISTRY));
-        if (reg)
+        if (repeat && bufferRpt && *bufferRpt)
         {
-            // We must be allowed to log to file, and
-            // the game cannot be exiting
-            if (prStringCompare(reg->GetValue("LogToFile"), "true") == CMP_EQUALTO &&
-                prStringCompare(reg->GetValue("Exit"), "true")      != CMP_EQUALTO)
-            {
-                FILE *fp = fopen(TRACE_LOG_NAME, "a");
-                if (fp)
-                {
-                    if (repeat && bufferRpt && *bufferRpt)
-                    {
-                        fprintf(fp, "%s", bufferRpt);
-                        fprintf(fp, "%s", bufferMsg);
-                    }
-                    else
-                    {
-                        fprintf(fp, "%s", bufferMsg);
-                    }
-
-                    fflush(fp);
-                    fclose(fp);
-                }
-            }
+            writer.Write(bufferRpt, (u32)strlen(bufferRpt));
         }
-    }
 
-#endif
+        writer.Write(bufferMsg, (u32)length);
+    }
 }
 
 
@@ -113,73 +103,75 @@ void prTraceWriteToFile(int repeat, const char *bufferRpt, const char *bufferMsg
 /// ---------------------------------------------------------------------------
 void prTrace(prLogLevel level, const char *fmt, ...)
 {
-    if (enabled)
+    if ((int)level >= threshold.load(std::memory_order_relaxed))
     {
         if (fmt && *fmt)
         {
-            if (level >= logLevel)
-            {
-                char bufferMsg[MSG_BUFFER_SIZE];
-                char bufferRpt[RPT_BUFFER_SIZE];
+            char bufferMsg[MSG_BUFFER_SIZE];
+            char bufferRpt[RPT_BUFFER_SIZE];
 
 
-                // Format the output.
-                va_list args;
-                va_start(args, fmt);
-                vsnprintf(bufferMsg, MSG_BUFFER_SIZE - 1, fmt, args);
-                va_end(args);
+            // Format the output.
+            va_list args;
+            va_start(args, fmt);
+            int length = vsnprintf(bufferMsg, MSG_BUFFER_SIZE - 1, fmt, args);
+            va_end(args);
 
+            if (length < 0)
+            {
+                return;
+            }
 
-                // Duplicate removal?
-                int repeat = FALSE;
-                if (duplicates)
-                {
-                    if (strcmp(bufferMsg, output) == 0)
-                    {
-                        outputted++;
-                        return;
-                    }
-                    else
-                    {
-                        repeat = (outputted > 0);
-
-                        if (repeat)
-                        {
-                            // I know this is pedantic, but this ensures that the repeat message always starts on a new line by checking
-                            // if the last character of the previous string was a carriage return.
-                            const char* msg = (outputLength == 0) ? "(Repeat x %i)\n" : output[outputLength - 1] == '\n' ? "(Repeat x %i)\n" :
-                                                                                                                           "\n(Repeat x %i)\n";
+            length = PRMIN(length, MSG_BUFFER_SIZE - 2);
 
-                            sprintf(bufferRpt, msg, outputted + 1);
-                        }
 
-                        // Reset
-                        outputted = 0;
+            // Duplicate removal?
+            int repeat = FALSE;
+            if (duplicates)
+            {
+                if (length == outputLength && memcmp(bufferMsg, output, length) == 0)
+                {
+                    outputted++;
+                    return;
+                }
+                else
+                {
+                    repeat = (outputted > 0);
 
-                        // Store string.
-                        strcpy(output, bufferMsg);
+                    if (repeat)
+                    {
+                        // I know this is pedantic, but this ensures that the repeat message always starts on a new line by checking
+                        // if the last character of the previous string was a carriage return.
+                        const char* msg = (outputLength == 0) ? "(Repeat x %i)\n" : output[outputLength - 1] == '\n' ? "(Repeat x %i)\n" :
+                                                                                                                       "\n(Repeat x %i)\n";
 
-                        // Store length
-                        outputLength = (int)strlen(output);
+                        sprintf(bufferRpt, msg, outputted + 1);
                     }
-                }
 
+                    // Reset
+                    outputted = 0;
 
-                // Write to console.
-                if (repeat)
-                {
-                    prOutputString(level, bufferRpt);
-                    prOutputString(level, bufferMsg);
-                }
-                else
-                {
-                    prOutputString(level, bufferMsg);
+                    // Store string and length.
+                    memcpy(output, bufferMsg, length + 1);
+                    outputLength = length;
                 }
+            }
 
 
-                // Write to a file?
-                prTraceWriteToFile(repeat, bufferRpt, bufferMsg);
+            // Write to console.
+            if (repeat)
+            {
+                prOutputString(level, bufferRpt);
+                prOutputString(level, bufferMsg);
             }
+            else
+            {
+                prOutputString(level, bufferMsg);
+            }
+
+
+            // Write to a file?
+            prTraceWriteToFile(repeat, bufferRpt, bufferMsg, length);
         }
     }
 }
@@ -193,6 +185,7 @@ int prTraceEnable(int state)
     int oldState = enabled;
     
     enabled = state;
+    UpdateThreshold();
 
     return oldState;
 }
@@ -213,6 +206,12 @@ void prTraceRemoveDuplicates(int state)
 void prTraceLogClear()
 {
 #if defined(PLATFORM_PC)
+
+    // The log can't be deleted while it's open.
+    prLogWriter &writer = prLogWriter::GetInstance();
+    bool         reopen = writer.IsOpen();
+
+    writer.Close();
     
     if (prFileExist(TRACE_LOG_NAME))
     {
@@ -220,10 +219,45 @@ void prTraceLogClear()
         prFileDelete(TRACE_LOG_NAME);
     }
 
+    if (reopen)
+    {
+        writer.Open(TRACE_LOG_NAME);
+    }
+
 #endif
 }
 
 
+/// ---------------------------------------------------------------------------
+/// Enables or disables logging to file.
+/// ---------------------------------------------------------------------------
+void prTraceLogToFile(int state)
+{
+    prLogWriter &writer = prLogWriter::GetInstance();
+
+    if (state)
+    {
+        if (!writer.IsOpen())
+        {
+            writer.Open(TRACE_LOG_NAME);
+        }
+    }
+    else
+    {
+        writer.Close();
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Writes any buffered file log messages.
+/// ---------------------------------------------------------------------------
+void prTraceFlush()
+{
+    prLogWriter::GetInstance().Flush();
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Sets the trace log level
 /// ---------------------------------------------------------------------------
@@ -232,6 +266,7 @@ void prTraceSetLogLevel(prLogLevel level)
     if (PRBETWEEN(level, prLogLevel::LogVerbose, prLogLevel::LogError))
     {
         logLevel = level;
+        UpdateThreshold();
 
 #ifdef TRACE_TEST
         prOutputString("prTraceSetLogLevel: %s\n", prTraceGetLogLevel());
@@ -285,3 +320,12 @@ int prTraceIsEnabled()
 {
     return enabled;
 }
+
+
+/// ---------------------------------------------------------------------------
+/// Determines if messages of a log level will be output.
+/// ---------------------------------------------------------------------------
+int prTraceIsLevelEnabled(prLogLevel level)
+{
+    return ((int)level >= threshold.load(std::memory_order_relaxed));
+}
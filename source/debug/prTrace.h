@@ -111,36 +111,72 @@ const char *prTraceGetLogLevel();
 //      non zero    - enabled
 int prTraceIsEnabled();
 
+// Function: prTraceIsLevelEnabled 
+//      Determines if messages of a log level will be output.
+//
+// Parameters:
+//      level - The log level
+//
+// Notes:
+//      Used by the macro versions to skip formatting filtered messages.
+//
+// Returns:
+//      zero        - the messages are filtered out
+//      non zero    - the messages are output
+int prTraceIsLevelEnabled(prLogLevel level);
+
+// Function: prTraceLogToFile 
+//      Enables or disables logging to file.
+//
+// Parameters:
+//      state - true or false.
+//
+// Notes:
+//      The file is written by a background thread, so logging doesn't wait
+//      on the file. Messages are written in batches, so may not be in the
+//      file until <prTraceFlush> is called.
+void prTraceLogToFile(int state);
+
+// Function: prTraceFlush 
+//      Writes any buffered file log messages.
+//
+// Notes:
+//      Call before anything which might end the program, so the log is complete.
+void prTraceFlush();
+
 
 // Macro versions
 #if (defined(_DEBUG) || defined(DEBUG))
+    // Filtered messages aren't formatted, and their parameters aren't evaluated.
+    #define PRLOG_LEVEL(level, ...)     do { if (prTraceIsLevelEnabled(level)) { prTrace(level, __VA_ARGS__); } } while (0)
+
     #if defined(PLATFORM_PC)
-        #define PRLOGV(msg, ...)        prTrace(prLogLevel::LogVerbose,     msg, __VA_ARGS__)
-        #define PRLOGD(msg, ...)        prTrace(prLogLevel::LogDebug,       msg, __VA_ARGS__)
-        #define PRLOGI(msg, ...)        prTrace(prLogLevel::LogInformation, msg, __VA_ARGS__)
-        #define PRLOGW(msg, ...)        prTrace(prLogLevel::LogWarning,     msg, __VA_ARGS__)
-        #define PRLOGE(msg, ...)        prTrace(prLogLevel::LogError,       msg, __VA_ARGS__)
+        #define PRLOGV(msg, ...)        PRLOG_LEVEL(prLogLevel::LogVerbose,     msg, __VA_ARGS__)
+        #define PRLOGD(msg, ...)        PRLOG_LEVEL(prLogLevel::LogDebug,       msg, __VA_ARGS__)
+        #define PRLOGI(msg, ...)        PRLOG_LEVEL(prLogLevel::LogInformation, msg, __VA_ARGS__)
+        #define PRLOGW(msg, ...)        PRLOG_LEVEL(prLogLevel::LogWarning,     msg, __VA_ARGS__)
+        #define PRLOGE(msg, ...)        PRLOG_LEVEL(prLogLevel::LogError,       msg, __VA_ARGS__)
 
     #elif defined(PLATFORM_ANDROID)
-        #define PRLOGV(msg, args...)    prTrace(prLogLevel::LogVerbose,     msg, ## args)
-        #define PRLOGD(msg, args...)    prTrace(prLogLevel::LogDebug,       msg, ## args)
-        #define PRLOGI(msg, args...)    prTrace(prLogLevel::LogInformation, msg, ## args)
-        #define PRLOGW(msg, args...)    prTrace(prLogLevel::LogWarning,     msg, ## args)
-        #define PRLOGE(msg, args...)    prTrace(prLogLevel::LogError,       msg, ## args)
+        #define PRLOGV(msg, args...)    PRLOG_LEVEL(prLogLevel::LogVerbose,     msg, ## args)
+        #define PRLOGD(msg, args...)    PRLOG_LEVEL(prLogLevel::LogDebug,       msg, ## args)
+        #define PRLOGI(msg, args...)    PRLOG_LEVEL(prLogLevel::LogInformation, msg, ## args)
+        #define PRLOGW(msg, args...)    PRLOG_LEVEL(prLogLevel::LogWarning,     msg, ## args)
+        #define PRLOGE(msg, args...)    PRLOG_LEVEL(prLogLevel::LogError,       msg, ## args)
 
     #elif defined(PLATFORM_IOS)
-        #define PRLOGV(msg, args...)    prTrace(prLogLevel::LogVerbose,     msg, ## args)
-        #define PRLOGD(msg, args...)    prTrace(prLogLevel::LogDebug,       msg, ## args)
-        #define PRLOGI(msg, args...)    prTrace(prLogLevel::LogInformation, msg, ## args)
-        #define PRLOGW(msg, args...)    prTrace(prLogLevel::LogWarning,     msg, ## args)
-        #define PRLOGE(msg, args...)    prTrace(prLogLevel::LogError,       msg, ## args)
+        #define PRLOGV(msg, args...)    PRLOG_LEVEL(prLogLevel::LogVerbose,     msg, ## args)
+        #define PRLOGD(msg, args...)    PRLOG_LEVEL(prLogLevel::LogDebug,       msg, ## args)
+        #define PRLOGI(msg, args...)    PRLOG_LEVEL(prLogLevel::LogInformation, msg, ## args)
+        #define PRLOGW(msg, args...)    PRLOG_LEVEL(prLogLevel::LogWarning,     msg, ## args)
+        #define PRLOGE(msg, args...)    PRLOG_LEVEL(prLogLevel::LogError,       msg, ## args)
 
     #elif defined(PLATFORM_LINUX)
-        #define PRLOGV(msg, args...)    prTrace(prLogLevel::LogVerbose,     msg, ## args)
-        #define PRLOGD(msg, args...)    prTrace(prLogLevel::LogDebug,       msg, ## args)
-        #define PRLOGI(msg, args...)    prTrace(prLogLevel::LogInformation, msg, ## args)
-        #define PRLOGW(msg, args...)    prTrace(prLogLevel::LogWarning,     msg, ## args)
-        #define PRLOGE(msg, args...)    prTrace(prLogLevel::LogError,       msg, ## args)
+        #define PRLOGV(msg, args...)    PRLOG_LEVEL(prLogLevel::LogVerbose,     msg, ## args)
+        #define PRLOGD(msg, args...)    PRLOG_LEVEL(prLogLevel::LogDebug,       msg, ## args)
+        #define PRLOGI(msg, args...)    PRLOG_LEVEL(prLogLevel::LogInformation, msg, ## args)
+        #define PRLOGW(msg, args...)    PRLOG_LEVEL(prLogLevel::LogWarning,     msg, ## args)
+        #define PRLOGE(msg, args...)    PRLOG_LEVEL(prLogLevel::LogError,       msg, ## args)
       
     #endif
 
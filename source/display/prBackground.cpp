@@ -62,6 +62,8 @@
 #include "../core/prCore.h"
 #include "../core/prRegistry.h"
 #include "../file/prFileShared.h"
+#include "../file/prAssetCooker.h"
+#include "../file/prChunkFile.h"
 #include "../tinyxml/tinyxml.h"
 #include "../display/prOglUtils.h"
 
@@ -110,21 +112,36 @@ prBackground::prBackground(const char *filename) : prGameObject()
     if (filename && *filename) 
     #endif
     {
-        TiXmlDocument* doc = new TiXmlDocument(filename);
-        if (doc)
+        // Cooked files are read directly.
+        prChunkReader reader;
+        if (reader.Load(filename, PRFILE_TYPE_BG, PRCOOKED_VERSION_BG))
         {
-            bool loaded = doc->LoadFile();      
-            if (loaded)
-            {
-                ParseFile(doc);
-            }
-            else
+            LoadCooked(reader);
+
+            if (!reader.IsValid())
             {
                 PRWARN("Failed to Load background '%s'\n", filename);
                 return;
             }
+        }
+        else
+        {
+            TiXmlDocument* doc = new TiXmlDocument(filename);
+            if (doc)
+            {
+                bool loaded = doc->LoadFile();      
+                if (loaded)
+                {
+                    ParseFile(doc);
+                }
+                else
+                {
+                    PRWARN("Failed to Load background '%s'\n", filename);
+                    return;
+                }
 
-            delete doc;
+                delete doc;
+            }
         }
     }
 
@@ -246,13 +263,29 @@ void prBackground::Draw()
         }
         else
         {
+            glPushMatrix();
+            ERR_CHECK();
+
+            // Move to offset
+            glTranslatef(pos.x, pos.y, 0);
+            ERR_CHECK();
+
             for (s32 i=0; i<BACKGROUND_MAX_LAYERS; i++)
             {
                 if (mLayers[i])
                 {
+                    // Only draw the tiles on screen.
+                    if (m_scrnWidth > 0.0f && m_scrnHeight > 0.0f)
+                    {
+                        mLayers[i]->SetView(-pos.x, -pos.y, m_scrnWidth, m_scrnHeight);
+                    }
+
                     mLayers[i]->Draw();
                 }
             }
+
+            glPopMatrix();
+            ERR_CHECK();
         }
     }
 }
@@ -576,55 +609,7 @@ void prBackground::ParseAttribs_Background(TiXmlElement* pElement)
             {
                 // Store texture filename
                 PRASSERT(pElem->Attribute("data"));
-                m_filenameTexture.Set(pElem->Attribute("data"));
-
-
-                // If we're a tool we cannot use the older .bgd files, they need to be
-                // converted as their textures may not be for the PC
-                #if defined(PROTEUS_TOOL)
-                    char filename[FILE_MAX_FILENAME_SIZE];
-                    prStringCopySafe(filename, m_filenameTexture.Text(), sizeof(filename));
-                    s32 index = prStringFindLastIndex(filename, '.');
-                    if (index > -1)
-                    {
-                        if (prStringCompareNoCase(&filename[index], ".pvr") == 0)
-                        {
-                            throw prException(std::string("You cannot use this background file, as it contains a .pvr file as the texture"));
-                        }
-                    }
-                    else
-                    {
-                        throw prException(std::string("Invalid background file"));
-                    }
-
-                #else
-                    // Tool created background files use the path to the textures image, so we need to
-                    // create the path to the .pvr data for games
-                    char filename[FILE_MAX_FILENAME_SIZE];
-                    prStringCopySafe(filename, m_filenameTexture.Text(), sizeof(filename));
-                    prStringReplaceChar(filename, '\\', '/');
-
-                    s32 indexExt = prStringFindLastIndex(filename, '.');
-                    s32 indexNme = prStringFindLastIndex(filename, '/');
-
-                    if (indexExt > -1 &&
-                        indexNme > -1)
-                    {
-                        // If not .pvr, create path to .pvr
-                        if (prStringCompareNoCase(&filename[indexExt], ".pvr") != 0)
-                        {
-                            char path[FILE_MAX_FILENAME_SIZE];
-                            filename[indexExt] = 0;
-                            prStringSnprintf(path, sizeof(path), "data/textures/%s.pvr", &filename[indexNme + 1]);
-                            m_filenameTexture.Set(path);
-                        }
-                    }
-                    else
-                    {
-                        PRPANIC("Invalid background file");
-                    }
-
-                #endif
+                StoreTextureFilename(pElem->Attribute("data"));
 
                 // Width/height
                 const char *width  = pElem->Attribute("width");
@@ -707,3 +692,146 @@ void prBackground::ParseAttribs_Layer(TiXmlElement* pElement)
         }
     }
 }
+
+
+/// ---------------------------------------------------------------------------
+/// Reads a cooked background file.
+/// ---------------------------------------------------------------------------
+void prBackground::LoadCooked(prChunkReader &reader)
+{
+    if (reader.FindChunk(PRCHUNK_INFO))
+    {
+        m_type = reader.ReadS32();
+
+        const char *texture   = reader.ReadString();
+        m_widthHeightSupplied = (reader.ReadS32() != 0);
+        m_scrnWidth           = reader.ReadF32();
+        m_scrnHeight          = reader.ReadF32();
+
+        if (m_type == IMAGE)
+        {
+            StoreTextureFilename(texture);
+        }
+
+        m_correctFileType = reader.IsValid();
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Stores the textures filename, converting it to the platforms texture path.
+/// ---------------------------------------------------------------------------
+void prBackground::StoreTextureFilename(const char *texture)
+{
+    PRASSERT(texture && *texture);
+    m_filenameTexture.Set(texture);
+
+    // If we're a tool we cannot use the older .bgd files, they need to be
+    // converted as their textures may not be for the PC
+    #if defined(PROTEUS_TOOL)
+        char filename[FILE_MAX_FILENAME_SIZE];
+        prStringCopySafe(filename, m_filenameTexture.Text(), sizeof(filename));
+        s32 index = prStringFindLastIndex(filename, '.');
+        if (index > -1)
+        {
+            if (prStringCompareNoCase(&filename[index], ".pvr") == 0)
+            {
+                throw prException(std::string("You cannot use this background file, as it contains a .pvr file as the texture"));
+            }
+        }
+        else
+        {
+            throw prException(std::string("Invalid background file"));
+        }
+
+    #else
+        // Tool created background files use the path to the textures image, so we need to
+        // create the path to the .pvr data for games
+        char filename[FILE_MAX_FILENAME_SIZE];
+        prStringCopySafe(filename, m_filenameTexture.Text(), sizeof(filename));
+        prStringReplaceChar(filename, '\\', '/');
+
+        s32 indexExt = prStringFindLastIndex(filename, '.');
+        s32 indexNme = prStringFindLastIndex(filename, '/');
+
+        if (indexExt > -1 &&
+            indexNme > -1)
+        {
+            // If not .pvr, create path to .pvr
+            if (prStringCompareNoCase(&filename[indexExt], ".pvr") != 0)
+            {
+                char path[FILE_MAX_FILENAME_SIZE];
+                filename[indexExt] = 0;
+                prStringSnprintf(path, sizeof(path), "data/textures/%s.pvr", &filename[indexNme + 1]);
+                m_filenameTexture.Set(path);
+            }
+        }
+        else
+        {
+            PRPANIC("Invalid background file");
+        }
+
+    #endif
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Writes an xml background file as a cooked background file.
+/// ---------------------------------------------------------------------------
+bool prBackground::Cook(TiXmlElement *pRoot, const char *destination)
+{
+    PRASSERT(pRoot);
+    PRASSERT(destination && *destination);
+
+    std::list<TiXmlElement *> backgrounds;
+    prCookFindElements(pRoot, "background", backgrounds);
+
+    if (backgrounds.empty() || backgrounds.front()->Attribute("type") == nullptr)
+    {
+        PRWARN("Background file has no background");
+        return false;
+    }
+
+    TiXmlElement *pBackground = backgrounds.front();
+    TiXmlElement *pTexture    = pBackground->FirstChildElement("texture");
+    const char   *type        = pBackground->Attribute("type");
+    const char   *texture     = nullptr;
+    const char   *width       = nullptr;
+    const char   *height      = nullptr;
+    s32           backgroundType;
+
+    if (prStringCompare(type, "image") == 0)
+    {
+        backgroundType = IMAGE;
+
+        if (pTexture == nullptr || pTexture->Attribute("data") == nullptr)
+        {
+            PRWARN("The background file has no texture.");
+            return false;
+        }
+
+        texture = pTexture->Attribute("data");
+        width   = pTexture->Attribute("width");
+        height  = pTexture->Attribute("height");
+    }
+    else if (prStringCompare(type, "tile") == 0)
+    {
+        backgroundType = TILEMAP;
+    }
+    else
+    {
+        PRWARN("Unknown background type");
+        return false;
+    }
+
+    prChunkWriter writer(PRFILE_TYPE_BG, PRCOOKED_VERSION_BG);
+
+    writer.BeginChunk(PRCHUNK_INFO, 1);
+    writer.WriteS32(backgroundType);
+    writer.WriteString(texture);
+    writer.WriteS32((width && height) ? 1 : 0);
+    writer.WriteF32((width && height) ? (f32)atof(width)  : 0.0f);
+    writer.WriteF32((width && height) ? (f32)atof(height) : 0.0f);
+
+    return writer.Save(destination);
+}
@@ -39,6 +39,7 @@ class TiXmlNode;
 class TiXmlElement;
 class prTexture;
 class prBackgroundLayer;
+class prChunkReader;
 
 
 // Defines
@@ -105,6 +106,21 @@ public:
     //      Either a layer or NULL
     prBackgroundLayer* GetLayer(s32 index);
 
+    // Method: Cook
+    //      Writes an xml background file as a cooked background file.
+    //
+    // Parameters:
+    //      pRoot       - The files root element
+    //      destination - The file to write
+    //
+    // Returns:
+    //      true on success
+    //
+    // Notes:
+    //      Normally called through <prCookAsset>. Tile map layers aren't
+    //      loaded yet, so only their type is cooked.
+    static bool Cook(TiXmlElement *pRoot, const char *destination);
+
 
 #if defined(PROTEUS_TOOL)
     // Method: GetTextureFilename
@@ -201,6 +217,14 @@ private:
     //      Attribute parser used to get information about the backgrounds layers.
     void ParseAttribs_Layer(TiXmlElement* pElement);
 
+    // Method: LoadCooked
+    //      Reads a cooked background file.
+    void LoadCooked(prChunkReader &reader);
+
+    // Method: StoreTextureFilename
+    //      Stores the textures filename, converting it to the platforms texture path.
+    void StoreTextureFilename(const char *texture);
+
 
 private:
     // Stops passing by value and assignment.
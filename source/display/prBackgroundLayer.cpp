@@ -25,6 +25,7 @@
 #include "../display/prOglUtils.h"
 #include "../display/prTexture.h"
 #include <cstring>
+#include <math.h>
 
 
 // ----------------------------------------------------------------------------
@@ -65,6 +66,13 @@
 //using namespace Proteus::Core;
 
 
+// Defines
+#define LAYER_OFFSET_Y      28                          // Tiles are drawn this many pixels down from the layers origin
+#define TILES_PER_CHUNK     (PRBACKGROUNDLAYER_CHUNK_SIZE * PRBACKGROUNDLAYER_CHUNK_SIZE)
+#define VERTICES_PER_QUAD   4
+#define INDICES_PER_QUAD    6
+
+
 /// ---------------------------------------------------------------------------
 /// Ctor
 /// ---------------------------------------------------------------------------
@@ -87,7 +95,7 @@ prBackgroundLayer::prBackgroundLayer(s32 width, s32 height, s32 tileWidth, s32 t
     mPixelHeight        = 1.0f / pTexture->GetHeight();
     mTileWidthInPixels  = mPixelWidth * tileWidth;
     mTileHeightInPixels = mPixelHeight * tileHeight;
-    
+
 //    m_framesAcross = pTexture->GetWidth()  / frameWidth;
 //    m_framesDown   = pTexture->GetHeight() / frameHeight;
 
@@ -98,6 +106,42 @@ prBackgroundLayer::prBackgroundLayer(s32 width, s32 height, s32 tileWidth, s32 t
     prTrace(prLogLevel::LogError, "Map size         : %i\n", sizeof(s32) * (width * height));
 
     memset(mMapData, -1, sizeof(s32) * (width * height));
+
+    // Chunks are built when first drawn.
+    mChunksAcross       = (width  + PRBACKGROUNDLAYER_CHUNK_SIZE - 1) / PRBACKGROUNDLAYER_CHUNK_SIZE;
+    mChunksDown         = (height + PRBACKGROUNDLAYER_CHUNK_SIZE - 1) / PRBACKGROUNDLAYER_CHUNK_SIZE;
+    mChunks             = new Chunk[mChunksAcross * mChunksDown];
+
+    for (s32 i=0; i<mChunksAcross * mChunksDown; i++)
+    {
+        mChunks[i].vertices = nullptr;
+        mChunks[i].quads    = 0;
+        mChunks[i].capacity = 0;
+        mChunks[i].dirty    = true;
+    }
+
+    // Two triangles per quad, wound the same way as the renderers triangle strip quads.
+    mIndices            = new u16[TILES_PER_CHUNK * INDICES_PER_QUAD];
+
+    u16 *pIndex = mIndices;
+
+    for (s32 i=0; i<TILES_PER_CHUNK; i++)
+    {
+        u16 base = (u16)(i * VERTICES_PER_QUAD);
+
+        *pIndex++ = base + 0;
+        *pIndex++ = base + 1;
+        *pIndex++ = base + 2;
+        *pIndex++ = base + 2;
+        *pIndex++ = base + 1;
+        *pIndex++ = base + 3;
+    }
+
+    mViewX              = 0.0f;
+    mViewY              = 0.0f;
+    mViewWidth          = 0.0f;
+    mViewHeight         = 0.0f;
+    mViewSet            = false;
 }
 
 
@@ -106,108 +150,240 @@ prBackgroundLayer::prBackgroundLayer(s32 width, s32 height, s32 tileWidth, s32 t
 /// ---------------------------------------------------------------------------
 prBackgroundLayer::~prBackgroundLayer()
 {
+    for (s32 i=0; i<mChunksAcross * mChunksDown; i++)
+    {
+        PRSAFE_DELETE_ARRAY(mChunks[i].vertices);
+    }
+
+    PRSAFE_DELETE_ARRAY(mChunks);
+    PRSAFE_DELETE_ARRAY(mIndices);
     PRSAFE_DELETE_ARRAY(mMapData);
 }
 
 
 /// ---------------------------------------------------------------------------
-/// Draws this layer
+/// Draws the chunks of this layer which overlap the view.
 /// ---------------------------------------------------------------------------
 void prBackgroundLayer::Draw()
 {
-    // TODO: Add screen offset for positioning
+    if (mpTexture == nullptr)
+    {
+        return;
+    }
+
+
+    // Find the visible tile window.
+    s32 x0 = 0;
+    s32 y0 = 0;
+    s32 x1 = mLayerWidth  - 1;
+    s32 y1 = mLayerHeight - 1;
 
-    if (mpTexture)
+    if (mViewSet)
     {
-        mpTexture->Bind();
+        f32 top = mViewY - LAYER_OFFSET_Y;
 
-        s32 tile = 0;
-        //f32 posX;
+        x0 = PRMAX(x0, (s32)floorf(mViewX / mTileWidth));
+        y0 = PRMAX(y0, (s32)floorf(top    / mTileHeight));
+        x1 = PRMIN(x1, (s32)ceilf((mViewX + mViewWidth)  / mTileWidth)  - 1);
+        y1 = PRMIN(y1, (s32)ceilf((top    + mViewHeight) / mTileHeight) - 1);
 
-        glEnable(GL_BLEND);
-        ERR_CHECK();
+        if (x0 > x1 || y0 > y1)
+        {
+            return;
+        }
+    }
 
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        ERR_CHECK();
+    s32 cx0 = x0 / PRBACKGROUNDLAYER_CHUNK_SIZE;
+    s32 cy0 = y0 / PRBACKGROUNDLAYER_CHUNK_SIZE;
+    s32 cx1 = x1 / PRBACKGROUNDLAYER_CHUNK_SIZE;
+    s32 cy1 = y1 / PRBACKGROUNDLAYER_CHUNK_SIZE;
 
-   //         glPushMatrix();
-     //       ERR_CHECK();
 
-            //// translate to quad center, then translate for position
-            //glTranslatef((GLfloat)(mTileWidth >> 1), (GLfloat)(mTileHeight >> 1), 0);
-            //ERR_CHECK();
+    // Set states
+    mpTexture->Bind();
 
-            //glTranslatef(0, 28, 0);
-            //ERR_CHECK();
+    glEnable(GL_BLEND);
+    ERR_CHECK();
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    ERR_CHECK();
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    ERR_CHECK();
+    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    ERR_CHECK();
 
-            //glScalef((GLfloat)mTileWidth, (GLfloat)mTileHeight, 0);
-            //ERR_CHECK();
 
-            
-            //glTranslatef(mTileWidth, 0, 0);
+    // Draw each chunk with a single call.
+    for (s32 cy=cy0; cy<=cy1; cy++)
+    {
+        for (s32 cx=cx0; cx<=cx1; cx++)
+        {
+            Chunk &chunk = mChunks[cy * mChunksAcross + cx];
 
-            for (s32 y=0; y<mLayerHeight; y++)
+            if (chunk.dirty)
             {
-                s32 row = y*mLayerWidth;
-
-                for (s32 x=0; x<mLayerWidth; x++)
-                {
-                    tile = mMapData[row + x];
-
-                    if (tile == -1)
-                        continue;
-        //// Set the frame source rect position indices
-        //s32 x = frame % m_framesAcross;
-        //s32 y = frame / m_framesAcross;
-
-                    // Set the tile image source rect
-                    s32 xpos = tile % mTilesAcross;
-                    s32 ypos = tile / mTilesAcross;
-                    f32 m_u0 = xpos * mTileWidthInPixels;
-                    f32 m_u1 = m_u0 + mTileWidthInPixels;            
-                    f32 m_v0 = 1.0f - ((ypos * mTileHeightInPixels) + mTileHeightInPixels);
-                    f32 m_v1 = m_v0 + mTileHeightInPixels;
-
-                    prRenderer *pRenderer = static_cast<prRenderer *>(prCoreGetComponent(PRSYSTEM_RENDERER));
-                    if (pRenderer)
-                    {
-                        glPushMatrix();
-                        ERR_CHECK();
+                Build(cx, cy);
+            }
 
-            // translate to quad center, then translate for position
-            glTranslatef((GLfloat)(mTileWidth >> 1), (GLfloat)(mTileHeight >> 1), 0);
-            ERR_CHECK();
+            if (chunk.quads == 0)
+            {
+                continue;
+            }
 
-            glTranslatef(0, 28, 0);
+            glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &chunk.vertices->x);
+            ERR_CHECK();
+            glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &chunk.vertices->u);
             ERR_CHECK();
+            glDrawElements(GL_TRIANGLES, chunk.quads * INDICES_PER_QUAD, GL_UNSIGNED_SHORT, mIndices);
+            ERR_CHECK();
+        }
+    }
 
-                        glTranslatef((GLfloat)mTileWidth * x, (GLfloat)mTileHeight * y, 0.f);
-                        glScalef((GLfloat)mTileWidth, (GLfloat)mTileHeight, 0);
 
-                        pRenderer->DrawQuad(m_u0, m_v0, m_u1, m_v1, prColour::White);// m_colour);
+    // Reset states
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    ERR_CHECK();
+    glDisable(GL_BLEND);
+    ERR_CHECK();
+}
 
-    //                    prTrace(LogError, "Tile size %i, %i\n", mTileWidth , mTileHeight);
-    //                    prTrace(LogError, "Tile %i, at (%i,  %i)\n", tile, mTileWidth * x, mTileHeight * y);
-                
-                        glPopMatrix();
-                        ERR_CHECK();
-                    }
+
+/// ---------------------------------------------------------------------------
+/// Sets the visible area of the layer.
+/// ---------------------------------------------------------------------------
+void prBackgroundLayer::SetView(f32 x, f32 y, f32 width, f32 height)
+{
+    PRASSERT(width >= 0.0f);
+    PRASSERT(height >= 0.0f);
+
+    mViewX      = x;
+    mViewY      = y;
+    mViewWidth  = width;
+    mViewHeight = height;
+    mViewSet    = true;
+}
 
 
-    //#if defined(PLATFORM_PC)
-    //        m_v0 += (m_ph / 2);             // Sub half pixel to stop blurring
-    //#endif
-                }
+/// ---------------------------------------------------------------------------
+/// Sets a tile.
+/// ---------------------------------------------------------------------------
+void prBackgroundLayer::SetTile(s32 x, s32 y, s32 tile)
+{
+    PRASSERT(PRBETWEEN(x, 0, mLayerWidth  - 1));
+    PRASSERT(PRBETWEEN(y, 0, mLayerHeight - 1));
+    PRASSERT(tile >= -1);
+
+    s32 &cell = mMapData[y * mLayerWidth + x];
+
+    if (cell != tile)
+    {
+        cell = tile;
+        mChunks[(y / PRBACKGROUNDLAYER_CHUNK_SIZE) * mChunksAcross + (x / PRBACKGROUNDLAYER_CHUNK_SIZE)].dirty = true;
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Gets a tile.
+/// ---------------------------------------------------------------------------
+s32 prBackgroundLayer::GetTile(s32 x, s32 y) const
+{
+    PRASSERT(PRBETWEEN(x, 0, mLayerWidth  - 1));
+    PRASSERT(PRBETWEEN(y, 0, mLayerHeight - 1));
+
+    return mMapData[y * mLayerWidth + x];
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Rebuilds every chunk when next drawn.
+/// ---------------------------------------------------------------------------
+void prBackgroundLayer::Invalidate()
+{
+    for (s32 i=0; i<mChunksAcross * mChunksDown; i++)
+    {
+        mChunks[i].dirty = true;
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Rebuilds a chunks vertices.
+/// ---------------------------------------------------------------------------
+void prBackgroundLayer::Build(s32 cx, s32 cy)
+{
+    Chunk &chunk = mChunks[cy * mChunksAcross + cx];
+
+    s32 x0 = cx * PRBACKGROUNDLAYER_CHUNK_SIZE;
+    s32 y0 = cy * PRBACKGROUNDLAYER_CHUNK_SIZE;
+    s32 x1 = PRMIN(x0 + PRBACKGROUNDLAYER_CHUNK_SIZE, mLayerWidth);
+    s32 y1 = PRMIN(y0 + PRBACKGROUNDLAYER_CHUNK_SIZE, mLayerHeight);
+
+    // Count the tiles first, so the array is sized to the chunks contents.
+    u32 quads = 0;
+
+    for (s32 y=y0; y<y1; y++)
+    {
+        const s32 *pRow = &mMapData[y * mLayerWidth];
+
+        for (s32 x=x0; x<x1; x++)
+        {
+            if (pRow[x] != -1)
+            {
+                quads++;
             }
+        }
+    }
 
-//            glPopMatrix();
-  //          ERR_CHECK();
+    if (quads > chunk.capacity)
+    {
+        PRSAFE_DELETE_ARRAY(chunk.vertices);
+        chunk.vertices = new Vertex[quads * VERTICES_PER_QUAD];
+        chunk.capacity = quads;
+    }
 
-        glDisable(GL_BLEND);
-        ERR_CHECK();
 
+    // Write a quad per tile, matching the renderers DrawQuad scaled to the tile size.
+    f32     halfWidth  = mTileWidth  * 0.5f;
+    f32     halfHeight = mTileHeight * 0.5f;
+    Vertex *pDst       = chunk.vertices;
+
+    for (s32 y=y0; y<y1; y++)
+    {
+        const s32 *pRow = &mMapData[y * mLayerWidth];
+
+        for (s32 x=x0; x<x1; x++)
+        {
+            s32 tile = pRow[x];
+
+            if (tile == -1)
+                continue;
+
+            // Set the tile image source rect
+            s32 xpos = tile % mTilesAcross;
+            s32 ypos = tile / mTilesAcross;
+            f32 u0   = xpos * mTileWidthInPixels;
+            f32 u1   = u0 + mTileWidthInPixels;
+            f32 v0   = 1.0f - ((ypos * mTileHeightInPixels) + mTileHeightInPixels);
+            f32 v1   = v0 + mTileHeightInPixels;
+
+            // Tile centre
+            f32 px   = (f32)(mTileWidth  * x) + (f32)(mTileWidth  >> 1);
+            f32 py   = (f32)(mTileHeight * y) + (f32)(mTileHeight >> 1) + LAYER_OFFSET_Y;
+
+            pDst[0].x = px - halfWidth;     pDst[0].y = py + halfHeight;    pDst[0].u = u0;     pDst[0].v = v0;
+            pDst[1].x = px - halfWidth;     pDst[1].y = py - halfHeight;    pDst[1].u = u0;     pDst[1].v = v1;
+            pDst[2].x = px + halfWidth;     pDst[2].y = py + halfHeight;    pDst[2].u = u1;     pDst[2].v = v0;
+            pDst[3].x = px + halfWidth;     pDst[3].y = py - halfHeight;    pDst[3].u = u1;     pDst[3].v = v1;
+
+            pDst += VERTICES_PER_QUAD;
+        }
     }
+
+    chunk.quads = quads;
+    chunk.dirty = false;
 }
+
+
 /*
         glEnable(GL_BLEND);
         ERR_CHECK();
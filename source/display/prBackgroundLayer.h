@@ -1,4 +1,11 @@
 // File: prBackgroundLayer.h
+//      A single layer of a tiled background.
+//
+// Notes:
+//      The layer is split into square chunks of tiles. Each chunk keeps a
+//      vertex array of its tiles, which is rebuilt only when one of its
+//      tiles changes, and is drawn with a single call. Chunks outside the
+//      view are skipped, and are not built until they are first seen.
 /**
  * Copyright 2014 Paul Michael McNab
  * 
@@ -27,6 +34,10 @@
 class prTexture;
 
 
+// Defines
+#define PRBACKGROUNDLAYER_CHUNK_SIZE    32              // Chunk width and height in tiles. Chunks must be indexable by 16 bit indices
+
+
 // Class: prBackgroundLayer
 //      Represents a single background layer
 class prBackgroundLayer
@@ -52,9 +63,52 @@ public:
     ~prBackgroundLayer();
 
     // Method: Draw
-    //      Draws this layer
+    //      Draws the chunks of this layer which overlap the view.
     void Draw();
 
+    // Method: SetView
+    //      Sets the visible area of the layer.
+    //
+    // Parameters:
+    //      x      - The left edge of the view in layer pixels
+    //      y      - The top edge of the view in layer pixels
+    //      width  - The width of the view in pixels
+    //      height - The height of the view in pixels
+    //
+    // Notes:
+    //      Until a view is set the whole layer is drawn.
+    void SetView(f32 x, f32 y, f32 width, f32 height);
+
+    // Method: SetTile
+    //      Sets a tile.
+    //
+    // Parameters:
+    //      x    - The tile column
+    //      y    - The tile row
+    //      tile - The tiles index in the texture, or -1 for no tile
+    //
+    // Notes:
+    //      Only the chunk holding the tile is rebuilt.
+    void SetTile(s32 x, s32 y, s32 tile);
+
+    // Method: GetTile
+    //      Gets a tile.
+    //
+    // Parameters:
+    //      x    - The tile column
+    //      y    - The tile row
+    //
+    // Returns:
+    //      The tiles index in the texture, or -1 for no tile
+    s32 GetTile(s32 x, s32 y) const;
+
+    // Method: Invalidate
+    //      Rebuilds every chunk when next drawn.
+    //
+    // Notes:
+    //      Must be called after changing the map data directly.
+    void Invalidate();
+
 #if defined(PROTEUS_TOOL)
     // Method: GetLayerWidth
     //      Gets the layers width. *Only available on tool builds*
@@ -82,11 +136,37 @@ public:
 
     // Method: GetMapData
     //      Gets the map data. *Only available on tool builds*
+    //
+    // Notes:
+    //      Call <Invalidate> after writing to the map data.
     s32 *GetMapData() { return mMapData; }
 #endif
 
 
 private:
+    // A tile vertex.
+    typedef struct Vertex
+    {
+        f32 x, y;
+        f32 u, v;
+
+    } Vertex;
+
+    // A square of tiles drawn with a single call.
+    typedef struct Chunk
+    {
+        Vertex     *vertices;
+        u32         quads;
+        u32         capacity;                           // Quads the vertices can hold
+        bool        dirty;
+
+    } Chunk;
+
+
+private:
+    // Rebuilds a chunks vertices.
+    void Build(s32 cx, s32 cy);
+
     // Stop passing by value and assignment.
     prBackgroundLayer(const prBackgroundLayer&);
     const prBackgroundLayer& operator = (const prBackgroundLayer&);
@@ -109,4 +189,14 @@ private:
     s32        *mMapData;
     prTexture  *mpTexture;
     PRBOOL      mWrap;
+
+    Chunk      *mChunks;
+    s32         mChunksAcross;
+    s32         mChunksDown;
+    u16        *mIndices;                               // Quad index pattern shared by all chunks
+    f32         mViewX;
+    f32         mViewY;
+    f32         mViewWidth;
+    f32         mViewHeight;
+    bool        mViewSet;
 };
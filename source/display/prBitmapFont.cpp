@@ -58,6 +58,7 @@
 #include "../debug/prDebug.h"
 #include "../file/prFile.h"
 #include "../file/prFileShared.h"
+#include "../file/prChunkFile.h"
 #include "../tinyxml/tinyxml.h"
 #include "../core/prMacros.h"
 #include "../core/prStringUtil.h"
@@ -74,9 +75,44 @@
 
 // Defines
 #define MSG_BUFFER_SIZE     1024
+#define LOOKUP_SIZE         256                             // Characters found by direct lookup. Covers ASCII and Latin-1
+#define LAYOUT_CACHE_SIZE   32                              // Laid out strings kept per font
+#define VERTICES_PER_QUAD   4
+#define INDICES_PER_QUAD    6
+#define MAX_RUN_QUADS       (65536 / VERTICES_PER_QUAD)     // Quads addressable by 16 bit indices
 //#define DEBUG_BMAP_FONT
 
 
+// Local functions
+namespace
+{
+    // Reads an integer attribute, which is zero if missing.
+    s32 IntAttribute(TiXmlElement* pElement, const char *name)
+    {
+        const char *pValue = pElement->Attribute(name);
+        PRASSERT(pValue, "Font element '%s' has no '%s' attribute", pElement->Value(), name);
+        return pValue ? atoi(pValue) : 0;
+    }
+
+
+    // Counts the child elements with a name.
+    s32 CountElements(TiXmlElement* pElement, const char *name)
+    {
+        s32 count = 0;
+
+        if (pElement)
+        {
+            for (TiXmlElement *pElem = pElement->FirstChildElement(name); pElem; pElem = pElem->NextSiblingElement(name))
+            {
+                count++;
+            }
+        }
+
+        return count;
+    }
+}
+
+
 // Info about a character.
 typedef struct CharData
 {
@@ -114,6 +150,40 @@ typedef struct KerningData
 } KerningData;
 
 
+// Cooked fonts store the character and kerning data in these layouts.
+PRCOMPILER_ASSERT(sizeof(CharData)    == sizeof(s32) * 10);
+PRCOMPILER_ASSERT(sizeof(KerningData) == sizeof(u32) * 3);
+
+
+// Glyphs which share a page, drawn with a single call.
+typedef struct TextRun
+{
+    s32 page;
+    u32 firstVertex;                                        // The runs indices are relative to this vertex
+    u32 quads;
+
+} TextRun;
+
+
+// A laid out string.
+typedef struct TextLayout
+{
+    u64         hash;
+    char       *text;
+    u32         textCapacity;
+    f32         scale;
+    s32         alignment;
+    u32         lastUsed;                                   // Draw count when last used, for eviction
+    QuadData   *vertices;                                   // Grouped by page
+    u32         quads;
+    u32         quadCapacity;
+    TextRun    *runs;
+    u32         runCount;
+    u32         runCapacity;
+
+} TextLayout;
+
+
 // Implementation data.
 typedef struct BitmapFontImplementation
 {
@@ -134,6 +204,20 @@ typedef struct BitmapFontImplementation
         pPageInfo    = nullptr;
         pKerningData = nullptr;
         rotation     = 0.0f;
+        draws        = 0;
+        pIndices     = nullptr;
+        indexQuads   = 0;
+        pScratch     = nullptr;
+        pGlyphPages  = nullptr;
+        scratchQuads = 0;
+        pPageCounts  = nullptr;
+
+        for (s32 i=0; i<LOOKUP_SIZE; i++)
+        {
+            lookup[i] = -1;
+        }
+
+        memset(layouts, 0, sizeof(layouts));
     }
 
     
@@ -145,6 +229,17 @@ typedef struct BitmapFontImplementation
         PRSAFE_DELETE_ARRAY(pCharInfo);
         PRSAFE_DELETE_ARRAY(pPageInfo);
         PRSAFE_DELETE_ARRAY(pKerningData);
+        PRSAFE_DELETE_ARRAY(pIndices);
+        PRSAFE_DELETE_ARRAY(pScratch);
+        PRSAFE_DELETE_ARRAY(pGlyphPages);
+        PRSAFE_DELETE_ARRAY(pPageCounts);
+
+        for (s32 i=0; i<LAYOUT_CACHE_SIZE; i++)
+        {
+            PRSAFE_DELETE_ARRAY(layouts[i].text);
+            PRSAFE_DELETE_ARRAY(layouts[i].vertices);
+            PRSAFE_DELETE_ARRAY(layouts[i].runs);
+        }
     }
 
 
@@ -153,6 +248,20 @@ typedef struct BitmapFontImplementation
     // ------------------------------------------------------------------------
     void Load(const char *filename)
     {
+        // Cooked fonts are read directly.
+        prChunkReader reader;
+        if (reader.Load(filename, PRFILE_TYPE_FN, PRCOOKED_VERSION_FN))
+        {
+            LoadCooked(reader);
+
+            if (!reader.IsValid())
+            {
+                PRWARN("Failed to Load %s\n", filename);
+            }
+
+            return;
+        }
+
         // Parse the document
         TiXmlDocument* doc = new TiXmlDocument(filename);
         if (doc)
@@ -172,6 +281,63 @@ typedef struct BitmapFontImplementation
     }
 
 
+    // ------------------------------------------------------------------------
+    // Reads a cooked font.
+    // ------------------------------------------------------------------------
+    void LoadCooked(prChunkReader &reader)
+    {
+        if (reader.FindChunk(PRCHUNK_INFO))
+        {
+            lineHeight  = reader.ReadS32();
+            base        = reader.ReadS32();
+            scaleW      = reader.ReadS32();
+            scaleH      = reader.ReadS32();
+            pages       = reader.ReadS32();
+        }
+
+        PRASSERT(pages > 0);
+        if (pages > 0 && reader.FindChunk(PRCHUNK_PAGE))
+        {
+            PRASSERT(reader.GetEntries() == (u32)pages);
+            pPageInfo = new PageData[pages];
+
+            for (s32 i=0; i<pages; i++)
+            {
+                s32 id = reader.ReadS32();
+                LoadPage(i, id, reader.ReadString());
+            }
+        }
+
+        // The characters and kernings are stored in their runtime layouts.
+        if (reader.FindChunk(PRCHUNK_CHAR) && reader.GetEntries() > 0)
+        {
+            characters = (s32)reader.GetEntries();
+            pCharInfo  = new CharData[characters];
+            reader.Read(pCharInfo, sizeof(CharData) * characters);
+
+            for (s32 i=0; i<characters; i++)
+            {
+                s32 id = pCharInfo[i].id;
+                if (PRBETWEEN(id, 0, LOOKUP_SIZE - 1))
+                {
+                    lookup[id] = i;
+                }
+            }
+        }
+        else
+        {
+            prTrace(prLogLevel::LogError, "Font character count is invalid\n");
+        }
+
+        if (reader.FindChunk(PRCHUNK_KERNING) && reader.GetEntries() > 0)
+        {
+            kernings     = (s32)reader.GetEntries();
+            pKerningData = new KerningData[kernings];
+            reader.Read(pKerningData, sizeof(KerningData) * kernings);
+        }
+    }
+
+
     // ------------------------------------------------------------------------
     // Parses the xml file.
     // ------------------------------------------------------------------------
@@ -359,20 +525,11 @@ typedef struct BitmapFontImplementation
                     }
 
 
-                    // Create the texture filename. Must be in 'data/fonts'
+                    // Create the page texture
                     PRASSERT(file);
                     if (file)
                     {
-                        strcpy(pPageInfo[index].filename, "data/fonts/");
-                        strcat(pPageInfo[index].filename, file);
-                        s32 idx = prStringFindLastIndex(pPageInfo[index].filename, '.');
-                        strcpy(&pPageInfo[index].filename[idx + 1], "pvr");
-
-                        // Create the page texture
-                        prResourceManager *pRM = static_cast<prResourceManager *>(prCoreGetComponent(PRSYSTEM_RESOURCEMANAGER));
-                        PRASSERT(pRM)
-                        pPageInfo[index].pTexture = pRM->Load<prTexture>(pPageInfo[index].filename, false, TEXTRA_ANTIALIAS);
-                        PRASSERT(pPageInfo[index].pTexture);
+                        LoadPage(index, pPageInfo[index].id, file);
                     }
                 }
 
@@ -383,6 +540,30 @@ typedef struct BitmapFontImplementation
     }
 
 
+    // ------------------------------------------------------------------------
+    // Loads a pages texture.
+    // ------------------------------------------------------------------------
+    void LoadPage(s32 index, s32 id, const char *file)
+    {
+        PRASSERT(PRBETWEEN(index, 0, pages - 1));
+        PRASSERT(file && *file);
+
+        pPageInfo[index].id = id;
+
+        // Create the texture filename. Must be in 'data/fonts'
+        strcpy(pPageInfo[index].filename, "data/fonts/");
+        strcat(pPageInfo[index].filename, file);
+        s32 idx = prStringFindLastIndex(pPageInfo[index].filename, '.');
+        strcpy(&pPageInfo[index].filename[idx + 1], "pvr");
+
+        // Create the page texture
+        prResourceManager *pRM = static_cast<prResourceManager *>(prCoreGetComponent(PRSYSTEM_RESOURCEMANAGER));
+        PRASSERT(pRM)
+        pPageInfo[index].pTexture = pRM->Load<prTexture>(pPageInfo[index].filename, false, TEXTRA_ANTIALIAS);
+        PRASSERT(pPageInfo[index].pTexture);
+    }
+
+
     // ------------------------------------------------------------------------
     // Parses any chars elements
     // ------------------------------------------------------------------------
@@ -452,6 +633,14 @@ typedef struct BitmapFontImplementation
                             pCharInfo[index].xadvance = atoi(xadvance);
                             pCharInfo[index].page     = atoi(page);
                             pCharInfo[index].chnl     = atoi(chnl);                        
+
+                            // Common characters are found directly.
+                            s32 id = pCharInfo[index].id;
+                            if (PRBETWEEN(id, 0, LOOKUP_SIZE - 1))
+                            {
+                                lookup[id] = index;
+                            }
+
                             index++;
                         }
                     }
@@ -542,6 +731,357 @@ typedef struct BitmapFontImplementation
     }
 
 
+    // ------------------------------------------------------------------------
+    // Finds a characters details.
+    // ------------------------------------------------------------------------
+    const CharData *FindChar(s32 character) const
+    {
+        if (PRBETWEEN(character, 0, LOOKUP_SIZE - 1))
+        {
+            s32 index = lookup[character];
+            return (index != -1) ? &pCharInfo[index] : nullptr;
+        }
+
+        // Less common characters are found by a binary search.
+        s32 lower = 0;
+        s32 upper = characters - 1;
+
+        while(lower <= upper)
+        {
+            s32 mid = (lower + upper) / 2;
+
+            if (character > pCharInfo[mid].id)
+            {
+                lower = mid + 1;
+            }
+            else if (character < pCharInfo[mid].id)
+            {
+                upper = mid - 1;
+            }
+            else
+            {
+                return &pCharInfo[mid];
+            }
+        }
+
+        return nullptr;
+    }
+
+
+    // ------------------------------------------------------------------------
+    // Decodes the character at index, and moves the index past it.
+    // ------------------------------------------------------------------------
+    static s32 NextChar(const char *text, s32 &index)
+    {
+        s32 character;
+        s32 c = text[index];
+
+        // utf-8?
+        if (c < 0)
+        {
+            index += (s32)utf8proc_iterate((const ::uint8_t*)&text[index], -1, (::int32_t*)&character);
+        }
+        else
+        {
+            character = c;
+            index++;
+        }
+
+        return character;
+    }
+
+
+    // ------------------------------------------------------------------------
+    // Gets a strings layout, laying it out if it isn't cached.
+    // ------------------------------------------------------------------------
+    const TextLayout *GetLayout(const char *text, f32 scale, s32 alignment)
+    {
+        u64         hash   = prStringHash64(text);
+        TextLayout *pEvict = &layouts[0];
+
+        draws++;
+
+        for (s32 i=0; i<LAYOUT_CACHE_SIZE; i++)
+        {
+            TextLayout &layout = layouts[i];
+
+            if (layout.text         != nullptr   &&
+                layout.hash         == hash      &&
+                layout.scale        == scale     &&
+                layout.alignment    == alignment &&
+                strcmp(layout.text, text) == 0)
+            {
+                layout.lastUsed = draws;
+                return &layout;
+            }
+
+            // Replace the least recently used layout.
+            if (layout.lastUsed < pEvict->lastUsed)
+            {
+                pEvict = &layout;
+            }
+        }
+
+        u32 length = (u32)strlen(text);
+        if (length + 1 > pEvict->textCapacity)
+        {
+            PRSAFE_DELETE_ARRAY(pEvict->text);
+            pEvict->text         = new char[length + 1];
+            pEvict->textCapacity = length + 1;
+        }
+
+        strcpy(pEvict->text, text);
+        pEvict->hash      = hash;
+        pEvict->scale     = scale;
+        pEvict->alignment = alignment;
+        pEvict->lastUsed  = draws;
+
+        BuildLayout(*pEvict);
+        return pEvict;
+    }
+
+
+    // ------------------------------------------------------------------------
+    // Lays out a string as quads grouped by page.
+    // ------------------------------------------------------------------------
+    void BuildLayout(TextLayout &layout)
+    {
+        const char *text  = layout.text;
+        f32         scale = layout.scale;
+
+        // A quad per character is the most a string can need.
+        u32 maxQuads = layout.textCapacity;
+        ReserveScratch(maxQuads);
+
+        f32 w         = (1.0f / scaleW);                    // Pre-calculated value
+        f32 h         = (1.0f / scaleH);                    // Pre-calculated value
+        f32 dist      = 0;
+        f32 ya        = 0;
+        u32 quads     = 0;
+        u32 lineStart = 0;
+        s32 index     = 0;
+        s32 character = NextChar(text, index);
+
+        for (s32 i=0; i<pages; i++)
+        {
+            pPageCounts[i] = 0;
+        }
+
+        while (character != '\0')
+        {
+            s32 next = NextChar(text, index);
+
+            if (character == '\n')
+            {
+                AlignLine(lineStart, quads, dist * scale, layout.alignment);
+
+                lineStart = quads;
+                dist      = 0;
+                ya       += (lineHeight * scale);
+            }
+            else if (character == '\r') // Just in case, we only need the one CR/LF character
+            {
+            }
+            else
+            {
+                const CharData *pChar = FindChar(character);
+
+                if (pChar)
+                {
+                    if (character != ' ')
+                    {
+                        PRASSERT(pChar->page >= 0);
+                        PRASSERT(pChar->page < pages);
+
+                        f32 width  = (f32)(pChar->width);
+                        f32 height = (f32)(pChar->height);
+
+                        f32 u0 = pChar->x * w;
+                        f32 u1 = u0 + (width * w);
+                        f32 v0 = 1.0f - ((pChar->y * h) + (height * h));
+                        f32 v1 = v0 + (height * h);
+
+                        f32 px = (pChar->xoffset + (width  / 2) + GetKerning(character, next) + dist) * scale;
+                        f32 py = (pChar->yoffset + (height / 2)) * scale + ya;
+                        f32 hw = (width  * scale) / 2;
+                        f32 hh = (height * scale) / 2;
+
+                        // Matches the renderers unit quad, scaled to the glyph.
+                        QuadData *pDst = &pScratch[quads * VERTICES_PER_QUAD];
+                        pDst[0].x = px - hw;    pDst[0].y = py + hh;    pDst[0].u = u0;     pDst[0].v = v0;
+                        pDst[1].x = px - hw;    pDst[1].y = py - hh;    pDst[1].u = u0;     pDst[1].v = v1;
+                        pDst[2].x = px + hw;    pDst[2].y = py + hh;    pDst[2].u = u1;     pDst[2].v = v0;
+                        pDst[3].x = px + hw;    pDst[3].y = py - hh;    pDst[3].u = u1;     pDst[3].v = v1;
+
+                        pGlyphPages[quads++] = pChar->page;
+                        pPageCounts[pChar->page]++;
+                    }
+
+                    dist += pChar->xadvance;
+                }
+                else
+                {
+                    prTrace(prLogLevel::LogError, "Unsupported character: %i, %c\n", character, character);
+                }
+            }
+
+            character = next;
+        }
+
+        AlignLine(lineStart, quads, dist * scale, layout.alignment);
+
+
+        // Group the quads by page, keeping their order within each page.
+        if (quads > layout.quadCapacity)
+        {
+            PRSAFE_DELETE_ARRAY(layout.vertices);
+            layout.vertices     = new QuadData[quads * VERTICES_PER_QUAD];
+            layout.quadCapacity = quads;
+        }
+
+        u32 runs = 0;
+        u32 first = 0;
+
+        for (s32 i=0; i<pages; i++)
+        {
+            if (pPageCounts[i] > 0)
+            {
+                runs += (pPageCounts[i] + MAX_RUN_QUADS - 1) / MAX_RUN_QUADS;
+            }
+
+            u32 count      = pPageCounts[i];
+            pPageCounts[i] = first;
+            first         += count;
+        }
+
+        for (u32 i=0; i<quads; i++)
+        {
+            u32 dst = pPageCounts[pGlyphPages[i]]++;
+            memcpy(&layout.vertices[dst * VERTICES_PER_QUAD], &pScratch[i * VERTICES_PER_QUAD], sizeof(QuadData) * VERTICES_PER_QUAD);
+        }
+
+
+        // Split into runs. Each page's quads now end at its count.
+        if (runs > layout.runCapacity)
+        {
+            PRSAFE_DELETE_ARRAY(layout.runs);
+            layout.runs        = new TextRun[runs];
+            layout.runCapacity = runs;
+        }
+
+        layout.quads    = quads;
+        layout.runCount = 0;
+        first           = 0;
+
+        for (s32 i=0; i<pages; i++)
+        {
+            u32 end = pPageCounts[i];
+
+            while (first < end)
+            {
+                TextRun &run    = layout.runs[layout.runCount++];
+                run.page        = i;
+                run.firstVertex = first * VERTICES_PER_QUAD;
+                run.quads       = PRMIN(end - first, (u32)MAX_RUN_QUADS);
+                first          += run.quads;
+            }
+        }
+
+        PRASSERT(layout.runCount == runs);
+        ReserveIndices(layout.runs, layout.runCount);
+    }
+
+
+    // ------------------------------------------------------------------------
+    // Moves a lines quads to suit the alignment.
+    // ------------------------------------------------------------------------
+    void AlignLine(u32 first, u32 end, f32 lineWidth, s32 alignment)
+    {
+        f32 offset;
+
+        switch(alignment)
+        {
+        default:
+            prTrace(prLogLevel::LogError, "Unsupported alignment\n");
+            return;
+
+        case prBitmapFont::ALIGN_LEFT:
+            return;
+
+        case prBitmapFont::ALIGN_RIGHT:
+            offset = -lineWidth;
+            break;
+
+        case prBitmapFont::ALIGN_CENTER:
+            offset = -lineWidth / 2;
+            break;
+        }
+
+        for (u32 i=first * VERTICES_PER_QUAD; i<end * VERTICES_PER_QUAD; i++)
+        {
+            pScratch[i].x += offset;
+        }
+    }
+
+
+    // ------------------------------------------------------------------------
+    // Ensures the layout scratch buffers can hold the quads.
+    // ------------------------------------------------------------------------
+    void ReserveScratch(u32 quads)
+    {
+        if (pPageCounts == nullptr && pages > 0)
+        {
+            pPageCounts = new u32[pages];
+        }
+
+        if (quads > scratchQuads)
+        {
+            PRSAFE_DELETE_ARRAY(pScratch);
+            PRSAFE_DELETE_ARRAY(pGlyphPages);
+            pScratch     = new QuadData[quads * VERTICES_PER_QUAD];
+            pGlyphPages  = new s32[quads];
+            scratchQuads = quads;
+        }
+    }
+
+
+    // ------------------------------------------------------------------------
+    // Ensures the index pattern covers the largest run.
+    // ------------------------------------------------------------------------
+    void ReserveIndices(const TextRun *pRuns, u32 count)
+    {
+        u32 quads = 0;
+
+        for (u32 i=0; i<count; i++)
+        {
+            quads = PRMAX(quads, pRuns[i].quads);
+        }
+
+        if (quads > indexQuads)
+        {
+            PRSAFE_DELETE_ARRAY(pIndices);
+            pIndices = new u16[quads * INDICES_PER_QUAD];
+
+            u16 *pIndex = pIndices;
+
+            for (u32 i=0; i<quads; i++)
+            {
+                u16 base = (u16)(i * VERTICES_PER_QUAD);
+
+                // Two triangles, wound the same way as the renderers triangle strip quads.
+                *pIndex++ = base + 0;
+                *pIndex++ = base + 1;
+                *pIndex++ = base + 2;
+                *pIndex++ = base + 2;
+                *pIndex++ = base + 1;
+                *pIndex++ = base + 3;
+            }
+
+            indexQuads = quads;
+        }
+    }
+
+
     // Data
     s32              pages;
     s32              characters;
@@ -556,6 +1096,16 @@ typedef struct BitmapFontImplementation
     CharData        *pCharInfo;
     PageData        *pPageInfo;
     KerningData     *pKerningData;
+    s32              lookup[LOOKUP_SIZE];                   // Index into pCharInfo, or -1
+
+    TextLayout       layouts[LAYOUT_CACHE_SIZE];
+    u32              draws;
+    u16             *pIndices;                              // Quad index pattern shared by all runs
+    u32              indexQuads;
+    QuadData        *pScratch;                              // Quads in text order while laying out
+    s32             *pGlyphPages;
+    u32              scratchQuads;
+    u32             *pPageCounts;
 
 } BitmapFontImplementation;
 
@@ -592,256 +1142,204 @@ void prBitmapFont::Load(const char *filename)
 
 
 /// ---------------------------------------------------------------------------
-/// Draw
+/// Writes an xml font as a cooked font.
 /// ---------------------------------------------------------------------------
-void prBitmapFont::Draw(f32 x, f32 y, const char *fmt, ...)
+bool prBitmapFont::Cook(TiXmlElement *pRoot, const char *destination)
 {
-    char message[MSG_BUFFER_SIZE];
-
-	// Format the output.
-    va_list args;
-    va_start(args, fmt);        
-
-    vsprintf(message, fmt, args);
-
-    va_end(args);
-
-    Draw(x, y, 1.0f, prColour::White, ALIGN_LEFT, message);
-}
+    PRASSERT(pRoot);
+    PRASSERT(destination && *destination);
 
+    TiXmlHandle   root(pRoot);
+    TiXmlElement *pCommon   = root.FirstChild("common").Element();
+    TiXmlElement *pPages    = root.FirstChild("pages").Element();
+    TiXmlElement *pChars    = root.FirstChild("chars").Element();
+    TiXmlElement *pKernings = root.FirstChild("kernings").Element();
 
-/// ---------------------------------------------------------------------------
-/// Draw
-/// ---------------------------------------------------------------------------
-void prBitmapFont::Draw(f32 x, f32 y, float scale, prColour colour, s32 alignment, const char *fmt, ...)
-{
-    if (fmt && *fmt)
+    if (pCommon == nullptr || pPages == nullptr || pChars == nullptr)
     {
-        char message[MSG_BUFFER_SIZE];
-
+        PRWARN("Font is missing its common, pages or chars element");
+        return false;
+    }
 
-		// Format the output.
-        va_list args;
-        va_start(args, fmt);        
-        vsprintf(message, fmt, args);
-        va_end(args);
+    prChunkWriter writer(PRFILE_TYPE_FN, PRCOOKED_VERSION_FN);
 
+    // Common
+    writer.BeginChunk(PRCHUNK_INFO, 1);
+    writer.WriteS32(IntAttribute(pCommon, "lineHeight"));
+    writer.WriteS32(IntAttribute(pCommon, "base"));
+    writer.WriteS32(IntAttribute(pCommon, "scaleW"));
+    writer.WriteS32(IntAttribute(pCommon, "scaleH"));
+    writer.WriteS32(IntAttribute(pCommon, "pages"));
 
-        // Render init
-        glEnable(GL_BLEND);
-        ERR_CHECK();
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        ERR_CHECK();
+    // Pages
+    writer.BeginChunk(PRCHUNK_PAGE, CountElements(pPages, "page"));
+    for (TiXmlElement *pElem = pPages->FirstChildElement("page"); pElem; pElem = pElem->NextSiblingElement("page"))
+    {
+        writer.WriteS32(IntAttribute(pElem, "id"));
+        writer.WriteString(pElem->Attribute("file"));
+    }
 
-        // Set states
-        //glEnableClientState(GL_VERTEX_ARRAY);
-        //ERR_CHECK();
-	    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-        ERR_CHECK();
+    // Characters, in their runtime layout. Limited to the count, as loading xml is.
+    s32 characters = PRMIN(IntAttribute(pChars, "count"), CountElements(pChars, "char"));
+    writer.BeginChunk(PRCHUNK_CHAR, characters);
 
+    TiXmlElement *pElem = pChars->FirstChildElement("char");
+    for (s32 i=0; i<characters; i++, pElem = pElem->NextSiblingElement("char"))
+    {
+        CharData data;
+        data.id       = IntAttribute(pElem, "id");
+        data.x        = IntAttribute(pElem, "x");
+        data.y        = IntAttribute(pElem, "y");
+        data.width    = IntAttribute(pElem, "width");
+        data.height   = IntAttribute(pElem, "height");
+        data.xoffset  = IntAttribute(pElem, "xoffset");
+        data.yoffset  = IntAttribute(pElem, "yoffset");
+        data.xadvance = IntAttribute(pElem, "xadvance");
+        data.page     = IntAttribute(pElem, "page");
+        data.chnl     = IntAttribute(pElem, "chnl");
+        writer.Write(&data, sizeof(data));
+    }
 
-        f32 xbak = x;
+    // Kernings, in their runtime layout.
+    if (pKernings)
+    {
+        s32 kernings = PRMIN(IntAttribute(pKernings, "count"), CountElements(pKernings, "kerning"));
+        writer.BeginChunk(PRCHUNK_KERNING, kernings);
 
-        // Set alignment
-        switch(alignment)
+        pElem = pKernings->FirstChildElement("kerning");
+        for (s32 i=0; i<kernings; i++, pElem = pElem->NextSiblingElement("kerning"))
         {
-        default:
-            prTrace(prLogLevel::LogError, "Unsupported alignment\n");
-            break;
-
-        case ALIGN_LEFT:
-            break;
-
-        case ALIGN_RIGHT:
-            x -= MeasureString(message, scale).x;
-            break;
-
-        case ALIGN_CENTER:
-            x -= MeasureStringUntilTerm(message, scale).x / 2;
-            break;
+            KerningData data;
+            data.first  = IntAttribute(pElem, "first");
+            data.second = IntAttribute(pElem, "second");
+            data.amount = IntAttribute(pElem, "amount");
+            writer.Write(&data, sizeof(data));
         }
+    }
 
+    return writer.Save(destination);
+}
 
-        // Move to position
-        glPushMatrix();
-        glTranslatef(x, y, 0);
-
-
-        // Set the colour.
-        glColor4f(colour.red, colour.green, colour.blue, colour.alpha);
-
-
-        // And rotate.
-        glRotatef(imp.rotation, 0, 0, 1);
-
-
-        // Write the text.
-        imp.boundPage = -1;
-
-        s32      c;
-        s32      index = 0;
-        s32      character;
-        float    dist  = 0;
-        float    w     = (1.0f / imp.scaleW);       // Pre-calculated value
-        float    h     = (1.0f / imp.scaleH);       // Pre-calculated value
-        float    ya    = 0;
 
-        do
+/// ---------------------------------------------------------------------------
+/// Draw
+/// ---------------------------------------------------------------------------
+void prBitmapFont::Draw(f32 x, f32 y, const char *fmt, ...)
+{
+    if (fmt && *fmt)
+    {
+        // Only format the output if needed.
+        if (strchr(fmt, '%'))
         {
-            c = message[index];
+            char message[MSG_BUFFER_SIZE];
 
-            // utf-8?
-            if (c < 0 || c > 127)
-            {
-                index += (s32)utf8proc_iterate((const ::uint8_t*)&fmt[index], -1, (::int32_t*)&character);
-            }
-            else
-            {
-                character = c;
-                index++;
-            }
-
-            if (character == '\n')
-            {
-                dist = 0;
-                ya  += (imp.lineHeight * scale);
+            va_list args;
+            va_start(args, fmt);
+            vsnprintf(message, sizeof(message), fmt, args);
+            va_end(args);
 
-                // Set alignment
-                switch(alignment)
-                {
-                default:
-                    prTrace(prLogLevel::LogError, "Unsupported alignment\n");
-                    break;
-
-                case ALIGN_LEFT:
-                    break;
-
-                case ALIGN_RIGHT:
-                    x  = xbak;
-                    x -= MeasureStringUntilTerm(&message[index], scale).x;
-                    break;
-
-                case ALIGN_CENTER:
-                    x  = xbak;
-                    x -= MeasureStringUntilTerm(&message[index], scale).x / 2;
-                    break;
-                }
-            }
-            else if (character == '\r') // Just in case, we only need the one CR/LF character
-            {
-            }
-            else if (character != '\0')
-            {
-                // find character details
-                s32  lower  = 0;
-                s32  upper  = imp.characters - 1;
-                s32  mid    = 0;
-                bool found  = false;
+            DrawString(x, y, 1.0f, prColour::White, ALIGN_LEFT, message);
+        }
+        else
+        {
+            DrawString(x, y, 1.0f, prColour::White, ALIGN_LEFT, fmt);
+        }
+    }
+}
 
-                while(lower <= upper)
-                {
-                    mid = (lower + upper) / 2;
 
-                    if (character > imp.pCharInfo[mid].id)
-                    {
-                        lower = mid + 1;
-                    }
-                    else if (character < imp.pCharInfo[mid].id)
-                    {
-                        upper = mid - 1;
-                    }
-                    else
-                    {
-                        found = true;
-                        break;
-                    }
-                }
-
-                if (found)
-                {
-                    CharData *pCharInfo = &imp.pCharInfo[mid];
+/// ---------------------------------------------------------------------------
+/// Draw
+/// ---------------------------------------------------------------------------
+void prBitmapFont::Draw(f32 x, f32 y, float scale, prColour colour, s32 alignment, const char *fmt, ...)
+{
+    if (fmt && *fmt)
+    {
+        // Only format the output if needed.
+        if (strchr(fmt, '%'))
+        {
+            char message[MSG_BUFFER_SIZE];
 
-                    if (character != ' ')
-                    {
-                        // Bind the current page texture.
-                        s32 currentPage = pCharInfo->page;                    
-                        PRASSERT(currentPage >= 0);
-                        PRASSERT(currentPage < imp.pages);
+            va_list args;
+            va_start(args, fmt);
+            vsnprintf(message, sizeof(message), fmt, args);
+            va_end(args);
 
-                        if (imp.boundPage != currentPage)
-                        {
-                            imp.pPageInfo[currentPage].pTexture->Bind();
-                            imp.boundPage = currentPage;
-                        }
+            DrawString(x, y, scale, colour, alignment, message);
+        }
+        else
+        {
+            DrawString(x, y, scale, colour, alignment, fmt);
+        }
+    }
+}
 
-                        float width  = (float)(pCharInfo->width);
-                        float height = (float)(pCharInfo->height);
 
-                        float u0 = pCharInfo->x * w;
-                        float u1 = u0 + (width * w);
-                        float v0 = 1.0f - ((pCharInfo->y * h) + (height * h));
-                        float v1 = v0 + (height * h);
+/// ---------------------------------------------------------------------------
+/// Draws a formatted string, with one draw call per page.
+/// ---------------------------------------------------------------------------
+void prBitmapFont::DrawString(f32 x, f32 y, float scale, prColour colour, s32 alignment, const char *text)
+{
+    const TextLayout *pLayout = imp.GetLayout(text, scale, alignment);
+    if (pLayout->runCount == 0)
+    {
+        return;
+    }
 
 
-                        glPushMatrix();
-                        ERR_CHECK();
+    // Render init
+    glEnable(GL_BLEND);
+    ERR_CHECK();
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    ERR_CHECK();
 
-                        float px = pCharInfo->xoffset + (width  / 2) + imp.GetKerning(character, message[index]) + dist;
-                        float py = pCharInfo->yoffset + (height / 2);
+    // Set states
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    ERR_CHECK();
 
-                        glTranslatef(px * scale, (py * scale) + ya, 0);
-                        ERR_CHECK();
 
-                        glScalef(scale * width, scale * height, 1);
-                        ERR_CHECK();
+    // Move to position
+    glPushMatrix();
+    ERR_CHECK();
+    glTranslatef(x, y, 0);
+    ERR_CHECK();
 
-                        QuadData quadData[] =
-                        {
-                            {-0.5f,  0.5f, u0, v0, },
-                            {-0.5f, -0.5f, u0, v1, },
-                            { 0.5f,  0.5f, u1, v0, },
-                            { 0.5f, -0.5f, u1, v1, },
-                        };
 
-	                    glVertexPointer(2, GL_FLOAT, sizeof(QuadData), &quadData->x);
-                        ERR_CHECK();
+    // Set the colour.
+    glColor4f(colour.red, colour.green, colour.blue, colour.alpha);
 
-	                    glTexCoordPointer(2, GL_FLOAT, sizeof(QuadData), &quadData->u);
-                        ERR_CHECK();
 
-	                    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-                        ERR_CHECK();
-                    
-                        glPopMatrix();
-                        ERR_CHECK();
+    // And rotate.
+    glRotatef(imp.rotation, 0, 0, 1);
+    ERR_CHECK();
 
-                        PRUNUSED(quadData->v);
-                    }
 
-                    dist += pCharInfo->xadvance;
-                }
-                else
-                {
-                    prTrace(prLogLevel::LogError, "Unsupported character: %i, %c\n", character, character);
-                }
-            }
-        }
-        while(c != '\0');
+    // Write the text.
+    for (u32 i=0; i<pLayout->runCount; i++)
+    {
+        const TextRun  &run    = pLayout->runs[i];
+        const QuadData *pFirst = &pLayout->vertices[run.firstVertex];
 
+        imp.pPageInfo[run.page].pTexture->Bind();
 
-        // Reset states
-        glPopMatrix();
+        glVertexPointer(2, GL_FLOAT, sizeof(QuadData), &pFirst->x);
         ERR_CHECK();
-
-	    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(QuadData), &pFirst->u);
         ERR_CHECK();
-
-        //glDisableClientState(GL_VERTEX_ARRAY);
-        //ERR_CHECK();
-
-        glDisable(GL_BLEND);
+        glDrawElements(GL_TRIANGLES, run.quads * INDICES_PER_QUAD, GL_UNSIGNED_SHORT, imp.pIndices);
         ERR_CHECK();
     }
+
+
+    // Reset states
+    glPopMatrix();
+    ERR_CHECK();
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    ERR_CHECK();
+
+    glDisable(GL_BLEND);
+    ERR_CHECK();
 }
 
 
@@ -855,25 +1353,13 @@ Proteus::Math::prVector2 prBitmapFont::MeasureString(const char *string, float s
 
     if (string && *string)
     {
-        s32   c;
         s32   index = 0;
         s32   character;
-        
+
         // --
         do
         {
-            c = string[index];
-
-            // utf-8?
-            if (c < 0 || c > 127)
-            {
-                 index += (s32)utf8proc_iterate((const ::uint8_t*)&string[index], -1, (::int32_t*)&character);
-            }
-            else
-            {
-                character = c;
-                index++;
-            }
+            character = BitmapFontImplementation::NextChar(string, index);
 
             if (character == '\n')
             {
@@ -885,34 +1371,11 @@ Proteus::Math::prVector2 prBitmapFont::MeasureString(const char *string, float s
             }
             else if (character != '\0')
             {
-                // find character details
-                s32  lower  = 0;
-                s32  upper  = imp.characters - 1;
-                s32  mid    = 0;
-                bool found  = false;
-
-                while(lower <= upper)
-                {
-                    mid = (lower + upper) / 2;
-
-                    if (character > imp.pCharInfo[mid].id)
-                    {
-                        lower = mid + 1;
-                    }
-                    else if (character < imp.pCharInfo[mid].id)
-                    {
-                        upper = mid - 1;
-                    }
-                    else
-                    {
-                        found = true;
-                        break;
-                    }
-                }
+                const CharData *pChar = imp.FindChar(character);
 
-                if (found)
+                if (pChar)
                 {
-                    len.x += imp.pCharInfo[mid].xadvance;
+                    len.x += pChar->xadvance;
 
                     if (len.x > max)
                     {
@@ -925,12 +1388,12 @@ Proteus::Math::prVector2 prBitmapFont::MeasureString(const char *string, float s
                 }
             }
         }
-        while(c != '\0');
+        while(character != '\0');
     }
 
     len.x = max;
     len  *= scale;
-    
+
     return len;
 }
 
@@ -954,57 +1417,21 @@ Proteus::Math::prVector2 prBitmapFont::MeasureStringUntilTerm(const char *string
 
     if (string && *string)
     {
-        char  c;
         s32   index = 0;
         s32   character;
-        
+
         do
         {
-            c = string[index];
-
-            // utf-8?
-            if (c < 0)// || c > 127)
-            {
-                index += (s32)utf8proc_iterate((const ::uint8_t*)&string[index], -1, (::int32_t*)&character);
-            }
-            else
-            {
-                character = c;
-                index++;
-            }
-
+            character = BitmapFontImplementation::NextChar(string, index);
 
             // Get size.
             if (character != '\0' && character != '\n' && character != '\r')
             {
-                // find character details
-                s32  lower  = 0;
-                s32  upper  = imp.characters - 1;
-                s32  mid    = 0;
-                bool found  = false;
+                const CharData *pChar = imp.FindChar(character);
 
-                while(lower <= upper)
+                if (pChar)
                 {
-                    mid = (lower + upper) / 2;
-
-                    if (character > imp.pCharInfo[mid].id)
-                    {
-                        lower = mid + 1;
-                    }
-                    else if (character < imp.pCharInfo[mid].id)
-                    {
-                        upper = mid - 1;
-                    }
-                    else
-                    {
-                        found = true;
-                        break;
-                    }
-                }
-
-                if (found)
-                {
-                    len.x += imp.pCharInfo[mid].xadvance;
+                    len.x += pChar->xadvance;
 
                     if (len.x > max)
                     {
@@ -1017,11 +1444,11 @@ Proteus::Math::prVector2 prBitmapFont::MeasureStringUntilTerm(const char *string
                 }
             }
         }
-        while(c != '\0' && c != '\n' && c != '\r');
+        while(character != '\0' && character != '\n' && character != '\r');
     }
 
     len.x = max;
     len  *= scale;
-    
+
     return len;
 }
@@ -26,10 +26,16 @@
 
 // Forward declarations.
 struct BitmapFontImplementation;
+class TiXmlElement;
 
 
 // Class: prBitmapFont
 //      Bitmap font class.
+//
+// Notes:
+//      Strings are laid out once and cached by their text, scale and
+//      alignment, so redrawing an unchanged string only costs one draw
+//      call per font page. Each line is aligned separately.
 class prBitmapFont
 {
 public:
@@ -62,9 +68,23 @@ public:
     //      Loads the font data.
     //
     // Parameters:
-    //      filename - The font file to load
+    //      filename - The font file to load. Either a cooked font or an xml font
     void Load(const char *filename);
 
+    // Method: Cook
+    //      Writes an xml font as a cooked font.
+    //
+    // Parameters:
+    //      pRoot       - The fonts root element
+    //      destination - The file to write
+    //
+    // Returns:
+    //      true on success
+    //
+    // Notes:
+    //      Normally called through <prCookAsset>.
+    static bool Cook(TiXmlElement *pRoot, const char *destination);
+
     // Method: Draw
     //      Draws a string
     //
@@ -107,6 +127,9 @@ private:
     // Measures a string
     Proteus::Math::prVector2 MeasureStringUntilTerm(const char *string, float scale);
 
+    // Draws a formatted string.
+    void DrawString(f32 x, f32 y, float scale, prColour colour, s32 alignment, const char *text);
+
 
 private:
     // Stops passing by value and assignment.
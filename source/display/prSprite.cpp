@@ -53,6 +53,7 @@
 #include "prRenderer.h"
 #include "prSprite.h"
 #include "prSpriteAnimation.h"
+#include "prSpriteBatch.h"
 #include "prSpriteManager.h"
 #include "prOglUtils.h"
 #include "../core/prMacros.h"
@@ -116,6 +117,8 @@ prSprite::prSprite(prSpriteManager *pSpriteManager, prTexture *pTexture, const c
     m_exp0      = false;
     m_exp1      = false;
     m_priority  = 0;
+    m_layer     = 0;
+    m_blend     = PRSPRITE_BLEND_ALPHA;
     
     debug       = SPRITE_DBG_NONE;
 
@@ -585,6 +588,16 @@ void prSprite::SetColour(prColour col)
 }
 
 
+/// ---------------------------------------------------------------------------
+/// Sets the blend mode.
+/// ---------------------------------------------------------------------------
+void prSprite::SetBlend(u32 blend)
+{
+    PRASSERT(blend < PRSPRITE_BLEND_MAX);
+    m_blend = blend;
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Sets the animations name.
 /// ---------------------------------------------------------------------------
@@ -595,3 +608,40 @@ void prSprite::SetName(const char *spriteName)
     m_name = new char[len];
     strcpy(m_name, spriteName);
 }
+
+
+/// ---------------------------------------------------------------------------
+/// Describes the sprite for batched drawing.
+/// ---------------------------------------------------------------------------
+void prSprite::GetBatchItem(prSpriteBatchItem &item) const
+{
+    f32 width  = m_frameWidth  * m_scaleX;
+    f32 height = m_frameHeight * m_scaleY;
+
+    // Set flips
+    if ((m_flip & FLIP_LEFTRIGHT) == FLIP_LEFTRIGHT)
+    {
+        width = -width;
+    }
+
+    if ((m_flip & FLIP_UPDOWN) == FLIP_UPDOWN)
+    {
+        height = -height;
+    }
+
+    // Same placement as Draw, which centres the quad on the frame.
+    item.texture  = m_pTexture;
+    item.x        = pos.x + (f32)(m_frameWidth  >> 1);
+    item.y        = pos.y + (f32)(m_frameHeight >> 1);
+    item.width    = width;
+    item.height   = height;
+    item.rotation = m_rotation;
+    item.u0       = m_u0;
+    item.v0       = m_v0;
+    item.u1       = m_u1;
+    item.v1       = m_v1;
+    item.colour   = m_colour;
+    item.layer    = m_layer;
+    item.priority = m_priority;
+    item.blend    = m_blend;
+}
@@ -38,6 +38,7 @@ class prSpriteManager;
 class prSpriteAnimationSequence;
 class prSpriteAnimation;
 class prRenderer;
+struct prSpriteBatchItem;
 
 
 // Defines
@@ -282,6 +283,38 @@ public:
     //      Returns draw order priority
     s32 GetPriority() const { return m_priority; }
 
+    // Method: SetPriority
+    //      Sets the draw order priority within the sprites layer.
+    //
+    // Parameters:
+    //      priority - Lower priorities are drawn first
+    void SetPriority(s32 priority) { m_priority = priority; }
+
+    // Method: GetLayer
+    //      Returns the draw order layer
+    s32 GetLayer() const { return m_layer; }
+
+    // Method: SetLayer
+    //      Sets the draw order layer.
+    //
+    // Parameters:
+    //      layer - Lower layers are drawn first
+    void SetLayer(s32 layer) { m_layer = layer; }
+
+    // Method: GetBlend
+    //      Returns the blend mode
+    //
+    // See Also:
+    //      <prSpriteBlend>
+    u32 GetBlend() const { return m_blend; }
+
+    // Method: SetBlend
+    //      Sets the blend mode.
+    //
+    // Parameters:
+    //      blend - A prSpriteBlend value
+    void SetBlend(u32 blend);
+
     // Method: SetColour
     //      Sets the tint colour.
     //
@@ -340,6 +373,10 @@ private:
     //      name        - The sequence name
     void AddSequence(prSpriteAnimationSequence* sequence, const char *name);
 
+    // Describes the sprite for batched drawing.
+    //      item        - Receives the description
+    void GetBatchItem(prSpriteBatchItem &item) const;
+
 
 private:
     // Stops passing by value and assignment.
@@ -373,7 +410,9 @@ private:
     f32                 m_pw;               // Pixel width
     f32                 m_ph;               // Pixel height
     f32                 m_angle;
-    s32                 m_priority;         // May not keep.
+    s32                 m_priority;         // Draw order within a layer.
+    s32                 m_layer;            // Draw order.
+    u32                 m_blend;            // Blend mode.
     prColour            m_colour;
     bool                m_animated;
     bool                m_visible;
@@ -29,6 +29,7 @@
 #include "../core/prMacros.h"
 #include "../core/prStringUtil.h"
 #include "../tinyxml/tinyxml.h"
+#include "../file/prChunkFile.h"
 
 
 //using namespace Proteus::Core;
@@ -239,6 +240,34 @@ void prSpriteAnimationSequence::ParseFrameData(TiXmlElement* pElement)
 }
 
 
+/// ---------------------------------------------------------------------------
+/// Reads the animation data from a cooked sprite file.
+/// ---------------------------------------------------------------------------
+void prSpriteAnimationSequence::LoadFrameData(prChunkReader &reader, s32 frames)
+{
+    for (s32 i=0; i<frames; i++)
+    {
+        prAnimSequenceData data;
+        data.index = reader.ReadS32();
+        data.delay = reader.ReadF32();
+
+        for (s32 j=0; j<MAX_USER_DATA; j++)
+        {
+            data.userData[j] = reader.ReadS32();
+        }
+
+        if (i < m_count)
+        {
+            m_pData[i] = data;
+        }
+        else if (i == m_count)
+        {
+            PRWARN("Sprite frame/index data exceeds specified frame count");
+        }
+    }
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Gets the user data for the current frame.
 /// ---------------------------------------------------------------------------
@@ -53,6 +53,7 @@ typedef struct prAnimSequenceData
 
 // Forward references
 class TiXmlElement;
+class prChunkReader;
 
 
 // Class: prSpriteAnimationSequence
@@ -103,6 +104,14 @@ public:
     //      pElement - The element to parse
     void ParseFrameData(TiXmlElement* pElement);
 
+    // Method: LoadFrameData
+    //      Reads the animation data from a cooked sprite file.
+    //
+    // Parameters:
+    //      reader - The reader, at the sequences frame data
+    //      frames - The number of frames stored
+    void LoadFrameData(prChunkReader &reader, s32 frames);
+
     // Method: GetUserDataForCurrentFrame
     //      Gets the user data for the current frame.
     //
@@ -0,0 +1,261 @@
+/**
+ * prSpriteBatch.cpp
+ *
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include <math.h>
+#include <algorithm>
+#include "prSpriteBatch.h"
+#include "../core/prMacros.h"
+#include "../debug/prAssert.h"
+
+
+// Defines
+#define SPRITEBATCH_MIN_CAPACITY    64
+
+
+// Local functions
+namespace
+{
+    // Orders sprites by layer, priority, blend mode, texture and then the order they were added.
+    struct DrawOrder
+    {
+        bool operator () (const prSpriteBatchKey &a, const prSpriteBatchKey &b) const
+        {
+            if (a.order   != b.order)     return a.order   < b.order;
+            if (a.blend   != b.blend)     return a.blend   < b.blend;
+            if (a.texture != b.texture)   return a.texture < b.texture;
+
+            return a.index < b.index;
+        }
+    };
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Constructor.
+/// ---------------------------------------------------------------------------
+prSpriteBatch::prSpriteBatch() : m_items    (nullptr)
+                               , m_order    (nullptr)
+                               , m_vertices (nullptr)
+                               , m_runs     (nullptr)
+                               , m_indices  (nullptr)
+                               , m_count    (0)
+                               , m_capacity (0)
+                               , m_runCount (0)
+{
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Destructor.
+/// ---------------------------------------------------------------------------
+prSpriteBatch::~prSpriteBatch()
+{
+    PRSAFE_DELETE_ARRAY(m_items);
+    PRSAFE_DELETE_ARRAY(m_order);
+    PRSAFE_DELETE_ARRAY(m_vertices);
+    PRSAFE_DELETE_ARRAY(m_runs);
+    PRSAFE_DELETE_ARRAY(m_indices);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Starts a new batch.
+/// ---------------------------------------------------------------------------
+void prSpriteBatch::Begin()
+{
+    m_count    = 0;
+    m_runCount = 0;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Adds a sprite to the batch.
+/// ---------------------------------------------------------------------------
+void prSpriteBatch::Add(const prSpriteBatchItem &item)
+{
+    PRASSERT(item.blend < PRSPRITE_BLEND_MAX);
+
+    if (m_count == m_capacity)
+    {
+        Reserve(m_capacity << 1);
+    }
+
+    m_items[m_count++] = item;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Sorts the sprites and builds the vertex stream and runs.
+/// ---------------------------------------------------------------------------
+void prSpriteBatch::Build()
+{
+    m_runCount = 0;
+
+    if (m_count == 0)
+    {
+        return;
+    }
+
+    // The keys are sorted rather than the items, as they're smaller and sorting them needs no indirection.
+    for (u32 i = 0; i < m_count; ++i)
+    {
+        const prSpriteBatchItem &item = m_items[i];
+
+        // Bias the signed values so they order correctly as unsigned.
+        m_order[i].order   = ((u64)((u32)item.layer ^ 0x80000000) << 32) | (u64)((u32)item.priority ^ 0x80000000);
+        m_order[i].texture = item.texture;
+        m_order[i].blend   = item.blend;
+        m_order[i].index   = i;
+    }
+
+    std::sort(m_order, m_order + m_count, DrawOrder());
+
+
+    prSpriteBatchRun *pRun = nullptr;
+    prSpriteVertex   *pDst = m_vertices;
+
+    for (u32 i = 0; i < m_count; ++i)
+    {
+        const prSpriteBatchItem &item = m_items[m_order[i].index];
+
+        // Start a new run on a state change, or when the run can no longer be indexed.
+        if (pRun == nullptr                 ||
+            pRun->texture != item.texture   ||
+            pRun->blend   != item.blend     ||
+            pRun->quads   == PRSPRITEBATCH_MAX_RUN_QUADS)
+        {
+            pRun              = &m_runs[m_runCount++];
+            pRun->texture     = item.texture;
+            pRun->blend       = item.blend;
+            pRun->firstVertex = i * PRSPRITEBATCH_VERTICES_PER_QUAD;
+            pRun->quads       = 0;
+        }
+
+        WriteQuad(item, pDst);
+
+        pDst += PRSPRITEBATCH_VERTICES_PER_QUAD;
+        pRun->quads++;
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Ensures the buffers can hold the requested number of sprites.
+/// ---------------------------------------------------------------------------
+void prSpriteBatch::Reserve(u32 count)
+{
+    count = PRMAX(count, (u32)SPRITEBATCH_MIN_CAPACITY);
+
+    if (count <= m_capacity)
+    {
+        return;
+    }
+
+
+    // Items are kept, everything else is rebuilt by Build.
+    prSpriteBatchItem *pItems = new prSpriteBatchItem[count];
+    for (u32 i = 0; i < m_count; ++i)
+    {
+        pItems[i] = m_items[i];
+    }
+
+    PRSAFE_DELETE_ARRAY(m_items);
+    PRSAFE_DELETE_ARRAY(m_order);
+    PRSAFE_DELETE_ARRAY(m_vertices);
+    PRSAFE_DELETE_ARRAY(m_runs);
+
+    m_items    = pItems;
+    m_order    = new prSpriteBatchKey[count];
+    m_vertices = new prSpriteVertex  [count * PRSPRITEBATCH_VERTICES_PER_QUAD];
+    m_runs     = new prSpriteBatchRun[count];
+
+
+    // The index pattern only needs to cover the largest possible run.
+    u32 oldQuads = PRMIN(m_capacity, (u32)PRSPRITEBATCH_MAX_RUN_QUADS);
+    u32 quads    = PRMIN(count,      (u32)PRSPRITEBATCH_MAX_RUN_QUADS);
+
+    if (quads > oldQuads)
+    {
+        PRSAFE_DELETE_ARRAY(m_indices);
+        m_indices = new u16[quads * PRSPRITEBATCH_INDICES_PER_QUAD];
+
+        u16 *pIndex = m_indices;
+
+        for (u32 i = 0; i < quads; ++i)
+        {
+            u16 base = (u16)(i * PRSPRITEBATCH_VERTICES_PER_QUAD);
+
+            // Two triangles, wound the same way as the existing triangle strip quads.
+            *pIndex++ = base + 0;
+            *pIndex++ = base + 1;
+            *pIndex++ = base + 2;
+            *pIndex++ = base + 2;
+            *pIndex++ = base + 1;
+            *pIndex++ = base + 3;
+        }
+    }
+
+    m_capacity = count;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Transforms a sprite into four vertices.
+/// ---------------------------------------------------------------------------
+void prSpriteBatch::WriteQuad(const prSpriteBatchItem &item, prSpriteVertex *pDst)
+{
+    PRASSERT(pDst);
+
+    // Corners of a unit quad, matching the renderers DrawQuad.
+    static const f32 corners[PRSPRITEBATCH_VERTICES_PER_QUAD][2] =
+    {
+        { -0.5f,  0.5f },
+        { -0.5f, -0.5f },
+        {  0.5f,  0.5f },
+        {  0.5f, -0.5f },
+    };
+
+    const f32 u[PRSPRITEBATCH_VERTICES_PER_QUAD] = { item.u0, item.u0, item.u1, item.u1 };
+    const f32 v[PRSPRITEBATCH_VERTICES_PER_QUAD] = { item.v0, item.v1, item.v0, item.v1 };
+
+    f32 c = 1.0f;
+    f32 s = 0.0f;
+
+    if (item.rotation != 0.0f)
+    {
+        f32 angle = PRDEG2RAD(item.rotation);
+        c = cosf(angle);
+        s = sinf(angle);
+    }
+
+    for (s32 i = 0; i < PRSPRITEBATCH_VERTICES_PER_QUAD; ++i)
+    {
+        f32 x = corners[i][0] * item.width;
+        f32 y = corners[i][1] * item.height;
+
+        pDst[i].x = item.x + (x * c) - (y * s);
+        pDst[i].y = item.y + (x * s) + (y * c);
+        pDst[i].u = u[i];
+        pDst[i].v = v[i];
+        pDst[i].r = item.colour.red;
+        pDst[i].g = item.colour.green;
+        pDst[i].b = item.colour.blue;
+        pDst[i].a = item.colour.alpha;
+    }
+}
@@ -0,0 +1,209 @@
+// File: prSpriteBatch.h
+//      Builds sorted vertex streams for batched sprite drawing.
+//
+// Notes:
+//      The batch builder makes no rendering calls. Sprites are added as
+//      <prSpriteBatchItem>s, then <Build> sorts them by layer, priority,
+//      blend mode and texture, transforms them into a single persistent
+//      vertex stream and splits the stream into runs which can each be
+//      drawn with a single draw call.
+/**
+ * Copyright 2014 Paul Michael McNab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+
+#include "prColour.h"
+#include "../core/prTypes.h"
+
+
+// Forward declarations
+class prTexture;
+
+
+// Defines
+#define PRSPRITEBATCH_VERTICES_PER_QUAD     4
+#define PRSPRITEBATCH_INDICES_PER_QUAD      6
+#define PRSPRITEBATCH_MAX_RUN_QUADS         (65536 / PRSPRITEBATCH_VERTICES_PER_QUAD)    // Quads addressable by 16 bit indices.
+
+
+// Enum: prSpriteBlend
+//      Sprite blend modes
+//
+//  PRSPRITE_BLEND_ALPHA    - Standard alpha blending. Default value
+//  PRSPRITE_BLEND_ADDITIVE - Additive blending
+enum prSpriteBlend
+{
+    PRSPRITE_BLEND_ALPHA,
+    PRSPRITE_BLEND_ADDITIVE,
+    PRSPRITE_BLEND_MAX,
+};
+
+
+// Struct: prSpriteBatchItem
+//      Describes a single sprite to the batch builder.
+typedef struct prSpriteBatchItem
+{
+    prTexture          *texture;        // Only used to group sprites. Never dereferenced
+    f32                 x;              // Centre
+    f32                 y;
+    f32                 width;          // Size. Negative values flip the sprite
+    f32                 height;
+    f32                 rotation;       // Rotation in degrees
+    f32                 u0;             // Texture coordinates
+    f32                 v0;
+    f32                 u1;
+    f32                 v1;
+    prColour            colour;
+    s32                 layer;          // Lower layers draw first
+    s32                 priority;       // Lower priorities draw first within a layer
+    u32                 blend;          // A prSpriteBlend value
+
+} prSpriteBatchItem;
+
+
+// Struct: prSpriteVertex
+//      An interleaved sprite vertex.
+typedef struct prSpriteVertex
+{
+    f32 x, y;
+    f32 u, v;
+    f32 r, g, b, a;
+
+} prSpriteVertex;
+
+
+// Struct: prSpriteBatchRun
+//      A run of quads which share a texture and blend mode.
+typedef struct prSpriteBatchRun
+{
+    prTexture          *texture;
+    u32                 blend;
+    u32                 firstVertex;    // The runs indices are relative to this vertex
+    u32                 quads;
+
+} prSpriteBatchRun;
+
+
+// Struct: prSpriteBatchKey
+//      Used to sort the sprites.
+typedef struct prSpriteBatchKey
+{
+    u64                 order;          // Layer and priority
+    prTexture          *texture;
+    u32                 blend;
+    u32                 index;          // Item index
+
+} prSpriteBatchKey;
+
+
+// Class: prSpriteBatch
+//      Sorts sprites and builds their vertex streams.
+//
+// Notes:
+//      Buffers grow as needed and are kept between frames, so a steady
+//      scene allocates nothing per frame.
+//
+//      Sprites on the same layer and priority with the same texture keep
+//      the order in which they were added. Sprites which differ only by
+//      texture or blend mode are grouped by texture, so their relative
+//      order is not defined.
+class prSpriteBatch
+{
+public:
+    // Method: prSpriteBatch
+    //      Constructor.
+    prSpriteBatch();
+
+    // Method: ~prSpriteBatch
+    //      Destructor.
+    ~prSpriteBatch();
+
+    // Method: Begin
+    //      Starts a new batch. Keeps the buffers allocated.
+    void Begin();
+
+    // Method: Add
+    //      Adds a sprite to the batch.
+    //
+    // Parameters:
+    //      item - The sprite description
+    void Add(const prSpriteBatchItem &item);
+
+    // Method: Build
+    //      Sorts the sprites and builds the vertex stream and runs.
+    void Build();
+
+    // Method: GetVertices
+    //      Returns the vertex stream. Valid after <Build>.
+    const prSpriteVertex *GetVertices() const { return m_vertices; }
+
+    // Method: GetVertexCount
+    //      Returns the number of vertices in the stream.
+    u32 GetVertexCount() const { return m_count * PRSPRITEBATCH_VERTICES_PER_QUAD; }
+
+    // Method: GetIndices
+    //      Returns the quad index pattern, which is shared by all runs.
+    //
+    // Notes:
+    //      Indices form two triangles per quad and are relative to a runs first vertex.
+    const u16 *GetIndices() const { return m_indices; }
+
+    // Method: GetRuns
+    //      Returns the runs. Valid after <Build>.
+    const prSpriteBatchRun *GetRuns() const { return m_runs; }
+
+    // Method: GetRunCount
+    //      Returns the number of runs.
+    u32 GetRunCount() const { return m_runCount; }
+
+    // Method: GetCount
+    //      Returns the number of sprites added.
+    u32 GetCount() const { return m_count; }
+
+    // Method: Reserve
+    //      Ensures the buffers can hold the requested number of sprites.
+    //
+    // Parameters:
+    //      count - The number of sprites
+    void Reserve(u32 count);
+
+    // Method: WriteQuad
+    //      Transforms a sprite into four vertices.
+    //
+    // Parameters:
+    //      item - The sprite description
+    //      pDst - Receives the four vertices
+    static void WriteQuad(const prSpriteBatchItem &item, prSpriteVertex *pDst);
+
+
+private:
+    // Stops passing by value and assignment.
+    prSpriteBatch(const prSpriteBatch&);
+    const prSpriteBatch& operator = (const prSpriteBatch&);
+
+
+private:
+    prSpriteBatchItem  *m_items;        // Sprites in the order added.
+    prSpriteBatchKey   *m_order;        // Sort keys in draw order.
+    prSpriteVertex     *m_vertices;     // The vertex stream.
+    prSpriteBatchRun   *m_runs;         // The draw runs.
+    u16                *m_indices;      // Quad index pattern for the largest run.
+    u32                 m_count;
+    u32                 m_capacity;
+    u32                 m_runCount;
+};
@@ -66,11 +66,50 @@
 #include "../display/prRenderer.h"
 #include "../display/prTexture.h"
 #include "../tinyxml/tinyxml.h"
+#include "../file/prAssetCooker.h"
+#include "../file/prChunkFile.h"
+#include "../file/prFileShared.h"
 
 
 //using namespace Proteus::Core;
 
 
+// Local functions
+namespace
+{
+    // Reads an integer attribute, which is zero if missing.
+    s32 IntAttribute(TiXmlElement* pElement, const char *name)
+    {
+        const char *pValue = pElement->Attribute(name);
+        PRASSERT(pValue, "Sprite element '%s' has no '%s' attribute", pElement->Value(), name);
+        return pValue ? atoi(pValue) : 0;
+    }
+
+
+    // Converts an animation type name.
+    s32 AnimationType(const char *animType)
+    {
+        PRASSERT(animType);
+
+        if (prStringCompare(animType, "loop") == CMP_EQUALTO)
+        {
+            return ANIM_TYPE_LOOP;
+        }
+        else if (prStringCompare(animType, "once") == CMP_EQUALTO)
+        {
+            return ANIM_TYPE_ONCE;
+        }
+        else if (prStringCompare(animType, "yoyo") == CMP_EQUALTO)
+        {
+            return ANIM_TYPE_YOYO;
+        }
+
+        PRWARN("Unrecognised animation type.");
+        return ANIM_TYPE_NONE;
+    }
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Constructs the background manager.
 /// ---------------------------------------------------------------------------
@@ -86,6 +125,7 @@ prSpriteManager::prSpriteManager() : prCoreSystem(PRSYSTEM_SPRITEMANAGER, "prSpr
     m_pBatchColours   = nullptr;
     m_numQuads        = 0;
     m_numQuadsAdded   = 0;
+    m_batchCapacity   = 0;
 }
 
 
@@ -95,6 +135,9 @@ prSpriteManager::prSpriteManager() : prCoreSystem(PRSYSTEM_SPRITEMANAGER, "prSpr
 prSpriteManager::~prSpriteManager()
 {
     ReleaseAll();
+
+    PRSAFE_DELETE_ARRAY(m_pBatchQuads);
+    PRSAFE_DELETE_ARRAY(m_pBatchColours);
 }
 
 
@@ -125,19 +168,81 @@ void prSpriteManager::Draw()
 {
     if (!m_activeSprites.empty())
     {
-        //std::list<prActiveSprite>::iterator it  = m_activeSprites.begin(); /*Update*/
-        //std::list<prActiveSprite>::iterator end = m_activeSprites.end();
+        // Gather
+        m_batch.Begin();
+
         auto it  = m_activeSprites.begin();
         auto end = m_activeSprites.end();
 
         for (; it != end; ++it)
         {
             // Shall we draw?
-            if ((*it).draw)
+            if ((*it).draw && (*it).sprite->GetVisible())
             {
-                (*it).sprite->Draw();
+                prSpriteBatchItem item;
+                (*it).sprite->GetBatchItem(item);
+                m_batch.Add(item);
             }
         }
+
+
+        // Sort and build the vertex stream.
+        m_batch.Build();
+
+        u32 runCount = m_batch.GetRunCount();
+        if (runCount == 0)
+        {
+            return;
+        }
+
+
+        // Set states
+        glEnable(GL_BLEND);
+        ERR_CHECK();
+        glEnableClientState(GL_COLOR_ARRAY);
+        ERR_CHECK();
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        ERR_CHECK();
+
+
+        // Draw one run at a time.
+        const prSpriteBatchRun *pRuns     = m_batch.GetRuns();
+        const prSpriteVertex   *pVertices = m_batch.GetVertices();
+        u32                     blend     = PRSPRITE_BLEND_MAX;
+
+        for (u32 i = 0; i < runCount; ++i)
+        {
+            const prSpriteBatchRun &run = pRuns[i];
+
+            if (run.blend != blend)
+            {
+                blend = run.blend;
+                glBlendFunc(GL_SRC_ALPHA, (blend == PRSPRITE_BLEND_ADDITIVE) ? GL_ONE : GL_ONE_MINUS_SRC_ALPHA);
+                ERR_CHECK();
+            }
+
+            run.texture->Bind();
+
+            const prSpriteVertex *pFirst = pVertices + run.firstVertex;
+
+            glVertexPointer(2, GL_FLOAT, sizeof(prSpriteVertex), &pFirst->x);
+            ERR_CHECK();
+            glTexCoordPointer(2, GL_FLOAT, sizeof(prSpriteVertex), &pFirst->u);
+            ERR_CHECK();
+            glColorPointer(4, GL_FLOAT, sizeof(prSpriteVertex), &pFirst->r);
+            ERR_CHECK();
+            glDrawElements(GL_TRIANGLES, run.quads * PRSPRITEBATCH_INDICES_PER_QUAD, GL_UNSIGNED_SHORT, m_batch.GetIndices());
+            ERR_CHECK();
+        }
+
+
+        // Reset states
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        ERR_CHECK();
+        glDisableClientState(GL_COLOR_ARRAY);
+        ERR_CHECK();
+        glDisable(GL_BLEND);
+        ERR_CHECK();
     }
 }
 
@@ -160,46 +265,12 @@ prSprite *prSpriteManager::Create(const char *filename, bool draw)
 
     if (m_sprite && m_texture)
     {
-        // Store
-        if (!m_activeSprites.empty())
-        {
-            prActiveSprite as;
-            as.sprite  = m_sprite;
-            as.texture = m_texture;
-            as.draw    = draw;
-
-            TODO("Re-add priority code")
-
-            // Insert sprite according to priority.
-/*            std::list<prActiveSprite>::iterator it  = m_activeSprites.begin();
-            std::list<prActiveSprite>::iterator end = m_activeSprites.end();
-            bool inserted = false;
-
-            for (; it != end; ++it)
-            {
-                //if ((*it).sprite->GetPriority() >= 0)
-                //{
-                    m_activeSprites.insert(it, as);
-                    inserted = true;
-                    break;
-                //}
-            }
-
-            // Else add last
-            if (!inserted)//*/
-            {
-                m_activeSprites.push_back(as);
-            }
-        }
-        else
-        {
-            // Push first
-            prActiveSprite as;
-            as.sprite  = m_sprite;
-            as.texture = m_texture;
-            as.draw    = draw;
-            m_activeSprites.push_back(as);
-        }
+        // Store. Draw order is decided by layer and priority when drawing.
+        prActiveSprite as;
+        as.sprite  = m_sprite;
+        as.texture = m_texture;
+        as.draw    = draw;
+        m_activeSprites.push_back(as);
     }
     else
     {
@@ -342,11 +413,24 @@ void prSpriteManager::BatchBegin(prSprite *pSprite, s32 batchSize)
 {
     PRASSERT(pSprite);
 
-    // Creat batch memory
+    // Create batch memory. It's kept for the next batch.
     if (batchSize > 0) 
     {
-        m_pBatchQuads   = new QuadData[(sizeof(QuadData) *  4) * batchSize];        // 4 quads per sprite
-        m_pBatchColours = new      f32[(sizeof(f32)      * 16) * batchSize];        // 16 colours per sprite
+        batchSize = PRMIN(batchSize, PRSPRITEBATCH_MAX_RUN_QUADS);
+
+        if (batchSize > m_batchCapacity)
+        {
+            PRSAFE_DELETE_ARRAY(m_pBatchQuads);
+            PRSAFE_DELETE_ARRAY(m_pBatchColours);
+
+            m_pBatchQuads   = new QuadData[ 4 * batchSize];     // 4 vertices per sprite
+            m_pBatchColours = new      f32[16 * batchSize];     // 16 colours per sprite
+            m_batchCapacity = batchSize;
+        }
+
+        // Ensure the shared index pattern covers the batch.
+        m_batch.Reserve(batchSize);
+
         m_numQuads      = batchSize;
         m_numQuadsAdded = 0;
         //PRLOGD("Starting batch size %i\n", (sizeof(QuadData) *  4) * batchSize);
@@ -398,15 +482,12 @@ void prSpriteManager::BatchEnd()
             ERR_CHECK();
             glTexCoordPointer(2, GL_FLOAT, sizeof(QuadData), &m_pBatchQuads->u);
             ERR_CHECK();
-//            glDrawArrays(GL_QUADS, 0, 4 * m_numQuadsAdded);
-            glDrawArrays(GL_TRIANGLES, 0, 4 * m_numQuadsAdded);
+            glDrawElements(GL_TRIANGLES, PRSPRITEBATCH_INDICES_PER_QUAD * m_numQuadsAdded, GL_UNSIGNED_SHORT, m_batch.GetIndices());
             ERR_CHECK();
         }
 
         //PRLOGD("Batch end %i - %i\n", m_numQuadsAdded, 4 * m_numQuadsAdded);
 
-        PRSAFE_DELETE_ARRAY(m_pBatchQuads);
-        PRSAFE_DELETE_ARRAY(m_pBatchColours);
         m_numQuads      = 0;
         m_numQuadsAdded = 0;
 
@@ -458,6 +539,21 @@ bool prSpriteManager::Load(const char *filename)
 {
     PRASSERT(filename && *filename);
 
+    // Cooked files are read directly.
+    prChunkReader reader;
+    if (reader.Load(filename, PRFILE_TYPE_SP, PRCOOKED_VERSION_SP))
+    {
+        LoadCooked(reader);
+
+        if (!reader.IsValid())
+        {
+            PRWARN("Failed to Load %s\n", filename);
+            return false;
+        }
+
+        return true;
+    }
+
     TiXmlDocument* doc = new TiXmlDocument(filename);
     
     bool result = false;
@@ -483,6 +579,130 @@ bool prSpriteManager::Load(const char *filename)
 }
 
 
+/// ---------------------------------------------------------------------------
+/// Reads a cooked sprite file.
+/// ---------------------------------------------------------------------------
+void prSpriteManager::LoadCooked(prChunkReader &reader)
+{
+    if (reader.FindChunk(PRCHUNK_INFO))
+    {
+        const char *name        = reader.ReadString();
+        s32         frameWidth  = reader.ReadS32();
+        s32         frameHeight = reader.ReadS32();
+        const char *texture     = reader.ReadString();
+
+        // Create the sprites texture and the sprite.
+        prResourceManager *pRM = static_cast<prResourceManager *>(prCoreGetComponent(PRSYSTEM_RESOURCEMANAGER));
+        PRASSERT(pRM)
+        m_texture = pRM->Load<prTexture>(texture);
+        PRASSERT(m_texture);
+
+        if (m_texture)
+        {
+            m_sprite = new prSprite(this, m_texture, name, frameWidth, frameHeight);
+        }
+    }
+
+    if (m_sprite && reader.FindChunk(PRCHUNK_SEQUENCE))
+    {
+        u32 count = reader.GetEntries();
+
+        for (u32 i=0; i<count; i++)
+        {
+            const char *name   = reader.ReadString();
+            s32         frames = reader.ReadS32();
+            s32         type   = reader.ReadS32();
+            s32         stored = reader.ReadS32();
+
+            // Create and add the animation sequence
+            prSpriteAnimationSequence* sequence = new prSpriteAnimationSequence(name, frames, type);
+            m_sprite->AddSequence(sequence, name);
+            sequence->LoadFrameData(reader, stored);
+        }
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Writes an xml sprite file as a cooked sprite file.
+/// ---------------------------------------------------------------------------
+bool prSpriteManager::Cook(TiXmlElement *pRoot, const char *destination)
+{
+    PRASSERT(pRoot);
+    PRASSERT(destination && *destination);
+
+    std::list<TiXmlElement *> sprites;
+    std::list<TiXmlElement *> sequences;
+    prCookFindElements(pRoot, "sprite",   sprites);
+    prCookFindElements(pRoot, "sequence", sequences);
+
+    if (sprites.empty())
+    {
+        PRWARN("Sprite file has no sprite");
+        return false;
+    }
+
+    // Sprite
+    TiXmlElement *pSprite  = sprites.front();
+    TiXmlElement *pTexture = pSprite->FirstChildElement("texture");
+    if (pTexture == nullptr || pTexture->Attribute("data") == nullptr)
+    {
+        PRWARN("Sprite '%s' has no texture.", pSprite->Attribute("name"));
+        return false;
+    }
+
+    prChunkWriter writer(PRFILE_TYPE_SP, PRCOOKED_VERSION_SP);
+
+    writer.BeginChunk(PRCHUNK_INFO, 1);
+    writer.WriteString(pSprite->Attribute("name"));
+    writer.WriteS32(IntAttribute(pSprite, "width"));
+    writer.WriteS32(IntAttribute(pSprite, "height"));
+    writer.WriteString(pTexture->Attribute("data"));
+
+    // Sequences
+    writer.BeginChunk(PRCHUNK_SEQUENCE, (u32)sequences.size());
+
+    for (auto it = sequences.begin(); it != sequences.end(); ++it)
+    {
+        TiXmlElement *pSequence = *it;
+        s32           frames    = IntAttribute(pSequence, "count");
+
+        std::list<TiXmlElement *> frameData;
+        for (TiXmlElement *pElem = pSequence->FirstChildElement("frame"); pElem; pElem = pElem->NextSiblingElement())
+        {
+            frameData.push_back(pElem);
+        }
+
+        if ((s32)frameData.size() > frames)
+        {
+            PRWARN("Sprite frame/index data exceeds specified frame count");
+            frameData.resize(frames);
+        }
+
+        writer.WriteString(pSequence->Attribute("name"));
+        writer.WriteS32(frames);
+        writer.WriteS32(AnimationType(pSequence->Attribute("anim")));
+        writer.WriteS32((s32)frameData.size());
+
+        for (auto frame = frameData.begin(); frame != frameData.end(); ++frame)
+        {
+            static const char *user[MAX_USER_DATA] = { "user0", "user1", "user2", "user3" };
+
+            writer.WriteS32(IntAttribute(*frame, "index"));
+            writer.WriteF32((f32)IntAttribute(*frame, "delay"));
+
+            for (s32 i=0; i<MAX_USER_DATA; i++)
+            {
+                const char *value = (*frame)->Attribute(user[i]);
+                writer.WriteS32(value ? atoi(value) : -1);
+            }
+        }
+    }
+
+    return writer.Save(destination);
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Parses a sprite file.
 /// ---------------------------------------------------------------------------
@@ -616,26 +836,7 @@ void prSpriteManager::ParseAttribs_Sequence(TiXmlElement* pElement)
 
 
         // Get animation type
-        const char *animType = pElement->Attribute("anim");
-        s32 type;
-
-        if (prStringCompare(animType, "loop") == CMP_EQUALTO)
-        {
-            type = ANIM_TYPE_LOOP;
-        }
-        else if (prStringCompare(animType, "once") == CMP_EQUALTO)
-        {
-            type = ANIM_TYPE_ONCE;
-        }
-        else if (prStringCompare(animType, "yoyo") == CMP_EQUALTO)
-        {
-            type = ANIM_TYPE_YOYO;
-        }
-        else
-        {
-            PRWARN("Unrecognised animation type.");
-            type = ANIM_TYPE_NONE;
-        }
+        s32 type = AnimationType(pElement->Attribute("anim"));
 
         
         // Create the animation sequence
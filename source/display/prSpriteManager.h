@@ -28,6 +28,7 @@
 #include <list>
 #include "../core/prTypes.h"
 #include "../core/prCoreSystem.h"
+#include "prSpriteBatch.h"
 
 
 // Forward declarations.
@@ -35,6 +36,7 @@ class prSprite;
 class TiXmlNode;
 class TiXmlElement;
 class prTexture;
+class prChunkReader;
 
 
 // Struct: prActiveSprite
@@ -73,6 +75,13 @@ public:
     //
     // Notes:
     //      This is an optional call.
+    //
+    //      Sprites are sorted by layer and priority, then batched so that
+    //      each run of sprites sharing a texture and blend mode is a single
+    //      draw call.
+    //
+    // See Also:
+    //      <prSpriteBatch>
     void Draw();
 
     // Method: Create
@@ -84,8 +93,27 @@ public:
     //
     // Returns:
     //      Returns the created sprite or NULL on failure
+    //
+    // Notes:
+    //      The sprite needs its textures size, so the texture is loaded before
+    //      this returns. To overlap texture loads, queue the textures earlier
+    //      with <prResourceManager::LoadAsync>, as the load waits for them.
     prSprite *Create(const char *filename, bool draw = true);
 
+    // Method: Cook
+    //      Writes an xml sprite file as a cooked sprite file.
+    //
+    // Parameters:
+    //      pRoot       - The files root element
+    //      destination - The file to write
+    //
+    // Returns:
+    //      true on success
+    //
+    // Notes:
+    //      Normally called through <prCookAsset>.
+    static bool Cook(TiXmlElement *pRoot, const char *destination);
+
 //#if defined(PROTEUS_TOOL) || defined(PLATFORM_PC)
     // Method: ToolCreate
     //      Creates a sprite.
@@ -134,6 +162,9 @@ public:
     // Parameters:
     //      pSprite   - The sprite to start batching with
     //      batchSize - The number of supported draw calls (32 equals 32 sprites, 0 equals don't use)
+    //
+    // Notes:
+    //      The batch memory is kept between batches and only grows.
     void BatchBegin(prSprite *pSprite, s32 batchSize = 0);
     
     // Method: BatchEnd
@@ -153,6 +184,11 @@ private:
     //      filename - Name of the file to load
     bool Load(const char *filename);
 
+    // Reads a cooked sprite file.
+    //
+    //      reader - The loaded file
+    void LoadCooked(prChunkReader &reader);
+
     // Parses a sprite file.
     //
     //      pParent - Pointer to a parent XML node
@@ -192,4 +228,6 @@ private:
     f32                        *m_pBatchColours;
     s32                         m_numQuads;
     s32                         m_numQuadsAdded;
+    s32                         m_batchCapacity;
+    prSpriteBatch               m_batch;
 };
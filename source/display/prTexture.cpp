@@ -123,6 +123,9 @@ prTexture::prTexture(const char *filename) : prResource(filename)
     m_height = 0;
     m_texID  = 0x00FFFFFF;
     m_alpha  = false;
+    m_pData    = nullptr;
+    m_pView    = nullptr;
+    m_dataSize = 0;
     m_exp0   = false;
     m_exp1   = false;
     m_exp2   = false;
@@ -135,6 +138,7 @@ prTexture::prTexture(const char *filename) : prResource(filename)
 prTexture::~prTexture()
 {
     lastTextureID = 0xFFFFFFFF;
+    ReleaseData();
     Unload();
 }
 
@@ -193,6 +197,22 @@ void prTexture::Unbind()
 /// ---------------------------------------------------------------------------
 void prTexture::Load(s32 extra)
 {
+    if (LoadAsync(extra))
+    {
+        LoadAsyncComplete(extra);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Reads the texture data. May be called on a loader thread.
+/// ---------------------------------------------------------------------------
+bool prTexture::LoadAsync(s32 extra)
+{
+    PRUNUSED(extra);
+
+    bool result = false;
+
     prFile *file = new prFile(Filename());
     if (file->Open())
     {
@@ -203,28 +223,50 @@ void prTexture::Load(s32 extra)
             PRWARN("prTexture::Load: File is empty.");
             file->Close();
             PRSAFE_DELETE(file);
-            return;
+            return false;
         }
 
-        SetSize(size);
-
         if (size < sizeof(prPVRTextureHeader))
         {
             PRWARN("prTexture::Load: File is too small to be a texture.");
             file->Close();
             PRSAFE_DELETE(file);
-            return;
+            return false;
         }
 
-        // Create load buffer
-        u8 *pTextureData = new u8[size];
+        // Use the archive data directly if possible, else create a load buffer
+        m_pView = file->GetView();
+        if (m_pView == nullptr)
+        {
+            m_pData = new u8[size];
 
-        // Load the data
-        file->Read(pTextureData, size);
+            // Load the data
+            file->Read(m_pData, size);
+            m_pView = m_pData;
+        }
         file->Close();
 
+        m_dataSize = size;
+        result     = true;
+    }
+
+    PRSAFE_DELETE(file);
+    return result;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Creates the texture from the loaded data. Must be called on the main thread.
+/// ---------------------------------------------------------------------------
+void prTexture::LoadAsyncComplete(s32 extra)
+{
+    if (m_pView)
+    {
+        // Set here, as the resource manager reads the size on the main thread.
+        SetSize(m_dataSize);
+
         // Check header
-        prPVRTextureHeader *header = (prPVRTextureHeader *)pTextureData;
+        prPVRTextureHeader *header = (prPVRTextureHeader *)m_pView;
         if (ValidateHeader(header))
         {
             // Set details
@@ -254,8 +296,7 @@ void prTexture::Load(s32 extra)
             {
                 prTrace(prLogLevel::LogError, "Failed to generate texture: %s\n", Filename());
                 prOpenGLErrorCheck(__FILE__, __FUNCTION__, __LINE__);
-                PRSAFE_DELETE_ARRAY(pTextureData);
-                PRSAFE_DELETE(file);
+                ReleaseData();
                 m_width  = 0;
                 m_height = 0;
                 m_texID  = 0xFFFFFFFF;
@@ -290,7 +331,7 @@ void prTexture::Load(s32 extra)
                 #if defined(PLATFORM_PC)
                     PRPANIC("Compressed textures not supported by this platform");
                 #else
-                    glCompressedTexImage2D(GL_TEXTURE_2D, 0, internalFormat, header->dwWidth, header->dwHeight, 0, size - sizeof(prPVRTextureHeader), ((u8*)header + sizeof(prPVRTextureHeader)));
+                    glCompressedTexImage2D(GL_TEXTURE_2D, 0, internalFormat, header->dwWidth, header->dwHeight, 0, m_dataSize - sizeof(prPVRTextureHeader), ((u8*)header + sizeof(prPVRTextureHeader)));
                     ERR_CHECK();
                 #endif
                 }
@@ -311,10 +352,19 @@ void prTexture::Load(s32 extra)
             PRWARN("Invalid texture header: %s", Filename());
         }
 
-        PRSAFE_DELETE_ARRAY(pTextureData);
+        ReleaseData();
     }
+}
 
-    PRSAFE_DELETE(file);
+
+/// ---------------------------------------------------------------------------
+/// Releases the loaded texture data.
+/// ---------------------------------------------------------------------------
+void prTexture::ReleaseData()
+{
+    PRSAFE_DELETE_ARRAY(m_pData);
+    m_pView    = nullptr;
+    m_dataSize = 0;
 }
 
 
@@ -59,6 +59,10 @@ public:
     //      Gets the textures alpha state.
     bool GetHasAlpha() const { return m_alpha; }
 
+    // Method: Class
+    //      Gets the resources class.
+    prResourceClass Class() const override { return PRRESOURCE_CLASS_TEXTURE; }
+
     // Method: GetTexID
     //      Gets the textures ID.
     u32 GetTexID() const { return m_texID; }
@@ -77,6 +81,15 @@ private:
     // Load texture.
     void Load(s32 extra);
 
+    // Reads the texture data. May be called on a loader thread.
+    bool LoadAsync(s32 extra);
+
+    // Creates the texture from the loaded data. Must be called on the main thread.
+    void LoadAsyncComplete(s32 extra);
+
+    // Releases the loaded texture data.
+    void ReleaseData();
+
     // Unload texture.
     void Unload();
 
@@ -115,6 +128,9 @@ private:
     s32     m_height;
     u32     m_texID;
     bool    m_alpha;
+    u8         *m_pData;        // Load buffer, if the data couldn't be viewed directly
+    const u8   *m_pView;        // Texture data waiting to be created
+    u32         m_dataSize;     // Size of the texture data
     bool    m_exp0;
     bool    m_exp1;
     bool    m_exp2;
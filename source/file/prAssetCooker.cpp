@@ -0,0 +1,120 @@
+/**
+ * prAssetCooker.cpp
+ *
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "../prConfig.h"
+#include <string.h>
+#include "prAssetCooker.h"
+#include "../debug/prAssert.h"
+#include "../debug/prTrace.h"
+#include "../core/prMacros.h"
+#include "../tinyxml/tinyxml.h"
+#include "../display/prBitmapFont.h"
+#include "../display/prBackground.h"
+#include "../display/prSpriteManager.h"
+#include "../particle/prParticleManager.h"
+#include "../locale/prLanguage.h"
+#include "../scene/prScene.h"
+#include "../achievements/prAchievementManager.h"
+
+
+// Local data
+namespace
+{
+    // Cooks a type of file.
+    typedef bool (*CookFunction)(TiXmlElement *pRoot, const char *destination);
+
+
+    // The cookable files, by their root element.
+    typedef struct CookType
+    {
+        const char     *root;
+        CookFunction    cook;
+
+    } CookType;
+
+
+    const CookType cookTypes[] =
+    {
+        { "sprite_file",        prSpriteManager::Cook       },
+        { "background_file",    prBackground::Cook          },
+        { "font",               prBitmapFont::Cook          },
+        { "particle_file",      prParticleManager::Cook     },
+        { "translations_file",  prLanguage::Cook            },
+        { "scene_file",         Scene::prScene::Cook        },
+        { "achievements_file",  prAchievementManager::Cook  },
+    };
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Cooks an xml data file.
+/// ---------------------------------------------------------------------------
+bool prCookAsset(const char *source, const char *destination)
+{
+    PRASSERT(source && *source);
+    PRASSERT(destination && *destination);
+
+    TiXmlDocument doc(source);
+    if (!doc.LoadFile())
+    {
+        PRWARN("Failed to Load %s\n", source);
+        return false;
+    }
+
+    TiXmlElement *pRoot = doc.RootElement();
+    if (pRoot)
+    {
+        for (u32 i=0; i<PRARRAY_SIZE(cookTypes); i++)
+        {
+            if (strcmp(pRoot->Value(), cookTypes[i].root) == 0)
+            {
+                bool result = cookTypes[i].cook(pRoot, destination);
+                if (!result)
+                {
+                    PRWARN("Failed to cook '%s'", source);
+                }
+
+                return result;
+            }
+        }
+    }
+
+    PRWARN("'%s' is not a type of file which can be cooked", source);
+    return false;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Finds the elements with a name below a node, in document order.
+/// ---------------------------------------------------------------------------
+void prCookFindElements(TiXmlNode *pParent, const char *name, std::list<TiXmlElement *> &elements)
+{
+    PRASSERT(pParent);
+    PRASSERT(name && *name);
+
+    for (TiXmlNode *pChild = pParent->FirstChild(); pChild != 0; pChild = pChild->NextSibling())
+    {
+        if (pChild->Type() == TiXmlNode::TINYXML_ELEMENT && strcmp(pChild->Value(), name) == 0)
+        {
+            elements.push_back(pChild->ToElement());
+        }
+
+        prCookFindElements(pChild, name, elements);
+    }
+}
@@ -0,0 +1,62 @@
+// File: prAssetCooker.h
+//      Converts the engines xml data files into cooked binary files.
+//
+// Notes:
+//      Cooked files are read without parsing, which makes loading much
+//      faster than loading xml. Cook the data for release builds, giving
+//      each cooked file the name of the xml file it replaces.
+//
+//      The loaders recognise cooked files by their header, so xml files can
+//      still be used during development.
+/**
+ * Copyright 2014 Paul Michael McNab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+
+#include <list>
+#include "../core/prTypes.h"
+
+
+// Forward declarations
+class TiXmlNode;
+class TiXmlElement;
+
+
+// Function: prCookAsset
+//      Cooks an xml data file.
+//
+// Parameters:
+//      source      - The xml file
+//      destination - The cooked file to write
+//
+// Returns:
+//      true on success
+//
+// Notes:
+//      The files type is found from its root element. Sprites, backgrounds,
+//      bitmap fonts, particles, language tables, scenes and achievements
+//      can be cooked.
+bool prCookAsset(const char *source, const char *destination);
+
+// Function: prCookFindElements
+//      Finds the elements with a name below a node, in document order.
+//
+// Notes:
+//      For the cookers, so they accept the same files as the xml loaders,
+//      which search the whole document.
+void prCookFindElements(TiXmlNode *pParent, const char *name, std::list<TiXmlElement *> &elements);
@@ -0,0 +1,509 @@
+/**
+ * prChunkFile.cpp
+ *
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "../prConfig.h"
+#include <stdio.h>
+#include <string.h>
+#include "prChunkFile.h"
+#include "prFile.h"
+#include "prFileShared.h"
+#include "../debug/prAssert.h"
+#include "../debug/prTrace.h"
+#include "../core/prMacros.h"
+
+
+// Defines
+#define CHUNK_NONE          0xFFFFFFFF
+#define CHUNK_ALIGNMENT     4
+#define WRITER_CAPACITY     4096
+
+
+/// ---------------------------------------------------------------------------
+/// Ctor
+/// ---------------------------------------------------------------------------
+prChunkReader::prChunkReader() : m_pView    (nullptr)
+                               , m_pData    (nullptr)
+                               , m_size     (0)
+                               , m_count    (0)
+                               , m_position (0)
+                               , m_end      (0)
+                               , m_entries  (0)
+                               , m_valid    (false)
+{
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Dtor
+/// ---------------------------------------------------------------------------
+prChunkReader::~prChunkReader()
+{
+    Release();
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Loads a chunked file.
+/// ---------------------------------------------------------------------------
+bool prChunkReader::Load(const char *filename, u32 type, u32 version)
+{
+    PRASSERT(filename && *filename);
+
+    Release();
+
+    prFile file(filename);
+    if (!file.Open())
+    {
+        return false;
+    }
+
+    u32 size = file.Size();
+    if (size < sizeof(prChunkHeader) + sizeof(prFileChunk))
+    {
+        file.Close();
+        return false;
+    }
+
+    // Check the header before reading the rest, as source files stop here.
+    prChunkHeader header;
+    const u8     *pView = file.GetView();
+
+    if (pView)
+    {
+        memcpy(&header, pView, sizeof(header));
+    }
+    else if (file.Read(&header, sizeof(header)) != sizeof(header))
+    {
+        file.Close();
+        return false;
+    }
+
+    if (header.magic1 != PRBIN_MAGIC1 ||
+        header.magic2 != PRBIN_MAGIC2)
+    {
+        file.Close();
+        return false;
+    }
+
+    if (header.type != type)
+    {
+        PRWARN("'%s' is not the expected type of cooked file", filename);
+        file.Close();
+        return false;
+    }
+
+    // Use the archive data directly if possible, else create a load buffer
+    if (pView == nullptr)
+    {
+        m_pData = new u8[size];
+
+        file.Rewind();
+        if (file.Read(m_pData, size) != size)
+        {
+            PRWARN("Failed to read cooked file '%s'", filename);
+            file.Close();
+            Release();
+            return false;
+        }
+
+        pView = m_pData;
+    }
+
+    file.Close();
+
+    m_pView = pView;
+    m_size  = size;
+    m_count = header.count;
+
+
+    // Validate the chunks, so reads only need to check the current chunk.
+    u32 offset = sizeof(prChunkHeader);
+    u32 first  = 0;
+    u32 i      = 0;
+
+    for (; i<m_count; i++)
+    {
+        prFileChunk chunk;
+
+        if (size - offset < sizeof(prFileChunk))
+        {
+            break;
+        }
+
+        memcpy(&chunk, m_pView + offset, sizeof(chunk));
+
+        if (chunk.size > size - offset - sizeof(prFileChunk))
+        {
+            break;
+        }
+
+        if (i == 0)
+        {
+            first = chunk.type;
+            m_entries = chunk.entries;
+        }
+
+        // The last chunk has no next chunk.
+        if (i == m_count - 1)
+        {
+            offset = (chunk.offset == 0) ? size : 0;
+        }
+        else if (chunk.offset >= sizeof(prFileChunk) + chunk.size &&
+                 chunk.offset <= size - offset)
+        {
+            offset += chunk.offset;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (i != m_count || offset != size)
+    {
+        PRWARN("Cooked file '%s' is corrupt", filename);
+        Release();
+        return false;
+    }
+
+    if (first != PRCHUNK_VERSION || m_entries != version)
+    {
+        PRWARN("Cooked file '%s' is version %u, expected %u. The data needs recooking", filename, m_entries, version);
+        Release();
+        return false;
+    }
+
+    m_entries = 0;
+    m_valid   = true;
+    return true;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Moves to the data of the first chunk of a type.
+/// ---------------------------------------------------------------------------
+bool prChunkReader::FindChunk(u32 type)
+{
+    PRASSERT(m_pView);
+
+    u32 offset = sizeof(prChunkHeader);
+
+    for (u32 i=0; m_pView && i<m_count; i++)
+    {
+        prFileChunk chunk;
+        memcpy(&chunk, m_pView + offset, sizeof(chunk));
+
+        if (chunk.type == type)
+        {
+            m_position = offset + sizeof(prFileChunk);
+            m_end      = m_position + chunk.size;
+            m_entries  = chunk.entries;
+            return true;
+        }
+
+        offset += chunk.offset;
+    }
+
+    m_position = 0;
+    m_end      = 0;
+    m_entries  = 0;
+    return false;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Copies data from the current chunk.
+/// ---------------------------------------------------------------------------
+bool prChunkReader::Read(void *pData, u32 size)
+{
+    PRASSERT(pData);
+
+    if (size > m_end - m_position)
+    {
+        memset(pData, 0, size);
+
+        if (m_valid)
+        {
+            PRWARN("Read past the end of a cooked files chunk");
+            m_valid = false;
+        }
+
+        return false;
+    }
+
+    memcpy(pData, m_pView + m_position, size);
+    m_position += size;
+    return true;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Reads an unsigned value from the current chunk.
+/// ---------------------------------------------------------------------------
+u32 prChunkReader::ReadU32()
+{
+    u32 value;
+    Read(&value, sizeof(value));
+    return value;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Reads a signed value from the current chunk.
+/// ---------------------------------------------------------------------------
+s32 prChunkReader::ReadS32()
+{
+    s32 value;
+    Read(&value, sizeof(value));
+    return value;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Reads a 64 bit value from the current chunk.
+/// ---------------------------------------------------------------------------
+u64 prChunkReader::ReadU64()
+{
+    u64 value;
+    Read(&value, sizeof(value));
+    return value;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Reads a float from the current chunk.
+/// ---------------------------------------------------------------------------
+f32 prChunkReader::ReadF32()
+{
+    f32 value;
+    Read(&value, sizeof(value));
+    return value;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Reads a string from the current chunk.
+/// ---------------------------------------------------------------------------
+const char *prChunkReader::ReadString()
+{
+    // Stored as the length, then the characters and their terminator.
+    u32 length = ReadU32();
+
+    if (m_valid)
+    {
+        if (length < m_end - m_position && m_pView[m_position + length] == '\0')
+        {
+            const char *string = (const char *)(m_pView + m_position);
+            m_position += length + 1;
+            return string;
+        }
+
+        PRWARN("Invalid string in a cooked file");
+        m_valid = false;
+    }
+
+    return "";
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Releases the data.
+/// ---------------------------------------------------------------------------
+void prChunkReader::Release()
+{
+    PRSAFE_DELETE_ARRAY(m_pData);
+
+    m_pView    = nullptr;
+    m_size     = 0;
+    m_count    = 0;
+    m_position = 0;
+    m_end      = 0;
+    m_entries  = 0;
+    m_valid    = false;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Ctor
+/// ---------------------------------------------------------------------------
+prChunkWriter::prChunkWriter(u32 type, u32 version) : m_pData    (nullptr)
+                                                    , m_size     (0)
+                                                    , m_capacity (0)
+                                                    , m_count    (0)
+                                                    , m_chunk    (CHUNK_NONE)
+                                                    , m_last     (CHUNK_NONE)
+{
+    prChunkHeader header;
+    header.magic1 = PRBIN_MAGIC1;
+    header.magic2 = PRBIN_MAGIC2;
+    header.count  = 0;
+    header.type   = type;
+
+    Reserve(WRITER_CAPACITY);
+    memcpy(m_pData, &header, sizeof(header));
+    m_size = sizeof(header);
+
+    BeginChunk(PRCHUNK_VERSION, version);
+    EndChunk();
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Dtor
+/// ---------------------------------------------------------------------------
+prChunkWriter::~prChunkWriter()
+{
+    PRSAFE_DELETE_ARRAY(m_pData);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Begins a chunk.
+/// ---------------------------------------------------------------------------
+void prChunkWriter::BeginChunk(u32 type, u32 entries)
+{
+    if (m_chunk != CHUNK_NONE)
+    {
+        EndChunk();
+    }
+
+    prFileChunk chunk;
+    chunk.type    = type;
+    chunk.size    = 0;
+    chunk.entries = entries;
+    chunk.offset  = 0;
+
+    m_chunk = m_size;
+    Write(&chunk, sizeof(chunk));
+    m_count++;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Ends the current chunk.
+/// ---------------------------------------------------------------------------
+void prChunkWriter::EndChunk()
+{
+    PRASSERT(m_chunk != CHUNK_NONE);
+
+    if (m_chunk != CHUNK_NONE)
+    {
+        prFileChunk *pChunk = (prFileChunk *)(m_pData + m_chunk);
+        pChunk->size = m_size - m_chunk - sizeof(prFileChunk);
+
+        // Pad, so the next chunk is aligned.
+        static const u8 padding[CHUNK_ALIGNMENT] = { 0 };
+        Write(padding, (CHUNK_ALIGNMENT - (m_size & (CHUNK_ALIGNMENT - 1))) & (CHUNK_ALIGNMENT - 1));
+
+        pChunk         = (prFileChunk *)(m_pData + m_chunk);
+        pChunk->offset = m_size - m_chunk;
+
+        m_last  = m_chunk;
+        m_chunk = CHUNK_NONE;
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Adds data to the current chunk.
+/// ---------------------------------------------------------------------------
+void prChunkWriter::Write(const void *pData, u32 size)
+{
+    PRASSERT(pData || size == 0);
+
+    if (size > 0)
+    {
+        Reserve(size);
+        memcpy(m_pData + m_size, pData, size);
+        m_size += size;
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Adds a string to the current chunk.
+/// ---------------------------------------------------------------------------
+void prChunkWriter::WriteString(const char *string)
+{
+    if (string == nullptr)
+    {
+        string = "";
+    }
+
+    u32 length = (u32)strlen(string);
+    WriteU32(length);
+    Write(string, length + 1);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Writes the file.
+/// ---------------------------------------------------------------------------
+bool prChunkWriter::Save(const char *filename)
+{
+    PRASSERT(filename && *filename);
+
+    if (m_chunk != CHUNK_NONE)
+    {
+        EndChunk();
+    }
+
+    // The last chunk has no next chunk.
+    ((prChunkHeader *)m_pData)->count = m_count;
+    ((prFileChunk *)(m_pData + m_last))->offset = 0;
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == nullptr)
+    {
+        PRWARN("Failed to write '%s'", filename);
+        return false;
+    }
+
+    bool result = (fwrite(m_pData, 1, m_size, fp) == m_size);
+    result = (fclose(fp) == 0) && result;
+
+    if (!result)
+    {
+        PRWARN("Failed to write '%s'", filename);
+    }
+
+    return result;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Ensures the buffer can hold more data.
+/// ---------------------------------------------------------------------------
+void prChunkWriter::Reserve(u32 size)
+{
+    if (m_size + size > m_capacity)
+    {
+        u32 capacity = PRMAX(m_capacity * 2, m_size + size);
+        u8 *pData    = new u8[capacity];
+
+        if (m_pData)
+        {
+            memcpy(pData, m_pData, m_size);
+        }
+
+        PRSAFE_DELETE_ARRAY(m_pData);
+        m_pData    = pData;
+        m_capacity = capacity;
+    }
+}
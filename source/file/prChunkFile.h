@@ -0,0 +1,214 @@
+// File: prChunkFile.h
+//      Reads and writes the engines chunked binary files.
+//
+// Notes:
+//      A chunked file is a <prChunkHeader> followed by its chunks. Each chunk
+//      is a <prFileChunk> followed by its data, padded to four bytes. The
+//      first chunk is always a PRCHUNK_VERSION chunk, whose entries hold the
+//      files version.
+//
+//      Data is stored little endian, which all the supported platforms are.
+/**
+ * Copyright 2014 Paul Michael McNab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+
+#include "../core/prTypes.h"
+
+
+// Class: prChunkReader
+//      Reads a chunked file without parsing or allocating per item.
+//
+// Notes:
+//      Strings are returned as pointers into the files data, so are only
+//      valid while the reader exists.
+class prChunkReader
+{
+public:
+    // Method: prChunkReader
+    //      Ctor
+    prChunkReader();
+
+    // Method: ~prChunkReader
+    //      Dtor
+    ~prChunkReader();
+
+    // Method: Load
+    //      Loads a chunked file.
+    //
+    // Parameters:
+    //      filename - The file to load
+    //      type     - The expected file type. One of PRFILE_TYPE_*
+    //      version  - The expected file version
+    //
+    // Returns:
+    //      true if the file is a valid chunked file of the type and version.
+    //
+    // Notes:
+    //      Files which aren't chunked files are rejected without warning, so
+    //      callers can fall back to loading the source format.
+    bool Load(const char *filename, u32 type, u32 version);
+
+    // Method: FindChunk
+    //      Moves to the data of the first chunk of a type.
+    //
+    // Returns:
+    //      true if the chunk was found.
+    bool FindChunk(u32 type);
+
+    // Method: GetEntries
+    //      Returns the number of entries in the current chunk.
+    u32 GetEntries() const { return m_entries; }
+
+    // Method: Read
+    //      Copies data from the current chunk.
+    //
+    // Returns:
+    //      true on success, false if the chunk has too little data, in which
+    //      case the destination is zeroed.
+    bool Read(void *pData, u32 size);
+
+    // Method: ReadU32
+    //      Reads an unsigned value from the current chunk.
+    u32 ReadU32();
+
+    // Method: ReadS32
+    //      Reads a signed value from the current chunk.
+    s32 ReadS32();
+
+    // Method: ReadU64
+    //      Reads a 64 bit value from the current chunk.
+    u64 ReadU64();
+
+    // Method: ReadF32
+    //      Reads a float from the current chunk.
+    f32 ReadF32();
+
+    // Method: ReadString
+    //      Reads a string from the current chunk.
+    //
+    // Returns:
+    //      The string, or an empty string on error. Never nullptr.
+    const char *ReadString();
+
+    // Method: IsValid
+    //      Determines if all the reads so far have succeeded.
+    bool IsValid() const { return m_valid; }
+
+
+private:
+    // Releases the data.
+    void Release();
+
+    // Stops passing by value and assignment.
+    prChunkReader(const prChunkReader&);
+    const prChunkReader& operator = (const prChunkReader&);
+
+
+private:
+    const u8   *m_pView;                                // The files data
+    u8         *m_pData;                                // The load buffer, if the data isn't a view
+    u32         m_size;
+    u32         m_count;                                // Number of chunks
+    u32         m_position;                             // Read position within the current chunk
+    u32         m_end;                                  // End of the current chunk
+    u32         m_entries;
+    bool        m_valid;
+};
+
+
+// Class: prChunkWriter
+//      Writes a chunked file.
+//
+// Notes:
+//      The file is built in memory, then written by <Save>.
+class prChunkWriter
+{
+public:
+    // Method: prChunkWriter
+    //      Ctor
+    //
+    // Parameters:
+    //      type     - The file type. One of PRFILE_TYPE_*
+    //      version  - The file version
+    prChunkWriter(u32 type, u32 version);
+
+    // Method: ~prChunkWriter
+    //      Dtor
+    ~prChunkWriter();
+
+    // Method: BeginChunk
+    //      Begins a chunk. Ends the previous chunk if needed.
+    void BeginChunk(u32 type, u32 entries);
+
+    // Method: EndChunk
+    //      Ends the current chunk.
+    void EndChunk();
+
+    // Method: Write
+    //      Adds data to the current chunk.
+    void Write(const void *pData, u32 size);
+
+    // Method: WriteU32
+    //      Adds an unsigned value to the current chunk.
+    void WriteU32(u32 value)        { Write(&value, sizeof(value)); }
+
+    // Method: WriteS32
+    //      Adds a signed value to the current chunk.
+    void WriteS32(s32 value)        { Write(&value, sizeof(value)); }
+
+    // Method: WriteU64
+    //      Adds a 64 bit value to the current chunk.
+    void WriteU64(u64 value)        { Write(&value, sizeof(value)); }
+
+    // Method: WriteF32
+    //      Adds a float to the current chunk.
+    void WriteF32(f32 value)        { Write(&value, sizeof(value)); }
+
+    // Method: WriteString
+    //      Adds a string to the current chunk.
+    //
+    // Notes:
+    //      nullptr is written as an empty string.
+    void WriteString(const char *string);
+
+    // Method: Save
+    //      Writes the file.
+    //
+    // Returns:
+    //      true on success.
+    bool Save(const char *filename);
+
+
+private:
+    // Ensures the buffer can hold more data.
+    void Reserve(u32 size);
+
+    // Stops passing by value and assignment.
+    prChunkWriter(const prChunkWriter&);
+    const prChunkWriter& operator = (const prChunkWriter&);
+
+
+private:
+    u8         *m_pData;
+    u32         m_size;
+    u32         m_capacity;
+    u32         m_count;                                // Number of chunks
+    u32         m_chunk;                                // Offset of the current chunk, or CHUNK_NONE
+    u32         m_last;                                 // Offset of the last chunk
+};
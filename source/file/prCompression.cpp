@@ -0,0 +1,204 @@
+/**
+ * prCompression.cpp
+ *
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "../prConfig.h"
+
+
+#include <string.h>
+#include "prCompression.h"
+#include "prFileShared.h"
+#include "../debug/prAssert.h"
+#include "../debug/prTrace.h"
+#include "../zlib/zlib.h"
+
+
+#if defined(ALLOW_ZSTD)
+#include <zstd.h>
+#endif
+
+
+namespace
+{
+    /// -----------------------------------------------------------------------
+    /// Reads an LZ4 length extension. Each 255 byte adds to the length, and
+    /// the first smaller byte ends it.
+    /// -----------------------------------------------------------------------
+    bool ReadLength(const u8 *&ip, const u8 *iend, u32 &length)
+    {
+        u8 byte;
+        do
+        {
+            if (ip >= iend)
+            {
+                return false;
+            }
+
+            byte    = *ip++;
+            length += byte;
+        }
+        while (byte == 255);
+
+        return true;
+    }
+
+
+    /// -----------------------------------------------------------------------
+    /// Decompresses an LZ4 block. All reads and writes are bounds checked, so
+    /// corrupt data fails rather than overrunning the buffers.
+    /// -----------------------------------------------------------------------
+    bool DecompressLZ4(const u8 *pSource, u32 sourceSize, u8 *pDest, u32 destSize)
+    {
+        const u8 *ip   = pSource;
+        const u8 *iend = pSource + sourceSize;
+        u8       *op   = pDest;
+        u8       *oend = pDest + destSize;
+
+        while (ip < iend)
+        {
+            u32 token = *ip++;
+
+            // Copy the literals
+            u32 literals = token >> 4;
+            if (literals == 15 && !ReadLength(ip, iend, literals))
+            {
+                return false;
+            }
+
+            if (literals > (u32)(iend - ip) || literals > (u32)(oend - op))
+            {
+                return false;
+            }
+
+            memcpy(op, ip, literals);
+            op += literals;
+            ip += literals;
+
+            // The last sequence only has literals
+            if (ip == iend)
+            {
+                break;
+            }
+
+            // Copy the match
+            if (iend - ip < 2)
+            {
+                return false;
+            }
+
+            u32 offset = ip[0] | (ip[1] << 8);
+            ip += 2;
+
+            if (offset == 0 || offset > (u32)(op - pDest))
+            {
+                return false;
+            }
+
+            u32 match = token & 15;
+            if (match == 15 && !ReadLength(ip, iend, match))
+            {
+                return false;
+            }
+
+            match += 4;
+            if (match > (u32)(oend - op))
+            {
+                return false;
+            }
+
+            const u8 *pMatch = op - offset;
+            if (offset >= match)
+            {
+                memcpy(op, pMatch, match);
+                op += match;
+            }
+            else
+            {
+                // Overlapping copies repeat the pattern, so must be done bytewise.
+                while (match--)
+                {
+                    *op++ = *pMatch++;
+                }
+            }
+        }
+
+        return op == oend;
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Decompresses an archive entry.
+/// ---------------------------------------------------------------------------
+bool prDecompress(u32 type, const u8 *pSource, u32 sourceSize, u8 *pDest, u32 destSize)
+{
+    PRASSERT(pSource);
+    PRASSERT(pDest);
+
+    bool result = false;
+
+    switch(type)
+    {
+    case PRARC_COMPRESSION_ZLIB:
+        {
+            uLong destLen = (uLong)destSize;
+            int   error   = uncompress(pDest, &destLen, pSource, sourceSize);
+            if (error < Z_OK)
+            {
+                prTrace(prLogLevel::LogError, "Uncompress failed: %i\n", error);
+            }
+            else
+            {
+                result = (destLen == (uLong)destSize);
+            }
+        }
+        break;
+
+    case PRARC_COMPRESSION_LZ4:
+        result = DecompressLZ4(pSource, sourceSize, pDest, destSize);
+        if (!result)
+        {
+            prTrace(prLogLevel::LogError, "LZ4 decompress failed\n");
+        }
+        break;
+
+    case PRARC_COMPRESSION_ZSTD:
+        #if defined(ALLOW_ZSTD)
+        {
+            size_t size = ZSTD_decompress(pDest, destSize, pSource, sourceSize);
+            if (ZSTD_isError(size))
+            {
+                prTrace(prLogLevel::LogError, "zstd decompress failed: %s\n", ZSTD_getErrorName(size));
+            }
+            else
+            {
+                result = (size == (size_t)destSize);
+            }
+        }
+        #else
+        prTrace(prLogLevel::LogError, "zstd compressed data found, but ALLOW_ZSTD is not defined\n");
+        #endif
+        break;
+
+    default:
+        prTrace(prLogLevel::LogError, "Unknown compression type: %i\n", type);
+        break;
+    }
+
+    return result;
+}
@@ -0,0 +1,43 @@
+// File: prCompression.h
+/**
+ * Copyright 2014 Paul Michael McNab
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+
+#include "../core/prTypes.h"
+
+
+// Function: prDecompress
+//      Decompresses an archive entry.
+//
+// Parameters:
+//      type       - The compression type. See PRARC_COMPRESSION_* in prFileShared.h
+//      pSource    - The compressed data
+//      sourceSize - The compressed data size
+//      pDest      - The destination buffer
+//      destSize   - The uncompressed size
+//
+// Returns:
+//      true if the data decompressed to exactly destSize bytes
+//
+// Notes:
+//      zstd is only available if ALLOW_ZSTD is defined, as it requires the zstd library.
+//
+// Notes:
+//      Thread safe.
+bool prDecompress(u32 type, const u8 *pSource, u32 sourceSize, u8 *pDest, u32 destSize);
@@ -166,7 +166,7 @@ prFile::prFile(const char *filename) : pImpl (new FileImplementation())
     {
         // Creates file names. One for the disk, one for the archive and keeps the original
         prStringCopySafe(imp.filenameArch, filename + 5, FILE_MAX_FILENAME_SIZE);
-        prStringCopySafe(imp.filenameDisk, pFM->GetSystemPath(filename), FILE_MAX_FILENAME_SIZE);
+        pFM->GetSystemPath(filename, imp.filenameDisk);
         prStringCopySafe(imp.filenameOrig, filename, FILE_MAX_FILENAME_SIZE);
 
         // Must be lowercase
@@ -467,7 +467,7 @@ u32 prFile::Read(void *pDataBuffer, u32 size)
     size_t bytes = 0xFFFFFFFF;
     if (imp.inArchive)
     {
-        bytes = pFM->Read((u8*)pDataBuffer, size, prStringHash(imp.filenameArch));
+        bytes = pFM->Read((u8*)pDataBuffer, size, prStringHash64(imp.filenameArch));
 
         #if defined(PLATFORM_ANDROID)
         __android_log_print(ANDROID_LOG_ERROR, "Proteus", "Error: File found in archive");
@@ -506,6 +506,32 @@ u32 prFile::Read(void *pDataBuffer, u32 size)
 }
 
 
+/// ---------------------------------------------------------------------------
+/// Returns a read only view of an open files data.
+/// ---------------------------------------------------------------------------
+const u8 *prFile::GetView()
+{
+    // Sanity checks
+    PRASSERT(pImpl        != nullptr);
+    PRASSERT(imp.opened   == true);
+    PRASSERT(imp.filemode == FileMode_Normal);
+
+    const u8 *pView = nullptr;
+
+    if (imp.inArchive)
+    {
+        // Get filemanager
+        prFileManager *pFM = static_cast<prFileManager *>(prCoreGetComponent(PRSYSTEM_FILEMANAGER));
+        PRASSERT(pFM)
+
+        u32 size = 0;
+        pView = pFM->GetView(prStringHash64(imp.filenameArch), size);
+    }
+
+    return pView;
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Seek within an open file.
 /// ---------------------------------------------------------------------------
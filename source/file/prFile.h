@@ -62,6 +62,14 @@ public:
     //      Reads data from an open file
     u32 Read(void *pDataBuffer, u32 size);
 
+    // Method: GetView
+    //      Returns a read only view of an open files data.
+    //
+    // Notes:
+    //      A view is only available for uncompressed files within a memory mapped
+    //      archive. If nullptr is returned then <Read> must be used instead.
+    const u8 *GetView();
+
     // Method: Seek
     //      Seek within an open file.
     void Seek(s32 offset, s32 origin);
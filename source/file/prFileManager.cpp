@@ -21,6 +21,7 @@
 
 
 #include <string.h>
+#include <algorithm>
 #include "prFileManager.h"
 #include "prFile.h"
 #include "../debug/prAssert.h"
@@ -30,7 +31,7 @@
 #include "../core/prCoreSystem.h"
 #include "../core/prStringUtil.h"
 #include "../file/prFileShared.h"
-#include "../zlib/zlib.h"
+#include "../file/prCompression.h"
 
 
 // Debug assist
@@ -46,14 +47,25 @@
 
 #elif defined(PLATFORM_IOS)  
   #include <stdlib.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
   #include "../ios/prIos.h"
 
 #elif defined(PLATFORM_MAC)
   #include <stdlib.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
 
 #elif defined(PLATFORM_LINUX)
   #include <stdlib.h>
+  #include <fcntl.h>
   #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
 
 #ifndef MAX_PATH
 #define MAX_PATH 256
@@ -85,6 +97,178 @@
 //using namespace Proteus::Core;
 
 
+namespace
+{
+    /// -----------------------------------------------------------------------
+    /// Orders archive entries by hash.
+    /// -----------------------------------------------------------------------
+    bool EntryOrder(const prArcEntryV2 &a, const prArcEntryV2 &b)
+    {
+        return a.hash < b.hash;
+    }
+}
+
+
+#if !defined(PLATFORM_ANDROID)
+namespace
+{
+    /// -----------------------------------------------------------------------
+    /// Opens an archive for positional reads.
+    /// -----------------------------------------------------------------------
+    prArchiveHandle OpenArchive(const char *filename)
+    {
+        PRASSERT(filename && *filename);
+
+    #if defined(PLATFORM_PC)
+        return CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    #else
+        return open(filename, O_RDONLY);
+    #endif
+    }
+
+
+    /// -----------------------------------------------------------------------
+    /// Closes an archive.
+    /// -----------------------------------------------------------------------
+    void CloseArchive(prArchiveHandle handle)
+    {
+        if (handle != PRARCHIVE_INVALID_HANDLE)
+        {
+        #if defined(PLATFORM_PC)
+            CloseHandle(handle);
+        #else
+            close(handle);
+        #endif
+        }
+    }
+
+
+    /// -----------------------------------------------------------------------
+    /// Returns the size of an archive. Archives may be larger than 4GB.
+    /// -----------------------------------------------------------------------
+    u64 ArchiveSize(prArchiveHandle handle)
+    {
+        PRASSERT(handle != PRARCHIVE_INVALID_HANDLE);
+
+    #if defined(PLATFORM_PC)
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(handle, &size))
+        {
+            return (u64)size.QuadPart;
+        }
+    #else
+        struct stat info;
+        if (fstat(handle, &info) == 0)
+        {
+            return (u64)info.st_size;
+        }
+    #endif
+
+        return 0;
+    }
+
+
+    /// -----------------------------------------------------------------------
+    /// Reads from an absolute offset within an archive. As no file pointer is
+    /// shared, reads can be issued from any thread.
+    /// -----------------------------------------------------------------------
+    u32 ReadArchive(prArchiveHandle handle, void *pDataBuffer, u32 size, u64 offset)
+    {
+        PRASSERT(handle != PRARCHIVE_INVALID_HANDLE);
+        PRASSERT(pDataBuffer);
+
+        u32 total = 0;
+
+    #if defined(PLATFORM_PC)
+        while (total < size)
+        {
+            OVERLAPPED overlapped;
+            memset(&overlapped, 0, sizeof(overlapped));
+            overlapped.Offset     = (DWORD)((offset + total) & 0xFFFFFFFF);
+            overlapped.OffsetHigh = (DWORD)((offset + total) >> 32);
+
+            DWORD bytes = 0;
+            if (!ReadFile(handle, static_cast<u8 *>(pDataBuffer) + total, size - total, &bytes, &overlapped) || bytes == 0)
+            {
+                break;
+            }
+
+            total += bytes;
+        }
+
+    #else
+        while (total < size)
+        {
+            ssize_t bytes = pread(handle, static_cast<u8 *>(pDataBuffer) + total, size - total, (off_t)(offset + total));
+            if (bytes <= 0)
+            {
+                break;
+            }
+
+            total += (u32)bytes;
+        }
+
+    #endif
+
+        return total;
+    }
+
+
+    #if defined(PROTEUS_OPTIMISE_MAP_ARCHIVES)
+    /// -----------------------------------------------------------------------
+    /// Maps an entire archive into memory as read only data.
+    /// -----------------------------------------------------------------------
+    const u8 *MapArchive(prArchiveHandle handle, u64 size)
+    {
+        const u8 *pData = nullptr;
+
+        // The archive must fit in the address space.
+        if (handle != PRARCHIVE_INVALID_HANDLE && size > 0 && size == (u64)(size_t)size)
+        {
+        #if defined(PLATFORM_PC)
+            HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping != nullptr)
+            {
+                pData = static_cast<const u8 *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+                // The view keeps the mapping alive.
+                CloseHandle(mapping);
+            }
+
+        #else
+            void *pMap = mmap(nullptr, (size_t)size, PROT_READ, MAP_PRIVATE, handle, 0);
+            if (pMap != MAP_FAILED)
+            {
+                pData = static_cast<const u8 *>(pMap);
+            }
+
+        #endif
+        }
+
+        return pData;
+    }
+
+
+    /// -----------------------------------------------------------------------
+    /// Releases a mapped archive.
+    /// -----------------------------------------------------------------------
+    void UnmapArchive(const u8 *pData, u64 size)
+    {
+        if (pData)
+        {
+        #if defined(PLATFORM_PC)
+            PRUNUSED(size);
+            UnmapViewOfFile(pData);
+        #else
+            munmap(const_cast<u8 *>(pData), (size_t)size);
+        #endif
+        }
+    }
+    #endif
+}
+#endif
+
+
 /// ---------------------------------------------------------------------------
 /// Creates a path to the applications data.
 /// ---------------------------------------------------------------------------
@@ -98,15 +282,17 @@ prFileManager::prFileManager(const char *saveFolder) : prCoreSystem(PRSYSTEM_FIL
     exp0     = false;
     exp1     = false;
     exp2     = false;
-    table    = -1;
-    index    = -1;
-    filehash = 0xFFFFFFFF;
 
     for (int i=0; i<FILE_ARCHIVES_MAX; i++)
     {
-        pArchiveFile[i] = nullptr;
-        pEntries[i]     = nullptr;
-        entryCount[i]   = 0;
+        archive[i]        = PRARCHIVE_INVALID_HANDLE;
+        pEntries[i]       = nullptr;
+        entryCount[i]     = 0;
+        pDisplacements[i] = nullptr;
+        bucketCount[i]    = 0;
+        pNames[i]         = nullptr;
+        pArchiveData[i]   = nullptr;
+        archiveSize[i]    = 0;
     }
 
     memset(path, 0, sizeof(path));
@@ -176,15 +362,22 @@ prFileManager::~prFileManager()
 {
     for (int i=0; i<FILE_ARCHIVES_MAX; i++)
     {
-        // Close and delete file
-        if (pArchiveFile[i] != nullptr)
-        {
-            pArchiveFile[i]->Close();
-            PRSAFE_DELETE(pArchiveFile[i]);
-        }
+        // Delete directory
+        ReleaseFat(i);
+
+    #if !defined(PLATFORM_ANDROID)
+        // Release mapped data
+        #if defined(PROTEUS_OPTIMISE_MAP_ARCHIVES)
+        UnmapArchive(pArchiveData[i], archiveSize[i]);
+        #endif
+
+        // Close file
+        CloseArchive(archive[i]);
+    #endif
 
-        // Delete entry table
-        PRSAFE_DELETE(pEntries[i]);
+        archive[i]      = PRARCHIVE_INVALID_HANDLE;
+        pArchiveData[i] = nullptr;
+        archiveSize[i]  = 0;
     }
 }
 
@@ -218,93 +411,105 @@ void prFileManager::RegisterArchive(const char *filename)
         prFile *fileFat = new prFile(filenameFat);
         if (fileArc->Exists() && fileFat->Exists())
         {
-            fileArc->Open();
             fileFat->Open();
-            u32 sizeArc = fileArc->Size();
             u32 sizeFat = fileFat->Size();
 
             // Read the fat?
             if (sizeFat > sizeof(prFatHeader))
             {
                 prFatHeader header;
-                fileFat->Read(&header, sizeof(prFatHeader));
+                u32 bytes = fileFat->Read(&header, sizeof(prFatHeader));
 
                 // Validate the header
-                if (header.magic1 == MAGIC1 && header.magic2 == MAGIC2 && header.size == sizeFat)
+                if (bytes == sizeof(prFatHeader) && header.magic1 == MAGIC1 && (header.magic2 == MAGIC2 || header.magic2 == MAGIC2_V2) && header.size == sizeFat)
                 {
-                    // See if the size matches entry count
-                    u32 size = (header.entries * sizeof(prArcEntry)) + sizeof(prFatHeader);
-
-                    if (size == sizeFat)
+                    // Find a free table
+                    bool found = false;
+                    int  idx = 0;
+                    for (int i=0; i<FILE_ARCHIVES_MAX; i++)
                     {
-                        // Check the archive is larger than 0.
-                        if (sizeArc > 0)
+                        if (pEntries[i] == nullptr && archive[i] == PRARCHIVE_INVALID_HANDLE)
                         {
-                            // Read the fat table.
-                            u32 tableSize = header.entries * sizeof(prArcEntry);
-
-                            prArcEntry *entries = new prArcEntry[header.entries];
+                            idx   = i;
+                            found = true;
+                            break;
+                        }
+                    }
 
-                            fileFat->Read(entries, tableSize);
+                    if (found)
+                    {
+                        // Read the directory. Version 1 tables are converted to the version 2 format.
+                        bool loaded = (header.magic2 == MAGIC2) ? LoadFat(fileFat, header, idx) : LoadFatV2(fileFat, header, idx);
+                        if (loaded)
+                        {
+                            // Open file for positional data access.
+                            prArchiveHandle handle = OpenArchive(GetSystemPath(filenameArc));
+                            if (handle == PRARCHIVE_INVALID_HANDLE)
+                            {
+                                handle = OpenArchive(filenameArc);
+                            }
 
+                            u64 sizeArc = (handle != PRARCHIVE_INVALID_HANDLE) ? ArchiveSize(handle) : 0;
 
-                            // Store table
-                            bool found = false;
-                            int  idx = 0;
-                            for (int i=0; i<FILE_ARCHIVES_MAX; i++)
+                            // Check every file lies within the archive, so a truncated
+                            // or corrupt archive can't be read past its end.
+                            bool valid = (sizeArc > 0);
+                            for (u32 i=0; valid && i<entryCount[idx]; i++)
                             {
-                                if (pEntries[i] == nullptr && pArchiveFile[i] == nullptr)
-                                {
-                                    idx   = i;
-                                    found = true;
-                                    break;
-                                }
+                                const prArcEntryV2 &entry = pEntries[idx][i];
+                                u64 stored = entry.compressed ? entry.compressedSize : entry.filesize;
+                                valid = (entry.offset <= sizeArc && stored <= sizeArc - entry.offset);
                             }
 
-
-                            if (found)
+                            if (valid)
                             {
-                                // Open file for data access, store entries and indicate we have an archive open for use.
-                                pArchiveFile[idx] = new prFile(filenameArc);
-                                pEntries    [idx] = entries;
-                                entryCount  [idx] = header.entries;
+                                // Indicate we have an archive open for use.
+                                archive    [idx] = handle;
+                                archiveSize[idx] = sizeArc;
                                 count++;
 
-                                pArchiveFile[idx]->Open();
-                                
-                                // Clear the extra data, as we need it to do accessed tracking.
-                                for(u32 i=0; i<header.entries; i++)
+                                // Map the archive, so reads don't need to seek and copy.
+                                #if defined(PROTEUS_OPTIMISE_MAP_ARCHIVES)
+                                pArchiveData[idx] = MapArchive(handle, sizeArc);
+                                if (pArchiveData[idx] == nullptr)
                                 {
-                                    prArcEntry *pE = pEntries[idx];
-                                    pE += i;
-                                    pE->accessed = 0;
-                                    pE->exp1     = 0;
+                                    prTrace(prLogLevel::LogError, "Failed to map archive, using file reads: %s\n", filenameArc);
                                 }
+                                #endif
 
                                 #if defined(FILEMANAGER_DEBUG)
                                 prTrace(LogError, "Found archive: %s\n", filenameArc);
-                                for(u32 i=0; i<header.entries; i++)
+                                for(u32 i=0; i<entryCount[idx]; i++)
                                 {
-                                    prArcEntry *pE = pEntries[idx];
+                                    prArcEntryV2 *pE = pEntries[idx];
                                     pE += i;
-                                    prTrace(LogError, "File: %s - %x - %s - %s\n", pE->filename, pE->hash, PRBOOL_TO_STRING(pE->accessed), PRBOOL_TO_STRING(pE->exp1));
+                                    prTrace(LogError, "File: %s - %llx - %s - %s\n", pNames[idx] + pE->filename, (unsigned long long)pE->hash, PRBOOL_TO_STRING(pE->accessed), PRBOOL_TO_STRING(pE->exp1));
                                 }
                                 #endif
                             }
                             else
                             {
-                                PRSAFE_DELETE_ARRAY(entries);
-                                PRWARN("Too many archives. Unable to store archive.");
+                                if (handle == PRARCHIVE_INVALID_HANDLE)
+                                {
+                                    PRWARN("Failed to open archive: %s", filenameArc);
+                                }
+                                else if (sizeArc == 0)
+                                {
+                                    PRWARN("Archive has no data. File is zero length: %s", filename);
+                                }
+                                else
+                                {
+                                    PRWARN("Archive is truncated or corrupt: %s", filename);
+                                }
+
+                                CloseArchive(handle);
+                                ReleaseFat(idx);
                             }
                         }
-                        else
-                        {
-                            PRWARN("Archive has no data. File is zero length: %s", filename);
-                        }
                     }
                     else
                     {
-                        PRWARN("Archive size does not match entry count.");
+                        PRWARN("Too many archives. Unable to store archive.");
                     }
                 }
                 else
@@ -317,7 +522,6 @@ void prFileManager::RegisterArchive(const char *filename)
                 PRWARN("Invalid archive file: %s", filename);
             }
 
-            fileArc->Close();
             fileFat->Close();
         }
         else
@@ -375,8 +579,18 @@ void prFileManager::RegisterArchive(const char *filename)
 /// Returns the filepath for the current platform.
 /// ---------------------------------------------------------------------------
 const char *prFileManager::GetSystemPath(const char *filename)
+{
+    return GetSystemPath(filename, path);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Returns the filepath for the current platform, using the callers buffer.
+/// ---------------------------------------------------------------------------
+const char *prFileManager::GetSystemPath(const char *filename, char *buffer) const
 {
     PRASSERT(filename && *filename);
+    PRASSERT(buffer);
 
     // Got a system data path?
     if (dataPath[0] != '\0')
@@ -394,16 +608,16 @@ const char *prFileManager::GetSystemPath(const char *filename)
         #if defined(PLATFORM_PC)        
             // Make filename for current system.
             // For PC its the data path + '/' + filepath
-            strcpy(path, dataPath);
-            strcat(path, "/");            
-            strcat(path, filename);
+            strcpy(buffer, dataPath);
+            strcat(buffer, "/");            
+            strcat(buffer, filename);
 
         // For iphone
         #elif defined(PLATFORM_IOS)
             // Make filename for current system.
             // For iphone its the data path + '/' + filename (path data needs to be stripped)
-            strcpy(path, dataPath);
-            strcat(path, "/");
+            strcpy(buffer, dataPath);
+            strcat(buffer, "/");
 
             // Remove the passed filename path data.
             char tempPath[FILE_MAX_FILENAME_SIZE];
@@ -413,31 +627,31 @@ const char *prFileManager::GetSystemPath(const char *filename)
             int index = prStringFindLastIndex(tempPath, '/');
             if (index > -1)
             {
-                strcat(path, &tempPath[index + 1]);
+                strcat(buffer, &tempPath[index + 1]);
             }
             else
             {
-                strcat(path, tempPath);
+                strcat(buffer, tempPath);
             }
 
         #elif defined(PLATFORM_ANDROID)
             // Make path
-            strcpy(path, "assets/");
-            strcat(path, filename);
+            strcpy(buffer, "assets/");
+            strcat(buffer, filename);
 
         #elif defined(PLATFORM_LINUX)
             // Make filename for current system.
             // Its the data path + '/' + filepath
-            strcpy(path, dataPath);
-            strcat(path, "/");
-            strcat(path, filename);
+            strcpy(buffer, dataPath);
+            strcat(buffer, "/");
+            strcat(buffer, filename);
         
         #elif defined(PLATFORM_MAC)
             // Make filename for current system.
             // Its the data path + '/' + filepath
-            strcpy(path, dataPath);
-            strcat(path, "/");
-            strcat(path, filename);
+            strcpy(buffer, dataPath);
+            strcat(buffer, "/");
+            strcat(buffer, filename);
 
         #else
             #error No platform defined.
@@ -446,19 +660,19 @@ const char *prFileManager::GetSystemPath(const char *filename)
     }
     else
     {
-        strcpy(path, filename);
+        strcpy(buffer, filename);
     }
 
 
     // Must be lowercase
     #if !defined (PLATFORM_IOS)
-    prStringToLower(path);
+    prStringToLower(buffer);
     #endif
 
 
     // And use forward slashes
-    prStringReplaceChar(path, '\\', '/');
-    return path;
+    prStringReplaceChar(buffer, '\\', '/');
+    return buffer;
 }
 
 
@@ -500,7 +714,7 @@ bool prFileManager::Exists(const char *filename, u32 &size)
 
 #if !defined(PLATFORM_ANDROID)
     
-    u32  hash   = prStringHash(filename);
+    u64  hash   = prStringHash64(filename);
     bool result = Exists(hash, size);
     if (!result)
     {
@@ -543,79 +757,101 @@ bool prFileManager::Exists(const char *filename, u32 &size)
 
 // ----------------------------------------------------------------------------
 // Read a file.
-// - Decompresses the source buffer into the destination buffer.  sourceLen is
-//   the byte length of the source buffer.  Upon entry, destLen is the total size
-//   of the destination buffer, which must be large enough to hold the entire
-//   uncompressed data.  (The size of the uncompressed data must have been saved
-//   previously by the compressor and transmitted to the decompressor by some
-//   mechanism outside the scope of this compression library.) Upon exit, destLen
-//   is the actual size of the uncompressed buffer.
-//   uncompress returns Z_OK if success, Z_MEM_ERROR if there was not
-//   enough memory, Z_BUF_ERROR if there was not enough room in the output
-//   buffer, or Z_DATA_ERROR if the input data was corrupted or incomplete.
+// - Compressed files are decompressed into the destination buffer, using the
+//   codec selected by the entries compression type. The destination buffer
+//   must be large enough to hold the entire uncompressed file.
+// - Returns 0 if the file couldn't be read or decompressed.
 // ----------------------------------------------------------------------------
-u32 prFileManager::Read(u8 *pDataBuffer, u32 size, u32 hash)
+u32 prFileManager::Read(u8 *pDataBuffer, u32 size, u64 hash)
 {
 #if !defined(PLATFORM_ANDROID)
 
     PRASSERT(pDataBuffer);
     PRASSERT(size > 0);
 
-    // Do we need to locate the file? Or can we use the last search results?
-    if (hash != filehash)
+    // Locate the file. The results are kept locally so concurrent reads don't interfere.
+    s32 table = -1;
+    s32 index = -1;
+    if (!FindEntry(hash, table, index))
     {
-        u32 filesize = 0;
-        if (!Exists(hash, filesize))
-        {
-            PRPANIC("Archive internal read failed. Failed to find file");
-        }
+        PRPANIC("Archive internal read failed. Failed to find file");
+        return 0xFFFFFFFF;
     }
 
 
     // Get the entry
     PRASSERT(count > 0);
-    PRASSERT(table > -1);
     PRASSERT(table < (s32)count);
 
-    prArcEntry *pEntry = pEntries[table];
+    prArcEntryV2 *pEntry = pEntries[table];
     PRASSERT(pEntry);
     pEntry += index;
 
     // Read the file?
-    prFile *pFile = pArchiveFile[table];
+    const u8 *pMapped = pArchiveData[table];
 
-    // Mark as accessed!
+    // Mark as accessed! (Benign race, as threads only ever set this)
     pEntry->accessed = true;
-    //prTrace(LogError, "Accessed '%s'\n", pEntry->filename);
+    //prTrace(LogError, "Accessed '%s'\n", pNames[table] + pEntry->filename);
+
+    if (pMapped)
+    {
+        PRASSERT(pEntry->offset + (pEntry->compressed ? pEntry->compressedSize : pEntry->filesize) <= archiveSize[table]);
 
-    if (pEntry->compressed)
+        if (pEntry->compressed)
+        {
+            // Decompress straight from the mapped data.
+            PRASSERT(size >= pEntry->filesize);
+            if (!prDecompress(pEntry->compressionType, pMapped + (size_t)pEntry->offset, pEntry->compressedSize, pDataBuffer, pEntry->filesize))
+            {
+                PRWARN("Decompress failed: %s\n", pNames[table] + pEntry->filename);
+                return 0;
+            }
+        }
+        else
+        {
+            memcpy(pDataBuffer, pMapped + (size_t)pEntry->offset, PRMIN(size, pEntry->filesize));
+        }
+    }
+    else if (pEntry->compressed)
     {
+        PRASSERT(size >= pEntry->filesize);
+
         u8* pData = (u8*)malloc(pEntry->compressedSize);
         if (pData)
         {
-            pFile->Internal_Seek(pEntry->offset, PRFILE_SEEK_SET);
-            pFile->Read(pData, pEntry->compressedSize);
-            pFile->Internal_Rewind();
-
-            uLong destLen = (uLong)pEntry->filesize;
-            int result = uncompress(pDataBuffer, &destLen, pData, pEntry->compressedSize);
-            if (result < Z_OK)
+            bool read = (ReadArchive(archive[table], pData, pEntry->compressedSize, pEntry->offset) == pEntry->compressedSize);
+            if (!read)
             {
-                PRWARN("Uncompress failed: %i\n", result);
+                PRWARN("Archive read failed: %s\n", pNames[table] + pEntry->filename);
+            }
+            else if (!prDecompress(pEntry->compressionType, pData, pEntry->compressedSize, pDataBuffer, pEntry->filesize))
+            {
+                PRWARN("Decompress failed: %s\n", pNames[table] + pEntry->filename);
+                read = false;
             }
 
             free(pData);
+
+            if (!read)
+            {
+                return 0;
+            }
         }
         else
         {
             PRPANIC("prFileManager::Read - Memory allocation failed");
+            return 0;
         }
     }
     else
     {
-        pFile->Internal_Seek(pEntry->offset, PRFILE_SEEK_SET);
-        pFile->Read(pDataBuffer, size);
-        pFile->Internal_Rewind();
+        u32 bytes = PRMIN(size, pEntry->filesize);
+        if (ReadArchive(archive[table], pDataBuffer, bytes, pEntry->offset) != bytes)
+        {
+            PRWARN("Archive read failed: %s\n", pNames[table] + pEntry->filename);
+            return 0;
+        }
     }
 
     return pEntry->filesize;
@@ -631,6 +867,48 @@ u32 prFileManager::Read(u8 *pDataBuffer, u32 size, u32 hash)
 }
 
 
+/// ---------------------------------------------------------------------------
+/// Returns a read only pointer to a files data within a memory mapped archive.
+/// ---------------------------------------------------------------------------
+const u8 *prFileManager::GetView(u64 hash, u32 &size)
+{
+    size = 0;
+
+#if !defined(PLATFORM_ANDROID)
+
+    s32 table = -1;
+    s32 index = -1;
+    if (FindEntry(hash, table, index))
+    {
+        const u8 *pMapped = pArchiveData[table];
+        if (pMapped)
+        {
+            prArcEntryV2 *pEntry = pEntries[table];
+            PRASSERT(pEntry);
+            pEntry += index;
+
+            // Compressed files must be decompressed by Read
+            if (!pEntry->compressed)
+            {
+                PRASSERT(pEntry->offset + pEntry->filesize <= archiveSize[table]);
+
+                pEntry->accessed = true;
+                size = pEntry->filesize;
+                return pMapped + (size_t)pEntry->offset;
+            }
+        }
+    }
+
+#else
+
+    PRUNUSED(hash);
+
+#endif
+
+    return nullptr;
+}
+
+
 /// -----------------------------------------------------------------------
 /// Displays all files with the access state passed. This
 /// allows all files which have and haven't been accessed to
@@ -640,20 +918,20 @@ void prFileManager::DisplayFiles(bool accessed)
 {
     for (int i=0; i<FILE_ARCHIVES_MAX; i++)
     {
-        if (pArchiveFile[i] && pEntries[i])
+        if (pEntries[i])
         {
             prTrace(prLogLevel::LogError, "Archive %i\n", i);
 
             u32 count = entryCount[i];
             if (count)
             {
-                prArcEntry *entry = pEntries[i];
+                prArcEntryV2 *entry = pEntries[i];
 
                 for (u32 j=0; j<count; j++)
                 {
                     if (static_cast<u8>(accessed) == entry->accessed)
                     {
-                        prTrace(prLogLevel::LogError, "File %i of %i : '%s' - %s\n", j, count, entry->filename, PRBOOL_TO_STRING(entry->accessed));
+                        prTrace(prLogLevel::LogError, "File %i of %i : '%s' - %s\n", j, count, pNames[i] + entry->filename, PRBOOL_TO_STRING(entry->accessed));
                     }
 
                     entry++;
@@ -669,33 +947,71 @@ void prFileManager::DisplayFiles(bool accessed)
 // Returns the last file found as code assumes later archives will contain
 // updated files
 // ------------------------------------------------------------------------
-bool prFileManager::Exists(u32 hash, u32 &size)
+bool prFileManager::Exists(u64 hash, u32 &size) const
 {
-    bool result = false;
+    size = 0xFFFFFFFF;
+
+    s32 table = -1;
+    s32 index = -1;
+    bool result = FindEntry(hash, table, index);
+    if (result)
+    {
+        size = pEntries[table][index].filesize;
+    }
+
+    //if (!result)
+    //{
+    //    Trace("Failed to find file in archive: %x\n", hash);
+    //}
+
+    return result;
+}
 
-    table    = -1;
-    index    = -1;
-    size     = 0xFFFFFFFF;
-    filehash = 0xFFFFFFFF;
 
-    if (count > 0)
+// ------------------------------------------------------------------------
+// Finds the table and index of a file. Holds no state, so can be called
+// from any thread.
+//
+// Archives are searched last to first, as later archives contain updated
+// files.
+// ------------------------------------------------------------------------
+bool prFileManager::FindEntry(u64 hash, s32 &table, s32 &index) const
+{
+    table = -1;
+    index = -1;
+
+    for (s32 i=(s32)count - 1; i>=0; i--)
     {
-        for (u32 i=0; i<count; i++)
+        const prArcEntryV2 *pStart = pEntries[i];
+        if (pStart == nullptr || entryCount[i] == 0)
         {
-            s32  lower = 0;
-            s32  upper = entryCount[i];
+            continue;
+        }
+
+        // Perfect hash lookup
+        if (pDisplacements[i])
+        {
+            u32 slot = prArchiveSlot(hash, pDisplacements[i], bucketCount[i], entryCount[i]);
+            if (slot < entryCount[i] && pStart[slot].hash == hash)
+            {
+                index = (s32)slot;
+                table = i;
+                return true;
+            }
+        }
 
-            // Get table start
-            prArcEntry *pStart = pEntries[i];
+        // Sorted table
+        else
+        {
+            s32  lower = 0;
+            s32  upper = (s32)entryCount[i] - 1;
 
             while(lower <= upper)
             {
                 s32 mid = (lower + upper) / 2;
-                //prTrace(LogError, "%i %i %i\n", lower, upper, mid);
 
                 // Get mid entry
-                prArcEntry *pEntry = pStart;
-                pEntry += mid;
+                const prArcEntryV2 *pEntry = pStart + mid;
 
                 if (hash > pEntry->hash)
                 {
@@ -707,24 +1023,246 @@ bool prFileManager::Exists(u32 hash, u32 &size)
                 }
                 else
                 {
-                    index    = mid;
-                    table    = i;
-                    result   = true;
-                    size     = pEntry->filesize;
-                    filehash = hash;
-                    //prTrace(LogError, "Found in archive: %s\n", pEntry->filename);
-                    break;
+                    index = mid;
+                    table = i;
+                    return true;
                 }
             }
         }
     }
 
-    //if (!result)
-    //{
-    //    Trace("Failed to find file in archive: %x\n", hash);
-    //}
+    return false;
+}
 
-    return result;
+
+// ------------------------------------------------------------------------
+// Loads a version 1 fat table. The entries are converted to the compact
+// version 2 format, with the filenames moved into a string pool and
+// rehashed with prStringHash64, then a perfect hash is built so all
+// archives share the same lookup.
+// ------------------------------------------------------------------------
+bool prFileManager::LoadFat(prFile *pFile, const prFatHeader &header, s32 idx)
+{
+    PRASSERT(pFile);
+    PRASSERT(idx >= 0 && idx < FILE_ARCHIVES_MAX);
+
+    // See if the size matches entry count
+    u32 size = (header.entries * sizeof(prArcEntry)) + sizeof(prFatHeader);
+    if (size != header.size || header.entries == 0)
+    {
+        PRWARN("Archive size does not match entry count.");
+        return false;
+    }
+
+
+    // Read the fat table.
+    prArcEntry *entries = new prArcEntry[header.entries];
+    if (pFile->Read(entries, header.entries * sizeof(prArcEntry)) != header.entries * sizeof(prArcEntry))
+    {
+        PRWARN("Failed to read the archive table.");
+        PRSAFE_DELETE_ARRAY(entries);
+        return false;
+    }
+
+
+    // Size the string pool
+    u32 namesSize = 0;
+    for (u32 i=0; i<header.entries; i++)
+    {
+        // Use the same name format as prFile
+        entries[i].filename[FILE_MAX_FILENAME_SIZE - 1] = '\0';
+        prStringToLower(entries[i].filename);
+        prStringReplaceChar(entries[i].filename, '\\', '/');
+        namesSize += (u32)strlen(entries[i].filename) + 1;
+    }
+
+
+    // Convert the entries
+    prArcEntryV2 *pTable   = new prArcEntryV2[header.entries];
+    char         *pPool    = new char[namesSize];
+    u32           position = 0;
+
+    for (u32 i=0; i<header.entries; i++)
+    {
+        u32 length = (u32)strlen(entries[i].filename) + 1;
+        memcpy(pPool + position, entries[i].filename, length);
+
+        pTable[i].offset          = entries[i].offset;
+        pTable[i].hash            = prStringHash64(entries[i].filename);
+        pTable[i].filesize        = entries[i].filesize;
+        pTable[i].compressedSize  = entries[i].compressedSize;
+        pTable[i].filename        = position;
+        pTable[i].compressed      = entries[i].compressed;
+        pTable[i].compressionType = PRARC_COMPRESSION_ZLIB;
+        pTable[i].accessed        = 0;
+        pTable[i].exp1            = 0;
+
+        position += length;
+    }
+
+    PRSAFE_DELETE_ARRAY(entries);
+
+
+    // Build the perfect hash. If it can't be built the entries are sorted by
+    // hash and searched instead.
+    u32  buckets       = prArchiveBucketCount(header.entries);
+    s32 *displacements = new s32[buckets];
+    u32 *slots         = new u32[header.entries];
+    u64 *hashes        = new u64[header.entries];
+
+    for (u32 i=0; i<header.entries; i++)
+    {
+        hashes[i] = pTable[i].hash;
+    }
+
+    if (prArchiveBuildPerfectHash(hashes, header.entries, displacements, slots))
+    {
+        prArcEntryV2 *pOrdered = new prArcEntryV2[header.entries];
+        for (u32 i=0; i<header.entries; i++)
+        {
+            pOrdered[slots[i]] = pTable[i];
+        }
+
+        PRSAFE_DELETE_ARRAY(pTable);
+        pTable = pOrdered;
+    }
+    else
+    {
+        u32 first  = 0;
+        u32 second = 0;
+        if (prArchiveFindCollision(hashes, header.entries, first, second))
+        {
+            PRWARN("Archive hash collision: '%s' and '%s'", pPool + pTable[first].filename, pPool + pTable[second].filename);
+        }
+
+        std::sort(pTable, pTable + header.entries, EntryOrder);
+        PRSAFE_DELETE_ARRAY(displacements);
+        buckets = 0;
+    }
+
+    PRSAFE_DELETE_ARRAY(hashes);
+    PRSAFE_DELETE_ARRAY(slots);
+
+
+    // Store
+    pEntries      [idx] = pTable;
+    entryCount    [idx] = header.entries;
+    pDisplacements[idx] = displacements;
+    bucketCount   [idx] = buckets;
+    pNames        [idx] = pPool;
+
+    return true;
+}
+
+
+// ------------------------------------------------------------------------
+// Loads a version 2 fat table.
+// ------------------------------------------------------------------------
+bool prFileManager::LoadFatV2(prFile *pFile, const prFatHeader &header, s32 idx)
+{
+    PRASSERT(pFile);
+    PRASSERT(idx >= 0 && idx < FILE_ARCHIVES_MAX);
+
+    if (header.size < sizeof(prFatHeaderV2))
+    {
+        PRWARN("Archive header is truncated.");
+        return false;
+    }
+
+
+    // Read the remainder of the header
+    prFatHeaderV2 headerV2;
+    memcpy(&headerV2, &header, sizeof(prFatHeader));
+    if (pFile->Read(reinterpret_cast<u8 *>(&headerV2) + sizeof(prFatHeader), sizeof(prFatHeaderV2) - sizeof(prFatHeader)) != sizeof(prFatHeaderV2) - sizeof(prFatHeader))
+    {
+        PRWARN("Archive header is truncated.");
+        return false;
+    }
+
+    if (headerV2.version != ARCHIVE_VERSION_2)
+    {
+        PRWARN("Unsupported archive version: %i", headerV2.version);
+        return false;
+    }
+
+
+    // See if the size matches the entry count
+    u64 size = (u64)sizeof(prFatHeaderV2)
+             + (u64)headerV2.buckets * sizeof(s32)
+             + (u64)headerV2.entries * sizeof(prArcEntryV2)
+             + (u64)headerV2.namesSize;
+
+    if (size != (u64)header.size || headerV2.entries == 0 || headerV2.buckets == 0 || headerV2.namesSize == 0)
+    {
+        PRWARN("Archive size does not match entry count.");
+        return false;
+    }
+
+
+    // Read the directory
+    s32          *displacements = new s32[headerV2.buckets];
+    prArcEntryV2 *pTable        = new prArcEntryV2[headerV2.entries];
+    char         *pPool         = new char[headerV2.namesSize];
+
+    bool read = (pFile->Read(displacements, headerV2.buckets * sizeof(s32))          == headerV2.buckets * sizeof(s32))
+             && (pFile->Read(pTable,        headerV2.entries * sizeof(prArcEntryV2)) == headerV2.entries * sizeof(prArcEntryV2))
+             && (pFile->Read(pPool,         headerV2.namesSize)                      == headerV2.namesSize);
+
+    if (!read)
+    {
+        PRWARN("Failed to read the archive table.");
+        PRSAFE_DELETE_ARRAY(pPool);
+        PRSAFE_DELETE_ARRAY(pTable);
+        PRSAFE_DELETE_ARRAY(displacements);
+        return false;
+    }
+
+
+    // Validate the names
+    bool valid = (pPool[headerV2.namesSize - 1] == '\0');
+    for (u32 i=0; i<headerV2.entries && valid; i++)
+    {
+        valid = (pTable[i].filename < headerV2.namesSize);
+
+        // Clear the extra data, as we need it to do accessed tracking.
+        pTable[i].accessed = 0;
+        pTable[i].exp1     = 0;
+    }
+
+    if (!valid)
+    {
+        PRWARN("Archive has invalid filenames.");
+        PRSAFE_DELETE_ARRAY(pPool);
+        PRSAFE_DELETE_ARRAY(pTable);
+        PRSAFE_DELETE_ARRAY(displacements);
+        return false;
+    }
+
+
+    // Store
+    pEntries      [idx] = pTable;
+    entryCount    [idx] = headerV2.entries;
+    pDisplacements[idx] = displacements;
+    bucketCount   [idx] = headerV2.buckets;
+    pNames        [idx] = pPool;
+
+    return true;
+}
+
+
+// ------------------------------------------------------------------------
+// Releases an archives directory.
+// ------------------------------------------------------------------------
+void prFileManager::ReleaseFat(s32 idx)
+{
+    PRASSERT(idx >= 0 && idx < FILE_ARCHIVES_MAX);
+
+    PRSAFE_DELETE_ARRAY(pEntries[idx]);
+    PRSAFE_DELETE_ARRAY(pDisplacements[idx]);
+    PRSAFE_DELETE_ARRAY(pNames[idx]);
+
+    entryCount [idx] = 0;
+    bucketCount[idx] = 0;
 }
 
 
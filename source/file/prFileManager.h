@@ -26,12 +26,29 @@
 
 
 // Forward declarations
-class prFile;
 struct zip;
+class  prFile;
+
+
+// Archive handles used for positional reads
+#if defined(PLATFORM_PC)
+  typedef HANDLE prArchiveHandle;
+  #define PRARCHIVE_INVALID_HANDLE      INVALID_HANDLE_VALUE
+
+#else
+  typedef s32 prArchiveHandle;
+  #define PRARCHIVE_INVALID_HANDLE      -1
+
+#endif
 
 
 // Class: prFileManager
 //      Class used to abstract file management.
+//
+// Notes:
+//      Once registration is complete <Exists>, <Read> and <GetView> hold no
+//      shared state and use positional reads, so may be called from worker threads.
+//      Registering archives is not thread safe.
 class prFileManager : public prCoreSystem
 {
 public:
@@ -54,6 +71,17 @@ public:
     //      filename - A filename to convert
     const char *GetSystemPath(const char *filename);
 
+    // Method: GetSystemPath
+    //      Returns the filepath for the current platform.
+    //
+    // Parameters:
+    //      filename - A filename to convert
+    //      buffer   - A buffer of at least FILE_MAX_FILENAME_SIZE characters, which receives the path
+    //
+    // Notes:
+    //      This version is thread safe.
+    const char *GetSystemPath(const char *filename, char *buffer) const;
+
     // Method: SetRegistrationComplete
     //      Let the file system know we're done registering archives.
     void SetRegistrationComplete();
@@ -72,7 +100,25 @@ public:
 
     // Method: Read
     //      Read a file.
-    u32 Read(u8 *pDataBuffer, u32 size, u32 hash);
+    //
+    // Returns:
+    //      The files size, or 0 if it couldn't be read or decompressed.
+    u32 Read(u8 *pDataBuffer, u32 size, u64 hash);
+
+    // Method: GetView
+    //      Returns a read only pointer to a files data within a memory mapped archive.
+    //
+    // Parameters:
+    //      hash - The prStringHash64 of the files archive name
+    //      size - Receives the files size
+    //
+    // Notes:
+    //      Only uncompressed files within mapped archives can be viewed. For all
+    //      other files nullptr is returned and <Read> must be used instead.
+    //
+    // Notes:
+    //      The view remains valid for the lifetime of the file manager.
+    const u8 *GetView(u64 hash, u32 &size);
 
 #if defined(PLATFORM_ANDROID)
     // Method: Read
@@ -103,7 +149,19 @@ private:
     // This function looks in all registered archives for the file.
     // Returns the last file found as code assumes later archives
     // will contain updated files
-    bool Exists(u32 hash, u32 &size);
+    bool Exists(u64 hash, u32 &size) const;
+
+    // Finds the table and index of a file.
+    bool FindEntry(u64 hash, s32 &table, s32 &index) const;
+
+    // Loads a version 1 fat table into the compact directory format.
+    bool LoadFat(prFile *pFile, const prFatHeader &header, s32 idx);
+
+    // Loads a version 2 fat table.
+    bool LoadFatV2(prFile *pFile, const prFatHeader &header, s32 idx);
+
+    // Releases an archives directory.
+    void ReleaseFat(s32 idx);
 
 
 private:
@@ -115,12 +173,14 @@ private:
     bool        exp2;                                           // Expansion use
     bool        exp1;                                           // Expansion use
     bool        exp0;                                           // Expansion use
-    prFile     *pArchiveFile[FILE_ARCHIVES_MAX];                // Archive files
-    prArcEntry *pEntries[FILE_ARCHIVES_MAX];                    // Entry tables
+    prArchiveHandle archive[FILE_ARCHIVES_MAX];                 // Archive files
+    prArcEntryV2 *pEntries[FILE_ARCHIVES_MAX];                  // Entry tables
     u32         entryCount[FILE_ARCHIVES_MAX];                  // Entry count
-    s32         table;                                          // Table in which the last file looked for was found.
-    s32         index;                                          // Index of the last file found in its table
-    u32         filehash;                                       // Hash of the last file found
+    s32        *pDisplacements[FILE_ARCHIVES_MAX];              // Perfect hash displacements. nullptr if the entries are sorted for binary search
+    u32         bucketCount[FILE_ARCHIVES_MAX];                 // Number of displacements
+    char       *pNames[FILE_ARCHIVES_MAX];                      // Filename string pools
+    const u8   *pArchiveData[FILE_ARCHIVES_MAX];                // Memory mapped archive data. nullptr if not mapped
+    u64         archiveSize[FILE_ARCHIVES_MAX];                 // Archive size
 };
 
 
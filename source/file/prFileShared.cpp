@@ -17,8 +17,11 @@
  */
 
 
+#include <string.h>
+#include <algorithm>
 #include "prFileShared.h"
 #include "../debug/prAssert.h"
+#include "../core/prMacros.h"
 
 
 //using namespace Proteus::Core;
@@ -43,3 +46,279 @@ u32 prCalculateChecksum(u8 *data, u32 datasize)
 
     return size;
 }
+
+
+namespace
+{
+    // Average number of entries per perfect hash bucket.
+    const u32 BUCKET_SIZE      = 4;
+
+    // Number of displacements tried for a bucket before the build fails.
+    const s32 DISPLACEMENT_MAX = 0x00FFFFFF;
+
+
+    /// -----------------------------------------------------------------------
+    /// Mixes a hash with a seed.
+    /// -----------------------------------------------------------------------
+    inline u32 Mix(u64 hash, u32 seed)
+    {
+        u64 h = hash ^ ((u64)seed * 0x9E3779B97F4A7C15ULL);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        h ^= h >> 33;
+        return (u32)h;
+    }
+
+
+    /// -----------------------------------------------------------------------
+    /// Orders entry indices by hash.
+    /// -----------------------------------------------------------------------
+    struct HashOrder
+    {
+        explicit HashOrder(const u64 *hashes) : pHashes(hashes) {}
+
+        bool operator () (u32 a, u32 b) const { return pHashes[a] < pHashes[b]; }
+
+        const u64 *pHashes;
+    };
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Returns the number of perfect hash buckets used for an entry count.
+/// ---------------------------------------------------------------------------
+u32 prArchiveBucketCount(u32 entries)
+{
+    return (entries + BUCKET_SIZE - 1) / BUCKET_SIZE;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Returns the entry slot for a hash using a perfect hash directory.
+///
+/// Positive displacements are a seed for the hash mix. Negative displacements
+/// store the slot directly (as -slot - 1), which is used for single entry
+/// buckets.
+/// ---------------------------------------------------------------------------
+u32 prArchiveSlot(u64 hash, const s32 *displacements, u32 buckets, u32 entries)
+{
+    PRASSERT(displacements);
+    PRASSERT(buckets > 0);
+    PRASSERT(entries > 0);
+
+    s32 displacement = displacements[Mix(hash, 0) % buckets];
+    if (displacement < 0)
+    {
+        return (u32)(-displacement - 1);
+    }
+
+    return Mix(hash, (u32)displacement) % entries;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Builds a minimal perfect hash directory using hash and displace. Buckets
+/// are placed largest first, as the large buckets are the hardest to fit.
+/// ---------------------------------------------------------------------------
+bool prArchiveBuildPerfectHash(const u64 *hashes, u32 entries, s32 *displacements, u32 *slots)
+{
+    PRASSERT(hashes);
+    PRASSERT(displacements);
+    PRASSERT(slots);
+
+    if (entries == 0)
+    {
+        return true;
+    }
+
+    u32  buckets = prArchiveBucketCount(entries);
+    u32 *bucket  = new u32[entries];                // The bucket of each hash
+    u32 *order   = new u32[buckets];                // Buckets in placement order
+    u32 *sizes   = new u32[buckets];                // Bucket sizes
+    u32 *items   = new u32[entries];                // Hashes grouped by bucket
+    u32 *first   = new u32[buckets + 1];            // First item for each bucket
+    u8  *used    = new u8 [entries];                // Slots taken
+    u32 *trial   = new u32[entries];                // Slots tried for a bucket
+
+    memset(sizes, 0, buckets * sizeof(u32));
+    memset(used,  0, entries * sizeof(u8));
+
+    // Group the hashes by bucket.
+    for (u32 i=0; i<entries; i++)
+    {
+        bucket[i] = Mix(hashes[i], 0) % buckets;
+        sizes[bucket[i]]++;
+    }
+
+    first[0] = 0;
+    for (u32 i=0; i<buckets; i++)
+    {
+        first[i + 1]     = first[i] + sizes[i];
+        order[i]         = i;
+        displacements[i] = 0;
+    }
+
+    for (u32 i=0; i<entries; i++)
+    {
+        items[first[bucket[i]]++] = i;
+    }
+
+    for (u32 i=buckets; i>0; i--)
+    {
+        first[i] = first[i - 1];
+    }
+    first[0] = 0;
+
+
+    // Sort the buckets by size, largest first. (Sizes are small, so count them)
+    u32 largest = 0;
+    for (u32 i=0; i<buckets; i++)
+    {
+        largest = PRMAX(largest, sizes[i]);
+    }
+
+    u32 placed = 0;
+    for (s32 size=(s32)largest; size>=0; size--)
+    {
+        for (u32 i=0; i<buckets; i++)
+        {
+            if (sizes[i] == (u32)size)
+            {
+                order[placed++] = i;
+            }
+        }
+    }
+
+
+    // Place the buckets
+    bool result = true;
+    u32  next   = 0;
+    for (u32 i=0; i<buckets && result; i++)
+    {
+        u32 b    = order[i];
+        u32 size = sizes[b];
+
+        if (size == 0)
+        {
+            break;
+        }
+        else if (size == 1)
+        {
+            // Single entries go straight into the next free slot.
+            while (used[next])
+            {
+                next++;
+            }
+
+            used[next]             = 1;
+            slots[items[first[b]]] = next;
+            displacements[b]       = -(s32)next - 1;
+        }
+        else
+        {
+            // Duplicate hashes can never be separated.
+            for (u32 j=0; j<size && result; j++)
+            {
+                for (u32 k=j + 1; k<size; k++)
+                {
+                    if (hashes[items[first[b] + j]] == hashes[items[first[b] + k]])
+                    {
+                        result = false;
+                        break;
+                    }
+                }
+            }
+
+            // Find a displacement which places every hash in a free slot.
+            bool found = false;
+            for (s32 d=1; d<DISPLACEMENT_MAX && result && !found; d++)
+            {
+                u32 j = 0;
+                for (; j<size; j++)
+                {
+                    u32 slot = Mix(hashes[items[first[b] + j]], (u32)d) % entries;
+                    if (used[slot])
+                    {
+                        break;
+                    }
+
+                    // Two hashes in the bucket may not share a slot.
+                    u32 k = 0;
+                    for (; k<j; k++)
+                    {
+                        if (trial[k] == slot)
+                        {
+                            break;
+                        }
+                    }
+
+                    if (k < j)
+                    {
+                        break;
+                    }
+
+                    trial[j] = slot;
+                }
+
+                if (j == size)
+                {
+                    for (j=0; j<size; j++)
+                    {
+                        used[trial[j]] = 1;
+                        slots[items[first[b] + j]] = trial[j];
+                    }
+
+                    displacements[b] = d;
+                    found = true;
+                }
+            }
+
+            result = result && found;
+        }
+    }
+
+    PRSAFE_DELETE_ARRAY(trial);
+    PRSAFE_DELETE_ARRAY(used);
+    PRSAFE_DELETE_ARRAY(first);
+    PRSAFE_DELETE_ARRAY(items);
+    PRSAFE_DELETE_ARRAY(sizes);
+    PRSAFE_DELETE_ARRAY(order);
+    PRSAFE_DELETE_ARRAY(bucket);
+
+    return result;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Finds two entries which share a hash.
+/// ---------------------------------------------------------------------------
+bool prArchiveFindCollision(const u64 *hashes, u32 entries, u32 &first, u32 &second)
+{
+    PRASSERT(hashes);
+
+    // Sort the indices by hash, so equal hashes are adjacent.
+    u32 *order = new u32[entries];
+    for (u32 i=0; i<entries; i++)
+    {
+        order[i] = i;
+    }
+
+    std::sort(order, order + entries, HashOrder(hashes));
+
+    bool result = false;
+    for (u32 i=1; i<entries; i++)
+    {
+        if (hashes[order[i - 1]] == hashes[order[i]])
+        {
+            first  = order[i - 1];
+            second = order[i];
+            result = true;
+            break;
+        }
+    }
+
+    PRSAFE_DELETE_ARRAY(order);
+    return result;
+}
@@ -72,6 +72,41 @@
 #define PRFILE_TYPE_SP      PRMAKE4('S', 'p', 'r', 't')
 #define PRFILE_TYPE_MH      PRMAKE4('M', 'e', 's', 'h')
 #define PRFILE_TYPE_SV      PRMAKE4('S', 'a', 'v', 'e')
+#define PRFILE_TYPE_FN      PRMAKE4('F', 'o', 'n', 't')
+#define PRFILE_TYPE_PT      PRMAKE4('P', 'a', 'r', 't')
+#define PRFILE_TYPE_LG      PRMAKE4('L', 'a', 'n', 'g')
+#define PRFILE_TYPE_SC      PRMAKE4('S', 'c', 'e', 'n')
+#define PRFILE_TYPE_AC      PRMAKE4('A', 'c', 'h', 'v')
+
+
+// ----------------------------------------------------------------------------
+// Cooked file versions. Increase when a types chunk layout changes, and
+// recook the data.
+// ----------------------------------------------------------------------------
+#define PRCOOKED_VERSION_BG     1
+#define PRCOOKED_VERSION_SP     1
+#define PRCOOKED_VERSION_FN     1
+#define PRCOOKED_VERSION_PT     1
+#define PRCOOKED_VERSION_LG     1
+#define PRCOOKED_VERSION_SC     1
+#define PRCOOKED_VERSION_AC     1
+#define PRCOOKED_VERSION_MH     2
+
+
+// ----------------------------------------------------------------------------
+// Cooked file chunk types.
+// ----------------------------------------------------------------------------
+#define PRCHUNK_VERSION         PRMAKE4('V', 'e', 'r', 's')     // Always the first chunk. The entries are the version
+#define PRCHUNK_INFO            PRMAKE4('I', 'n', 'f', 'o')
+#define PRCHUNK_PAGE            PRMAKE4('P', 'a', 'g', 'e')
+#define PRCHUNK_CHAR            PRMAKE4('C', 'h', 'a', 'r')
+#define PRCHUNK_KERNING         PRMAKE4('K', 'e', 'r', 'n')
+#define PRCHUNK_SEQUENCE        PRMAKE4('S', 'e', 'q', 'u')
+#define PRCHUNK_EMITTER         PRMAKE4('E', 'm', 'i', 't')
+#define PRCHUNK_EFFECT          PRMAKE4('E', 'f', 'c', 't')
+#define PRCHUNK_ENTRY           PRMAKE4('E', 'n', 't', 'r')
+#define PRCHUNK_VERTEX          PRMAKE4('V', 'e', 'r', 't')
+#define PRCHUNK_INDEX           PRMAKE4('I', 'n', 'd', 'x')
 
 
 // Typedef: prFileHeader
@@ -143,6 +178,16 @@ typedef struct prSaveHeader
 // ----------------------------------------------------------------------------
 #define MAGIC1              PRMAKE4('p', 'r', 'o', 't')         // Used to uniquely identify an archive file.
 #define MAGIC2              PRMAKE4('a', 'r', 'c', 'h')         // Used to uniquely identify an archive file.
+#define MAGIC2_V2           PRMAKE4('a', 'r', 'c', '2')         // Used to uniquely identify a version 2 archive file.
+#define ARCHIVE_VERSION_2   2
+
+
+// ----------------------------------------------------------------------------
+// Archive entry compression types. Only used if the entry is compressed.
+// ----------------------------------------------------------------------------
+#define PRARC_COMPRESSION_ZLIB      0                               // zlib (Version 1 archives always use zlib)
+#define PRARC_COMPRESSION_LZ4       1                               // LZ4 block format
+#define PRARC_COMPRESSION_ZSTD      2                               // zstd frame format
 
 
 // ----------------------------------------------------------------------------
@@ -176,6 +221,53 @@ typedef struct prArcEntry
 } prArcEntry;
 
 
+// ----------------------------------------------------------------------------
+// Version 2 fat header.
+//
+// The first four members match <prFatHeader>, so the version can be detected
+// from the magic values.
+//
+// The fat file layout is
+//      prFatHeaderV2
+//      s32           displacements[buckets]
+//      prArcEntryV2  entries[entries]          - In perfect hash slot order
+//      char          names[namesSize]          - Null terminated filenames
+// ----------------------------------------------------------------------------
+typedef struct prFatHeaderV2
+{
+    u32 entries;
+    u32 size;
+    u32 magic1;
+    u32 magic2;
+    u32 version;
+    u32 buckets;
+    u32 namesSize;
+    u32 exp1;
+
+} prFatHeaderV2;
+
+
+// ----------------------------------------------------------------------------
+// Represents a version 2 archive entry. The filename is stored as an offset
+// into the string pool, which keeps the entries small.
+//
+// The hash is prStringHash64 of the filename. (Version 1 archives use prStringHash)
+// ----------------------------------------------------------------------------
+typedef struct prArcEntryV2
+{
+    u64     offset;
+    u64     hash;
+    u32     filesize;
+    u32     compressedSize;
+    u32     filename;
+    u8      compressed;
+    u8      compressionType;
+    u8      accessed;
+    u8      exp1;
+
+} prArcEntryV2;
+
+
 // Function: prCalculateChecksum
 //      Calculates a checksum.
 //
@@ -186,3 +278,58 @@ typedef struct prArcEntry
 // Returns:
 //      The checksum value
 u32 prCalculateChecksum(u8 *data, u32 datasize);
+
+
+// Function: prArchiveBucketCount
+//      Returns the number of perfect hash buckets used for an entry count.
+//
+// Parameters:
+//      entries - The number of archive entries
+//
+// Returns:
+//      The bucket count
+u32 prArchiveBucketCount(u32 entries);
+
+
+// Function: prArchiveSlot
+//      Returns the entry slot for a hash using a perfect hash directory.
+//
+// Parameters:
+//      hash          - The filename hash
+//      displacements - The displacement table
+//      buckets       - The number of displacements
+//      entries       - The number of entries
+//
+// Returns:
+//      The slot index. The entry in the slot must be compared against the hash,
+//      as files not in the archive also map to a slot.
+u32 prArchiveSlot(u64 hash, const s32 *displacements, u32 buckets, u32 entries);
+
+
+// Function: prArchiveBuildPerfectHash
+//      Builds a minimal perfect hash directory for a set of unique hashes.
+//
+// Parameters:
+//      hashes        - The filename hashes
+//      entries       - The number of hashes
+//      displacements - Receives the displacement table. Must hold <prArchiveBucketCount> values
+//      slots         - Receives the slot for each hash
+//
+// Returns:
+//      false if the directory could not be built, which will happen if the
+//      hashes are not unique. Use <prArchiveFindCollision> to report them
+bool prArchiveBuildPerfectHash(const u64 *hashes, u32 entries, s32 *displacements, u32 *slots);
+
+
+// Function: prArchiveFindCollision
+//      Finds two entries which share a hash.
+//
+// Parameters:
+//      hashes  - The filename hashes
+//      entries - The number of hashes
+//      first   - Receives the index of the first entry
+//      second  - Receives the index of the second entry
+//
+// Returns:
+//      true if a collision was found
+bool prArchiveFindCollision(const u64 *hashes, u32 entries, u32 &first, u32 &second);
@@ -69,6 +69,17 @@ void prKeyboard::Update()
 }
 
 
+/// ---------------------------------------------------------------------------
+/// Clears the pressed keys, leaving the held keys.
+/// ---------------------------------------------------------------------------
+void prKeyboard::ClearPresses()
+{
+    mLastKey         = 0;
+    mPrevControlKeys = mControlKeys;
+    memcpy(mPrevKeyBuffer, mKeyBuffer, sizeof(mKeyBuffer));
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Tests if the key passed is currently being held down.
 /// ---------------------------------------------------------------------------
@@ -58,6 +58,11 @@ public:
     //      Updates the keyboard. Called by the engine. Do not call
     void Update();
 
+    // Method: ClearPresses
+    //      Clears the pressed keys, leaving the held keys. Called by the engine
+    //      after each fixed step, so presses are only seen once. Do not call
+    void ClearPresses();
+
     // Method: IsKeyDown
     //      Tests if the key passed is currently being held down.
     bool IsKeyDown(u32 charcode, u32 ctrlKeys = PRCTRL_KEY_NONE) const;
@@ -135,6 +135,24 @@ void prMouse::Update()
 }
 
 
+/// ---------------------------------------------------------------------------
+/// Clears the pressed and released buttons and the wheel movement.
+/// ---------------------------------------------------------------------------
+void prMouse::ClearPresses()
+{
+    m_buttonsPressed  = 0;
+    m_buttonsReleased = 0;
+
+    if (m_mouseWheelMoved)
+    {
+        m_mouseWheelMoved = false;
+        m_mouseWheelReset = false;
+        m_wheelDir        = 0;
+        m_wheelClicks     = 0;
+    }
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Receives mouse data messages from the window message handler.
 /// ---------------------------------------------------------------------------
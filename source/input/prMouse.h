@@ -130,6 +130,14 @@ public:
     //      This method is called by the engine. *You should not call it*
     void Update();
 
+    // Method: ClearPresses
+    //      Clears the pressed and released buttons and the wheel movement.
+    //
+    // Notes:
+    //      Called by the engine after each fixed step, so presses are only
+    //      seen once. *You should not call it*
+    void ClearPresses();
+
     // Method: ButtonPressed
     //      Determines if one or more mouse buttons have been pressed.
     //
@@ -25,6 +25,8 @@
 #include "../debug/prAssert.h"
 #include "../debug/prDebug.h"
 #include "../debug/prTrace.h"
+#include "../file/prChunkFile.h"
+#include "../file/prFileShared.h"
 
 
 //using namespace Proteus::Core;
@@ -33,12 +35,48 @@
 // Stores info about a specific locale.
 typedef struct LocaleInfo
 {
-    u32 hash;
+    u64 hash;
     u32 locale;
 
 } LocaleInfo;
 
 
+// Cooked entries store the locales present as bits.
+PRCOMPILER_ASSERT(Proteus::Locale::MAX <= 32);
+
+
+// Local functions
+namespace
+{
+    // Finds a locale by its name. Returns -1 if the locale is unknown.
+    s32 FindLocale(const char *name)
+    {
+        static const LocaleInfo locales[] = 
+        {
+            { prStringHash64Const("en-US"),   Proteus::Locale::EN_US },
+            { prStringHash64Const("en-GB"),   Proteus::Locale::EN_GB },
+            { prStringHash64Const("fr-FR"),   Proteus::Locale::FR_FR },
+            { prStringHash64Const("it-IT"),   Proteus::Locale::IT_IT },
+            { prStringHash64Const("de-DE"),   Proteus::Locale::DE_DE },
+            { prStringHash64Const("es-ES"),   Proteus::Locale::ES_ES },
+            { prStringHash64Const("zh-CN"),   Proteus::Locale::ZH_CN },
+        };
+
+        u64 hash = prStringHash64(name);
+
+        for (u32 i=0; i<PRARRAY_SIZE(locales); i++)
+        {
+            if (locales[i].hash == hash)
+            {
+                return (s32)locales[i].locale;
+            }
+        }
+
+        return -1;
+    }
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Ctor
 /// ---------------------------------------------------------------------------
@@ -93,6 +131,20 @@ void prLanguage::Load(const char *filename)
 {
     PRASSERT(filename && *filename);
 
+    // Cooked files are already sorted.
+    prChunkReader reader;
+    if (reader.Load(filename, PRFILE_TYPE_LG, PRCOOKED_VERSION_LG))
+    {
+        LoadCooked(reader);
+
+        if (!reader.IsValid())
+        {
+            PRWARN("Failed to Load %s\n", filename);
+        }
+
+        return;
+    }
+
     // Parse the document
     TiXmlDocument* doc = new TiXmlDocument(filename);
     if (doc)
@@ -172,7 +224,7 @@ const char *prLanguage::GetString(const char *name) const
 {
     if (count > 0)
     {
-        u32 hash  = prStringHash(name);
+        u64 hash  = prStringHash64(name);
         s32 lower = 0;
         s32 upper = count - 1;
 
@@ -256,17 +308,6 @@ void prLanguage::ParseAttribs_File(TiXmlElement* pElement)
 /// ---------------------------------------------------------------------------
 void prLanguage::ParseAttribs_Entry(TiXmlElement* pElement)
 {
-    static const LocaleInfo locales[] = 
-    {
-        { prStringHash("en-US"),   Proteus::Locale::EN_US },
-        { prStringHash("en-GB"),   Proteus::Locale::EN_GB },
-        { prStringHash("fr-FR"),   Proteus::Locale::FR_FR },
-        { prStringHash("it-IT"),   Proteus::Locale::IT_IT },
-        { prStringHash("de-DE"),   Proteus::Locale::DE_DE },
-        { prStringHash("es-ES"),   Proteus::Locale::ES_ES },
-        { prStringHash("zh-CN"),   Proteus::Locale::ZH_CN },
-    };
-
     PRASSERT(correctFileType);
     PRASSERT(pElement);
 
@@ -279,7 +320,7 @@ void prLanguage::ParseAttribs_Entry(TiXmlElement* pElement)
         // Create new entry and hash it.
         prStringTableEntry *entry = new prStringTableEntry();
         PRASSERT(entry);
-        entry->hash = prStringHash(id);
+        entry->hash = prStringHash64(id);
 
         // Acquire the string data.
         TiXmlHandle root(pElement);
@@ -293,21 +334,14 @@ void prLanguage::ParseAttribs_Entry(TiXmlElement* pElement)
 
             if (locale && text)
             {
-                u32 hash = prStringHash(locale);
-
-                // Find each locale.
-                for (u32 i=0; i<PRARRAY_SIZE(locales); i++)
+                s32 index = FindLocale(locale);
+                if (index >= 0)
                 {
-                    if (locales[i].hash == hash)
-                    {
-                        s32 locale = locales[i].locale;
+                    PRSAFE_DELETE_ARRAY(entry->text[index]);
+                    entry->text[index] = new char [strlen(text) + 1];
 
-                        entry->text[locale] = new char [strlen(text) + 1];
-
-                        prStringCopy((char *)text, entry->text[locale]);
-                        //prTrace(LogError, "> %s - %s - %i\n", entry->text[locale], text, strlen(text) + 1);
-                        break;
-                    }
+                    prStringCopy((char *)text, entry->text[index]);
+                    //prTrace(LogError, "> %s - %s - %i\n", entry->text[index], text, strlen(text) + 1);
                 }
             }
         }
@@ -352,3 +386,99 @@ void prLanguage::ParseAttribs_Entry(TiXmlElement* pElement)
         }
     }
 }
+
+
+/// ---------------------------------------------------------------------------
+/// Reads a cooked language file.
+/// ---------------------------------------------------------------------------
+void prLanguage::LoadCooked(prChunkReader &reader)
+{
+    if (!reader.FindChunk(PRCHUNK_ENTRY) || reader.GetEntries() == 0)
+    {
+        return;
+    }
+
+    u32 total = reader.GetEntries();
+    pStringTableEntries = new prStringTableEntry*[total];
+
+    for (u32 i=0; i<total; i++)
+    {
+        prStringTableEntry *entry = new prStringTableEntry();
+        entry->hash = reader.ReadU64();
+
+        u32 present = reader.ReadU32();
+        for (s32 locale=0; locale<Proteus::Locale::MAX; locale++)
+        {
+            if (present & (1 << locale))
+            {
+                const char *text = reader.ReadString();
+
+                entry->text[locale] = new char [strlen(text) + 1];
+                prStringCopy((char *)text, entry->text[locale]);
+            }
+        }
+
+        // The binary search needs the cooked order.
+        if (!reader.IsValid() || (count > 0 && entry->hash <= pStringTableEntries[count - 1]->hash))
+        {
+            PRWARN("Language: Invalid cooked entry");
+            PRSAFE_DELETE(entry);
+            break;
+        }
+
+        pStringTableEntries[count++] = entry;
+    }
+
+    // Indicate correct file type.
+    correctFileType = PRTRUE;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Writes an xml language file as a cooked language file.
+/// ---------------------------------------------------------------------------
+bool prLanguage::Cook(TiXmlElement *pRoot, const char *destination)
+{
+    PRASSERT(pRoot);
+    PRASSERT(destination && *destination);
+
+    // The parser sorts and removes duplicates.
+    prLanguage language;
+    language.ParseFile(pRoot);
+
+    prChunkWriter writer(PRFILE_TYPE_LG, PRCOOKED_VERSION_LG);
+    writer.BeginChunk(PRCHUNK_ENTRY, (u32)language.entries.Size());
+
+    prList<prStringTableEntry*>::prIterator it = language.entries.Begin();
+    while(it.Okay())
+    {
+        prStringTableEntry *entry = *it;
+
+        u32 present = 0;
+        for (s32 locale=0; locale<Proteus::Locale::MAX; locale++)
+        {
+            if (entry->text[locale])
+            {
+                present |= (1 << locale);
+            }
+        }
+
+        writer.WriteU64(entry->hash);
+        writer.WriteU32(present);
+
+        for (s32 locale=0; locale<Proteus::Locale::MAX; locale++)
+        {
+            if (entry->text[locale])
+            {
+                writer.WriteString(entry->text[locale]);
+            }
+        }
+
+        PRSAFE_DELETE(entry);
+        ++it;
+    }
+
+    language.entries.Clear();
+
+    return writer.Save(destination);
+}
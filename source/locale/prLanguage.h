@@ -27,6 +27,10 @@
 #include "prLocales.h"
 
 
+// Forward declarations
+class prChunkReader;
+
+
 // Class: prStringTableEntry
 //      String table data.
 class prStringTableEntry
@@ -55,7 +59,7 @@ public:
     }
 
 
-    u32   hash;
+    u64   hash;
     char *text[Proteus::Locale::MAX];
 };
 
@@ -84,8 +88,26 @@ public:
 
     // Method: Load
     //      Loads the language data.
+    //
+    // Parameters:
+    //      filename - Either a cooked file or an xml file
     void Load(const char *filename);
 
+    // Method: Cook
+    //      Writes an xml language file as a cooked language file.
+    //
+    // Parameters:
+    //      pRoot       - The files root element
+    //      destination - The file to write
+    //
+    // Returns:
+    //      true on success
+    //
+    // Notes:
+    //      The entries are stored sorted, so loading doesn't need to sort them.
+    //      Normally called through <prCookAsset>.
+    static bool Cook(TiXmlElement *pRoot, const char *destination);
+
     // Method: Set
     //      Sets the language used.
     //
@@ -120,6 +142,9 @@ private:
     // XML parser
     void ParseAttribs_Entry(TiXmlElement* pElement);
 
+    // Reads a cooked language file.
+    void LoadCooked(prChunkReader &reader);
+
 
 private:
     // Stops passing by value and assignment.
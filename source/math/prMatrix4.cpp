@@ -18,8 +18,25 @@
 
 
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
 #include "prMatrix4.h"
+#include "prVector2.h"
 #include "prVector3.h"
+#include "../core/prClock.h"
+#include "../core/prMacros.h"
+#include "../debug/prTrace.h"
+#include "../debug/prAssert.h"
+
+
+// Defines
+#if defined(PRSIMD_SSE)
+    #define PRSIMD_NAME     "SSE"
+#elif defined(PRSIMD_NEON)
+    #define PRSIMD_NAME     "NEON"
+#else
+    #define PRSIMD_NAME     "Scalar"
+#endif
 
 
 // Namespaces
@@ -33,6 +50,132 @@ namespace Math {
 const f32 DEG2RAD = 3.141593f / 180;
 
 
+// Local functions
+namespace
+{
+    // The scalar multiply, which the SIMD version is measured against.
+    // The result can't be either of the matrices.
+    void MultiplyScalar(const f32 *m, const f32 *n, f32 *result)
+    {
+        for (s32 i=0; i<16; i+=4)
+        {
+            result[i]     = m[0] * n[i] + m[4] * n[i + 1] + m[8]  * n[i + 2] + m[12] * n[i + 3];
+            result[i + 1] = m[1] * n[i] + m[5] * n[i + 1] + m[9]  * n[i + 2] + m[13] * n[i + 3];
+            result[i + 2] = m[2] * n[i] + m[6] * n[i + 1] + m[10] * n[i + 2] + m[14] * n[i + 3];
+            result[i + 3] = m[3] * n[i] + m[7] * n[i + 1] + m[11] * n[i + 2] + m[15] * n[i + 3];
+        }
+    }
+
+
+    // The scalar inverse. The result can be the matrix. Returns false if
+    // the matrix has no inverse, in which case the result is unchanged.
+    bool InvertScalar(const f32 *m, f32 *result)
+    {
+        // Cofactors
+        f32 inv[16];
+
+        inv[0]  =  m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+        inv[4]  = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+        inv[8]  =  m[4] * m[9]  * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+        inv[12] = -m[4] * m[9]  * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+        inv[1]  = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+        inv[5]  =  m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+        inv[9]  = -m[0] * m[9]  * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+        inv[13] =  m[0] * m[9]  * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+        inv[2]  =  m[1] * m[6]  * m[15] - m[1] * m[7]  * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7]  - m[13] * m[3] * m[6];
+        inv[6]  = -m[0] * m[6]  * m[15] + m[0] * m[7]  * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7]  + m[12] * m[3] * m[6];
+        inv[10] =  m[0] * m[5]  * m[15] - m[0] * m[7]  * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7]  - m[12] * m[3] * m[5];
+        inv[14] = -m[0] * m[5]  * m[14] + m[0] * m[6]  * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6]  + m[12] * m[2] * m[5];
+        inv[3]  = -m[1] * m[6]  * m[11] + m[1] * m[7]  * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9]  * m[2] * m[7]  + m[9]  * m[3] * m[6];
+        inv[7]  =  m[0] * m[6]  * m[11] - m[0] * m[7]  * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8]  * m[2] * m[7]  - m[8]  * m[3] * m[6];
+        inv[11] = -m[0] * m[5]  * m[11] + m[0] * m[7]  * m[9]  + m[4] * m[1] * m[11] - m[4] * m[3] * m[9]  - m[8]  * m[1] * m[7]  + m[8]  * m[3] * m[5];
+        inv[15] =  m[0] * m[5]  * m[10] - m[0] * m[6]  * m[9]  - m[4] * m[1] * m[10] + m[4] * m[2] * m[9]  + m[8]  * m[1] * m[6]  - m[8]  * m[2] * m[5];
+
+        f32 determinant = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+        if (determinant == 0.0f)
+        {
+            return false;
+        }
+
+        f32 scale = 1.0f / determinant;
+
+        for (s32 i=0; i<16; i++)
+        {
+            result[i] = inv[i] * scale;
+        }
+
+        return true;
+    }
+
+
+    // The scalar version of TransformPoints3.
+    void TransformPoints3Scalar(const f32 *m, const u8 *pSrc, u8 *pDst, u32 count, u32 stride)
+    {
+        for (u32 i=0; i<count; i++, pSrc += stride, pDst += stride)
+        {
+            const f32 *p = reinterpret_cast<const f32 *>(pSrc);
+            f32       *q = reinterpret_cast<f32 *>(pDst);
+
+            f32 x = p[0];
+            f32 y = p[1];
+            f32 z = p[2];
+
+            q[0] = m[0] * x + m[4] * y + m[8]  * z + m[12];
+            q[1] = m[1] * x + m[5] * y + m[9]  * z + m[13];
+            q[2] = m[2] * x + m[6] * y + m[10] * z + m[14];
+        }
+    }
+
+
+    // The scalar version of TransformPoints2.
+    void TransformPoints2Scalar(const f32 *m, const u8 *pSrc, u8 *pDst, u32 count, u32 stride)
+    {
+        for (u32 i=0; i<count; i++, pSrc += stride, pDst += stride)
+        {
+            const f32 *p = reinterpret_cast<const f32 *>(pSrc);
+            f32       *q = reinterpret_cast<f32 *>(pDst);
+
+            f32 x = p[0];
+            f32 y = p[1];
+
+            q[0] = m[0] * x + m[4] * y + m[12];
+            q[1] = m[1] * x + m[5] * y + m[13];
+        }
+    }
+
+
+    // A repeatable random number between -1 and 1.
+    f32 BenchmarkRandom(u32 &seed)
+    {
+        seed = seed * 1664525 + 1013904223;
+        return (f32)(seed >> 8) / 8388608.0f - 1.0f;
+    }
+
+
+    // Logs one benchmark result. Returns the largest difference between the results.
+    f32 BenchmarkReport(const char *name, u64 simd, u64 scalar, u32 iterations, const f32 *pSimd, const f32 *pScalar, u32 count)
+    {
+        f32  difference = 0.0f;
+        bool exact      = (memcmp(pSimd, pScalar, count * sizeof(f32)) == 0);
+
+        for (u32 i=0; i<count; i++)
+        {
+            difference = PRMAX(difference, fabsf(pSimd[i] - pScalar[i]));
+        }
+
+        prTrace(prLogLevel::LogInformation, "Matrix benchmark: %-16s %s %.3f ms, scalar %.3f ms, %s, max difference %g\n",
+                name,
+                PRSIMD_NAME,
+                (f32)((f64)simd   / (f64)iterations / 1000000.0),
+                (f32)((f64)scalar / (f64)iterations / 1000000.0),
+                exact ? "bit exact" : "not bit exact",
+                difference);
+
+        return difference;
+    }
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Ctor
 /// ---------------------------------------------------------------------------
@@ -307,10 +450,390 @@ prMatrix4& prMatrix4::RotateZ(f32 angle)
 
 
 /// ---------------------------------------------------------------------------
-/// 
+/// Inverts the matrix
+/// ---------------------------------------------------------------------------
+bool prMatrix4::Invert()
+{
+#if defined(PRSIMD_SSE)
+
+    // Cramer's rule, after Intel's "Streaming SIMD Extensions - Inverse of 4x4 Matrix".
+    // The matrix is loaded transposed, which the result undoes.
+    f32   *src  = _m;
+    __m128 zero = _mm_setzero_ps();
+    __m128 minor0, minor1, minor2, minor3;
+    __m128 row0, row1, row2, row3;
+    __m128 det, tmp1;
+
+    tmp1   = _mm_loadh_pi(_mm_loadl_pi(zero, (const __m64 *)(src)),     (const __m64 *)(src + 4));
+    row1   = _mm_loadh_pi(_mm_loadl_pi(zero, (const __m64 *)(src + 8)), (const __m64 *)(src + 12));
+    row0   = _mm_shuffle_ps(tmp1, row1, 0x88);
+    row1   = _mm_shuffle_ps(row1, tmp1, 0xDD);
+    tmp1   = _mm_loadh_pi(_mm_loadl_pi(zero, (const __m64 *)(src + 2)),  (const __m64 *)(src + 6));
+    row3   = _mm_loadh_pi(_mm_loadl_pi(zero, (const __m64 *)(src + 10)), (const __m64 *)(src + 14));
+    row2   = _mm_shuffle_ps(tmp1, row3, 0x88);
+    row3   = _mm_shuffle_ps(row3, tmp1, 0xDD);
+
+    tmp1   = _mm_mul_ps(row2, row3);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    minor0 = _mm_mul_ps(row1, tmp1);
+    minor1 = _mm_mul_ps(row0, tmp1);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor0 = _mm_sub_ps(_mm_mul_ps(row1, tmp1), minor0);
+    minor1 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor1);
+    minor1 = _mm_shuffle_ps(minor1, minor1, 0x4E);
+
+    tmp1   = _mm_mul_ps(row1, row2);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    minor0 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor0);
+    minor3 = _mm_mul_ps(row0, tmp1);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row3, tmp1));
+    minor3 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor3);
+    minor3 = _mm_shuffle_ps(minor3, minor3, 0x4E);
+
+    tmp1   = _mm_mul_ps(_mm_shuffle_ps(row1, row1, 0x4E), row3);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    row2   = _mm_shuffle_ps(row2, row2, 0x4E);
+    minor0 = _mm_add_ps(_mm_mul_ps(row2, tmp1), minor0);
+    minor2 = _mm_mul_ps(row0, tmp1);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row2, tmp1));
+    minor2 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor2);
+    minor2 = _mm_shuffle_ps(minor2, minor2, 0x4E);
+
+    tmp1   = _mm_mul_ps(row0, row1);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    minor2 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor2);
+    minor3 = _mm_sub_ps(_mm_mul_ps(row2, tmp1), minor3);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor2 = _mm_sub_ps(_mm_mul_ps(row3, tmp1), minor2);
+    minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row2, tmp1));
+
+    tmp1   = _mm_mul_ps(row0, row3);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row2, tmp1));
+    minor2 = _mm_add_ps(_mm_mul_ps(row1, tmp1), minor2);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor1 = _mm_add_ps(_mm_mul_ps(row2, tmp1), minor1);
+    minor2 = _mm_sub_ps(minor2, _mm_mul_ps(row1, tmp1));
+
+    tmp1   = _mm_mul_ps(row0, row2);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    minor1 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor1);
+    minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row1, tmp1));
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row3, tmp1));
+    minor3 = _mm_add_ps(_mm_mul_ps(row1, tmp1), minor3);
+
+    // Determinant
+    det    = _mm_mul_ps(row0, minor0);
+    det    = _mm_add_ps(_mm_shuffle_ps(det, det, 0x4E), det);
+    det    = _mm_add_ss(_mm_shuffle_ps(det, det, 0xB1), det);
+
+    f32 determinant = _mm_cvtss_f32(det);
+    if (determinant == 0.0f)
+    {
+        return false;
+    }
+
+    det = _mm_set1_ps(1.0f / determinant);
+
+    _mm_storeu_ps(src,      _mm_mul_ps(det, minor0));
+    _mm_storeu_ps(src + 4,  _mm_mul_ps(det, minor1));
+    _mm_storeu_ps(src + 8,  _mm_mul_ps(det, minor2));
+    _mm_storeu_ps(src + 12, _mm_mul_ps(det, minor3));
+
+    return true;
+
+#else
+
+    return InvertScalar(_m, _m);
+
+#endif
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Transforms an array of points by the matrix.
+/// ---------------------------------------------------------------------------
+void prMatrix4::TransformPoints(const prVector3 *pIn, prVector3 *pOut, u32 count) const
+{
+    TransformPoints3(&pIn->x, &pOut->x, count, sizeof(prVector3));
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Transforms an array of 2D points by the matrix.
+/// ---------------------------------------------------------------------------
+void prMatrix4::TransformPoints(const prVector2 *pIn, prVector2 *pOut, u32 count) const
+{
+    TransformPoints2(&pIn->x, &pOut->x, count, sizeof(prVector2));
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Transforms the x, y and z of interleaved vertices by the matrix.
+/// ---------------------------------------------------------------------------
+void prMatrix4::TransformPoints3(const f32 *pIn, f32 *pOut, u32 count, u32 stride) const
+{
+    const u8 *pSrc = reinterpret_cast<const u8 *>(pIn);
+    u8       *pDst = reinterpret_cast<u8 *>(pOut);
+
+#if defined(PRSIMD_SSE)
+
+    __m128 c0 = _mm_loadu_ps(&_m[0]);
+    __m128 c1 = _mm_loadu_ps(&_m[4]);
+    __m128 c2 = _mm_loadu_ps(&_m[8]);
+    __m128 c3 = _mm_loadu_ps(&_m[12]);
+
+    for (u32 i=0; i<count; i++, pSrc += stride, pDst += stride)
+    {
+        const f32 *p = reinterpret_cast<const f32 *>(pSrc);
+        f32       *q = reinterpret_cast<f32 *>(pDst);
+
+        __m128 point = _mm_add_ps(c3, _mm_mul_ps(c0, _mm_set1_ps(p[0])));
+        point = _mm_add_ps(point, _mm_mul_ps(c1, _mm_set1_ps(p[1])));
+        point = _mm_add_ps(point, _mm_mul_ps(c2, _mm_set1_ps(p[2])));
+
+        _mm_storel_pi(reinterpret_cast<__m64 *>(q), point);
+        _mm_store_ss(&q[2], _mm_movehl_ps(point, point));
+    }
+
+#elif defined(PRSIMD_NEON)
+
+    float32x4_t c0 = vld1q_f32(&_m[0]);
+    float32x4_t c1 = vld1q_f32(&_m[4]);
+    float32x4_t c2 = vld1q_f32(&_m[8]);
+    float32x4_t c3 = vld1q_f32(&_m[12]);
+
+    for (u32 i=0; i<count; i++, pSrc += stride, pDst += stride)
+    {
+        const f32 *p = reinterpret_cast<const f32 *>(pSrc);
+        f32       *q = reinterpret_cast<f32 *>(pDst);
+
+        float32x4_t point = vmlaq_n_f32(c3, c0, p[0]);
+        point = vmlaq_n_f32(point, c1, p[1]);
+        point = vmlaq_n_f32(point, c2, p[2]);
+
+        vst1_f32(q, vget_low_f32(point));
+        q[2] = vgetq_lane_f32(point, 2);
+    }
+
+#else
+
+    TransformPoints3Scalar(_m, pSrc, pDst, count, stride);
+
+#endif
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Transforms the x and y of interleaved vertices by the matrix.
+/// ---------------------------------------------------------------------------
+void prMatrix4::TransformPoints2(const f32 *pIn, f32 *pOut, u32 count, u32 stride) const
+{
+    const u8 *pSrc = reinterpret_cast<const u8 *>(pIn);
+    u8       *pDst = reinterpret_cast<u8 *>(pOut);
+
+#if defined(PRSIMD_SSE)
+
+    __m128 c0 = _mm_loadu_ps(&_m[0]);
+    __m128 c1 = _mm_loadu_ps(&_m[4]);
+    __m128 c3 = _mm_loadu_ps(&_m[12]);
+
+    for (u32 i=0; i<count; i++, pSrc += stride, pDst += stride)
+    {
+        const f32 *p = reinterpret_cast<const f32 *>(pSrc);
+        f32       *q = reinterpret_cast<f32 *>(pDst);
+
+        __m128 point = _mm_add_ps(c3, _mm_mul_ps(c0, _mm_set1_ps(p[0])));
+        point = _mm_add_ps(point, _mm_mul_ps(c1, _mm_set1_ps(p[1])));
+
+        _mm_storel_pi(reinterpret_cast<__m64 *>(q), point);
+    }
+
+#elif defined(PRSIMD_NEON)
+
+    float32x2_t c0 = vld1_f32(&_m[0]);
+    float32x2_t c1 = vld1_f32(&_m[4]);
+    float32x2_t c3 = vld1_f32(&_m[12]);
+
+    for (u32 i=0; i<count; i++, pSrc += stride, pDst += stride)
+    {
+        const f32 *p = reinterpret_cast<const f32 *>(pSrc);
+        f32       *q = reinterpret_cast<f32 *>(pDst);
+
+        float32x2_t point = vmla_n_f32(c3, c0, p[0]);
+        point = vmla_n_f32(point, c1, p[1]);
+
+        vst1_f32(q, point);
+    }
+
+#else
+
+    TransformPoints2Scalar(_m, pSrc, pDst, count, stride);
+
+#endif
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Multiplies an array of matrices by one matrix.
+/// ---------------------------------------------------------------------------
+void prMatrix4::Multiply(const prMatrix4 &lhs, const prMatrix4 *pRhs, prMatrix4 *pResults, u32 count)
+{
+    // A local copy can't be overwritten by the results, so stays in registers.
+    const prMatrix4 left(lhs);
+
+    for (u32 i=0; i<count; i++)
+    {
+        Multiply(left, pRhs[i], pResults[i]);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Multiplies two arrays of matrices.
+/// ---------------------------------------------------------------------------
+void prMatrix4::Multiply(const prMatrix4 *pLhs, const prMatrix4 *pRhs, prMatrix4 *pResults, u32 count)
+{
+    for (u32 i=0; i<count; i++)
+    {
+        Multiply(pLhs[i], pRhs[i], pResults[i]);
+    }
+}
+
+
+
+/// ---------------------------------------------------------------------------
+/// Measures the SIMD matrix functions against their scalar versions.
 /// ---------------------------------------------------------------------------
-void prMatrix4::Invert()
+f32 prMatrix4::Benchmark(u32 count, u32 iterations)
 {
+    PRASSERT(count > 0);
+    PRASSERT(iterations > 0);
+
+    prMatrix4 *pLhs     = new prMatrix4[count];
+    prMatrix4 *pRhs     = new prMatrix4[count];
+    prMatrix4 *pSimd    = new prMatrix4[count];
+    prMatrix4 *pScalar  = new prMatrix4[count];
+    f32       *pPoints  = new f32[count * 3];
+    f32       *pOutSimd = new f32[count * 3];
+    f32       *pOutScal = new f32[count * 3];
+
+    // The same data on every run. The diagonals are raised, so every matrix has an inverse.
+    u32 seed = 1;
+    for (u32 i=0; i<count; i++)
+    {
+        for (s32 j=0; j<16; j++)
+        {
+            pLhs[i]._m[j] = BenchmarkRandom(seed) + ((j % 5) == 0 ? 4.0f : 0.0f);
+            pRhs[i]._m[j] = BenchmarkRandom(seed) + ((j % 5) == 0 ? 4.0f : 0.0f);
+        }
+    }
+
+    for (u32 i=0; i<count * 3; i++)
+    {
+        pPoints[i] = BenchmarkRandom(seed) * 100.0f;
+    }
+
+    const u32 stride     = 3 * sizeof(f32);
+    const u8 *pSrc       = reinterpret_cast<const u8 *>(pPoints);
+    u8       *pDst       = reinterpret_cast<u8 *>(pOutScal);
+    f32       difference = 0.0f;
+    f32       result;
+    u64       simd       = 0;
+    u64       scalar     = 0;
+    u64       start;
+
+    // Multiply
+    for (u32 i=0; i<iterations; i++)
+    {
+        start   = prClockNanoseconds();
+        Multiply(pLhs, pRhs, pSimd, count);
+        simd   += prClockNanoseconds() - start;
+
+        start   = prClockNanoseconds();
+        for (u32 j=0; j<count; j++)
+        {
+            MultiplyScalar(pLhs[j]._m, pRhs[j]._m, pScalar[j]._m);
+        }
+        scalar += prClockNanoseconds() - start;
+    }
+
+    result     = BenchmarkReport("Multiply", simd, scalar, iterations, pSimd->_m, pScalar->_m, count * 16);
+    difference = PRMAX(difference, result);
+
+    // Invert
+    simd   = 0;
+    scalar = 0;
+
+    for (u32 i=0; i<iterations; i++)
+    {
+        start   = prClockNanoseconds();
+        for (u32 j=0; j<count; j++)
+        {
+            pSimd[j] = pLhs[j];
+            pSimd[j].Invert();
+        }
+        simd   += prClockNanoseconds() - start;
+
+        start   = prClockNanoseconds();
+        for (u32 j=0; j<count; j++)
+        {
+            InvertScalar(pLhs[j]._m, pScalar[j]._m);
+        }
+        scalar += prClockNanoseconds() - start;
+    }
+
+    result     = BenchmarkReport("Invert", simd, scalar, iterations, pSimd->_m, pScalar->_m, count * 16);
+    difference = PRMAX(difference, result);
+
+    // TransformPoints3
+    simd   = 0;
+    scalar = 0;
+
+    for (u32 i=0; i<iterations; i++)
+    {
+        start   = prClockNanoseconds();
+        pLhs->TransformPoints3(pPoints, pOutSimd, count, stride);
+        simd   += prClockNanoseconds() - start;
+
+        start   = prClockNanoseconds();
+        TransformPoints3Scalar(pLhs->_m, pSrc, pDst, count, stride);
+        scalar += prClockNanoseconds() - start;
+    }
+
+    result     = BenchmarkReport("TransformPoints3", simd, scalar, iterations, pOutSimd, pOutScal, count * 3);
+    difference = PRMAX(difference, result);
+
+    // TransformPoints2. The points keep the same stride, so z is left untouched.
+    simd   = 0;
+    scalar = 0;
+
+    for (u32 i=0; i<iterations; i++)
+    {
+        start   = prClockNanoseconds();
+        pLhs->TransformPoints2(pPoints, pOutSimd, count, stride);
+        simd   += prClockNanoseconds() - start;
+
+        start   = prClockNanoseconds();
+        TransformPoints2Scalar(pLhs->_m, pSrc, pDst, count, stride);
+        scalar += prClockNanoseconds() - start;
+    }
+
+    result     = BenchmarkReport("TransformPoints2", simd, scalar, iterations, pOutSimd, pOutScal, count * 3);
+    difference = PRMAX(difference, result);
+
+    PRSAFE_DELETE_ARRAY(pLhs);
+    PRSAFE_DELETE_ARRAY(pRhs);
+    PRSAFE_DELETE_ARRAY(pSimd);
+    PRSAFE_DELETE_ARRAY(pScalar);
+    PRSAFE_DELETE_ARRAY(pPoints);
+    PRSAFE_DELETE_ARRAY(pOutSimd);
+    PRSAFE_DELETE_ARRAY(pOutScal);
+
+    return difference;
 }
 
 
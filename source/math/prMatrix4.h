@@ -20,6 +20,7 @@
 
 
 #include "../core/prTypes.h"
+#include "prSimd.h"
 
 
 // Namespaces
@@ -28,11 +29,18 @@ namespace Math {
 
 
 // Forward declarations
+class prVector2;
 class prVector3;
 
 
 // Class: prMatrix4
 //      Represents a 4x4 matrix
+//
+// Notes:
+//      The matrix is stored in column order, as OpenGL expects.
+//
+//      Multiplication and inversion use SSE or NEON where available.
+//      See <prSimd.h>
 class prMatrix4
 {
 public:
@@ -101,8 +109,99 @@ public:
     //      Rotate the matrix by the supplied angle
     prMatrix4& RotateZ(f32 angle);
 
+    // Method: Invert
+    //      Inverts the matrix
     //
-    void Invert();
+    // Returns:
+    //      true if inverted, false if the matrix has no inverse, in which case it is unchanged
+    bool Invert();
+
+    // Method: TransformPoints
+    //      Transforms an array of points by the matrix.
+    //
+    // Parameters:
+    //      pIn   - The points
+    //      pOut  - Receives the transformed points. Can be the same as pIn
+    //      count - The number of points
+    void TransformPoints(const prVector3 *pIn, prVector3 *pOut, u32 count) const;
+
+    // Method: TransformPoints
+    //      Transforms an array of 2D points by the matrix. The points are given a z of zero.
+    //
+    // Parameters:
+    //      pIn   - The points
+    //      pOut  - Receives the transformed points. Can be the same as pIn
+    //      count - The number of points
+    void TransformPoints(const prVector2 *pIn, prVector2 *pOut, u32 count) const;
+
+    // Method: TransformPoints3
+    //      Transforms the x, y and z of interleaved vertices by the matrix.
+    //
+    // Parameters:
+    //      pIn    - The first vertex position
+    //      pOut   - Receives the first transformed position. Can be the same as pIn
+    //      count  - The number of vertices
+    //      stride - The size of a vertex in bytes
+    void TransformPoints3(const f32 *pIn, f32 *pOut, u32 count, u32 stride) const;
+
+    // Method: TransformPoints2
+    //      Transforms the x and y of interleaved vertices by the matrix. The vertices are given a z of zero.
+    //
+    // Parameters:
+    //      pIn    - The first vertex position
+    //      pOut   - Receives the first transformed position. Can be the same as pIn
+    //      count  - The number of vertices
+    //      stride - The size of a vertex in bytes
+    void TransformPoints2(const f32 *pIn, f32 *pOut, u32 count, u32 stride) const;
+
+    // Method: Multiply
+    //      Multiplies two matrices.
+    //
+    // Parameters:
+    //      lhs    - The left hand matrix
+    //      rhs    - The right hand matrix
+    //      result - Receives lhs * rhs. Can be either of the matrices
+    static inline void Multiply(const prMatrix4 &lhs, const prMatrix4 &rhs, prMatrix4 &result);
+
+    // Method: Multiply
+    //      Multiplies an array of matrices by one matrix.
+    //
+    // Parameters:
+    //      lhs      - The left hand matrix
+    //      pRhs     - The right hand matrices
+    //      pResults - Receives lhs * pRhs[i]. Can be the same as pRhs
+    //      count    - The number of matrices
+    static void Multiply(const prMatrix4 &lhs, const prMatrix4 *pRhs, prMatrix4 *pResults, u32 count);
+
+    // Method: Multiply
+    //      Multiplies two arrays of matrices.
+    //
+    // Parameters:
+    //      pLhs     - The left hand matrices
+    //      pRhs     - The right hand matrices
+    //      pResults - Receives pLhs[i] * pRhs[i]. Can be the same as either array
+    //      count    - The number of matrices
+    static void Multiply(const prMatrix4 *pLhs, const prMatrix4 *pRhs, prMatrix4 *pResults, u32 count);
+
+    // Method: Benchmark
+    //      Measures the SIMD matrix functions against their scalar versions
+    //
+    // Parameters:
+    //      count      - The number of matrices and points per call
+    //      iterations - The number of times each function is measured
+    //
+    // Returns:
+    //      The largest difference between a SIMD and a scalar result
+    //
+    // Notes:
+    //      Logs the average time of Multiply, Invert, TransformPoints3 and
+    //      TransformPoints2, and whether their results match the scalar
+    //      versions bit for bit. The input data is the same on every run.
+    //
+    //      Multiply sums in the same order as the scalar version, so should
+    //      be bit exact. Invert and the transforms sum in a different order,
+    //      so differ by rounding.
+    static f32 Benchmark(u32 count, u32 iterations);
 
 
     // -- Operators --
@@ -140,6 +239,12 @@ public:
     inline f32& operator[](s32 index);
 
 
+private:
+    // Used to create a matrix which is about to be overwritten.
+    enum NoInit { NO_INIT };
+    explicit prMatrix4(NoInit) {}
+
+
 private:
     f32 _m[16];
 };
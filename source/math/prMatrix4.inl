@@ -88,25 +88,9 @@ inline prMatrix4& prMatrix4::operator-=(const prMatrix4& rhs)
 // ------------------------------------------------------------------------------------------------
 inline prMatrix4 prMatrix4::operator*(const prMatrix4& n) const
 {
-    return prMatrix4(_m[0] * n[0]  + _m[4] * n[1]  + _m[8]  * n[2]  + _m[12] * n[3],
-                     _m[1] * n[0]  + _m[5] * n[1]  + _m[9]  * n[2]  + _m[13] * n[3],
-                     _m[2] * n[0]  + _m[6] * n[1]  + _m[10] * n[2]  + _m[14] * n[3],
-                     _m[3] * n[0]  + _m[7] * n[1]  + _m[11] * n[2]  + _m[15] * n[3],
-
-                     _m[0] * n[4]  + _m[4] * n[5]  + _m[8]  * n[6]  + _m[12] * n[7],
-                     _m[1] * n[4]  + _m[5] * n[5]  + _m[9]  * n[6]  + _m[13] * n[7],
-                     _m[2] * n[4]  + _m[6] * n[5]  + _m[10] * n[6]  + _m[14] * n[7],
-                     _m[3] * n[4]  + _m[7] * n[5]  + _m[11] * n[6]  + _m[15] * n[7],
-
-                     _m[0] * n[8]  + _m[4] * n[9]  + _m[8]  * n[10] + _m[12] * n[11],
-                     _m[1] * n[8]  + _m[5] * n[9]  + _m[9]  * n[10] + _m[13] * n[11],
-                     _m[2] * n[8]  + _m[6] * n[9]  + _m[10] * n[10] + _m[14] * n[11],
-                     _m[3] * n[8]  + _m[7] * n[9]  + _m[11] * n[10] + _m[15] * n[11],
-
-                     _m[0] * n[12] + _m[4] * n[13] + _m[8]  * n[14] + _m[12] * n[15],
-                     _m[1] * n[12] + _m[5] * n[13] + _m[9]  * n[14] + _m[13] * n[15],
-                     _m[2] * n[12] + _m[6] * n[13] + _m[10] * n[14] + _m[14] * n[15],
-                     _m[3] * n[12] + _m[7] * n[13] + _m[11] * n[14] + _m[15] * n[15]);
+    prMatrix4 result(NO_INIT);
+    Multiply(*this, n, result);
+    return result;
 }
 
 
@@ -115,11 +99,80 @@ inline prMatrix4 prMatrix4::operator*(const prMatrix4& n) const
 // ------------------------------------------------------------------------------------------------
 inline prMatrix4& prMatrix4::operator*=(const prMatrix4& rhs)
 {
-    *this = *this * rhs;
+    Multiply(*this, rhs, *this);
     return *this;
 }
 
 
+// ------------------------------------------------------------------------------------------------
+// Multiplies two matrices
+// ------------------------------------------------------------------------------------------------
+inline void prMatrix4::Multiply(const prMatrix4 &lhs, const prMatrix4 &rhs, prMatrix4 &result)
+{
+    const f32 *m = lhs._m;
+    const f32 *n = rhs._m;
+
+#if defined(PRSIMD_SSE)
+
+    // Each result column is the sum of the left hand columns, scaled by a right hand column.
+    // Each right hand column is read before its result column is written, so the matrices can overlap.
+    __m128 c0 = _mm_loadu_ps(&m[0]);
+    __m128 c1 = _mm_loadu_ps(&m[4]);
+    __m128 c2 = _mm_loadu_ps(&m[8]);
+    __m128 c3 = _mm_loadu_ps(&m[12]);
+
+    for (s32 i=0; i<16; i+=4)
+    {
+        __m128 column = _mm_mul_ps(c0, _mm_set1_ps(n[i]));
+        column = _mm_add_ps(column, _mm_mul_ps(c1, _mm_set1_ps(n[i + 1])));
+        column = _mm_add_ps(column, _mm_mul_ps(c2, _mm_set1_ps(n[i + 2])));
+        column = _mm_add_ps(column, _mm_mul_ps(c3, _mm_set1_ps(n[i + 3])));
+        _mm_storeu_ps(&result._m[i], column);
+    }
+
+#elif defined(PRSIMD_NEON)
+
+    // See the SSE version.
+    float32x4_t c0 = vld1q_f32(&m[0]);
+    float32x4_t c1 = vld1q_f32(&m[4]);
+    float32x4_t c2 = vld1q_f32(&m[8]);
+    float32x4_t c3 = vld1q_f32(&m[12]);
+
+    for (s32 i=0; i<16; i+=4)
+    {
+        float32x4_t column = vmulq_n_f32(c0, n[i]);
+        column = vmlaq_n_f32(column, c1, n[i + 1]);
+        column = vmlaq_n_f32(column, c2, n[i + 2]);
+        column = vmlaq_n_f32(column, c3, n[i + 3]);
+        vst1q_f32(&result._m[i], column);
+    }
+
+#else
+
+    result = prMatrix4(m[0] * n[0]  + m[4] * n[1]  + m[8]  * n[2]  + m[12] * n[3],
+                       m[1] * n[0]  + m[5] * n[1]  + m[9]  * n[2]  + m[13] * n[3],
+                       m[2] * n[0]  + m[6] * n[1]  + m[10] * n[2]  + m[14] * n[3],
+                       m[3] * n[0]  + m[7] * n[1]  + m[11] * n[2]  + m[15] * n[3],
+
+                       m[0] * n[4]  + m[4] * n[5]  + m[8]  * n[6]  + m[12] * n[7],
+                       m[1] * n[4]  + m[5] * n[5]  + m[9]  * n[6]  + m[13] * n[7],
+                       m[2] * n[4]  + m[6] * n[5]  + m[10] * n[6]  + m[14] * n[7],
+                       m[3] * n[4]  + m[7] * n[5]  + m[11] * n[6]  + m[15] * n[7],
+
+                       m[0] * n[8]  + m[4] * n[9]  + m[8]  * n[10] + m[12] * n[11],
+                       m[1] * n[8]  + m[5] * n[9]  + m[9]  * n[10] + m[13] * n[11],
+                       m[2] * n[8]  + m[6] * n[9]  + m[10] * n[10] + m[14] * n[11],
+                       m[3] * n[8]  + m[7] * n[9]  + m[11] * n[10] + m[15] * n[11],
+
+                       m[0] * n[12] + m[4] * n[13] + m[8]  * n[14] + m[12] * n[15],
+                       m[1] * n[12] + m[5] * n[13] + m[9]  * n[14] + m[13] * n[15],
+                       m[2] * n[12] + m[6] * n[13] + m[10] * n[14] + m[14] * n[15],
+                       m[3] * n[12] + m[7] * n[13] + m[11] * n[14] + m[15] * n[15]);
+
+#endif
+}
+
+
 // ------------------------------------------------------------------------------------------------
 // Operator ==
 // ------------------------------------------------------------------------------------------------
@@ -0,0 +1,43 @@
+// File: prSimd.h
+//      Selects the SIMD instruction set used by the maths code.
+//
+// Notes:
+//      Defines PRSIMD_SSE or PRSIMD_NEON when the compiler targets them.
+//      When neither is defined, the maths code uses its scalar versions.
+//
+//      Define PROTEUS_OPTIMISE_NO_SIMD in prConfig.h to always use the
+//      scalar versions.
+/**
+ * Copyright 2014 Paul Michael McNab
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+
+#include "../prConfig.h"
+
+
+#if !defined(PROTEUS_OPTIMISE_NO_SIMD)
+    #if (defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+        #include <emmintrin.h>
+        #define PRSIMD_SSE
+
+    #elif (defined(__ARM_NEON) || defined(__ARM_NEON__))
+        #include <arm_neon.h>
+        #define PRSIMD_NEON
+
+    #endif
+#endif
@@ -0,0 +1,90 @@
+/**
+ * prConcurrentPool.cpp
+ *
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "prConcurrentPool.h"
+
+
+// The slots in use are kept as a bit mask.
+PRCOMPILER_ASSERT(PRCONCURRENTPOOL_THREADS_MAX <= 32);
+
+
+namespace
+{
+    // The magazine slots in use, one bit per slot.
+    std::atomic<u32> usedSlots(0);
+
+    // The calling thread's magazine slot, which is freed when the thread exits.
+    struct ThreadSlot
+    {
+        ThreadSlot() : slot(PRCONCURRENTPOOL_NULL)
+        {
+        }
+
+        ~ThreadSlot()
+        {
+            if (slot < PRCONCURRENTPOOL_THREADS_MAX)
+            {
+                usedSlots.fetch_and(~(1U << slot), std::memory_order_release);
+            }
+        }
+
+        u32 slot;
+    };
+
+    thread_local ThreadSlot threadSlot;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Returns the calling thread's magazine slot.
+/// ---------------------------------------------------------------------------
+u32 prConcurrentPoolThreadSlot()
+{
+    // Threads without a slot try again each call, as slots are freed when threads exit.
+    if (threadSlot.slot >= PRCONCURRENTPOOL_THREADS_MAX)
+    {
+        u32 used = usedSlots.load(std::memory_order_relaxed);
+        u32 slot = PRCONCURRENTPOOL_THREADS_MAX;
+
+        for (;;)
+        {
+            // Find the lowest free slot
+            u32 free = 0;
+            while (free < PRCONCURRENTPOOL_THREADS_MAX && (used & (1U << free)))
+            {
+                free++;
+            }
+
+            if (free == PRCONCURRENTPOOL_THREADS_MAX)
+            {
+                break;
+            }
+
+            if (usedSlots.compare_exchange_weak(used, used | (1U << free), std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                slot = free;
+                break;
+            }
+        }
+
+        threadSlot.slot = slot;
+    }
+
+    return threadSlot.slot;
+}
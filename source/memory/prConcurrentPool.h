@@ -0,0 +1,504 @@
+// File: prConcurrentPool.h
+//      Thread safe memory pool (Pool of objects)
+//
+// Notes:
+//      Each thread keeps a small magazine of free objects, so the common
+//      pop/push path only touches the thread's own magazine. Magazines are
+//      refilled from, and flushed to, a lock-free global freelist. Each
+//      magazine has an uncontended lock, so a pop which finds the pool
+//      exhausted can take the free objects cached by other threads. The freelist
+//      links objects by index with a tag in the upper 32 bits of the head,
+//      which guards against the ABA problem using a plain 64 bit CAS.
+/**
+ * Copyright 2014 Paul Michael McNab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+
+#include <atomic>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include "../debug/prAssert.h"
+#include "../debug/prTrace.h"
+#include "../core/prMacros.h"
+#include "../core/prTypes.h"
+#include "../core/prDefines.h"
+#include "../thread/prMutex.h"
+
+
+// Defines
+#define PRCONCURRENTPOOL_THREADS_MAX    32              // Threads running beyond this count bypass the magazines and use the freelist directly.
+#define PRCONCURRENTPOOL_MAGAZINE_SIZE  32              // Free objects cached per thread.
+#define PRCONCURRENTPOOL_CHUNKS_MAX     64              // Maximum number of chunks a growable pool may own.
+#define PRCONCURRENTPOOL_CACHE_LINE     64              // Padding used to keep magazines on separate cache lines.
+#define PRCONCURRENTPOOL_NULL           0xFFFFFFFF      // Empty freelist index.
+
+
+// Function: prConcurrentPoolThreadSlot
+//      Returns the calling thread's magazine slot.
+//
+// Notes:
+//      Slots are shared by all pools, and are freed for reuse when
+//      their thread exits. A slot of PRCONCURRENTPOOL_THREADS_MAX or
+//      above means the thread has no magazine.
+u32 prConcurrentPoolThreadSlot();
+
+
+// Class: prConcurrentPool
+//      A memory pool which can be used from multiple threads
+//      concurrently without a mutex on the hot path.
+//
+// Notes:
+//      Unlike <prMemoryPool> objects are constructed on <Pop> and
+//      destroyed on <Push>, so the pool only holds raw storage.
+//
+//      All objects must be returned before the pool is destroyed.
+//      Objects cached in the magazine of a thread which has exited
+//      are used by the next thread given its slot, or taken by a
+//      <Pop> which finds the pool exhausted.
+template<typename T>
+class prConcurrentPool
+{
+public:
+    // Method: prConcurrentPool
+    //      Constructor
+    //
+    // Parameters:
+    //      size    - The size of the pool in objects. If the pool can grow this is the chunk size
+    //      grow    - Allows the pool to allocate further chunks of size objects when exhausted
+    //      name    - An optional name for debug purposes
+    prConcurrentPool(s32 size, bool grow = false, const char* name = 0) : m_name(name)
+                                                                        , m_head(PRCONCURRENTPOOL_NULL)
+                                                                        , m_chunkCount(0)
+                                                                        , m_chunkSize(0)
+                                                                        , m_grow(grow)
+                                                                        , m_direct(0)
+    {
+        PRASSERT(size > 0);
+
+        for (s32 i=0; i<PRCONCURRENTPOOL_CHUNKS_MAX; ++i)
+        {
+            m_chunks[i] = 0;
+            m_next[i]   = 0;
+        }
+
+        for (s32 i=0; i<PRCONCURRENTPOOL_THREADS_MAX; ++i)
+        {
+            m_caches[i].count = 0;
+            m_caches[i].used.store(0, std::memory_order_relaxed);
+            m_caches[i].lock.store(0, std::memory_order_relaxed);
+        }
+
+        m_chunkSize = (u32)size;
+        Grow();
+    }
+
+    // Method: ~prConcurrentPool
+    //      Destructor.
+    //
+    // Notes:
+    //      Must not be called while other threads are using the pool.
+    ~prConcurrentPool()
+    {
+        PRASSERT(GetUsed() == 0, "Pool '%s' destroyed with %i objects in use", (m_name && *m_name) ? m_name : "unnamed", GetUsed());
+
+        u32 count = m_chunkCount.load(std::memory_order_acquire);
+        for (u32 i=0; i<count; ++i)
+        {
+            PRSAFE_DELETE_ARRAY(m_chunks[i]);
+            PRSAFE_DELETE_ARRAY(m_next[i]);
+        }
+    }
+
+    // Method: Pop
+    //      Acquires an object from the pool and constructs it in place.
+    //
+    // Parameters:
+    //      args    - The constructor arguments
+    //
+    // Returns:
+    //      An object or NULL if the pool is empty
+    template<typename... Args>
+    T *Pop(Args&&... args)
+    {
+        u32 index = PRCONCURRENTPOOL_NULL;
+        u32 slot  = prConcurrentPoolThreadSlot();
+
+        if (slot < PRCONCURRENTPOOL_THREADS_MAX)
+        {
+            Cache &cache = m_caches[slot];
+            Lock(cache);
+
+            if (cache.count == 0)
+            {
+                Refill(cache);
+            }
+
+            // Exhausted? Take the objects other threads have cached.
+            if (cache.count == 0 && Steal(slot))
+            {
+                Refill(cache);
+            }
+
+            if (cache.count > 0)
+            {
+                index = cache.items[--cache.count];
+                cache.used.store(cache.used.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+
+            Unlock(cache);
+        }
+        else
+        {
+            index = Acquire();
+            if (index == PRCONCURRENTPOOL_NULL && Steal(slot))
+            {
+                index = Acquire();
+            }
+
+            if (index != PRCONCURRENTPOOL_NULL)
+            {
+                m_direct.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        if (index == PRCONCURRENTPOOL_NULL)
+        {
+            prTrace(prLogLevel::LogError, "Failed to pop object from pool\n");
+            return 0;
+        }
+
+        return new (Address(index)) T(std::forward<Args>(args)...);
+    }
+
+    // Method: Push
+    //      Destroys an object and returns it to the pool.
+    //
+    // Notes:
+    //      The object pointer cannot be NULL and must have come from this pool.
+    //      Any thread may return an object, not just the one which popped it
+    void Push(T *object)
+    {
+        PRASSERT(object);
+
+        u32 index = IndexOf(object);
+        if (index == PRCONCURRENTPOOL_NULL)
+        {
+            prTrace(prLogLevel::LogError, "Failed to push object onto pool\n");
+            return;
+        }
+
+        object->~T();
+
+        u32 slot = prConcurrentPoolThreadSlot();
+        if (slot < PRCONCURRENTPOOL_THREADS_MAX)
+        {
+            Cache &cache = m_caches[slot];
+            Lock(cache);
+
+            if (cache.count == PRCONCURRENTPOOL_MAGAZINE_SIZE)
+            {
+                Flush(cache);
+            }
+
+            cache.items[cache.count++] = index;
+            cache.used.store(cache.used.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+
+            Unlock(cache);
+        }
+        else
+        {
+            Release(index, index);
+            m_direct.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Method: GetSize
+    //      Returns the size of the pool in objects, *not* bytes.
+    s32 GetSize() const { return (s32)(m_chunkCount.load(std::memory_order_acquire) * m_chunkSize); }
+
+    // Method: GetFree
+    //      Returns the number of free objects in the pool.
+    //
+    // Notes:
+    //      Only a snapshot while other threads are using the pool
+    s32 GetFree() const { return GetSize() - GetUsed(); }
+
+    // Method: GetUsed
+    //      Returns the number of used objects in the pool.
+    //
+    // Notes:
+    //      Only a snapshot while other threads are using the pool
+    s32 GetUsed() const
+    {
+        // Objects may be returned by a different thread than the one which
+        // popped them, so individual counts can be negative.
+        s32 used = m_direct.load(std::memory_order_relaxed);
+        for (s32 i=0; i<PRCONCURRENTPOOL_THREADS_MAX; ++i)
+        {
+            used += m_caches[i].used.load(std::memory_order_relaxed);
+        }
+
+        return used;
+    }
+
+    // Method: DisplayUsage
+    //      Displays memory pool status information.
+    void DisplayUsage() const
+    {
+        #if defined(_DEBUG) || defined(DEBUG)
+
+        prTrace(prLogLevel::LogError, "\n");
+        prTrace(prLogLevel::LogError, "---------------------------------------------------------------\n");
+        prTrace(prLogLevel::LogError, "Concurrent memory pool: (%s)\n", (m_name && *m_name) ? m_name : "unnamed");
+        prTrace(prLogLevel::LogError, "---------------------------------------------------------------\n");
+        prTrace(prLogLevel::LogError, "Size in objects: %i\n", GetSize());
+        prTrace(prLogLevel::LogError, "Size in bytes  : %i\n", GetSize() * sizeof(T));
+        prTrace(prLogLevel::LogError, "Chunks         : %i\n", m_chunkCount.load(std::memory_order_acquire));
+        prTrace(prLogLevel::LogError, "Free objects   : %i\n", GetFree());
+        prTrace(prLogLevel::LogError, "Used objects   : %i\n", GetUsed());
+        prTrace(prLogLevel::LogError, "---------------------------------------------------------------\n");
+
+        #endif
+    }
+
+
+private:
+    // Raw storage for a single object.
+    typedef typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type Storage;
+
+    // A per thread magazine. The items are guarded by the lock, which only
+    // a thread stealing from an exhausted pool contends for. The used count
+    // is atomic so <GetUsed> can read it from any thread.
+    typedef struct Cache
+    {
+        u32                 items[PRCONCURRENTPOOL_MAGAZINE_SIZE];
+        u32                 count;
+        std::atomic<s32>    used;
+        std::atomic<u32>    lock;
+        u8                  padding[PRCONCURRENTPOOL_CACHE_LINE];
+
+    } Cache;
+
+    // Locks a magazine.
+    void Lock(Cache &cache)
+    {
+        while (cache.lock.exchange(1, std::memory_order_acquire) != 0)
+        {
+        }
+    }
+
+    // Unlocks a magazine.
+    void Unlock(Cache &cache)
+    {
+        cache.lock.store(0, std::memory_order_release);
+    }
+
+    // Returns the storage of an object index.
+    T *Address(u32 index)
+    {
+        return reinterpret_cast<T*>(&m_chunks[index / m_chunkSize][index % m_chunkSize]);
+    }
+
+    // Returns the freelist link of an object index.
+    std::atomic<u32> &Next(u32 index)
+    {
+        return m_next[index / m_chunkSize][index % m_chunkSize];
+    }
+
+    // Returns the index of an object, or PRCONCURRENTPOOL_NULL if it's not from this pool.
+    u32 IndexOf(T *object) const
+    {
+        const Storage *p = reinterpret_cast<const Storage*>(object);
+
+        u32 count = m_chunkCount.load(std::memory_order_acquire);
+        for (u32 i=0; i<count; ++i)
+        {
+            const Storage *pChunk = m_chunks[i];
+            if (p >= pChunk && p < pChunk + m_chunkSize)
+            {
+                return (i * m_chunkSize) + (u32)(p - pChunk);
+            }
+        }
+
+        return PRCONCURRENTPOOL_NULL;
+    }
+
+    // Pushes a linked run of objects onto the global freelist with a single CAS.
+    void Release(u32 first, u32 last)
+    {
+        u64 head = m_head.load(std::memory_order_relaxed);
+        u64 replacement;
+
+        do
+        {
+            Next(last).store((u32)head, std::memory_order_relaxed);
+            replacement = (((head >> 32) + 1) << 32) | first;
+        }
+        while (!m_head.compare_exchange_weak(head, replacement, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    // Pops an object from the global freelist, growing the pool if allowed.
+    u32 Acquire()
+    {
+        for (;;)
+        {
+            u64 head = m_head.load(std::memory_order_acquire);
+
+            while ((u32)head != PRCONCURRENTPOOL_NULL)
+            {
+                // The link may be stale if another thread wins the race, in which case the tag
+                // will have changed and the exchange fails.
+                u32 next        = Next((u32)head).load(std::memory_order_relaxed);
+                u64 replacement = (((head >> 32) + 1) << 32) | next;
+
+                if (m_head.compare_exchange_weak(head, replacement, std::memory_order_acquire, std::memory_order_acquire))
+                {
+                    return (u32)head;
+                }
+            }
+
+            if (!m_grow || !Grow())
+            {
+                return PRCONCURRENTPOOL_NULL;
+            }
+        }
+    }
+
+    // Refills an empty magazine with half its capacity.
+    void Refill(Cache &cache)
+    {
+        while (cache.count < PRCONCURRENTPOOL_MAGAZINE_SIZE / 2)
+        {
+            u32 index = Acquire();
+            if (index == PRCONCURRENTPOOL_NULL)
+            {
+                break;
+            }
+
+            cache.items[cache.count++] = index;
+        }
+    }
+
+    // Moves the older half of a full magazine to the global freelist.
+    void Flush(Cache &cache)
+    {
+        const u32 half = PRCONCURRENTPOOL_MAGAZINE_SIZE / 2;
+
+        for (u32 i=0; i<half - 1; ++i)
+        {
+            Next(cache.items[i]).store(cache.items[i + 1], std::memory_order_relaxed);
+        }
+
+        Release(cache.items[0], cache.items[half - 1]);
+
+        for (u32 i=half; i<cache.count; ++i)
+        {
+            cache.items[i - half] = cache.items[i];
+        }
+
+        cache.count -= half;
+    }
+
+    // Moves the objects cached in the other threads magazines to the global
+    // freelist. Busy magazines are skipped rather than waited for, so two
+    // stealing threads can't deadlock. Returns true if any were moved.
+    bool Steal(u32 slot)
+    {
+        bool result = false;
+
+        for (u32 i=0; i<PRCONCURRENTPOOL_THREADS_MAX; ++i)
+        {
+            Cache &cache = m_caches[i];
+            if (i == slot || cache.lock.exchange(1, std::memory_order_acquire) != 0)
+            {
+                continue;
+            }
+
+            if (cache.count > 0)
+            {
+                for (u32 j=0; j<cache.count - 1; ++j)
+                {
+                    Next(cache.items[j]).store(cache.items[j + 1], std::memory_order_relaxed);
+                }
+
+                Release(cache.items[0], cache.items[cache.count - 1]);
+                cache.count = 0;
+                result      = true;
+            }
+
+            Unlock(cache);
+        }
+
+        return result;
+    }
+
+    // Adds a chunk of objects to the global freelist.
+    bool Grow()
+    {
+        // Growth is rare, so it's simply serialised.
+        m_growLock.Lock();
+
+        bool result = false;
+        u32  count  = m_chunkCount.load(std::memory_order_relaxed);
+
+        if ((u32)m_head.load(std::memory_order_acquire) != PRCONCURRENTPOOL_NULL)
+        {
+            // Another thread grew the pool, or objects were returned, while we waited.
+            result = true;
+        }
+        else if (count < PRCONCURRENTPOOL_CHUNKS_MAX)
+        {
+            m_chunks[count] = new Storage [m_chunkSize];
+            m_next[count]   = new std::atomic<u32> [m_chunkSize];
+
+            // Publish the chunk before any of its objects can be handed out.
+            m_chunkCount.store(count + 1, std::memory_order_release);
+
+            u32 first = count * m_chunkSize;
+            u32 last  = first + m_chunkSize - 1;
+            for (u32 i=first; i<last; ++i)
+            {
+                Next(i).store(i + 1, std::memory_order_relaxed);
+            }
+
+            Release(first, last);
+            result = true;
+        }
+        else
+        {
+            prTrace(prLogLevel::LogError, "Pool '%s' reached its chunk limit\n", (m_name && *m_name) ? m_name : "unnamed");
+        }
+
+        m_growLock.Unlock();
+        return result;
+    }
+
+
+protected:
+    const char         *m_name;                                  // A name used to uniquely identify a pool during debugging.
+    std::atomic<u64>    m_head;                                  // Global freelist head. Tag in the upper 32 bits, index in the lower.
+    Storage            *m_chunks[PRCONCURRENTPOOL_CHUNKS_MAX];   // Object storage.
+    std::atomic<u32>   *m_next[PRCONCURRENTPOOL_CHUNKS_MAX];     // Freelist links, parallel to the object storage.
+    std::atomic<u32>    m_chunkCount;                            // The number of chunks allocated.
+    u32                 m_chunkSize;                             // The size of each chunk in objects.
+    bool                m_grow;                                  // Can the pool grow?
+    std::atomic<s32>    m_direct;                                // Objects in use by threads without a magazine.
+    Cache               m_caches[PRCONCURRENTPOOL_THREADS_MAX];  // Per thread magazines.
+    prMutex             m_growLock;                              // Serialises chunk allocation.
+};
@@ -11,6 +11,9 @@
 //      and memory. Not meant for full blown pc, xbox or playstation
 //      games where more advanced memory management would be
 //      required
+//
+// See Also:
+//      <prTLSFHeap> which allocates and releases in constant time
 /**
  * Copyright 2014 Paul Michael McNab
  * 
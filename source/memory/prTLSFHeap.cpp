@@ -0,0 +1,750 @@
+/**
+ * prTLSFHeap.cpp
+ *
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include <stddef.h>
+#include "prTLSFHeap.h"
+#include "../debug/prAssert.h"
+#include "../debug/prTrace.h"
+#include "../core/prMacros.h"
+
+
+#if defined(PLATFORM_PC)
+  #include <intrin.h>
+#endif
+
+
+#define KILOBYTE            1024                                                        // 1K.
+#define SPACE_COUNT         6                                                           // Used to format display usage.
+#define TLSF_BLOCK_FREE     1                                                           // Block states.
+#define TLSF_BLOCK_USED     2
+#define TLSF_HEADER_SIZE    ((u32)offsetof(TLSFBlock, nextFree))                        // The part of a block which is always present.
+#define TLSF_MIN_BLOCK      PRROUND_UP(sizeof(TLSFBlock), TLSF_ALIGN_SIZE)              // A free block must be able to hold its links.
+
+
+// Local functions
+namespace
+{
+    // Returns the index of the lowest set bit, or -1 if none are set.
+    s32 LowestBit(u32 word)
+    {
+    #if defined(PLATFORM_PC)
+        unsigned long index;
+        return _BitScanForward(&index, word) ? (s32)index : -1;
+    #else
+        return word ? __builtin_ctz(word) : -1;
+    #endif
+    }
+
+
+    // Returns the index of the highest set bit, or -1 if none are set.
+    s32 HighestBit(u32 word)
+    {
+    #if defined(PLATFORM_PC)
+        unsigned long index;
+        return _BitScanReverse(&index, word) ? (s32)index : -1;
+    #else
+        return word ? 31 - __builtin_clz(word) : -1;
+    #endif
+    }
+
+
+    // Returns the bin a block of the given size belongs in.
+    void MappingInsert(u32 size, s32 &fl, s32 &sl)
+    {
+        if (size < (1 << TLSF_FL_SHIFT))
+        {
+            fl = 0;
+            sl = (s32)(size / ((1 << TLSF_FL_SHIFT) / TLSF_SL_COUNT));
+        }
+        else
+        {
+            s32 bit = HighestBit(size);
+            sl = (s32)((size >> (bit - TLSF_SL_COUNT_LOG2)) ^ TLSF_SL_COUNT);
+            fl = bit - (TLSF_FL_SHIFT - 1);
+        }
+    }
+
+
+    // Returns the first bin whose blocks are all at least the given size.
+    // Returns false if the size is too large for any bin.
+    bool MappingSearch(u32 size, s32 &fl, s32 &sl)
+    {
+        u64 rounded = size;
+
+        if (size >= (1 << TLSF_FL_SHIFT))
+        {
+            rounded += (1 << (HighestBit(size) - TLSF_SL_COUNT_LOG2)) - 1;
+        }
+
+        if (rounded > 0xFFFFFFFF)
+        {
+            return false;
+        }
+
+        MappingInsert((u32)rounded, fl, sl);
+        return true;
+    }
+
+
+    #if defined(DEBUG) || defined(_DEBUG)
+    const char* BlockState(u32 state)
+    {
+        switch(state)
+        {
+        case TLSF_BLOCK_FREE:   return "Free   ";
+        case TLSF_BLOCK_USED:   return "Normal ";
+        default:                return "Unknown";
+        }
+    }
+    #endif
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Constructor
+/// ---------------------------------------------------------------------------
+prTLSFHeap::prTLSFHeap(u32 size, const char *name, bool threadSafe) : m_name(name)
+                                                                     , m_bounds_check(0)
+                                                                     , m_user_addr(false)
+                                                                     , m_thread_safe(threadSafe)
+{
+    // Validate size.
+    if (size < TLSF_HEADER_SIZE + TLSF_MIN_BLOCK)
+    {
+        PRPANIC("Requested TLSF heap size of %i bytes is too small. The minimum size is %i", size, TLSF_HEADER_SIZE + TLSF_MIN_BLOCK);
+    }
+
+    m_memory = new u8 [size];
+    Create(m_memory, size);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Constructor
+/// ---------------------------------------------------------------------------
+prTLSFHeap::prTLSFHeap(u8 *start, u32 size, const char *name, bool threadSafe) : m_name(name)
+                                                                                 , m_bounds_check(0)
+                                                                                 , m_user_addr(true)
+                                                                                 , m_thread_safe(threadSafe)
+{
+    PRASSERT(start);
+
+    // Validate size. Allow for aligning the start address.
+    if (size < TLSF_HEADER_SIZE + TLSF_MIN_BLOCK + TLSF_ALIGN_SIZE)
+    {
+        PRPANIC("Requested TLSF heap size of %i bytes is too small. The minimum size is %i", size, TLSF_HEADER_SIZE + TLSF_MIN_BLOCK + TLSF_ALIGN_SIZE);
+    }
+
+    m_memory = start;
+    Create(m_memory, size);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Destructor
+/// ---------------------------------------------------------------------------
+prTLSFHeap::~prTLSFHeap()
+{
+    if (m_user_addr == false)
+    {
+        PRSAFE_DELETE_ARRAY(m_memory);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Allocate
+/// ---------------------------------------------------------------------------
+void* prTLSFHeap::Allocate(u32 size, const char* func)
+{
+    if (!m_thread_safe)
+    {
+        return AllocateMemory(size, func);
+    }
+
+    m_lock.Lock();
+    void *p = AllocateMemory(size, func);
+    m_lock.Unlock();
+
+    return p;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Release
+/// ---------------------------------------------------------------------------
+void prTLSFHeap::Release(void* p)
+{
+    if (!m_thread_safe)
+    {
+        ReleaseMemory(p);
+        return;
+    }
+
+    m_lock.Lock();
+    ReleaseMemory(p);
+    m_lock.Unlock();
+}
+
+
+/// ---------------------------------------------------------------------------
+/// ReleaseAll
+/// ---------------------------------------------------------------------------
+void prTLSFHeap::ReleaseAll()
+{
+    if (m_thread_safe)
+    {
+        m_lock.Lock();
+    }
+
+    Create(m_heap, m_heap_size);
+
+    if (m_thread_safe)
+    {
+        m_lock.Unlock();
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// DisplayUsage
+/// ---------------------------------------------------------------------------
+void prTLSFHeap::DisplayUsage(bool full) const
+{
+#if defined(DEBUG) || defined(_DEBUG)
+
+    prTrace(prLogLevel::LogError, "\nTLSF heap: ==============================================================================\n");
+
+    if (full)
+    {
+        TLSFBlock* block = m_first;
+
+        while(block != m_sentinel)
+        {
+            prTrace
+            (
+                prLogLevel::LogError,
+                "Addr: %p State: %s Block size: %*i Data size: %*i Func: %s\n",
+                (u8*)block + TLSF_HEADER_SIZE + m_bounds_check,
+                BlockState(block->status),
+                SPACE_COUNT, block->size,
+                SPACE_COUNT, block->size - TLSF_HEADER_SIZE - (m_bounds_check << 1),
+                (block->status == TLSF_BLOCK_USED && block->func) ? block->func : "Unknown"
+            );
+
+            block = NextBlock(block);
+        }
+
+        prTrace(prLogLevel::LogError, "\n");
+    }
+
+    prTrace(prLogLevel::LogError, "Heap name          : %s\n", (m_name && *m_name) ? m_name : "unnamed");
+    prTrace(prLogLevel::LogError, "Bounds check       : %s\n", m_bounds_check ? "true" : "false");
+    prTrace(prLogLevel::LogError, "Size used blocks   : %iK and %i bytes\n", GetSizeOfUsedBlocks()/KILOBYTE,   GetSizeOfUsedBlocks()%KILOBYTE);
+    prTrace(prLogLevel::LogError, "Size unused blocks : %iK and %i bytes\n", GetSizeOfUnusedBlocks()/KILOBYTE, GetSizeOfUnusedBlocks()%KILOBYTE);
+    prTrace(prLogLevel::LogError, "Largest free block : %iK and %i bytes\n", GetLargestFreeBlock()/KILOBYTE,   GetLargestFreeBlock()%KILOBYTE);
+    prTrace(prLogLevel::LogError, "Heap size          : %iK and %i bytes\n", m_heap_size/KILOBYTE,             m_heap_size%KILOBYTE);
+    prTrace(prLogLevel::LogError, "=========================================================================================\n");
+
+
+    if (full)
+    {
+        FreeListShow();
+    }
+
+#else
+
+    PRUNUSED(full);
+
+#endif
+}
+
+
+/// ---------------------------------------------------------------------------
+/// GetLargestFreeBlock
+/// ---------------------------------------------------------------------------
+u32 prTLSFHeap::GetLargestFreeBlock() const
+{
+    u32 largest = 0;
+
+    s32 fl = HighestBit(m_fl_bitmap);
+    if (fl >= 0)
+    {
+        // Only the highest occupied bin can contain the largest block.
+        s32 sl = HighestBit(m_sl_bitmap[fl]);
+
+        TLSFBlock* block = m_bins[fl][sl];
+
+        while(block)
+        {
+            largest = PRMAX(largest, block->size);
+            block   = block->nextFree;
+        }
+    }
+
+    return largest;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// GetSizeOfUnusedBlocks
+/// ---------------------------------------------------------------------------
+u32 prTLSFHeap::GetSizeOfUnusedBlocks() const
+{
+    return m_heap_size - TLSF_HEADER_SIZE - m_used;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// GetTotalFreeMemory
+/// ---------------------------------------------------------------------------
+u32 prTLSFHeap::GetTotalFreeMemory() const
+{
+    return GetSizeOfUnusedBlocks();
+}
+
+
+/// ---------------------------------------------------------------------------
+/// BoundsCheckEnable
+/// ---------------------------------------------------------------------------
+void prTLSFHeap::BoundsCheckEnable(bool enable)
+{
+    if (m_used == 0)
+    {
+        m_bounds_check = enable ? BOUNDS_CHECK_SIZE : 0;
+    }
+    else
+    {
+        PRWARN("You can only disable/enable bounds checking when a TLSF heap is empty.");
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// BoundsCheck
+/// ---------------------------------------------------------------------------
+void prTLSFHeap::BoundsCheck() const
+{
+    if (m_bounds_check)
+    {
+        TLSFBlock* block = m_first;
+
+        while(block != m_sentinel)
+        {
+            if (block->status == TLSF_BLOCK_USED)
+            {
+                BlockCheck(block);
+            }
+
+            block = NextBlock(block);
+        }
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// IsBoundsCheckEnabled
+/// ---------------------------------------------------------------------------
+bool prTLSFHeap::IsBoundsCheckEnabled() const
+{
+    return (BOUNDS_CHECK_SIZE == m_bounds_check);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// IsValidPointer
+/// ---------------------------------------------------------------------------
+bool prTLSFHeap::IsValidPointer(void* p) const
+{
+    if (IsPointerInHeap(p))
+    {
+        TLSFBlock* address = (TLSFBlock*)((u8*)p - TLSF_HEADER_SIZE - m_bounds_check);
+        TLSFBlock* block   = m_first;
+
+        while(block != m_sentinel)
+        {
+            if (block == address)
+            {
+                return (block->status == TLSF_BLOCK_USED);
+            }
+
+            block = NextBlock(block);
+        }
+    }
+
+    return false;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Tests to see if the pointers address is contained within the heaps bounds.
+/// ---------------------------------------------------------------------------
+bool prTLSFHeap::IsPointerInHeap(void* p) const
+{
+    bool result = false;
+
+    if (p)
+    {
+        // As it'll be a pointer to a block subtract the header size.
+        u8* address = (u8*)p - TLSF_HEADER_SIZE - m_bounds_check;
+
+        // In heap memory range?
+        result = (address >= (u8*)m_first && address < (u8*)m_sentinel);
+    }
+
+    return result;
+}
+
+
+// ------------------------------------------------------------------------------------------------
+//
+// --- PRIVATE
+//
+// ------------------------------------------------------------------------------------------------
+
+
+/// ---------------------------------------------------------------------------
+/// Sets up the heap as a single free block.
+/// ---------------------------------------------------------------------------
+void prTLSFHeap::Create(u8 *start, u32 size)
+{
+    // Align the start and the size.
+    u32 adjust = (u32)(TLSF_ALIGN_SIZE - ((u64)start & (TLSF_ALIGN_SIZE - 1))) & (TLSF_ALIGN_SIZE - 1);
+
+    m_heap      = start + adjust;
+    m_heap_size = (size - adjust) & ~(TLSF_ALIGN_SIZE - 1);
+    m_used      = 0;
+    m_fl_bitmap = 0;
+
+    for (s32 fl=0; fl<TLSF_FL_COUNT; ++fl)
+    {
+        m_sl_bitmap[fl] = 0;
+
+        for (s32 sl=0; sl<TLSF_SL_COUNT; ++sl)
+        {
+            m_bins[fl][sl] = 0;
+        }
+    }
+
+
+    // One free block followed by a used sentinel, so every block has a next block.
+    m_first              = (TLSFBlock*)m_heap;
+    m_first->prevPhys    = 0;
+    m_first->func        = 0;
+    m_first->size        = m_heap_size - TLSF_HEADER_SIZE;
+    m_first->status      = TLSF_BLOCK_FREE;
+
+    m_sentinel           = (TLSFBlock*)(m_heap + m_first->size);
+    m_sentinel->prevPhys = m_first;
+    m_sentinel->func     = 0;
+    m_sentinel->size     = TLSF_HEADER_SIZE;
+    m_sentinel->status   = TLSF_BLOCK_USED;
+
+    FreeListAdd(m_first);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// FreeListAdd
+/// ---------------------------------------------------------------------------
+void prTLSFHeap::FreeListAdd(TLSFBlock* block)
+{
+    s32 fl, sl;
+    MappingInsert(block->size, fl, sl);
+
+    TLSFBlock* head = m_bins[fl][sl];
+
+    block->nextFree = head;
+    block->prevFree = 0;
+
+    if (head)
+    {
+        head->prevFree = block;
+    }
+
+    m_bins[fl][sl]   = block;
+    m_sl_bitmap[fl] |= (1 << sl);
+    m_fl_bitmap     |= (1 << fl);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// FreeListRemove
+/// ---------------------------------------------------------------------------
+void prTLSFHeap::FreeListRemove(TLSFBlock* block)
+{
+    s32 fl, sl;
+    MappingInsert(block->size, fl, sl);
+
+    if (block->prevFree)
+    {
+        block->prevFree->nextFree = block->nextFree;
+    }
+    else
+    {
+        m_bins[fl][sl] = block->nextFree;
+
+        // Bin now empty?
+        if (m_bins[fl][sl] == 0)
+        {
+            m_sl_bitmap[fl] &= ~(1 << sl);
+
+            if (m_sl_bitmap[fl] == 0)
+            {
+                m_fl_bitmap &= ~(1 << fl);
+            }
+        }
+    }
+
+    if (block->nextFree)
+    {
+        block->nextFree->prevFree = block->prevFree;
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// FreeListSearch
+/// ---------------------------------------------------------------------------
+TLSFBlock* prTLSFHeap::FreeListSearch(u32 size) const
+{
+    s32 fl, sl;
+    if (!MappingSearch(size, fl, sl) || fl >= TLSF_FL_COUNT)
+    {
+        return 0;
+    }
+
+
+    // Look for a bin in this size class, then in the larger size classes.
+    u32 sl_map = m_sl_bitmap[fl] & (~0u << sl);
+
+    if (sl_map == 0)
+    {
+        u32 fl_map = (fl + 1 < 32) ? (m_fl_bitmap & (~0u << (fl + 1))) : 0;
+        if (fl_map == 0)
+        {
+            return 0;
+        }
+
+        fl     = LowestBit(fl_map);
+        sl_map = m_sl_bitmap[fl];
+    }
+
+    return m_bins[fl][LowestBit(sl_map)];
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Returns the block which follows a block in memory.
+/// ---------------------------------------------------------------------------
+TLSFBlock* prTLSFHeap::NextBlock(TLSFBlock* block) const
+{
+    return (TLSFBlock*)((u8*)block + block->size);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Checks a used blocks bounds check tags.
+/// ---------------------------------------------------------------------------
+void prTLSFHeap::BlockCheck(const TLSFBlock* block) const
+{
+    u32* start_tag = (u32*)((u8*)block + TLSF_HEADER_SIZE + m_bounds_check - BOUNDS_CHECK_ADJUST);
+    u32* end_tag   = (u32*)((u8*)block + block->size - BOUNDS_CHECK_ADJUST);
+
+    if (*start_tag != BOUNDS_CHECK_TAG)
+    {
+        PRPANIC("Bounds check failed at block start. %s\n", block->func ? block->func : "Unknown");
+    }
+
+    if (*end_tag != BOUNDS_CHECK_TAG)
+    {
+        PRPANIC("Bounds check failed at block end. %s\n", block->func ? block->func : "Unknown");
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Allocates memory from the heap.
+/// ---------------------------------------------------------------------------
+void* prTLSFHeap::AllocateMemory(u32 size, const char* func)
+{
+    if (0 == size)
+    {
+        PRPANIC("Requested memory allocation is too small.");
+    }
+
+    if (size > m_heap_size)
+    {
+        prTrace(prLogLevel::LogError, "TLSF heap '%s' cannot allocate %u bytes\n", (m_name && *m_name) ? m_name : "unnamed", size);
+        return 0;
+    }
+
+
+    // Get required size. Bounds checking uses a whole alignment unit at either end to keep the data aligned.
+    u32 required_size = PRROUND_UP(size, TLSF_ALIGN_SIZE) + TLSF_HEADER_SIZE + (m_bounds_check << 1);
+    required_size     = PRMAX(required_size, (u32)TLSF_MIN_BLOCK);
+
+
+    TLSFBlock* block = FreeListSearch(required_size);
+    if (block == 0)
+    {
+        prTrace(prLogLevel::LogError, "TLSF heap '%s' cannot allocate %u bytes\n", (m_name && *m_name) ? m_name : "unnamed", size);
+        return 0;
+    }
+
+    FreeListRemove(block);
+
+
+    // Split off the remainder if it's large enough to be a block.
+    if (block->size - required_size >= TLSF_MIN_BLOCK)
+    {
+        TLSFBlock* remainder = (TLSFBlock*)((u8*)block + required_size);
+
+        remainder->prevPhys = block;
+        remainder->func     = 0;
+        remainder->size     = block->size - required_size;
+        remainder->status   = TLSF_BLOCK_FREE;
+
+        NextBlock(remainder)->prevPhys = remainder;
+
+        block->size = required_size;
+
+        FreeListAdd(remainder);
+    }
+
+
+    block->func   = const_cast<char*>(func);
+    block->status = TLSF_BLOCK_USED;
+    m_used       += block->size;
+
+
+    u8* p = (u8*)block + TLSF_HEADER_SIZE + m_bounds_check;
+
+    // Set the tags.
+    if (m_bounds_check)
+    {
+        *(u32*)(p - BOUNDS_CHECK_ADJUST)                        = BOUNDS_CHECK_TAG;
+        *(u32*)((u8*)block + block->size - BOUNDS_CHECK_ADJUST) = BOUNDS_CHECK_TAG;
+    }
+
+    return p;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Releases memory to the heap.
+/// ---------------------------------------------------------------------------
+void prTLSFHeap::ReleaseMemory(void* p)
+{
+    if (p)
+    {
+        // Does pointer belong to this heap?
+        if (!IsPointerInHeap(p))
+        {
+            PRWARN("Pointer doesn't belong to this heap.");
+            return;
+        }
+
+
+        // Point to the block.
+        TLSFBlock* block = (TLSFBlock*)((u8*)p - TLSF_HEADER_SIZE - m_bounds_check);
+
+
+        // Ensure we don't attempt to release a block twice.
+        if (block->status == TLSF_BLOCK_FREE)
+        {
+            PRWARN("Delete called more than once. Block has already been released.");
+            return;
+        }
+
+        if (block->status != TLSF_BLOCK_USED)
+        {
+            PRWARN("Pointer isn't the start of a block.");
+            return;
+        }
+
+
+        if (m_bounds_check)
+        {
+            BlockCheck(block);
+        }
+
+
+        m_used       -= block->size;
+        block->status = TLSF_BLOCK_FREE;
+
+
+        // Merge with the previous block.
+        TLSFBlock* prev = block->prevPhys;
+
+        if (prev && prev->status == TLSF_BLOCK_FREE)
+        {
+            FreeListRemove(prev);
+            prev->size += block->size;
+            block       = prev;
+
+            NextBlock(block)->prevPhys = block;
+        }
+
+
+        // Merge with the next block. The sentinel is never free.
+        TLSFBlock* next = NextBlock(block);
+
+        if (next->status == TLSF_BLOCK_FREE)
+        {
+            FreeListRemove(next);
+            block->size += next->size;
+
+            NextBlock(block)->prevPhys = block;
+        }
+
+
+        FreeListAdd(block);
+    }
+}
+
+
+#if defined(_DEBUG) || defined(DEBUG)
+// ------------------------------------------------------------------------------------------------
+// FreeListShow
+// ------------------------------------------------------------------------------------------------
+void prTLSFHeap::FreeListShow() const
+{
+    if (m_fl_bitmap)
+    {
+        prTrace(prLogLevel::LogError, "Free list entries: ======================================================================\n");
+
+        for (s32 fl=0; fl<TLSF_FL_COUNT; ++fl)
+        {
+            for (s32 sl=0; sl<TLSF_SL_COUNT; ++sl)
+            {
+                TLSFBlock* block = m_bins[fl][sl];
+
+                while(block)
+                {
+                    prTrace(prLogLevel::LogError, "Bin: %2i,%2i Size : %i, Addr: %p\n", fl, sl, block->size, block);
+                    block = block->nextFree;
+                }
+            }
+        }
+
+        prTrace(prLogLevel::LogError, "=========================================================================================\n");
+    }
+}
+#endif
@@ -0,0 +1,230 @@
+// File: prTLSFHeap.h
+//      Contains a two level segregated fit memory heap manager.
+//
+// Notes:
+//      Free blocks are kept in size class bins indexed by a first level
+//      (power of two) and a second level (linear subdivision) index.
+//      Two bitmaps record which bins are occupied, so finding a block
+//      and releasing one are both constant time, regardless of how many
+//      free blocks the heap contains. Released blocks are merged with
+//      their free neighbours immediately, so no defragment is needed.
+/**
+ * Copyright 2014 Paul Michael McNab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+
+#include "../core/prTypes.h"
+#include "../thread/prMutex.h"
+#include "prMemory.h"
+#include "prAllocator.h"
+
+
+// Size class configuration
+#define TLSF_ALIGN_SIZE         8                                       // All blocks are a multiple of this size.
+#define TLSF_SL_COUNT_LOG2      4                                       // Log2 of the second level subdivisions.
+#define TLSF_SL_COUNT           (1 << TLSF_SL_COUNT_LOG2)               // Second level subdivisions per first level.
+#define TLSF_FL_SHIFT           (TLSF_SL_COUNT_LOG2 + 3)                // Sizes below (1 << TLSF_FL_SHIFT) share the first bin.
+#define TLSF_FL_COUNT           (32 - TLSF_FL_SHIFT + 1)                // First level bins needed for 32 bit sizes.
+
+
+// Used to link the memory blocks.
+typedef struct TLSFBlock
+{
+    struct TLSFBlock* prevPhys;     // Previous block in memory
+
+    char* func;                     // Allocating function
+
+    u32 size;                       // Size including this header
+    u32 status;                     // Free or used
+
+    struct TLSFBlock* nextFree;     // Next free block in the same bin. Only valid when free
+    struct TLSFBlock* prevFree;     // Previous free block in the same bin. Only valid when free
+
+} TLSFBlock;
+
+
+// Class: prTLSFHeap
+//      Represents a memory heap manager with constant time allocation and release.
+//
+// Notes:
+//      The heap can optionally be made thread safe, in which case allocation
+//      and release are serialised. For small objects allocated at high
+//      frequency across threads, use a <prConcurrentPool> instead.
+class prTLSFHeap : public Proteus::Memory::prAllocator
+{
+public:
+    // Method: prTLSFHeap
+    //      Constructor.
+    //
+    // Parameters:
+    //      size        - The size of heap required
+    //      name        - Optional name of the heap
+    //      threadSafe  - Set to serialise allocation and release
+    prTLSFHeap(u32 size, const char *name = 0, bool threadSafe = false);
+
+    // Method: prTLSFHeap
+    //      Use this constructor if you already have the address and size of the memory you wish to use.
+    //
+    // Parameters:
+    //      start       - The start of your preallocated heap
+    //      size        - The size of your preallocated heap
+    //      name        - Optional name of the heap
+    //      threadSafe  - Set to serialise allocation and release
+    prTLSFHeap(u8 *start, u32 size, const char *name = 0, bool threadSafe = false);
+
+    // Method: ~prTLSFHeap
+    //      Destructor.
+    ~prTLSFHeap();
+
+    // Method: Allocate
+    //      Allocates memory from the heap.
+    //
+    // Parameters:
+    //      size - Bytes required
+    //      name - Optional name for the allocation (Use in memory tracking)
+    //
+    // Returns:
+    //      The memory, aligned to TLSF_ALIGN_SIZE bytes, or NULL if the heap is exhausted
+    void* Allocate(u32 size, const char* func = 0) override;
+
+    // Method: Release
+    //      Releases a memory block.
+    void  Release(void* p) override;
+
+    // Method: ReleaseAll
+    //      Releases all memory blocks.
+    void  ReleaseAll();
+
+    // Method: DisplayUsage
+    //      Displays information about the heap.
+    void DisplayUsage(bool full = false) const;
+
+    // Method: GetLargestFreeBlock
+    //      Returns the size of the largest free block.
+    //
+    // Notes:
+    //      The returned size includes the block header and bounds checking tags.
+    //      Requests are rounded up to the next size class when searching, so a
+    //      request close to this size may still fail.
+    u32 GetLargestFreeBlock() const;
+
+    // Method: GetSizeOfUsedBlocks
+    //      Returns the size of all the used blocks.
+    //
+    // Notes:
+    //      The returned size includes the block headers plus the bounds checking tags.
+    u32 GetSizeOfUsedBlocks() const { return m_used; }
+
+    // Method: GetSizeOfUnusedBlocks
+    //      Returns the size of all the unused blocks.
+    //
+    // Notes:
+    //      The returned size includes the block headers.
+    u32 GetSizeOfUnusedBlocks() const;
+
+    // Method: GetTotalFreeMemory
+    //      Returns the total amount of free memory in the heap.
+    u32 GetTotalFreeMemory() const;
+
+    // Method: BoundsCheckEnable
+    //      Enable/disable bounds checking.
+    //
+    // Notes:
+    //      Bounds checking can only be enabled and disabled when the heap is empty.
+    void BoundsCheckEnable(bool enable);
+
+    // Method: BoundsCheck
+    //      Checks all allocated blocks for accidental overwrite and underwrite.
+    //
+    // Notes:
+    //      If bounds checking is enabled then this method will check that the overwrite tags,
+    //      placed at the start and end of each allocated memory block are intact.
+    void BoundsCheck() const;
+
+    // Method: IsBoundsCheckEnabled
+    //      Returns the bounds checking enabled status.
+    bool IsBoundsCheckEnabled() const;
+
+    // Method: IsValidPointer
+    //      Allows you to test if a pointer is valid for a specific heap.
+    //
+    // Notes:
+    //      Will only return true if the pointer points to the start of a valid block that's being used.
+    //      A freed block will return false. The time taken is relative to the number of blocks.
+    bool IsValidPointer(void* p) const;
+
+    // Method: IsPointerInHeap
+    //      Tests to see if the pointers address is contained within the heaps bounds.
+    bool IsPointerInHeap(void* p) const;
+
+
+private:
+    // Stop passing by value and assignment.
+    prTLSFHeap( const prTLSFHeap& );
+    const prTLSFHeap& operator = ( const prTLSFHeap& );
+
+
+    // Sets up the heap as a single free block.
+    void Create(u8 *start, u32 size);
+
+    // Adds a block to its bin.
+    void FreeListAdd(TLSFBlock* block);
+
+    // Removes a block from its bin.
+    void FreeListRemove(TLSFBlock* block);
+
+    // Finds a free block of at least size bytes.
+    TLSFBlock* FreeListSearch(u32 size) const;
+
+    // Returns the block which follows a block in memory.
+    TLSFBlock* NextBlock(TLSFBlock* block) const;
+
+    // Checks a used blocks bounds check tags.
+    void BlockCheck(const TLSFBlock* block) const;
+
+    // Allocates memory from the heap.
+    void* AllocateMemory(u32 size, const char* func);
+
+    // Releases memory to the heap.
+    void ReleaseMemory(void* p);
+
+    // Displays all the available blocks in the bins.
+    #if defined(_DEBUG) || defined(DEBUG)
+    void FreeListShow() const;
+    #endif
+
+
+protected:
+    TLSFBlock*  m_bins[TLSF_FL_COUNT][TLSF_SL_COUNT];   // Free blocks by size class.
+    u32         m_sl_bitmap[TLSF_FL_COUNT];             // Occupied second level bins.
+    u32         m_fl_bitmap;                            // Occupied first level bins.
+
+    TLSFBlock*  m_first;                                // First block in memory.
+    TLSFBlock*  m_sentinel;                             // Used marker block at the end of the heap.
+
+    const char* m_name;                                 // A name used to uniquely identify the heap during debugging.
+
+    u8*         m_memory;                               // The memory as allocated, or as supplied.
+    u8*         m_heap;                                 // The aligned heap.
+    u32         m_heap_size;                            // The size of the aligned heap.
+    u32         m_used;                                 // Size of all the used blocks.
+    u32         m_bounds_check;                         // Bounds check?
+    bool        m_user_addr;                            // User supplied the heap start address and heap size.
+    bool        m_thread_safe;                          // Serialise allocation and release?
+    prMutex     m_lock;                                 // Used when thread safe.
+};
@@ -142,11 +142,13 @@ prAnimation_MD2::~prAnimation_MD2()
 /// ---------------------------------------------------------------------------
 void prAnimation_MD2::Update(f32 step)
 {
-    if (mCurrAnimation != ANIMATION_INVALID)
+    if (mCurrAnimation != ANIMATION_INVALID && !mPause)
     {
-        mStep += step;
+        // The step is in milliseconds, as are all engine frame times.
+        mStep += step * MD2_FRAMES_PER_SECOND / 1000.0f;
 
-        if (mStep > 1.0f)
+        // Long frames may pass more than one animation frame.
+        while (mStep >= 1.0f)
         {
             mStep -= 1.0f;
 
@@ -159,6 +161,20 @@ void prAnimation_MD2::Update(f32 step)
 }
 
 
+/// ---------------------------------------------------------------------------
+/// Gets the frame being moved towards.
+/// ---------------------------------------------------------------------------
+s32 prAnimation_MD2::GetNextFrame() const
+{
+    if (mCurrAnimation == ANIMATION_INVALID)
+    {
+        return mCurFrame;
+    }
+
+    return (mCurFrame < mEndFrame) ? mCurFrame + 1 : mStartFrame;
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Plays an animation
 /// ---------------------------------------------------------------------------
@@ -39,6 +39,9 @@ public:
 
     // Method: Update
     //      Updates the animation
+    //
+    // Parameters:
+    //      step - The frame time in milliseconds
     void Update(f32 step);
 
     // Method: Play
@@ -61,6 +64,14 @@ public:
     //      Gets the current frame.
     s32 GetFrame() const { return mCurFrame; }
 
+    // Method: GetNextFrame
+    //      Gets the frame being moved towards.
+    s32 GetNextFrame() const;
+
+    // Method: GetInterpolation
+    //      Gets how far between the current and next frame the animation is. (0 to 1)
+    f32 GetInterpolation() const { return mStep; }
+
 
 private:
 
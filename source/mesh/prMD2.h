@@ -155,3 +155,5 @@ typedef struct
 #define MD2_MAGIC               PRMAKE4('2', 'P', 'D', 'I')
 #define MD2_VERSION             8
 #define MD2_MAX_FRAMES          199
+#define MD2_NUMBER_OF_NORMALS   162
+#define MD2_FRAMES_PER_SECOND   10.0f                   // The rate MD2 animations are authored at
@@ -19,6 +19,9 @@
 #pragma once
 
 
+#include "../core/prTypes.h"
+
+
 // Forward declarations
 class prTexture;
 
@@ -42,7 +45,10 @@ public:
 
     // Method: Update
     //      Updates a 3D meshes animation if it is animated
-    virtual void Update() = 0;
+    //
+    // Parameters:
+    //      dt - The frame time in milliseconds
+    virtual void Update(f32 dt) = 0;
 
     // Method: Draw
     //      Draws a 3D mesh
@@ -33,8 +33,13 @@
 #include "../debug/prTrace.h"
 #include "../display/prTexture.h"
 #include "../file/prFileShared.h"
+#include "../math/prSimd.h"
+#include "../thread/prJobSystem.h"
 #include <stdio.h>
+#include <string.h>
 #include <fstream>
+#include <map>
+#include <vector>
 #include <windows.h>
 #include <gl/gl.h>
 #include <gl/glu.h>
@@ -47,6 +52,67 @@
 #define MD2_DEBUG
 
 
+// Defines
+#define MD2_JOB_GRAIN       4                               // Meshes per job
+
+
+// Local functions
+namespace
+{
+    // Blends two frames. The count must be a multiple of 4.
+    void Lerp(f32 *pOut, const f32 *pA, const f32 *pB, f32 t, u32 count)
+    {
+    #if defined(PRSIMD_SSE)
+
+        __m128 amount = _mm_set1_ps(t);
+
+        for (u32 i=0; i<count; i += 4)
+        {
+            __m128 a = _mm_loadu_ps(pA + i);
+            __m128 b = _mm_loadu_ps(pB + i);
+            _mm_storeu_ps(pOut + i, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), amount)));
+        }
+
+    #elif defined(PRSIMD_NEON)
+
+        for (u32 i=0; i<count; i += 4)
+        {
+            float32x4_t a = vld1q_f32(pA + i);
+            float32x4_t b = vld1q_f32(pB + i);
+            vst1q_f32(pOut + i, vmlaq_n_f32(a, vsubq_f32(b, a), t));
+        }
+
+    #else
+
+        for (u32 i=0; i<count; i++)
+        {
+            pOut[i] = pA[i] + (pB[i] - pA[i]) * t;
+        }
+
+    #endif
+    }
+}
+
+
+// Blends the frames of a range of meshes.
+struct prMesh_MD2::InterpolateRange : public prJobRange
+{
+    explicit InterpolateRange(prMesh_MD2 **ppMeshes) : ppMeshes(ppMeshes)
+    {
+    }
+
+    void Run(u32 begin, u32 end) override
+    {
+        for (u32 i = begin; i < end; ++i)
+        {
+            ppMeshes[i]->Interpolate();
+        }
+    }
+
+    prMesh_MD2 **ppMeshes;
+};
+
+
 /// ---------------------------------------------------------------------------
 /// Constructor.
 /// ---------------------------------------------------------------------------
@@ -54,16 +120,22 @@ prMesh_MD2::prMesh_MD2() : prMesh()
 {
     mpAnimation     = NULL;
     m_skins         = NULL;
+    m_frameData     = NULL;
+    m_vertices      = NULL;
     m_texCoords     = NULL;
-    m_triangles     = NULL;
-    m_frames        = NULL;
-    m_glcmds        = NULL;
+    m_indices       = NULL;
     m_numTriangles  = 0;
+    m_numVertices   = 0;
+    m_streamSize    = 0;
+    m_frameSize     = 0;
     m_skinWidth     = 0;
     m_skinHeight    = 0;
     m_scale         = 1.0f;
     m_frame         = 0;
     m_numFrames     = 0;
+    m_blendFrame    = -1;
+    m_blendNext     = -1;
+    m_blendAmount   = 0.0f;
 }
 
 
@@ -73,10 +145,10 @@ prMesh_MD2::prMesh_MD2() : prMesh()
 prMesh_MD2::~prMesh_MD2()
 {
     PRSAFE_DELETE_ARRAY(m_skins);
+    PRSAFE_DELETE_ARRAY(m_frameData);
+    PRSAFE_DELETE_ARRAY(m_vertices);
     PRSAFE_DELETE_ARRAY(m_texCoords);
-    PRSAFE_DELETE_ARRAY(m_triangles);
-    PRSAFE_DELETE_ARRAY(m_frames);
-    PRSAFE_DELETE_ARRAY(m_glcmds);
+    PRSAFE_DELETE_ARRAY(m_indices);
     PRSAFE_DELETE(mpAnimation);
 }
 
@@ -106,12 +178,37 @@ void prMesh_MD2::Draw()
 
 
             // Render
-            glPushAttrib(GL_POLYGON_BIT);
+            glPushAttrib(GL_POLYGON_BIT | GL_ENABLE_BIT);
 
                 // Set polyons to clockwise (For back face culling)
                 glFrontFace(GL_CW);
 
-                RenderFrame(m_frame);
+                // Blended normals are shorter than unit length.
+                glEnable(GL_NORMALIZE);
+
+                // Bind texture
+                if (mpTexture)
+                {
+                    mpTexture->Bind();
+                }
+
+                // Make sure the stream holds the current frame, for meshes
+                // which were never updated.
+                Interpolate();
+
+                glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+
+                    glEnableClientState(GL_VERTEX_ARRAY);
+                    glEnableClientState(GL_NORMAL_ARRAY);
+                    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+                    glVertexPointer(3, GL_FLOAT, 0, m_vertices);
+                    glNormalPointer(GL_FLOAT, 0, m_vertices + m_streamSize);
+                    glTexCoordPointer(2, GL_FLOAT, 0, m_texCoords);
+
+                    glDrawElements(GL_TRIANGLES, m_numTriangles * 3, GL_UNSIGNED_SHORT, m_indices);
+
+                glPopClientAttrib();
 
                 glFrontFace(GL_CCW);
 
@@ -123,27 +220,56 @@ void prMesh_MD2::Draw()
 
 
 /// ---------------------------------------------------------------------------
-/// Renders the mesh.
+/// Animates the mesh, then blends its frames.
 /// ---------------------------------------------------------------------------
-void prMesh_MD2::Update()
+void prMesh_MD2::Update(f32 dt)
 {
-    Animate();
+    Animate(dt);
+    Interpolate();
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Updates many meshes, blending their frames in parallel.
+/// ---------------------------------------------------------------------------
+void prMesh_MD2::Update(prMesh_MD2 **ppMeshes, u32 count, f32 dt, prJobSystem *pJobs)
+{
+    PRASSERT(ppMeshes || count == 0);
+
+    if (pJobs == nullptr && prCoreExist() && prCoreComponentExist(PRSYSTEM_JOBSYSTEM))
+    {
+        pJobs = static_cast<prJobSystem *>(prCoreGetComponent(PRSYSTEM_JOBSYSTEM));
+    }
+
+    // Animating is cheap, so is done here.
+    for (u32 i=0; i<count; i++)
+    {
+        ppMeshes[i]->Animate(dt);
+    }
+
+    InterpolateRange interpolate(ppMeshes);
+    if (pJobs)
+    {
+        pJobs->ParallelFor(count, MD2_JOB_GRAIN, interpolate);
+    }
+    else
+    {
+        interpolate.Run(0, count);
+    }
 }
 
 
 // Animates the mesh.
 //
-void prMesh_MD2::Animate()
+void prMesh_MD2::Animate(f32 dt)
 {
     if (mLoaded)
     {
         if (mpAnimation)
         {
-            //mpAnimation->
-            mpAnimation->Update(16.0f/1000.0f);
+            mpAnimation->Update(dt);
 
-            m_frame = static_cast<prAnimation_MD2*>(mpAnimation)->GetFrame();
-            prTrace(prLogLevel::LogError, "Frame %i\n", m_frame);
+            m_frame = mpAnimation->GetFrame();
         }
     }
 }
@@ -212,11 +338,10 @@ bool prMesh_MD2::Load(const char *filename)
             #endif
 
 
-            // Memory allocation for model data
-            m_texCoords = new prMD2TexCoord [header.num_st];
-            m_triangles = new prMD2Triangle [header.num_tris];
-            m_frames    = new prMD2Frame    [header.num_frames];
-            m_glcmds    = new int           [header.num_glcmds];
+            // Memory allocation for the file data, which is decoded below.
+            prMD2TexCoord *pTexCoords = new prMD2TexCoord [PRMAX(header.num_st, 1)];
+            prMD2Triangle *pTriangles = new prMD2Triangle [PRMAX(header.num_tris, 1)];
+            prMD2Frame    *pFrames    = new prMD2Frame    [PRMAX(header.num_frames, 1)];
 
 
             // Read skin names
@@ -291,11 +416,11 @@ bool prMesh_MD2::Load(const char *filename)
 
             // Read texture coords.
             ifs.seekg(header.offset_st, std::ios::beg);
-            ifs.read(reinterpret_cast<char*>(m_texCoords), sizeof(prMD2TexCoord) * header.num_st);
+            ifs.read(reinterpret_cast<char*>(pTexCoords), sizeof(prMD2TexCoord) * header.num_st);
 
             // Read triangle data
             ifs.seekg(header.offset_tris, std::ios::beg);
-            ifs.read(reinterpret_cast<char*>(m_triangles), sizeof(prMD2Triangle) * header.num_tris);
+            ifs.read(reinterpret_cast<char*>(pTriangles), sizeof(prMD2Triangle) * header.num_tris);
 
             // Read frames
             ifs.seekg(header.offset_frames, std::ios::beg);
@@ -303,22 +428,21 @@ bool prMesh_MD2::Load(const char *filename)
             for (int i=0; i<header.num_frames; i++)
             {
                 // Memory allocation for the vertices of this frame
-                m_frames[i].verts = new prMD2Vertex[header.num_vertices];
+                pFrames[i].verts = new prMD2Vertex[header.num_vertices];
 
                 // Read frame data
-                ifs.read(reinterpret_cast<char*>(&m_frames[i].scale),    sizeof(prMD2Vec3));
-                ifs.read(reinterpret_cast<char*>(&m_frames[i].translate),sizeof(prMD2Vec3));
-                ifs.read(reinterpret_cast<char*>(&m_frames[i].name),     sizeof(char) * 16);
-                ifs.read(reinterpret_cast<char*>( m_frames[i].verts),    sizeof(prMD2Vertex) * header.num_vertices);
+                ifs.read(reinterpret_cast<char*>(&pFrames[i].scale),    sizeof(prMD2Vec3));
+                ifs.read(reinterpret_cast<char*>(&pFrames[i].translate),sizeof(prMD2Vec3));
+                ifs.read(reinterpret_cast<char*>(&pFrames[i].name),     sizeof(char) * 16);
+                ifs.read(reinterpret_cast<char*>( pFrames[i].verts),    sizeof(prMD2Vertex) * header.num_vertices);
 
                 #ifdef MD2_DEBUG
-                prTrace(prLogLevel::LogError, "Name: %s\n", &m_frames[i].name);
+                prTrace(prLogLevel::LogError, "Name: %s\n", &pFrames[i].name);
                 #endif
             }
 
-            // Read OpenGL commands
-            ifs.seekg(header.offset_glcmds, std::ios::beg);
-            ifs.read(reinterpret_cast<char*>(m_glcmds), sizeof(int) * header.num_glcmds);
+            bool read = !ifs.fail();
+            ifs.close();
 
 
             // Store some of the header data.
@@ -328,16 +452,22 @@ bool prMesh_MD2::Load(const char *filename)
             m_numFrames     = header.num_frames;
 
 
-            // Done.
-            mLoaded = true;
-            ifs.close();
-
+            // Decode the frames, so drawing only has to blend them.
+            if (read && Decode(header, pFrames, pTriangles, pTexCoords))
+            {
+                mLoaded = true;
 
-            // Create the animation data
-            if (m_numFrames > 0)
+                // Create the animation data
+                mpAnimation = new prAnimation_MD2(pFrames, m_numFrames);
+            }
+            else
             {
-                mpAnimation = new prAnimation_MD2(m_frames, m_numFrames);
+                PRWARN("Failed to load mesh '%s'.", filename);
             }
+
+            PRSAFE_DELETE_ARRAY(pTexCoords);
+            PRSAFE_DELETE_ARRAY(pTriangles);
+            PRSAFE_DELETE_ARRAY(pFrames);
         }
         else
         {
@@ -345,65 +475,163 @@ bool prMesh_MD2::Load(const char *filename)
         }
     }
 
-    return true;
+    return mLoaded;
 }
 
 
-// Renders the mesh.
-//
-void prMesh_MD2::RenderFrame(int frame)
+/// ---------------------------------------------------------------------------
+/// Decodes the frames into the float streams.
+/// ---------------------------------------------------------------------------
+bool prMesh_MD2::Decode(const prMD2Header &header, const prMD2Frame *pFrames, const prMD2Triangle *pTriangles, const prMD2TexCoord *pTexCoords)
 {
-    // Valid frame?
-    if (!PRBETWEEN(frame, 0, m_numFrames - 1))
+    if (header.num_frames <= 0 || header.num_tris <= 0 || header.num_frames >= MD2_MAX_FRAMES ||
+        header.skinWidth  <= 0 || header.skinHeight <= 0)
     {
-        prTrace(prLogLevel::LogError, "prMesh_MD2 - Invalid frame index\n");
-        return;
+        return false;
     }
 
-    
-    // Bind texture
-    if (mpTexture)
-    {
-        //glEnable(GL_TEXTURE_2D);
-        mpTexture->Bind();
-    }
+    PRSAFE_DELETE_ARRAY(m_frameData);
+    PRSAFE_DELETE_ARRAY(m_vertices);
+    PRSAFE_DELETE_ARRAY(m_texCoords);
+    PRSAFE_DELETE_ARRAY(m_indices);
+
+    // Triangle corners with the same vertex and texture coordinate share a render vertex.
+    std::map<u32, u16> corners;
+    std::vector<u32>   sources;
+
+    m_indices = new u16[header.num_tris * 3];
 
-    glBegin (GL_TRIANGLES);
+    for (int i=0; i<header.num_tris; i++)
     {
-        // Draw each triangle
-        for (int i = 0; i < m_numTriangles; i++)
+        for (int j=0; j<3; j++)
         {
-            // Draw each vertex of this triangle
-            for (int j = 0; j < 3; j++)
+            u16 vertex = pTriangles[i].vertex[j];
+            u16 st     = pTriangles[i].st[j];
+
+            if (vertex >= header.num_vertices || st >= header.num_st)
             {
-                prMD2Frame    *pFrame     = &m_frames[frame];
-                prMD2Vertex   *pVert      = &pFrame->verts[m_triangles[i].vertex[j]];
-                prMD2TexCoord *pTexCoords = &m_texCoords[m_triangles[i].st[j]];
+                PRWARN("MD2 triangle %i has an invalid index", i);
+                return false;
+            }
 
-                // Compute final texture coords.
-                float s = static_cast<float>(pTexCoords->s) / m_skinWidth;
-                float t = static_cast<float>(pTexCoords->t) / m_skinHeight;
+            u32  key = ((u32)vertex << 16) | st;
+            auto it  = corners.find(key);
 
-                glTexCoord2f (s, 1.0f - t);
-                //OGL_ErrorCheck();
+            if (it == corners.end())
+            {
+                if (sources.size() > 0xFFFF)
+                {
+                    PRWARN("MD2 mesh has too many vertices");
+                    return false;
+                }
 
-                // Send normal vector to OpenGL
-                glNormal3fv(md2Normals[pVert->normalIndex]);
-                //OGL_ErrorCheck();
+                it = corners.insert(std::pair<u32, u16>(key, (u16)sources.size())).first;
+                sources.push_back(key);
+            }
 
-                // Uncompress vertex position and scale it
-                prMD2Vec3 vector;
+            m_indices[i * 3 + j] = (*it).second;
+        }
+    }
 
-                vector[0] = (pFrame->scale[0] * pVert->v[0] + pFrame->translate[0]) * m_scale;
-                vector[1] = (pFrame->scale[1] * pVert->v[1] + pFrame->translate[1]) * m_scale;
-                vector[2] = (pFrame->scale[2] * pVert->v[2] + pFrame->translate[2]) * m_scale;
 
-                glVertex3fv(vector);                
-                //OGL_ErrorCheck();
-            }
+    // Each stream is padded, so blending needs no remainder loop.
+    m_numVertices = (int)sources.size();
+    m_streamSize  = (m_numVertices * 3 + 3) & ~3;
+    m_frameSize   = m_streamSize * 2;
+
+    m_frameData   = new f32[m_frameSize * header.num_frames];
+    m_vertices    = new f32[m_frameSize];
+    m_texCoords   = new f32[m_numVertices * 2];
+
+    memset(m_frameData, 0, sizeof(f32) * m_frameSize * header.num_frames);
+    memset(m_vertices,  0, sizeof(f32) * m_frameSize);
+
+
+    // Texture coordinates
+    for (int i=0; i<m_numVertices; i++)
+    {
+        const prMD2TexCoord &st = pTexCoords[sources[i] & 0xFFFF];
+
+        m_texCoords[i * 2 + 0] = static_cast<float>(st.s) / m_skinWidth;
+        m_texCoords[i * 2 + 1] = 1.0f - static_cast<float>(st.t) / m_skinHeight;
+    }
+
+
+    // Uncompress the frames
+    for (int f=0; f<header.num_frames; f++)
+    {
+        const prMD2Frame &frame = pFrames[f];
+
+        f32 *pPositions = m_frameData + f * m_frameSize;
+        f32 *pNormals   = pPositions  + m_streamSize;
+
+        for (int i=0; i<m_numVertices; i++)
+        {
+            const prMD2Vertex &vert = frame.verts[sources[i] >> 16];
+
+            pPositions[i * 3 + 0] = (frame.scale[0] * vert.v[0] + frame.translate[0]) * m_scale;
+            pPositions[i * 3 + 1] = (frame.scale[1] * vert.v[1] + frame.translate[1]) * m_scale;
+            pPositions[i * 3 + 2] = (frame.scale[2] * vert.v[2] + frame.translate[2]) * m_scale;
+
+            const f32 *pNormal = md2Normals[PRMIN(vert.normalIndex, MD2_NUMBER_OF_NORMALS - 1)];
+
+            pNormals[i * 3 + 0] = pNormal[0];
+            pNormals[i * 3 + 1] = pNormal[1];
+            pNormals[i * 3 + 2] = pNormal[2];
         }
     }
-    glEnd();
+
+    return true;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Blends the current frames into the vertex stream.
+/// ---------------------------------------------------------------------------
+void prMesh_MD2::Interpolate()
+{
+    if (!mLoaded)
+    {
+        return;
+    }
+
+    s32 frame  = m_frame;
+    s32 next   = frame;
+    f32 amount = 0.0f;
+
+    if (mpAnimation)
+    {
+        next   = mpAnimation->GetNextFrame();
+        amount = mpAnimation->GetInterpolation();
+    }
+
+    // Valid frame?
+    if (!PRBETWEEN(frame, 0, m_numFrames - 1) || !PRBETWEEN(next, 0, m_numFrames - 1))
+    {
+        prTrace(prLogLevel::LogError, "prMesh_MD2 - Invalid frame index\n");
+        return;
+    }
+
+    // Already blended? Paused and stopped meshes stop here.
+    if (frame == m_blendFrame && next == m_blendNext && amount == m_blendAmount)
+    {
+        return;
+    }
+
+    const f32 *pFrame = m_frameData + frame * m_frameSize;
+
+    if (amount <= 0.0f || frame == next)
+    {
+        memcpy(m_vertices, pFrame, sizeof(f32) * m_frameSize);
+    }
+    else
+    {
+        Lerp(m_vertices, pFrame, m_frameData + next * m_frameSize, amount, m_frameSize);
+    }
+
+    m_blendFrame  = frame;
+    m_blendNext   = next;
+    m_blendAmount = amount;
 }
 
 
@@ -27,9 +27,15 @@
 
 // Forward declarations
 class prAnimation_MD2;
+class prJobSystem;
 
 
 /** Base mesh class
+ *
+ *  The frames are decoded once when loaded. Each frame is a stream of float
+ *  positions followed by a stream of float normals, one per render vertex.
+ *  Updating blends the current and next frames into the meshes own vertex
+ *  stream, which is drawn with vertex arrays.
  */
 class prMesh_MD2 : public prMesh
 {
@@ -43,13 +49,25 @@ public:
      */
     void Draw();
 
-    void Update();
-    //{}
+
+    /** Animates the mesh, then blends its frames.
+     *
+     *  The frame time is in milliseconds.
+     */
+    void Update(f32 dt);
+
+
+    /** Updates many meshes, blending their frames in parallel.
+     *
+     *  The frame time is in milliseconds. If the job system is null the
+     *  cores job system is used if it exists.
+     */
+    static void Update(prMesh_MD2 **ppMeshes, u32 count, f32 dt, prJobSystem *pJobs = nullptr);
 
 
-    /** Animates the mesh.
+    /** Animates the mesh. The frame time is in milliseconds.
      */
-    void Animate();
+    void Animate(f32 dt);
 
 
     /** Loads the mesh.
@@ -62,23 +80,38 @@ public:
 
 private:
 
-    /**
+    // Blends frames for many meshes.
+    struct InterpolateRange;
+
+
+    /** Decodes the frames into the float streams.
+     */
+    bool Decode(const prMD2Header &header, const prMD2Frame *pFrames, const prMD2Triangle *pTriangles, const prMD2TexCoord *pTexCoords);
+
+
+    /** Blends the current frames into the vertex stream.
      */
-    void RenderFrame(int frame);
+    void Interpolate();
 
 
 private:
     prAnimation_MD2 *mpAnimation;
     prMD2Skin       *m_skins;
-    prMD2TexCoord   *m_texCoords;
-    prMD2Triangle   *m_triangles;
-    prMD2Frame      *m_frames;
-    int             *m_glcmds;
+    f32             *m_frameData;           // Decoded frames. m_frameSize floats each
+    f32             *m_vertices;            // The blended positions and normals, drawn each frame
+    f32             *m_texCoords;           // Two per render vertex
+    u16             *m_indices;             // Three per triangle
 
     int             m_numTriangles;
     int             m_numFrames;
+    int             m_numVertices;          // Number of render vertices
+    int             m_streamSize;           // Floats in a position or normal stream. A multiple of 4
+    int             m_frameSize;            // Floats in a decoded frame
     int             m_skinWidth;
     int             m_skinHeight;
     float           m_scale;
     int             m_frame;
+    int             m_blendFrame;           // The frames in the vertex stream, so
+    int             m_blendNext;            // unchanged frames aren't blended again
+    float           m_blendAmount;
 };
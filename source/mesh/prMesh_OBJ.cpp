@@ -24,11 +24,17 @@
 
 
 #include <stdlib.h>
+#include <string.h>
 #include "prMesh_OBJ.h"
+#include "../file/prChunkFile.h"
 #include "../file/prFile.h"
+#include "../file/prFileManager.h"
+#include "../file/prFileShared.h"
 #include "../debug/prTrace.h"
 #include "../debug/prAssert.h"
+#include "../core/prCore.h"
 #include "../core/prStringUtil.h"
+#include "../core/prStringHash.h"
 #include "../core/prMacros.h"
 #include <windows.h>
 #include <gl/gl.h>
@@ -38,13 +44,231 @@
 //using namespace Proteus::Core;
 
 
+// Defines
+#define CACHE_EXTENSION         ".mesh"
+#define CACHE_HAS_NORMALS       0x00000001
+#define CACHE_HAS_TEXCOORDS     0x00000002
+#define NO_INDEX                -1
+
+
+// Local functions
+namespace
+{
+    // A face corner. The indices are zero based, or NO_INDEX if absent.
+    typedef struct Corner
+    {
+        s32 position;
+        s32 texCoord;
+        s32 normal;
+
+    } Corner;
+
+
+    // Merges identical face corners, so each becomes one vertex.
+    class CornerMap
+    {
+    public:
+        CornerMap() : pSlots(nullptr), capacity(0)
+        {
+        }
+
+        ~CornerMap()
+        {
+            PRSAFE_DELETE_ARRAY(pSlots);
+        }
+
+        // Finds a corners vertex, adding the corner if it's new.
+        u32 Find(const Corner &corner, bool &added)
+        {
+            // Keep the table at most half full.
+            if ((corners.size() + 1) * 2 > capacity)
+            {
+                Grow();
+            }
+
+            u32 mask = capacity - 1;
+            u32 slot = Hash(corner) & mask;
+
+            while (pSlots[slot] != 0)
+            {
+                const Corner &c = corners[pSlots[slot] - 1];
+                if (c.position == corner.position &&
+                    c.texCoord == corner.texCoord &&
+                    c.normal   == corner.normal)
+                {
+                    added = false;
+                    return pSlots[slot] - 1;
+                }
+
+                slot = (slot + 1) & mask;
+            }
+
+            corners.push_back(corner);
+            pSlots[slot] = (u32)corners.size();
+            added = true;
+            return pSlots[slot] - 1;
+        }
+
+        // Reserves space for a number of vertices.
+        void Reserve(u32 count)
+        {
+            corners.reserve(count);
+        }
+
+    private:
+        static u32 Hash(const Corner &corner)
+        {
+            u32 hash = (u32)corner.position * 0x9E3779B1;
+            hash ^= (u32)corner.texCoord * 0x85EBCA77;
+            hash ^= (u32)corner.normal   * 0xC2B2AE3D;
+            return hash ^ (hash >> 15);
+        }
+
+        void Grow()
+        {
+            u32 size = PRMAX(capacity * 2, (u32)1024);
+
+            PRSAFE_DELETE_ARRAY(pSlots);
+            pSlots   = new u32[size];
+            capacity = size;
+            memset(pSlots, 0, size * sizeof(u32));
+
+            // Rehash
+            u32 mask = capacity - 1;
+            for (u32 i=0; i<(u32)corners.size(); i++)
+            {
+                u32 slot = Hash(corners[i]) & mask;
+                while (pSlots[slot] != 0)
+                {
+                    slot = (slot + 1) & mask;
+                }
+
+                pSlots[slot] = i + 1;
+            }
+        }
+
+    private:
+        std::vector<Corner>     corners;
+        u32                    *pSlots;                     // Vertex index + 1, or 0 if empty
+        u32                     capacity;
+    };
+
+
+    // Skips spaces and tabs, but not line ends.
+    const char *SkipSpaces(const char *text)
+    {
+        while (*text == ' ' || *text == '\t')
+        {
+            text++;
+        }
+
+        return text;
+    }
+
+
+    // Moves to the start of the next line.
+    const char *NextLine(const char *text)
+    {
+        while (*text && *text != '\n')
+        {
+            text++;
+        }
+
+        return (*text == '\n') ? text + 1 : text;
+    }
+
+
+    // Reads a float. Returns false if there isn't one.
+    bool ParseFloat(const char *&text, f32 &value)
+    {
+        // strtod would skip line ends.
+        if (*text == '\0' || PRIS_WHITESPACE(*text))
+        {
+            return false;
+        }
+
+        char *end;
+        value = (f32)strtod(text, &end);
+
+        if (end == text)
+        {
+            return false;
+        }
+
+        text = SkipSpaces(end);
+        return true;
+    }
+
+
+    // Reads a one based obj index, which may be relative, as a zero based
+    // index. Returns NO_INDEX if the index is absent or out of range.
+    s32 ParseIndex(const char *&text, u32 count)
+    {
+        // strtol would skip line ends.
+        if (*text == '\0' || PRIS_WHITESPACE(*text))
+        {
+            return NO_INDEX;
+        }
+
+        char *end;
+        long  index = strtol(text, &end, 10);
+
+        if (end == text)
+        {
+            return NO_INDEX;
+        }
+
+        text = end;
+
+        if (index > 0 && (u32)index <= count)
+        {
+            return (s32)(index - 1);
+        }
+
+        if (index < 0 && (u32)-index <= count)
+        {
+            return (s32)(count + index);
+        }
+
+        return NO_INDEX;
+    }
+
+
+    // Hashes the source bytes, so the cache can detect edits that keep the
+    // file size. Uses the string hash rounds, consuming 8 byte words.
+    u64 HashSource(const char *buffer, u32 size)
+    {
+        u64 acc = PRHASH64_SEED;
+
+        for (u32 i=0; i<size; i+=8)
+        {
+            u64 word  = 0;
+            u32 count = PRMIN(size - i, 8U);
+
+            for (u32 j=0; j<count; j++)
+            {
+                word |= (u64)(u8)buffer[i + j] << (j * 8);
+            }
+
+            acc = prStringHashImpl::Round(acc, word);
+        }
+
+        return prStringHashImpl::Avalanche(acc + size);
+    }
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Constructor.
 /// ---------------------------------------------------------------------------
 prMesh_OBJ::prMesh_OBJ() : prMesh()
 {
-    pVerts = NULL;
-    count  = 0;
+    pVertices    = nullptr;
+    pIndices     = nullptr;
+    vertexCount  = 0;
+    indexCount   = 0;
+    hasNormals   = false;
+    hasTexCoords = false;
 }
 
 
@@ -53,108 +277,112 @@ prMesh_OBJ::prMesh_OBJ() : prMesh()
 /// ---------------------------------------------------------------------------
 prMesh_OBJ::~prMesh_OBJ()
 {
-    PRSAFE_DELETE_ARRAY(pVerts);
+    Release();
 }
 
 
 /// ---------------------------------------------------------------------------
-/// 
+/// Loads the mesh, from its cache if possible.
 /// ---------------------------------------------------------------------------
 bool prMesh_OBJ::Load(const char *filename)
 {
     PRASSERT(filename && *filename);
 
-    prFile *file = new prFile(filename);
-    if (file)
-    {
-        if (file->Open())
-        {
-            u32 size = file->Size();
-            if (size > 0)
-            {
-                // Create buffer with + 1 for terminating null
-                char *buffer = new char [size + 1];
+    Release();
 
-                // Read file
-                file->Read(buffer, size);
-                file->Close();
-                delete file;
+    char cacheName[FILE_MAX_FILENAME_SIZE];
+    prStringSnprintf(cacheName, sizeof(cacheName), "%s%s", filename, CACHE_EXTENSION);
 
-                // Terminate read data
-                buffer[size] = 0;
+    // The source size and hash are used to detect a stale cache. The source
+    // needn't exist if the cache does.
+    prFile file(filename);
+    u32    size   = file.Open() ? file.Size() : 0;
+    char  *buffer = nullptr;
+    u32    bytes  = 0;
+    u64    hash   = 0;
 
-                // Parse
-                Parse(buffer);
-                PRSAFE_DELETE_ARRAY(buffer);
-
-                count = (s32)(faces.size() * 3);
-
-                pVerts = new prVertex3D[count];
+    if (size > 0)
+    {
+        // Create buffer with + 1 for terminating null
+        buffer = new char [size + 1];
 
-                std::list<prFace>::iterator it  = faces.begin();
-                std::list<prFace>::iterator end = faces.end();
+        // Read file
+        bytes = file.Read(buffer, size);
 
+        // Terminate read data
+        buffer[bytes] = 0;
 
-                prVertex3D *pTempVerts = pVerts;
+        hash = HashSource(buffer, bytes);
+    }
 
-                for (;it != end; ++it)
-                {
-                    s32 a = (*it).a;
-                    s32 b = (*it).b;
-                    s32 c = (*it).c;
-
-                    // Tri 1
-                    pTempVerts->x = verts[a].x;
-                    pTempVerts->y = verts[a].y;
-                    pTempVerts->z = verts[a].z;
-                    pTempVerts++;
-
-                    // Tri 2
-                    pTempVerts->x = verts[b].x;
-                    pTempVerts->y = verts[b].y;
-                    pTempVerts->z = verts[b].z;
-                    pTempVerts++;
-
-                    // Tri 3
-                    pTempVerts->x = verts[c].x;
-                    pTempVerts->y = verts[c].y;
-                    pTempVerts->z = verts[c].z;
-                    pTempVerts++;
-
-                    //prTrace(LogError, "%f, %f, %f, ",  verts[a].x, verts[a].y, verts[a].z);
-                    //prTrace(LogError, "%f, %f, %f, ",  verts[b].x, verts[b].y, verts[b].z);
-                    //prTrace(LogError, "%f, %f, %f,\n", verts[c].x, verts[c].y, verts[c].z);
-                }
+    file.Close();
 
-                verts.clear();
-                faces.clear();
-            }
+    if (LoadCache(cacheName, size, hash))
+    {
+        mLoaded = true;
+    }
+    else if (buffer)
+    {
+        // Parse
+        if (bytes == size && Parse(buffer, size))
+        {
+            SaveCache(cacheName, size, hash);
+            mLoaded = true;
+        }
+        else
+        {
+            PRWARN("Failed to load mesh '%s'", filename);
+            Release();
         }
     }
 
-    return false;
+    PRSAFE_DELETE_ARRAY(buffer);
+
+    return mLoaded;
 }
 
 
+/// ---------------------------------------------------------------------------
+/// Draws the mesh.
+/// ---------------------------------------------------------------------------
 void prMesh_OBJ::Draw()
 {
+    if (!mLoaded)
+    {
+        return;
+    }
+
     glPushMatrix();
 
     // Render
     glPushAttrib(GL_POLYGON_BIT);
 
+    // Wireframe?
+    glPolygonMode(GL_FRONT_AND_BACK, mWireframe ? GL_LINE : GL_FILL);
+
     // Set polyons to clockwise (For back face culling)
     glFrontFace(GL_CCW);
 
-    glBegin (GL_TRIANGLES);
-    {
-        // Draw each triangle
-        for (int i = 0; i < count; i++)
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glVertexPointer(3, GL_FLOAT, sizeof(prMeshVertex), &pVertices->x);
+
+        if (hasNormals)
         {
-            glVertex3f(pVerts[i].x, pVerts[i].y, pVerts[i].z);           
+            glEnableClientState(GL_NORMAL_ARRAY);
+            glNormalPointer(GL_FLOAT, sizeof(prMeshVertex), &pVertices->nx);
+        }
+
+        if (hasTexCoords)
+        {
+            glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+            glTexCoordPointer(2, GL_FLOAT, sizeof(prMeshVertex), &pVertices->u);
         }
-    }
-    glEnd();
+
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, pIndices);
+
+    glPopClientAttrib();
 
     glPopAttrib();
 
@@ -162,135 +390,295 @@ void prMesh_OBJ::Draw()
 }
 
 
-void prMesh_OBJ::Parse(char *buffer)
+/// ---------------------------------------------------------------------------
+/// Parses the obj file data in a single pass.
+/// ---------------------------------------------------------------------------
+bool prMesh_OBJ::Parse(const char *buffer, u32 size)
 {
-    s32 size;
-    //s32 i=0;
+    PRASSERT(buffer);
 
-    while(ReadLine(buffer, size))
-    {
-        // Terminate the line
-        char c = buffer[size];
-        buffer[size] = 0;
+    std::vector<f32>            positions;
+    std::vector<f32>            normals;
+    std::vector<f32>            texCoords;
+    std::vector<prMeshVertex>   vertices;
+    std::vector<u32>            indices;
+    CornerMap                   cornerMap;
 
-        // Parse each line
-        ParseLine(buffer);
+    // Reserve for typical line lengths, to avoid most reallocations.
+    u32 lines = size / 32;
+    positions.reserve(lines * 3);
+    vertices .reserve(lines);
+    indices  .reserve(lines * 3);
+    cornerMap.Reserve(lines);
 
-        // Restore buffer
-        buffer[size] = c;
+    bool badFace = false;
 
-        // Next line start
-        buffer += size;
-    }
-}
-
-
-bool prMesh_OBJ::ReadLine(char *buffer, s32 &size)
-{
-    size = 0;
-
-    char *working = buffer;
-
-    //char
-    if (working)
+    for (const char *line = buffer; *line; line = NextLine(line))
     {
-        bool loop = true;
+        const char *text = SkipSpaces(line);
 
-        do
+        if (text[0] == 'v')
         {
-            char c = *working++;
+            f32 x, y, z;
 
-            // File ended?
-            if (c == '\0')
+            // Position
+            if (text[1] == ' ' || text[1] == '\t')
+            {
+                text = SkipSpaces(text + 1);
+                if (ParseFloat(text, x) && ParseFloat(text, y) && ParseFloat(text, z))
+                {
+                    positions.push_back(x);
+                    positions.push_back(y);
+                    positions.push_back(z);
+                }
+            }
+            // Normal
+            else if (text[1] == 'n')
             {
-                size = (s32)(working - buffer);
-                return false;
+                text = SkipSpaces(text + 2);
+                if (ParseFloat(text, x) && ParseFloat(text, y) && ParseFloat(text, z))
+                {
+                    normals.push_back(x);
+                    normals.push_back(y);
+                    normals.push_back(z);
+                }
             }
-
-            // Line end?
-            if (c == '\r')
+            // Texture coordinate
+            else if (text[1] == 't')
             {
-                //prTrace(LogError, "CR\n");
-                continue; // Until we get '\n'
+                text = SkipSpaces(text + 2);
+                if (ParseFloat(text, x) && ParseFloat(text, y))
+                {
+                    texCoords.push_back(x);
+                    texCoords.push_back(y);
+                }
             }
+        }
+
+        // Faces are triangulated as fans. Corners are v, v/t, v//n or v/t/n
+        else if (text[0] == 'f' && (text[1] == ' ' || text[1] == '\t'))
+        {
+            text = SkipSpaces(text + 1);
+
+            u32 first   = 0;
+            u32 prev    = 0;
+            u32 corners = 0;
 
-            // Line end?
-            if (c == '\n')
+            while (*text && *text != '\n' && *text != '\r' && *text != '#')
             {
-                size = (s32)(working - buffer);
-                return true;
+                Corner corner;
+                corner.position = ParseIndex(text, (u32)positions.size() / 3);
+                corner.texCoord = NO_INDEX;
+                corner.normal   = NO_INDEX;
+
+                if (*text == '/')
+                {
+                    text++;
+                    if (*text != '/')
+                    {
+                        corner.texCoord = ParseIndex(text, (u32)texCoords.size() / 2);
+                    }
+
+                    if (*text == '/')
+                    {
+                        text++;
+                        corner.normal = ParseIndex(text, (u32)normals.size() / 3);
+                    }
+                }
+
+                if (corner.position == NO_INDEX)
+                {
+                    badFace = true;
+                    break;
+                }
+
+                text = SkipSpaces(text);
+
+                // Find or add the vertex
+                bool added;
+                u32  index = cornerMap.Find(corner, added);
+
+                if (added)
+                {
+                    prMeshVertex v;
+                    memset(&v, 0, sizeof(v));
+
+                    const f32 *p = &positions[corner.position * 3];
+                    v.x = p[0];
+                    v.y = p[1];
+                    v.z = p[2];
+
+                    if (corner.normal != NO_INDEX)
+                    {
+                        const f32 *n = &normals[corner.normal * 3];
+                        v.nx = n[0];
+                        v.ny = n[1];
+                        v.nz = n[2];
+                        hasNormals = true;
+                    }
+
+                    if (corner.texCoord != NO_INDEX)
+                    {
+                        const f32 *t = &texCoords[corner.texCoord * 2];
+                        v.u = t[0];
+                        v.v = t[1];
+                        hasTexCoords = true;
+                    }
+
+                    vertices.push_back(v);
+                }
+
+                if (corners == 0)
+                {
+                    first = index;
+                }
+                else if (corners >= 2)
+                {
+                    indices.push_back(first);
+                    indices.push_back(prev);
+                    indices.push_back(index);
+                }
+
+                prev = index;
+                corners++;
             }
         }
-        while(loop);
     }
 
-    return false;
+    if (badFace)
+    {
+        PRWARN("Mesh has faces with invalid vertices. They have been skipped");
+    }
+
+    if (indices.empty())
+    {
+        return false;
+    }
+
+    // Store
+    vertexCount = (u32)vertices.size();
+    indexCount  = (u32)indices.size();
+    pVertices   = new prMeshVertex[vertexCount];
+    pIndices    = new u32[indexCount];
+
+    memcpy(pVertices, &vertices[0], vertexCount * sizeof(prMeshVertex));
+    memcpy(pIndices,  &indices[0],  indexCount  * sizeof(u32));
+
+    return true;
 }
 
 
-void prMesh_OBJ::ParseLine(char *buffer)
+/// ---------------------------------------------------------------------------
+/// Loads the binary mesh cache.
+/// ---------------------------------------------------------------------------
+bool prMesh_OBJ::LoadCache(const char *filename, u32 sourceSize, u64 sourceHash)
 {
-    if (buffer)
+    prChunkReader reader;
+    if (!reader.Load(filename, PRFILE_TYPE_MH, PRCOOKED_VERSION_MH))
     {
-        s32 len = prStringLength(buffer);//strlen(buffer);
+        return false;
+    }
 
-        //prTrace(LogError, "Size %03i: %s", len, buffer);
+    if (!reader.FindChunk(PRCHUNK_INFO))
+    {
+        return false;
+    }
 
-        if (len >= 2)
-        {
-            char c1 = *buffer ++;
-            char c2 = *buffer ++;
+    // Is the cache stale?
+    u32 cachedSize = reader.ReadU32();
+    u64 cachedHash = reader.ReadU64();
+    if (sourceSize > 0 && (sourceSize != cachedSize || sourceHash != cachedHash))
+    {
+        return false;
+    }
 
-            // Vertex data
-            if (c1 == 'v' && c2 == ' ')
-            {
-                buffer = prStringSkipWhitespace(buffer);        // Skip leading whitespace
-                f32 x  = (f32)atof(buffer);                     // Converts
-                buffer = prStringSkipToWhitespace(buffer);      // Skip to next whitespace
+    u32 flags    = reader.ReadU32();
+    hasNormals   = (flags & CACHE_HAS_NORMALS)   != 0;
+    hasTexCoords = (flags & CACHE_HAS_TEXCOORDS) != 0;
+
+    if (reader.FindChunk(PRCHUNK_VERTEX) && reader.GetEntries() > 0)
+    {
+        vertexCount = reader.GetEntries();
+        pVertices   = new prMeshVertex[vertexCount];
+        reader.Read(pVertices, vertexCount * sizeof(prMeshVertex));
+    }
 
+    if (reader.FindChunk(PRCHUNK_INDEX) && reader.GetEntries() > 0)
+    {
+        indexCount = reader.GetEntries();
+        pIndices   = new u32[indexCount];
+        reader.Read(pIndices, indexCount * sizeof(u32));
+    }
 
-                buffer = prStringSkipWhitespace(buffer);
-                f32 y  = (f32)atof(buffer);
-                buffer = prStringSkipToWhitespace(buffer);
+    // Check the indices, as drawing trusts them.
+    bool valid = reader.IsValid() && pVertices && pIndices;
+    for (u32 i=0; valid && i<indexCount; i++)
+    {
+        valid = (pIndices[i] < vertexCount);
+    }
 
-                buffer = prStringSkipWhitespace(buffer);
-                f32 z  = (f32)atof(buffer);
+    if (!valid)
+    {
+        PRWARN("Mesh cache '%s' is invalid", filename);
+        Release();
+    }
 
-                //prTrace(LogError, "v %f, %f, %f\n", x,y,z);
+    return valid;
+}
 
-                prVertex3D v;
-                v.x = x;
-                v.y = y;
-                v.z = z;
 
-                verts.push_back(v);
-            }
-            
-            // Face data
-            if (c1 == 'f' && c2 == ' ')
-            {
-                buffer = prStringSkipWhitespace(buffer);        // Skip leading whitespace
-                s32 a  = atoi(buffer);                          // Converts
-                buffer = prStringSkipToWhitespace(buffer);      // Skip to next whitespace
+/// ---------------------------------------------------------------------------
+/// Writes the binary mesh cache.
+/// ---------------------------------------------------------------------------
+void prMesh_OBJ::SaveCache(const char *filename, u32 sourceSize, u64 sourceHash)
+{
+    prFileManager *pFM = static_cast<prFileManager *>(prCoreGetComponent(PRSYSTEM_FILEMANAGER));
+    PRASSERT(pFM);
 
+    // Archives are read only.
+    if (pFM == nullptr || pFM->ArchiveCount() > 0)
+    {
+        return;
+    }
 
-                buffer = prStringSkipWhitespace(buffer);
-                s32 b  = atoi(buffer);
-                buffer = prStringSkipToWhitespace(buffer);
+    u32 flags = 0;
+    flags |= hasNormals   ? CACHE_HAS_NORMALS   : 0;
+    flags |= hasTexCoords ? CACHE_HAS_TEXCOORDS : 0;
 
-                buffer = prStringSkipWhitespace(buffer);
-                s32 c  = atoi(buffer);
+    prChunkWriter writer(PRFILE_TYPE_MH, PRCOOKED_VERSION_MH);
 
-                //prTrace(LogError, "f %i, %i, %i\n", a, b, c);
-                prFace f;
-                f.a = a - 1;
-                f.b = b - 1;
-                f.c = c - 1;
+    writer.BeginChunk(PRCHUNK_INFO, 1);
+    writer.WriteU32(sourceSize);
+    writer.WriteU64(sourceHash);
+    writer.WriteU32(flags);
 
-                faces.push_back(f);
-            }
-        }
-    }
+    writer.BeginChunk(PRCHUNK_VERTEX, vertexCount);
+    writer.Write(pVertices, vertexCount * sizeof(prMeshVertex));
+
+    writer.BeginChunk(PRCHUNK_INDEX, indexCount);
+    writer.Write(pIndices, indexCount * sizeof(u32));
+
+    char path[FILE_MAX_FILEPATH_SIZE];
+    pFM->GetSystemPath(filename, path);
+    prStringReplaceChar(path, '\\', '/');
+
+    writer.Save(path);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Releases the mesh data.
+/// ---------------------------------------------------------------------------
+void prMesh_OBJ::Release()
+{
+    PRSAFE_DELETE_ARRAY(pVertices);
+    PRSAFE_DELETE_ARRAY(pIndices);
+
+    vertexCount  = 0;
+    indexCount   = 0;
+    hasNormals   = false;
+    hasTexCoords = false;
+    mLoaded      = false;
 }
 
 
@@ -21,21 +21,34 @@
 
 #include "prMesh.h"
 #include "../core/prTypes.h"
-#include "../core/prVertex.h"
 #include <vector>
-#include <list>
 
 
-// Tri face
-typedef struct
+// Forward declarations
+class prChunkReader;
+
+
+// Typedef: prMeshVertex
+//      An indexed mesh vertex.
+typedef struct prMeshVertex
 {
-    s32 a, b, c;
+    f32 x,  y,  z;
+    f32 nx, ny, nz;
+    f32 u,  v;
 
-} prFace;
+} prMeshVertex;
 
 
-// Method: prMeshLoader_OBJ
+// Class: prMesh_OBJ
 //      A 3D mesh loader class for wavefront obj files
+//
+// Notes:
+//      Positions, normals and texture coordinates are supported. Vertices
+//      shared by faces are merged, and the mesh is drawn indexed.
+//
+//      The loaded mesh is cached in a binary file next to the obj file (The
+//      obj filename with '.mesh' added), which later loads read instead of
+//      the obj file. The cache is rebuilt if the obj file changes size.
 class prMesh_OBJ : public prMesh
 {
 public:
@@ -53,7 +66,7 @@ public:
 
     // Method: Update
     //      Updates a 3D meshes animation if it is animated
-    void Update() {}
+    void Update(f32) {}
 
     // Method: Draw
     //      Draws a 3D mesh
@@ -61,16 +74,24 @@ public:
 
 
 private:
+    // Parses the obj file data.
+    bool Parse(const char *buffer, u32 size);
 
-    void Parse(char *buffer);
-    bool ReadLine(char *buffer, s32 &size);
-    void ParseLine(char *buffer);
-    
+    // Loads the binary mesh cache.
+    bool LoadCache(const char *filename, u32 sourceSize, u64 sourceHash);
 
-private:
+    // Writes the binary mesh cache.
+    void SaveCache(const char *filename, u32 sourceSize, u64 sourceHash);
 
-    std::vector<prVertex3D> verts;
-    std::list<prFace>       faces;
-    prVertex3D             *pVerts;
-    s32                     count;
+    // Releases the mesh data.
+    void Release();
+
+
+private:
+    prMeshVertex   *pVertices;
+    u32            *pIndices;
+    u32             vertexCount;
+    u32             indexCount;
+    bool            hasNormals;
+    bool            hasTexCoords;
 };
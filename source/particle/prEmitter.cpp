@@ -19,30 +19,70 @@
 
 #include "prEmitter.h"
 #include "prParticleShared.h"
+#include "prParticleBuffer.h"
 #include "../debug/prTrace.h"
+#include "../debug/prAssert.h"
 #include "../core/prDefines.h"
 #include "../core/prMacros.h"
+#include "../math/prMathsUtil.h"
+#include <math.h>
 
 
-//using namespace Proteus::Core;
+using namespace Proteus::Math;
+
+
+// Local data
+namespace
+{
+    // Used by effects which have no <effect> definition.
+    const prEffectDefinition defaultEffect("default");
+
+
+    // Scrambles the bits of a value. Used as a counter based random number generator.
+    u32 Hash(u32 x)
+    {
+        x ^= x >> 16;
+        x *= 0x7FEB352Du;
+        x ^= x >> 15;
+        x *= 0x846CA68Bu;
+        x ^= x >> 16;
+        return x;
+    }
+}
 
 
 /// ---------------------------------------------------------------------------
 /// Constructor
 /// ---------------------------------------------------------------------------
-prEmitter::prEmitter(s32 id, const prEmitterDefinition &ed) : mID(id)
+prEmitter::prEmitter(s32 id, const prEmitterDefinition &ed, const prVector3 &pos, prParticleChunkPool &pool, u32 seed) : mPos        (pos)
+                                                                                                                      , mEffects    (nullptr)
+                                                                                                                      , mEffectCount(ed.GetNumEffects())
+                                                                                                                      , mID         (id)
+                                                                                                                      , mSeed       (seed)
+                                                                                                                      , mAlive      (true)
 {
-    prTrace(prLogLevel::LogError, "prEmitter::prEmitter - %i\n", mID);
+    if (mEffectCount > 0)
+    {
+        mEffects = new prEmitterEffect[mEffectCount];
 
-    pEffects = nullptr;
-    mAlive   = true;
+        u32 index = 0;
+        for (auto it = ed.GetEffectsList().begin(); it != ed.GetEffectsList().end(); ++it, ++index)
+        {
+            const prEffectType &et = (*it);
+            prEmitterEffect    &effect = mEffects[index];
 
+            effect.pParticles  = new prParticleBuffer(pool);
+            effect.waitTime    = et.mWaitTime;
+            effect.runTime     = et.mRunTime;
+            effect.elapsed     = 0.0f;
+            effect.count       = (u32)PRMAX(et.mCount, 0);
+            effect.emitted     = 0;
+            effect.spawnFirst  = 0;
+            effect.spawnCount  = 0;
 
-    // s32 count = 0;//(s32)ed.mEffects.size();
-    // if (count >= 0)
-    // {
-        // //pEffects = new prEffectType[count];
-    // }
+            Attach(effect, defaultEffect);
+        }
+    }
 }
 
 
@@ -51,30 +91,213 @@ prEmitter::prEmitter(s32 id, const prEmitterDefinition &ed) : mID(id)
 /// ---------------------------------------------------------------------------
 prEmitter::~prEmitter()
 {
-    prTrace(prLogLevel::LogError, "prEmitter::~prEmitter - %i\n", mID);
+    for (u32 i = 0; i < mEffectCount; ++i)
+    {
+        PRSAFE_DELETE(mEffects[i].pParticles);
+    }
 
-    PRSAFE_DELETE(pEffects);
+    PRSAFE_DELETE_ARRAY(mEffects);
 }
 
 
-//void prEmitter::Load(const char *filename)
-//{
-//}
+/// ---------------------------------------------------------------------------
+/// Sets the particle properties of an effect.
+/// ---------------------------------------------------------------------------
+void prEmitter::SetEffect(u32 index, const prEffectDefinition &definition)
+{
+    PRASSERT(index < mEffectCount);
+    Attach(mEffects[index], definition);
+}
 
 
-bool prEmitter::Update(f32 dt)
+/// ---------------------------------------------------------------------------
+/// Reserves the particles to emit this frame.
+/// ---------------------------------------------------------------------------
+bool prEmitter::Emit(f32 dt)
 {
-    // Reduce lifetime
     if (mAlive)
     {
-        mLifetime -= dt;
-        mAlive = (mLifetime > 0);
+        bool alive = false;
+
+        for (u32 i = 0; i < mEffectCount; ++i)
+        {
+            prEmitterEffect &effect = mEffects[i];
+
+            effect.spawnCount = 0;
+
+            if (effect.emitted < effect.count)
+            {
+                if (effect.waitTime > 0.0f)
+                {
+                    effect.waitTime -= dt;
+                }
+                else
+                {
+                    // Spread the emission evenly over the run time.
+                    effect.elapsed += dt;
+
+                    u32 target = effect.count;
+                    if (effect.elapsed < effect.runTime)
+                    {
+                        target = (u32)((f32)effect.count * (effect.elapsed / effect.runTime));
+                    }
+
+                    if (target > effect.emitted)
+                    {
+                        effect.spawnCount = target - effect.emitted;
+                        effect.spawnFirst = effect.pParticles->Spawn(effect.spawnCount);
+                        effect.emitted    = target;
+                    }
+                }
+
+                alive = true;
+            }
+
+            if (effect.pParticles->GetCount() > 0)
+            {
+                alive = true;
+            }
+        }
+
+        mAlive = alive;
     }
 
     return mAlive;
 }
 
 
-//void prEmitter::Draw()
-//{
-//}
+/// ---------------------------------------------------------------------------
+/// Fills the particles reserved by Emit in one chunk of an effect.
+/// ---------------------------------------------------------------------------
+void prEmitter::Fill(u32 index, u32 chunk) const
+{
+    PRASSERT(index < mEffectCount);
+
+    const prEmitterEffect    &effect = mEffects[index];
+    const prEffectDefinition &def    = *effect.pDefinition;
+
+    // The reserved particles which fall in this chunk.
+    u32 begin = PRMAX(effect.spawnFirst, chunk << PRPARTICLE_CHUNK_SHIFT);
+    u32 end   = PRMIN(effect.spawnFirst + effect.spawnCount, (chunk + 1) << PRPARTICLE_CHUNK_SHIFT);
+
+    // Sequence numbers continue across frames.
+    u32 sequence = effect.emitted - effect.spawnCount - effect.spawnFirst;
+
+    f32 lifeRange  = def.mLifeMax  - def.mLifeMin;
+    f32 speedRange = def.mSpeedMax - def.mSpeedMin;
+
+    for (u32 i = begin; i < end; ++i)
+    {
+        // Directions are picked uniformly from the cone.
+        f32 cosTheta = 1.0f - Random(index, sequence + i, 0) * (1.0f - effect.cosSpread);
+        f32 sinTheta = sqrtf(PRMAX(0.0f, 1.0f - cosTheta * cosTheta));
+        f32 phi      = Random(index, sequence + i, 1) * TwoPi;
+
+        prVector3 velocity = def.mDirection * cosTheta + effect.axisU * (cosf(phi) * sinTheta) + effect.axisW * (sinf(phi) * sinTheta);
+        velocity *= def.mSpeedMin + speedRange * Random(index, sequence + i, 2);
+
+        f32 life = PRMAX(def.mLifeMin + lifeRange * Random(index, sequence + i, 3), 0.001f);
+
+        effect.pParticles->Set(i, mPos, velocity, life);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Returns the acceleration applied to an effects particles.
+/// ---------------------------------------------------------------------------
+const prVector3 &prEmitter::GetGravity(u32 index) const
+{
+    PRASSERT(index < mEffectCount);
+    return mEffects[index].pDefinition->mGravity;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Moves, kills and emits the emitters particles on the calling thread.
+/// ---------------------------------------------------------------------------
+bool prEmitter::Update(f32 dt)
+{
+    // Move the existing particles first, so new particles start at the emitter.
+    for (u32 i = 0; i < mEffectCount; ++i)
+    {
+        mEffects[i].pParticles->Update(dt, GetGravity(i));
+    }
+
+    bool alive = Emit(dt);
+
+    for (u32 i = 0; i < mEffectCount; ++i)
+    {
+        const prEmitterEffect &effect = mEffects[i];
+
+        if (effect.spawnCount > 0)
+        {
+            u32 first = effect.spawnFirst >> PRPARTICLE_CHUNK_SHIFT;
+            u32 last  = (effect.spawnFirst + effect.spawnCount - 1) >> PRPARTICLE_CHUNK_SHIFT;
+
+            for (u32 chunk = first; chunk <= last; ++chunk)
+            {
+                Fill(i, chunk);
+            }
+        }
+    }
+
+    return alive;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Returns the number of live particles.
+/// ---------------------------------------------------------------------------
+u32 prEmitter::GetParticleCount() const
+{
+    u32 count = 0;
+
+    for (u32 i = 0; i < mEffectCount; ++i)
+    {
+        count += mEffects[i].pParticles->GetCount();
+    }
+
+    return count;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Returns an effects particles.
+/// ---------------------------------------------------------------------------
+const prParticleBuffer *prEmitter::GetParticles(u32 index) const
+{
+    PRASSERT(index < mEffectCount);
+    return mEffects[index].pParticles;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Sets an effects definition and firing basis.
+/// ---------------------------------------------------------------------------
+void prEmitter::Attach(prEmitterEffect &effect, const prEffectDefinition &definition)
+{
+    const prVector3 &dir = definition.mDirection;
+
+    prVector3 axis(1.0f, 0.0f, 0.0f);
+    if (fabsf(dir.x) > 0.9f)
+    {
+        axis = prVector3(0.0f, 1.0f, 0.0f);
+    }
+
+    effect.pDefinition = &definition;
+    effect.axisU       = axis.CrossProduct(dir);
+    effect.axisU.Normalize();
+    effect.axisW       = dir.CrossProduct(effect.axisU);
+    effect.cosSpread   = cosf(PRDEG2RAD(PRMIN(PRMAX(definition.mSpread, 0.0f), 180.0f)));
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Returns a random number between 0 and 1 for a particle.
+/// ---------------------------------------------------------------------------
+f32 prEmitter::Random(u32 effect, u32 sequence, u32 component) const
+{
+    u32 x = Hash(mSeed ^ Hash((sequence << 2) + component + effect * 0x9E3779B9u));
+    return (f32)(x >> 8) * (1.0f / 16777216.0f);
+}
@@ -21,16 +21,47 @@
 
 #include "../core/prTypes.h"
 #include "../math/prVector3.h"
-#include "../display/prColour.h"
 
 
 // Forward declarations
 struct prEffectType;
+struct prEffectDefinition;
 struct prEmitterDefinition;
+class prParticleBuffer;
+class prParticleChunkPool;
+
+
+// Struct: prEmitterEffect
+//      The run time state of one of an emitters effects
+typedef struct prEmitterEffect
+{
+    const prEffectDefinition   *pDefinition;    // Particle properties
+    prParticleBuffer           *pParticles;     // The live particles
+    f32                         waitTime;       // Time left before emission starts
+    f32                         runTime;        // Time taken to emit all the particles
+    f32                         elapsed;        // Time spent emitting
+    u32                         count;          // Total particles to emit
+    u32                         emitted;        // Particles emitted so far
+    u32                         spawnFirst;     // Particles reserved by the last <prEmitter::Emit>, waiting to be filled
+    u32                         spawnCount;
+    Proteus::Math::prVector3    axisU;          // Basis around the firing direction
+    Proteus::Math::prVector3    axisW;
+    f32                         cosSpread;      // Cosine of the spread angle
+
+} prEmitterEffect;
 
 
 // Class: prEmitter
-//      Class represents a particle emission point - W.I.P Work in progress
+//      Class represents a particle emission point
+//
+// Notes:
+//      Each effect emits its particles evenly over its run time, after
+//      waiting for its wait time. The emitter stays alive until all its
+//      effects have finished emitting and all their particles have died.
+//
+//      Each particles random values are derived from the seed the manager
+//      supplies and the particles sequence number, so a seeded run is
+//      repeatable however the work is split between threads.
 class prEmitter
 {
 private:
@@ -39,27 +70,80 @@ private:
 
     // Method: prEmitter 
     //      Ctor
-    prEmitter(s32 id, const prEmitterDefinition &ed);
+    //
+    // Parameters:
+    //      id   - The emitters unique ID
+    //      ed   - The emitters definition
+    //      pos  - The emitters position
+    //      pool - The pool to take particle storage from
+    //      seed - The random seed
+    prEmitter(s32 id, const prEmitterDefinition &ed, const Proteus::Math::prVector3 &pos, prParticleChunkPool &pool, u32 seed);
 
     // Method: prEmitter 
     //      Dtor
     ~prEmitter();
 
-//    void Load(const char *filename);
+    // Method: SetEffect
+    //      Sets the particle properties of an effect.
+    //
+    // Parameters:
+    //      index      - The index of the effect in the emitters definition
+    //      definition - The particle properties
+    void SetEffect(u32 index, const prEffectDefinition &definition);
 
     // Method: GetID
     //      Get the emitters unique ID.
     s32 GetID() const { return mID; }
 
+    // Method: Emit
+    //      Reserves the particles to emit this frame.
+    //
+    // Returns:
+    //      false when the emitter has finished
+    //
+    // Notes:
+    //      The reserved particles must be filled with <Fill> before the
+    //      effects are next simulated.
+    bool Emit(f32 dt);
+
+    // Method: Fill
+    //      Fills the particles reserved by <Emit> in one chunk of an effect.
+    //
+    // Notes:
+    //      Different chunks may be filled concurrently.
+    void Fill(u32 effect, u32 chunk) const;
+
+    // Method: GetBuffer
+    //      Returns an effects particles.
+    prParticleBuffer *GetBuffer(u32 index) { return mEffects[index].pParticles; }
+
+    // Method: GetGravity
+    //      Returns the acceleration applied to an effects particles.
+    const Proteus::Math::prVector3 &GetGravity(u32 index) const;
+
 
 public:
+    // Method: Update
+    //      Moves, kills and emits the emitters particles on the calling thread.
+    //
+    // Returns:
+    //      false when the emitter has finished
     bool Update(f32 dt);
-    //void Draw();
 
+    // Method: GetParticleCount
+    //      Returns the number of live particles.
+    u32 GetParticleCount() const;
 
-    Proteus::Math::prVector3   mPos;           // Position of the emitter
+    // Method: GetEffectCount
+    //      Returns the number of effects.
+    u32 GetEffectCount() const { return mEffectCount; }
 
-    //std::list<> mParticles;
+    // Method: GetParticles
+    //      Returns an effects particles.
+    const prParticleBuffer *GetParticles(u32 index) const;
+
+
+    Proteus::Math::prVector3   mPos;           // Position of the emitter
 
 
 private:
@@ -67,10 +151,17 @@ private:
     prEmitter(const prEmitter&);
     const prEmitter& operator = (const prEmitter&);
 
-    prEffectType   *pEffects;
+    // Sets an effects definition and firing basis.
+    void Attach(prEmitterEffect &effect, const prEffectDefinition &definition);
+
+    // Returns a random number between 0 and 1 for a particle.
+    f32 Random(u32 effect, u32 sequence, u32 component) const;
+
+    prEmitterEffect    *mEffects;
+    u32                 mEffectCount;
 
-    s32             mID;                // Unique ID
-    f32             mLifetime;          // Lifetime of this emitter as a whole
+    s32                 mID;                // Unique ID
+    u32                 mSeed;              // Random seed
 
-    bool            mAlive;             //
+    bool                mAlive;             //
 };
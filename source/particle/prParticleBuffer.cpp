@@ -0,0 +1,451 @@
+/**
+ * prParticleBuffer.cpp
+ *
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "prParticleBuffer.h"
+#include "../core/prMacros.h"
+#include "../debug/prAssert.h"
+#include <string.h>
+
+
+// SSE is available on all x86 targets we build for. Other targets use the
+// scalar kernels, which are written so the compiler can vectorise them.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #include <emmintrin.h>
+    #define PARTICLE_SSE
+#endif
+
+
+using namespace Proteus::Math;
+
+
+// Local functions
+namespace
+{
+    // Integrates a run of particles. v += a * dt, p += v * dt
+    void Integrate(f32 *px, f32 *py, f32 *pz, f32 *vx, f32 *vy, f32 *vz, u32 count, f32 ax, f32 ay, f32 az, f32 dt)
+    {
+        u32 i = 0;
+
+    #if defined(PARTICLE_SSE)
+        const __m128 ddx = _mm_set1_ps(ax * dt);
+        const __m128 ddy = _mm_set1_ps(ay * dt);
+        const __m128 ddz = _mm_set1_ps(az * dt);
+        const __m128 d   = _mm_set1_ps(dt);
+
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 x = _mm_add_ps(_mm_loadu_ps(vx + i), ddx);
+            __m128 y = _mm_add_ps(_mm_loadu_ps(vy + i), ddy);
+            __m128 z = _mm_add_ps(_mm_loadu_ps(vz + i), ddz);
+
+            _mm_storeu_ps(vx + i, x);
+            _mm_storeu_ps(vy + i, y);
+            _mm_storeu_ps(vz + i, z);
+
+            _mm_storeu_ps(px + i, _mm_add_ps(_mm_loadu_ps(px + i), _mm_mul_ps(x, d)));
+            _mm_storeu_ps(py + i, _mm_add_ps(_mm_loadu_ps(py + i), _mm_mul_ps(y, d)));
+            _mm_storeu_ps(pz + i, _mm_add_ps(_mm_loadu_ps(pz + i), _mm_mul_ps(z, d)));
+        }
+    #endif
+
+        const f32 adx = ax * dt;
+        const f32 ady = ay * dt;
+        const f32 adz = az * dt;
+
+        for (; i < count; ++i)
+        {
+            vx[i] += adx;
+            vy[i] += ady;
+            vz[i] += adz;
+            px[i] += vx[i] * dt;
+            py[i] += vy[i] * dt;
+            pz[i] += vz[i] * dt;
+        }
+    }
+
+
+    // Ages a run of particles.
+    void Age(f32 *life, u32 count, f32 dt)
+    {
+        u32 i = 0;
+
+    #if defined(PARTICLE_SSE)
+        const __m128 d = _mm_set1_ps(dt);
+
+        for (; i + 4 <= count; i += 4)
+        {
+            _mm_storeu_ps(life + i, _mm_sub_ps(_mm_loadu_ps(life + i), d));
+        }
+    #endif
+
+        for (; i < count; ++i)
+        {
+            life[i] -= dt;
+        }
+    }
+
+
+    // Returns true if any of four particles are dead.
+    bool AnyDead(const f32 *life)
+    {
+    #if defined(PARTICLE_SSE)
+        return _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(life), _mm_setzero_ps())) != 0;
+    #else
+        return (life[0] <= 0.0f) | (life[1] <= 0.0f) | (life[2] <= 0.0f) | (life[3] <= 0.0f);
+    #endif
+    }
+
+
+    // Removes the dead particles from a chunk. Returns the remaining count.
+    u32 Kill(prParticleChunk *pChunk, u32 count)
+    {
+        u32 i = 0;
+
+        while (i < count)
+        {
+            // Skip four live particles at a time.
+            if ((i & 3) == 0 && i + 4 <= count && !AnyDead(pChunk->life + i))
+            {
+                i += 4;
+                continue;
+            }
+
+            if (pChunk->life[i] <= 0.0f)
+            {
+                // Swap remove. The moved particle is tested next.
+                u32 last = --count;
+                if (i != last)
+                {
+                    pChunk->px[i]      = pChunk->px[last];
+                    pChunk->py[i]      = pChunk->py[last];
+                    pChunk->pz[i]      = pChunk->pz[last];
+                    pChunk->vx[i]      = pChunk->vx[last];
+                    pChunk->vy[i]      = pChunk->vy[last];
+                    pChunk->vz[i]      = pChunk->vz[last];
+                    pChunk->life[i]    = pChunk->life[last];
+                    pChunk->invSpan[i] = pChunk->invSpan[last];
+                }
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        return count;
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Constructor.
+/// ---------------------------------------------------------------------------
+prParticleChunkPool::prParticleChunkPool() : m_pFree     (nullptr)
+                                           , m_allocated (0)
+                                           , m_free      (0)
+{
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Destructor.
+/// ---------------------------------------------------------------------------
+prParticleChunkPool::~prParticleChunkPool()
+{
+    PRASSERT(m_free == m_allocated, "%i particle chunks have not been released", m_allocated - m_free);
+
+    while (m_pFree)
+    {
+        prParticleChunk *pChunk = m_pFree;
+        m_pFree = m_pFree->pNext;
+        delete pChunk;
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Acquires a chunk.
+/// ---------------------------------------------------------------------------
+prParticleChunk *prParticleChunkPool::Acquire()
+{
+    prParticleChunk *pChunk = m_pFree;
+
+    if (pChunk)
+    {
+        m_pFree = pChunk->pNext;
+        m_free--;
+    }
+    else
+    {
+        pChunk = new prParticleChunk;
+        m_allocated++;
+    }
+
+    pChunk->pNext = nullptr;
+    return pChunk;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Returns a chunk to the pool.
+/// ---------------------------------------------------------------------------
+void prParticleChunkPool::Release(prParticleChunk *pChunk)
+{
+    PRASSERT(pChunk);
+
+    pChunk->pNext = m_pFree;
+    m_pFree       = pChunk;
+    m_free++;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Constructor.
+/// ---------------------------------------------------------------------------
+prParticleBuffer::prParticleBuffer(prParticleChunkPool &pool) : m_pool          (pool)
+                                                              , m_chunks        (nullptr)
+                                                              , m_counts        (nullptr)
+                                                              , m_chunkCount    (0)
+                                                              , m_chunkCapacity (0)
+                                                              , m_count         (0)
+{
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Destructor.
+/// ---------------------------------------------------------------------------
+prParticleBuffer::~prParticleBuffer()
+{
+    Clear();
+    PRSAFE_DELETE_ARRAY(m_chunks);
+    PRSAFE_DELETE_ARRAY(m_counts);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Adds particles to the end of the buffer.
+/// ---------------------------------------------------------------------------
+u32 prParticleBuffer::Spawn(u32 count)
+{
+    u32 first  = m_count;
+    u32 needed = (m_count + count + PRPARTICLE_CHUNK_MASK) >> PRPARTICLE_CHUNK_SHIFT;
+
+    // Grow the chunk table.
+    if (needed > m_chunkCapacity)
+    {
+        u32 capacity = PRMAX(needed, m_chunkCapacity << 1);
+
+        prParticleChunk **chunks = new prParticleChunk *[capacity];
+        u32              *counts = new u32 [capacity];
+        for (u32 i = 0; i < m_chunkCount; ++i)
+        {
+            chunks[i] = m_chunks[i];
+            counts[i] = m_counts[i];
+        }
+
+        PRSAFE_DELETE_ARRAY(m_chunks);
+        PRSAFE_DELETE_ARRAY(m_counts);
+        m_chunks        = chunks;
+        m_counts        = counts;
+        m_chunkCapacity = capacity;
+    }
+
+    while (m_chunkCount < needed)
+    {
+        m_counts[m_chunkCount]   = 0;
+        m_chunks[m_chunkCount++] = m_pool.Acquire();
+    }
+
+    // Fill the last partial chunk, then the new ones.
+    m_count += count;
+
+    for (u32 i = first >> PRPARTICLE_CHUNK_SHIFT; i < m_chunkCount; ++i)
+    {
+        m_counts[i] = PRMIN(m_count - (i << PRPARTICLE_CHUNK_SHIFT), (u32)PRPARTICLE_CHUNK_SIZE);
+    }
+
+    return first;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Sets a particle.
+/// ---------------------------------------------------------------------------
+void prParticleBuffer::Set(u32 index, const prVector3 &position, const prVector3 &velocity, f32 life)
+{
+    PRASSERT(index < m_count);
+    PRASSERT(life > 0.0f);
+
+    prParticleChunk *pChunk = m_chunks[index >> PRPARTICLE_CHUNK_SHIFT];
+    u32              slot   = index & PRPARTICLE_CHUNK_MASK;
+
+    pChunk->px[slot]      = position.x;
+    pChunk->py[slot]      = position.y;
+    pChunk->pz[slot]      = position.z;
+    pChunk->vx[slot]      = velocity.x;
+    pChunk->vy[slot]      = velocity.y;
+    pChunk->vz[slot]      = velocity.z;
+    pChunk->life[slot]    = life;
+    pChunk->invSpan[slot] = 1.0f / life;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Integrates, ages and kills the particles.
+/// ---------------------------------------------------------------------------
+void prParticleBuffer::Update(f32 dt, const prVector3 &acceleration)
+{
+    for (u32 i = 0; i < m_chunkCount; ++i)
+    {
+        Simulate(i, dt, acceleration);
+    }
+
+    Compact();
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Integrates, ages and kills the particles in one chunk.
+/// ---------------------------------------------------------------------------
+void prParticleBuffer::Simulate(u32 chunk, f32 dt, const prVector3 &acceleration)
+{
+    PRASSERT(chunk < m_chunkCount);
+
+    prParticleChunk *pChunk = m_chunks[chunk];
+    u32              count  = m_counts[chunk];
+
+    Integrate(pChunk->px, pChunk->py, pChunk->pz, pChunk->vx, pChunk->vy, pChunk->vz, count, acceleration.x, acceleration.y, acceleration.z, dt);
+    Age(pChunk->life, count, dt);
+
+    m_counts[chunk] = Kill(pChunk, count);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Fills the gaps left by Simulate and releases empty chunks.
+/// ---------------------------------------------------------------------------
+void prParticleBuffer::Compact()
+{
+    if (m_chunkCount == 0)
+    {
+        return;
+    }
+
+    // Move particles from the last chunks into the gaps in the first.
+    u32 lo = 0;
+    u32 hi = m_chunkCount - 1;
+
+    while (lo < hi)
+    {
+        if (m_counts[lo] == PRPARTICLE_CHUNK_SIZE)
+        {
+            ++lo;
+        }
+        else if (m_counts[hi] == 0)
+        {
+            --hi;
+        }
+        else
+        {
+            u32 count = PRMIN(PRPARTICLE_CHUNK_SIZE - m_counts[lo], m_counts[hi]);
+
+            m_counts[hi] -= count;
+            Move(m_chunks[hi], m_counts[hi], m_chunks[lo], m_counts[lo], count);
+            m_counts[lo] += count;
+        }
+    }
+
+    // Return the unused chunks.
+    while (m_chunkCount > 0 && m_counts[m_chunkCount - 1] == 0)
+    {
+        m_pool.Release(m_chunks[--m_chunkCount]);
+    }
+
+    m_count = 0;
+    if (m_chunkCount > 0)
+    {
+        m_count = ((m_chunkCount - 1) << PRPARTICLE_CHUNK_SHIFT) + m_counts[m_chunkCount - 1];
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Writes the particles in one chunk as vertices.
+/// ---------------------------------------------------------------------------
+void prParticleBuffer::WriteVertices(u32 chunk, prParticleVertex *pDst) const
+{
+    PRASSERT(chunk < m_chunkCount);
+    PRASSERT(pDst);
+
+    const prParticleChunk *pChunk = m_chunks[chunk];
+    u32                    count  = m_counts[chunk];
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        pDst[i].x   = pChunk->px[i];
+        pDst[i].y   = pChunk->py[i];
+        pDst[i].z   = pChunk->pz[i];
+        pDst[i].age = 1.0f - pChunk->life[i] * pChunk->invSpan[i];
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Removes all particles.
+/// ---------------------------------------------------------------------------
+void prParticleBuffer::Clear()
+{
+    for (u32 i = 0; i < m_chunkCount; ++i)
+    {
+        m_pool.Release(m_chunks[i]);
+    }
+
+    m_chunkCount = 0;
+    m_count      = 0;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Returns the number of particles in a chunk.
+/// ---------------------------------------------------------------------------
+u32 prParticleBuffer::GetChunkParticles(u32 index) const
+{
+    PRASSERT(index < m_chunkCount);
+
+    return m_counts[index];
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Copies particles between chunks.
+/// ---------------------------------------------------------------------------
+void prParticleBuffer::Move(const prParticleChunk *pSrc, u32 srcSlot, prParticleChunk *pDst, u32 dstSlot, u32 count)
+{
+    u32 size = count * sizeof(f32);
+
+    memcpy(pDst->px      + dstSlot, pSrc->px      + srcSlot, size);
+    memcpy(pDst->py      + dstSlot, pSrc->py      + srcSlot, size);
+    memcpy(pDst->pz      + dstSlot, pSrc->pz      + srcSlot, size);
+    memcpy(pDst->vx      + dstSlot, pSrc->vx      + srcSlot, size);
+    memcpy(pDst->vy      + dstSlot, pSrc->vy      + srcSlot, size);
+    memcpy(pDst->vz      + dstSlot, pSrc->vz      + srcSlot, size);
+    memcpy(pDst->life    + dstSlot, pSrc->life    + srcSlot, size);
+    memcpy(pDst->invSpan + dstSlot, pSrc->invSpan + srcSlot, size);
+}
@@ -0,0 +1,237 @@
+// File: prParticleBuffer.h
+//      Structure of arrays particle storage.
+//
+// Notes:
+//      Particles are stored in fixed size chunks, with one array per
+//      component, so the update kernels stream through memory and can
+//      process four particles per instruction. Chunks come from a shared
+//      <prParticleChunkPool>, so buffers grow and shrink without touching
+//      the heap once the pool has warmed up.
+/**
+ * Copyright 2014 Paul Michael McNab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+
+#include "../core/prTypes.h"
+#include "../math/prVector3.h"
+
+
+// Defines
+#define PRPARTICLE_CHUNK_SHIFT      9
+#define PRPARTICLE_CHUNK_SIZE       (1 << PRPARTICLE_CHUNK_SHIFT)       // Particles per chunk. Must be a multiple of 4.
+#define PRPARTICLE_CHUNK_MASK       (PRPARTICLE_CHUNK_SIZE - 1)
+
+
+// Struct: prParticleChunk
+//      A chunk of particles stored as structure of arrays.
+typedef struct prParticleChunk
+{
+    f32                         px[PRPARTICLE_CHUNK_SIZE];          // Position
+    f32                         py[PRPARTICLE_CHUNK_SIZE];
+    f32                         pz[PRPARTICLE_CHUNK_SIZE];
+    f32                         vx[PRPARTICLE_CHUNK_SIZE];          // Velocity
+    f32                         vy[PRPARTICLE_CHUNK_SIZE];
+    f32                         vz[PRPARTICLE_CHUNK_SIZE];
+    f32                         life[PRPARTICLE_CHUNK_SIZE];        // Remaining life in seconds
+    f32                         invSpan[PRPARTICLE_CHUNK_SIZE];     // One over the initial life. Used to normalise the age
+    struct prParticleChunk     *pNext;                              // Pool link
+
+} prParticleChunk;
+
+
+// Struct: prParticleVertex
+//      A particle as seen by the renderer.
+typedef struct prParticleVertex
+{
+    f32 x, y, z;
+    f32 age;                                                        // Zero when emitted, one at death
+
+} prParticleVertex;
+
+
+// Class: prParticleChunkPool
+//      Recycles particle chunks.
+//
+// Notes:
+//      Not thread safe.
+class prParticleChunkPool
+{
+public:
+    // Method: prParticleChunkPool
+    //      Constructor.
+    prParticleChunkPool();
+
+    // Method: ~prParticleChunkPool
+    //      Destructor.
+    //
+    // Notes:
+    //      All chunks must have been released.
+    ~prParticleChunkPool();
+
+    // Method: Acquire
+    //      Acquires a chunk, allocating one if the pool is empty.
+    prParticleChunk *Acquire();
+
+    // Method: Release
+    //      Returns a chunk to the pool.
+    void Release(prParticleChunk *pChunk);
+
+    // Method: GetAllocated
+    //      Returns the number of chunks allocated.
+    u32 GetAllocated() const { return m_allocated; }
+
+    // Method: GetFree
+    //      Returns the number of chunks in the pool.
+    u32 GetFree() const { return m_free; }
+
+
+private:
+    // Stop passing by value and assignment.
+    prParticleChunkPool(const prParticleChunkPool&);
+    const prParticleChunkPool& operator = (const prParticleChunkPool&);
+
+
+private:
+    prParticleChunk    *m_pFree;
+    u32                 m_allocated;
+    u32                 m_free;
+};
+
+
+// Class: prParticleBuffer
+//      A set of particles which share the same acceleration.
+//
+// Notes:
+//      Particles are kept densely packed. Dead particles are removed by
+//      moving the last particle into their slot, so particle order is
+//      not preserved.
+//
+//      <Update> can be split across threads by calling <Simulate> for
+//      each chunk concurrently, followed by <Compact> on one thread.
+class prParticleBuffer
+{
+public:
+    // Method: prParticleBuffer
+    //      Constructor.
+    //
+    // Parameters:
+    //      pool - The pool to take chunks from
+    explicit prParticleBuffer(prParticleChunkPool &pool);
+
+    // Method: ~prParticleBuffer
+    //      Destructor.
+    ~prParticleBuffer();
+
+    // Method: Spawn
+    //      Adds particles to the end of the buffer.
+    //
+    // Parameters:
+    //      count - The number of particles
+    //
+    // Returns:
+    //      The index of the first new particle. The new particles must be set with <Set>
+    u32 Spawn(u32 count);
+
+    // Method: Set
+    //      Sets a particle.
+    //
+    // Parameters:
+    //      index    - The particle index
+    //      position - The position
+    //      velocity - The velocity
+    //      life     - The life in seconds. Must be greater than zero
+    void Set(u32 index, const Proteus::Math::prVector3 &position, const Proteus::Math::prVector3 &velocity, f32 life);
+
+    // Method: Update
+    //      Integrates, ages and kills the particles.
+    //
+    // Parameters:
+    //      dt           - Delta time
+    //      acceleration - Acceleration applied to all particles
+    void Update(f32 dt, const Proteus::Math::prVector3 &acceleration);
+
+    // Method: Simulate
+    //      Integrates, ages and kills the particles in one chunk.
+    //
+    // Parameters:
+    //      chunk        - The chunk index
+    //      dt           - Delta time
+    //      acceleration - Acceleration applied to all particles
+    //
+    // Notes:
+    //      Different chunks may be simulated concurrently. Dead particles
+    //      are only removed within the chunk, so <Compact> must be called
+    //      before the buffer is used again.
+    void Simulate(u32 chunk, f32 dt, const Proteus::Math::prVector3 &acceleration);
+
+    // Method: Compact
+    //      Fills the gaps left by <Simulate> and releases empty chunks.
+    void Compact();
+
+    // Method: WriteVertices
+    //      Writes the particles in one chunk as vertices.
+    //
+    // Parameters:
+    //      chunk - The chunk index
+    //      pDst  - Receives <GetChunkParticles> vertices
+    //
+    // Notes:
+    //      Different chunks may be written concurrently.
+    void WriteVertices(u32 chunk, prParticleVertex *pDst) const;
+
+    // Method: Clear
+    //      Removes all particles.
+    void Clear();
+
+    // Method: GetCount
+    //      Returns the number of live particles.
+    u32 GetCount() const { return m_count; }
+
+    // Method: GetChunkCount
+    //      Returns the number of chunks in use.
+    u32 GetChunkCount() const { return m_chunkCount; }
+
+    // Method: GetChunk
+    //      Returns a chunk.
+    //
+    // Notes:
+    //      Every chunk except the last is full. See <GetChunkParticles>
+    const prParticleChunk *GetChunk(u32 index) const { return m_chunks[index]; }
+
+    // Method: GetChunkParticles
+    //      Returns the number of particles in a chunk.
+    u32 GetChunkParticles(u32 index) const;
+
+
+private:
+    // Copies particles between chunks.
+    static void Move(const prParticleChunk *pSrc, u32 srcSlot, prParticleChunk *pDst, u32 dstSlot, u32 count);
+
+    // Stop passing by value and assignment.
+    prParticleBuffer(const prParticleBuffer&);
+    const prParticleBuffer& operator = (const prParticleBuffer&);
+
+
+private:
+    prParticleChunkPool    &m_pool;
+    prParticleChunk       **m_chunks;
+    u32                    *m_counts;                   // Particles per chunk
+    u32                     m_chunkCount;
+    u32                     m_chunkCapacity;
+    u32                     m_count;
+};
@@ -25,10 +25,18 @@
 #include "../core/prStringUtil.h"
 #include "../core/prMacros.h"
 #include "../tinyxml/tinyxml.h"
+#include "../file/prAssetCooker.h"
+#include "../file/prChunkFile.h"
+#include "../file/prFileShared.h"
 #include "../core/prString.h"
+#include "../core/prClock.h"
+#include "../math/prVector3.h"
+#include "../thread/prJobSystem.h"
+#include "../core/prCore.h"
 
 
 //using namespace Proteus::Core;
+using namespace Proteus::Math;
 
 
 // Types
@@ -36,15 +44,152 @@
 typedef std::map<std::string, prEmitterDefinition*>::iterator   prEmitterDefinitionIt;
 
 
+// Local functions
+namespace
+{
+    // Reads an optional float attribute.
+    f32 FloatAttribute(TiXmlElement* pElement, const char *name, f32 defaultValue)
+    {
+        const char *pValue = pElement->Attribute(name);
+        return pValue ? (f32)atof(pValue) : defaultValue;
+    }
+
+
+    // Creates an emitter definition from its element.
+    prEmitterDefinition *ParseEmitter(TiXmlElement* pElement)
+    {
+        // Sanity checks
+        const char *pEmitterName = pElement->Attribute("name");
+        PRASSERT(pEmitterName && *pEmitterName);
+
+        
+        // Create the emitters definition
+        prEmitterDefinition *ed = new prEmitterDefinition(pEmitterName);        
+
+
+        // Acquire the effect data.
+        TiXmlHandle   root(pElement);
+        TiXmlElement *pElem  = root.FirstChild("effectType").Element();
+        for (; pElem; pElem = pElem->NextSiblingElement())
+        {
+            const char *pName     = pElem->Attribute("name");               // Name of the effect
+            const char *pCount    = pElem->Attribute("count");              // How many particles to emit
+            const char *pWaitTime = pElem->Attribute("waitTime");           // How long before we kick off the effect
+            const char *pRuntime  = pElem->Attribute("runTime");            // How long to take to run the effect
+
+            PRASSERT(pName);
+            PRASSERT(pCount);
+            PRASSERT(pWaitTime);
+            PRASSERT(pRuntime);
+
+            prEffectType et;
+            et.mHash     = prStringHash64(pName);
+            et.mCount    = atoi(pCount);
+            et.mWaitTime = (f32)atof(pWaitTime);
+            et.mRunTime  = (f32)atof(pRuntime);
+
+            ed->GetEffectsList().push_back(et);
+        }
+
+        return ed;
+    }
+
+
+    // Creates an effect definition from its element. Unset values keep their defaults.
+    prEffectDefinition *ParseEffect(TiXmlElement* pElement)
+    {
+        const char *pEffectName = pElement->Attribute("name");
+        PRASSERT(pEffectName && *pEffectName);
+
+        prEffectDefinition *pEffect = new prEffectDefinition(pEffectName);
+
+        pEffect->mLifeMin   = FloatAttribute(pElement, "lifeMin",  pEffect->mLifeMin);
+        pEffect->mLifeMax   = FloatAttribute(pElement, "lifeMax",  pEffect->mLifeMax);
+        pEffect->mSpeedMin  = FloatAttribute(pElement, "speedMin", pEffect->mSpeedMin);
+        pEffect->mSpeedMax  = FloatAttribute(pElement, "speedMax", pEffect->mSpeedMax);
+        pEffect->mSpread    = FloatAttribute(pElement, "spread",   pEffect->mSpread);
+        pEffect->mDirection = prVector3(FloatAttribute(pElement, "dirX", pEffect->mDirection.x),
+                                        FloatAttribute(pElement, "dirY", pEffect->mDirection.y),
+                                        FloatAttribute(pElement, "dirZ", pEffect->mDirection.z));
+        pEffect->mGravity   = prVector3(FloatAttribute(pElement, "gravityX", pEffect->mGravity.x),
+                                        FloatAttribute(pElement, "gravityY", pEffect->mGravity.y),
+                                        FloatAttribute(pElement, "gravityZ", pEffect->mGravity.z));
+
+        return pEffect;
+    }
+}
+
+
 // Used to give an emitter an ID.
 s32 prParticleManager::sEmitterID = 0;
 
 
+// Defines
+#define PARTICLE_JOB_GRAIN      4                                       // Chunks per job
+
+
+// Moves, ages and kills the particles in a range of chunks.
+struct prParticleManager::SimulateRange : public prJobRange
+{
+    SimulateRange(const prParticleJob *pJobs, f32 dt) : pJobs(pJobs), dt(dt)
+    {
+    }
+
+    void Run(u32 begin, u32 end) override
+    {
+        for (u32 i = begin; i < end; ++i)
+        {
+            const prParticleJob &job = pJobs[i];
+            job.pEmitter->GetBuffer(job.effect)->Simulate(job.chunk, dt, job.pEmitter->GetGravity(job.effect));
+        }
+    }
+
+    const prParticleJob    *pJobs;
+    f32                     dt;
+};
+
+
+// Fills the new particles in a range of chunks and writes their vertices.
+struct prParticleManager::OutputRange : public prJobRange
+{
+    OutputRange(const prParticleJob *pJobs, prParticleVertex *pVertices) : pJobs(pJobs), pVertices(pVertices)
+    {
+    }
+
+    void Run(u32 begin, u32 end) override
+    {
+        for (u32 i = begin; i < end; ++i)
+        {
+            const prParticleJob &job = pJobs[i];
+            job.pEmitter->Fill(job.effect, job.chunk);
+            job.pEmitter->GetBuffer(job.effect)->WriteVertices(job.chunk, pVertices + job.vertex);
+        }
+    }
+
+    const prParticleJob    *pJobs;
+    prParticleVertex       *pVertices;
+};
+
+
 /// ---------------------------------------------------------------------------
 /// Constructor
 /// ---------------------------------------------------------------------------
-prParticleManager::prParticleManager()
+prParticleManager::prParticleManager(prJobSystem *pJobs)
 {
+    if (pJobs == nullptr && prCoreExist() && prCoreComponentExist(PRSYSTEM_JOBSYSTEM))
+    {
+        pJobs = static_cast<prJobSystem *>(prCoreGetComponent(PRSYSTEM_JOBSYSTEM));
+    }
+
+    mJobSystem       = pJobs;
+    mJobs            = nullptr;
+    mJobCount        = 0;
+    mJobCapacity     = 0;
+    mVertices        = nullptr;
+    mVertexCount     = 0;
+    mVertexCapacity  = 0;
+    mSeed            = 0;
+    mFired           = 0;
     mCorrectFileType = false;
 }
 
@@ -55,6 +200,9 @@ prParticleManager::prParticleManager()
 prParticleManager::~prParticleManager()
 {
     Clear();
+
+    PRSAFE_DELETE_ARRAY(mJobs);
+    PRSAFE_DELETE_ARRAY(mVertices);
 }
 
 
@@ -68,6 +216,21 @@ bool prParticleManager::Load(const char *filename)
     // Set wrong file type.
     mCorrectFileType = false;
 
+    // Cooked files are read directly.
+    prChunkReader reader;
+    if (reader.Load(filename, PRFILE_TYPE_PT, PRCOOKED_VERSION_PT))
+    {
+        LoadCooked(reader);
+
+        if (!reader.IsValid())
+        {
+            PRWARN("Failed to Load %s\n", filename);
+            mCorrectFileType = false;
+        }
+
+        return mCorrectFileType;
+    }
+
     TiXmlDocument* doc = new TiXmlDocument(filename);    
     if (doc)
     {
@@ -115,9 +278,18 @@ void prParticleManager::Clear()
         prTrace(prLogLevel::LogError, "Clean definitions\n");
     }
 
+    // Clean the effects
+    for (auto it = mEffects.begin(); it != mEffects.end(); ++it)
+    {
+        PRSAFE_DELETE((*it).second);
+    }
+
     // And clear
     mEmitters.clear();
     mDefinitions.clear();
+    mEffects.clear();
+    mJobCount    = 0;
+    mVertexCount = 0;
 }
 
 
@@ -126,19 +298,61 @@ void prParticleManager::Clear()
 /// ---------------------------------------------------------------------------
 void prParticleManager::Update(f32 dt)
 {
-    if (!mEmitters.empty())
+    // Move the existing particles first, so new particles start at their emitter.
+    BuildJobs();
+
+    SimulateRange simulate(mJobs, dt);
+    if (mJobSystem)
     {
-        //prEmitterIt it;
-        for (auto it = mEmitters.begin(); it != mEmitters.end(); ++it)
+        mJobSystem->ParallelFor(mJobCount, PARTICLE_JOB_GRAIN, simulate);
+    }
+    else
+    {
+        simulate.Run(0, mJobCount);
+    }
+
+
+    // Close the gaps left by the dead particles, then reserve the new particles.
+    for (auto it = mEmitters.begin(); it != mEmitters.end();)
+    {
+        prEmitter *pEmitter = (*it).second;
+
+        for (u32 i = 0; i < pEmitter->GetEffectCount(); ++i)
         {
-            prEmitter *pEmitter = (*it).second;
-            if (pEmitter)
-            {
-                if (pEmitter->Update(dt))
-                {
-                }
-            }
+            pEmitter->GetBuffer(i)->Compact();
+        }
+
+        if (pEmitter->Emit(dt))
+        {
+            ++it;
         }
+        else
+        {
+            // Finished, so return its particle chunks to the pool.
+            PRSAFE_DELETE(pEmitter);
+            it = mEmitters.erase(it);
+        }
+    }
+
+
+    // Fill the new particles and write the vertices.
+    BuildJobs();
+
+    if (mVertexCount > mVertexCapacity)
+    {
+        PRSAFE_DELETE_ARRAY(mVertices);
+        mVertexCapacity = PRMAX(mVertexCount, mVertexCapacity + (mVertexCapacity >> 1));
+        mVertices       = new prParticleVertex[mVertexCapacity];
+    }
+
+    OutputRange output(mJobs, mVertices);
+    if (mJobSystem)
+    {
+        mJobSystem->ParallelFor(mJobCount, PARTICLE_JOB_GRAIN, output);
+    }
+    else
+    {
+        output.Run(0, mJobCount);
     }
 }
 
@@ -150,12 +364,10 @@ s32 prParticleManager::Fire(const char *name, const Proteus::Math::prVector3 &po
 {
     s32 handle = -1;
 
-    PRUNUSED(pos);
-
     if (name && *name && !mDefinitions.empty())
     {
         // Okay, we hashed the name for speed!
-        u32 hash = prStringHash(name);
+        u64 hash = prStringHash64(name);
 
 
         // Find an emitters definition
@@ -171,10 +383,25 @@ s32 prParticleManager::Fire(const char *name, const Proteus::Math::prVector3 &po
                 sEmitterID++;
                 sEmitterID &= 0x0FFFFFFF;
 
+                // Each emitter gets its own random sequence.
+                u32 seed = mSeed ^ (++mFired * 0x9E3779B9u);
+
                 // Make new emitter
-                prEmitter *pEmitter = new prEmitter(sEmitterID, *ed);
+                prEmitter *pEmitter = new prEmitter(sEmitterID, *ed, pos, mPool, seed);
                 if (pEmitter)
                 {
+                    // Attach the effect definitions. Effects without one use the defaults.
+                    u32 index = 0;
+                    for (auto et = ed->GetEffectsList().begin(); et != ed->GetEffectsList().end(); ++et, ++index)
+                    {
+                        auto effect = mEffects.find((*et).mHash);
+                        if (effect != mEffects.end())
+                        {
+                            pEmitter->SetEffect(index, *(*effect).second);
+                        }
+                    }
+
+
                     handle = pEmitter->GetID();
                     mEmitters.insert(std::pair<s32, prEmitter*>(handle, pEmitter));
                 }
@@ -218,6 +445,133 @@ prEmitterDefinition *prParticleManager::GetEmitterDefinitionByIndex(s32 index)
 }
 
 
+/// ---------------------------------------------------------------------------
+/// Returns the number of live particles across all emitters
+/// ---------------------------------------------------------------------------
+u32 prParticleManager::GetParticleCount() const
+{
+    u32 count = 0;
+
+    for (auto it = mEmitters.begin(); it != mEmitters.end(); ++it)
+    {
+        count += (*it).second->GetParticleCount();
+    }
+
+    return count;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Measures the cost of simulating particles, without rendering
+/// ---------------------------------------------------------------------------
+f32 prParticleManager::Benchmark(u32 particles, u32 frames, s32 threads)
+{
+    PRASSERT(particles > 0);
+    PRASSERT(frames > 0);
+
+    const f32 dt      = 1.0f / 60.0f;
+    const f32 lifeMin = 1.0f;
+    const f32 lifeMax = 2.0f;
+    const u32 warmup  = (u32)(lifeMax / dt) + 1;        // Frames until emission and death balance
+
+    prJobSystem       jobs(threads);
+    prParticleManager pm(&jobs);
+
+    // A fountain which keeps roughly the requested number of particles alive.
+    prEffectDefinition *pEffect = new prEffectDefinition("benchmark");
+    pEffect->mLifeMin  = lifeMin;
+    pEffect->mLifeMax  = lifeMax;
+    pEffect->mSpeedMin = 5.0f;
+    pEffect->mSpeedMax = 10.0f;
+    pEffect->mSpread   = 30.0f;
+    pEffect->mGravity  = prVector3(0.0f, -9.8f, 0.0f);
+
+    f32 runTime = (f32)(warmup + frames + 1) * dt;
+    f32 rate    = (f32)particles / ((lifeMin + lifeMax) * 0.5f);
+
+    prEffectType et;
+    et.mHash     = pEffect->mHash;
+    et.mCount    = (s32)(rate * runTime);
+    et.mWaitTime = 0.0f;
+    et.mRunTime  = runTime;
+
+    prEmitterDefinition *pDefinition = new prEmitterDefinition("benchmark");
+    pDefinition->GetEffectsList().push_back(et);
+
+    pm.mEffects.insert(std::pair<u64, prEffectDefinition*>(pEffect->mHash, pEffect));
+    pm.mDefinitions.insert(std::pair<std::string, prEmitterDefinition*>(pDefinition->GetName(), pDefinition));
+    pm.Fire("benchmark", prVector3::Zero);
+
+    for (u32 i = 0; i < warmup; ++i)
+    {
+        pm.Update(dt);
+    }
+
+    u64 total = 0;
+    u64 live  = 0;
+
+    for (u32 i = 0; i < frames; ++i)
+    {
+        u64 start = prClockNanoseconds();
+        pm.Update(dt);
+        total += prClockNanoseconds() - start;
+        live  += pm.GetVertexCount();
+    }
+
+    f32 ms = (f32)((double)total / (double)frames / 1000000.0);
+
+    prTrace(prLogLevel::LogInformation, "Particle benchmark: %u threads, %u frames, %u particles average, %.3f ms per frame\n", jobs.GetThreadCount(), frames, (u32)(live / frames), ms);
+
+    return ms;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Builds a job for every chunk of every effect.
+/// ---------------------------------------------------------------------------
+void prParticleManager::BuildJobs()
+{
+    mJobCount    = 0;
+    mVertexCount = 0;
+
+    for (auto it = mEmitters.begin(); it != mEmitters.end(); ++it)
+    {
+        prEmitter *pEmitter = (*it).second;
+
+        for (u32 i = 0; i < pEmitter->GetEffectCount(); ++i)
+        {
+            const prParticleBuffer *pParticles = pEmitter->GetBuffer(i);
+
+            for (u32 chunk = 0; chunk < pParticles->GetChunkCount(); ++chunk)
+            {
+                if (mJobCount == mJobCapacity)
+                {
+                    u32 capacity = PRMAX(64u, mJobCapacity << 1);
+
+                    prParticleJob *jobs = new prParticleJob[capacity];
+                    for (u32 j = 0; j < mJobCount; ++j)
+                    {
+                        jobs[j] = mJobs[j];
+                    }
+
+                    PRSAFE_DELETE_ARRAY(mJobs);
+                    mJobs        = jobs;
+                    mJobCapacity = capacity;
+                }
+
+                prParticleJob &job = mJobs[mJobCount++];
+                job.pEmitter = pEmitter;
+                job.effect   = i;
+                job.chunk    = chunk;
+                job.vertex   = mVertexCount;
+
+                mVertexCount += pParticles->GetChunkParticles(chunk);
+            }
+        }
+    }
+}
+
+
 /// ---------------------------------------------------------------------------
 /// Parses a particle file
 /// ---------------------------------------------------------------------------
@@ -294,64 +648,202 @@ void prParticleManager::ParseAttribs_Emitter(TiXmlElement* pElement)
 
     if (pElement)
     {
-        // Sanity checks
-        const char *pEmitterName = pElement->Attribute("name");
-        PRASSERT(pEmitterName && *pEmitterName);
+        AddEmitterDefinition(ParseEmitter(pElement));
+    }
+}
 
-        
-        // Create the emitters definition
-        prEmitterDefinition *ed = new prEmitterDefinition(pEmitterName);        
+
+/// ---------------------------------------------------------------------------
+/// Parses a particle file
+/// ---------------------------------------------------------------------------
+void prParticleManager::ParseAttribs_Effect(TiXmlElement* pElement)
+{
+    PRASSERT(pElement);
+    if (pElement)
+    {
+        AddEffectDefinition(ParseEffect(pElement));
+    }
+}
 
 
-        // Acquire the effect data.
-        TiXmlHandle   root(pElement);
-        TiXmlElement *pElem  = root.FirstChild("effectType").Element();
-        for (; pElem; pElem = pElem->NextSiblingElement())
+/// ---------------------------------------------------------------------------
+/// Reads a cooked particle file
+/// ---------------------------------------------------------------------------
+void prParticleManager::LoadCooked(prChunkReader &reader)
+{
+    if (reader.FindChunk(PRCHUNK_EMITTER))
+    {
+        u32 count = reader.GetEntries();
+
+        for (u32 i=0; i<count && reader.IsValid(); i++)
         {
-            const char *pName     = pElem->Attribute("name");               // Name of the effect
-            const char *pCount    = pElem->Attribute("count");              // How many particles to emit
-            const char *pWaitTime = pElem->Attribute("waitTime");           // How long before we kick off the effect
-            const char *pRuntime  = pElem->Attribute("runTime");            // How long to take to run the effect
+            prEmitterDefinition *ed = new prEmitterDefinition(reader.ReadString());
 
-            PRASSERT(pName);
-            PRASSERT(pCount);
-            PRASSERT(pWaitTime);
-            PRASSERT(pRuntime);
+            u32 effects = reader.ReadU32();
+            for (u32 j=0; j<effects; j++)
+            {
+                prEffectType et;
+                et.mHash     = reader.ReadU64();
+                et.mCount    = reader.ReadS32();
+                et.mWaitTime = reader.ReadF32();
+                et.mRunTime  = reader.ReadF32();
 
-            prEffectType et;
-            et.mHash     = prStringHash(pName);
-            et.mCount    = atoi(pCount);
-            et.mRunTime  = (f32)atof(pWaitTime);
-            et.mWaitTime = (f32)atof(pRuntime);
+                ed->GetEffectsList().push_back(et);
+            }
 
-            ed->GetEffectsList().push_back(et);
+            AddEmitterDefinition(ed);
         }
+    }
 
-        // Store the definition
-        std::string key(pEmitterName);
+    if (reader.FindChunk(PRCHUNK_EFFECT))
+    {
+        u32 count = reader.GetEntries();
 
-        if (mDefinitions.find(key) == mDefinitions.end())
+        for (u32 i=0; i<count && reader.IsValid(); i++)
         {
-            mDefinitions.insert
-            (
-                std::pair<std::string, prEmitterDefinition*>(key, ed)
-            );
+            prEffectDefinition *pEffect = new prEffectDefinition(reader.ReadString());
+
+            pEffect->mLifeMin     = reader.ReadF32();
+            pEffect->mLifeMax     = reader.ReadF32();
+            pEffect->mSpeedMin    = reader.ReadF32();
+            pEffect->mSpeedMax    = reader.ReadF32();
+            pEffect->mSpread      = reader.ReadF32();
+            pEffect->mDirection.x = reader.ReadF32();
+            pEffect->mDirection.y = reader.ReadF32();
+            pEffect->mDirection.z = reader.ReadF32();
+            pEffect->mGravity.x   = reader.ReadF32();
+            pEffect->mGravity.y   = reader.ReadF32();
+            pEffect->mGravity.z   = reader.ReadF32();
+
+            AddEffectDefinition(pEffect);
         }
-        else
+    }
+
+    // Indicate correct file type.
+    mCorrectFileType = true;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Writes an xml particle file as a cooked particle file
+/// ---------------------------------------------------------------------------
+bool prParticleManager::Cook(TiXmlElement *pRoot, const char *destination)
+{
+    PRASSERT(pRoot);
+    PRASSERT(destination && *destination);
+
+    std::list<TiXmlElement *> emitters;
+    std::list<TiXmlElement *> effects;
+    prCookFindElements(pRoot, "emitter", emitters);
+    prCookFindElements(pRoot, "effect",  effects);
+
+    prChunkWriter writer(PRFILE_TYPE_PT, PRCOOKED_VERSION_PT);
+
+    // Emitters
+    writer.BeginChunk(PRCHUNK_EMITTER, (u32)emitters.size());
+
+    for (auto it = emitters.begin(); it != emitters.end(); ++it)
+    {
+        prEmitterDefinition *ed = ParseEmitter(*it);
+
+        writer.WriteString(ed->GetName());
+        writer.WriteU32(ed->GetNumEffects());
+
+        const prEffectTypeList &list = ed->GetEffectsList();
+        for (auto et = list.begin(); et != list.end(); ++et)
         {
-            PRPANIC("Multiple emitter defintions with the same name is not allowed");
+            writer.WriteU64((*et).mHash);
+            writer.WriteS32((*et).mCount);
+            writer.WriteF32((*et).mWaitTime);
+            writer.WriteF32((*et).mRunTime);
         }
+
+        PRSAFE_DELETE(ed);
+    }
+
+    // Effects. Validated when loaded, as with xml.
+    writer.BeginChunk(PRCHUNK_EFFECT, (u32)effects.size());
+
+    for (auto it = effects.begin(); it != effects.end(); ++it)
+    {
+        prEffectDefinition *pEffect = ParseEffect(*it);
+
+        writer.WriteString(pEffect->mName.c_str());
+        writer.WriteF32(pEffect->mLifeMin);
+        writer.WriteF32(pEffect->mLifeMax);
+        writer.WriteF32(pEffect->mSpeedMin);
+        writer.WriteF32(pEffect->mSpeedMax);
+        writer.WriteF32(pEffect->mSpread);
+        writer.WriteF32(pEffect->mDirection.x);
+        writer.WriteF32(pEffect->mDirection.y);
+        writer.WriteF32(pEffect->mDirection.z);
+        writer.WriteF32(pEffect->mGravity.x);
+        writer.WriteF32(pEffect->mGravity.y);
+        writer.WriteF32(pEffect->mGravity.z);
+
+        PRSAFE_DELETE(pEffect);
     }
+
+    return writer.Save(destination);
 }
 
 
 /// ---------------------------------------------------------------------------
-/// Parses a particle file
+/// Stores an emitter definition
 /// ---------------------------------------------------------------------------
-void prParticleManager::ParseAttribs_Effect(TiXmlElement* pElement)
+void prParticleManager::AddEmitterDefinition(prEmitterDefinition *ed)
 {
-    PRASSERT(pElement);
-    if (pElement)
+    PRASSERT(ed);
+
+    // Store the definition
+    std::string key(ed->GetName());
+
+    if (mDefinitions.find(key) == mDefinitions.end())
+    {
+        mDefinitions.insert
+        (
+            std::pair<std::string, prEmitterDefinition*>(key, ed)
+        );
+    }
+    else
+    {
+        PRSAFE_DELETE(ed);
+        PRPANIC("Multiple emitter defintions with the same name is not allowed");
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Validates and stores an effect definition
+/// ---------------------------------------------------------------------------
+void prParticleManager::AddEffectDefinition(prEffectDefinition *pEffect)
+{
+    PRASSERT(pEffect);
+
+    const char *pEffectName = pEffect->mName.c_str();
+    PRUNUSED(pEffectName);
+
+    PRASSERT(pEffect->mLifeMin > 0.0f && pEffect->mLifeMax >= pEffect->mLifeMin, "Invalid life for effect '%s'", pEffectName);
+    PRASSERT(pEffect->mSpeedMax >= pEffect->mSpeedMin, "Invalid speed for effect '%s'", pEffectName);
+
+    if (pEffect->mDirection.LengthSquared() > 0.0f)
+    {
+        pEffect->mDirection.Normalize();
+    }
+    else
+    {
+        PRWARN("Effect '%s' has no direction", pEffectName);
+        pEffect->mDirection = prVector3(0.0f, 1.0f, 0.0f);
+    }
+
+    // Store the definition
+    if (mEffects.find(pEffect->mHash) == mEffects.end())
+    {
+        mEffects.insert(std::pair<u64, prEffectDefinition*>(pEffect->mHash, pEffect));
+    }
+    else
     {
+        PRSAFE_DELETE(pEffect);
+        PRPANIC("Multiple effect defintions with the same name is not allowed");
     }
 }
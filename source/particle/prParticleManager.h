@@ -31,23 +31,40 @@ namespace Proteus
 
 class TiXmlNode;
 class TiXmlElement;
+class prJobSystem;
+class prChunkReader;
 struct prEmitterDefinition;
+struct prEffectDefinition;
 
 
 #include <list>
 #include <map>
 #include <string>
 #include "../core/prTypes.h"
+#include "prParticleBuffer.h"
 
 
 // Class: prParticleManager
 //      This class is responsible for creating and destroying particle emitters
+//
+// Notes:
+//      Particles are simulated in structure of arrays chunks, which all the
+//      emitters share through a single chunk pool.
+//
+//      Each chunk is a separate job, so the update is spread across the
+//      job systems threads. Every job writes its vertices to its own range
+//      of a single vertex buffer, which the renderer can consume without
+//      locks. The results do not depend on the number of threads.
 class prParticleManager
 {
 public:
     // Method: prParticleManager
     //      Constructor.
-    prParticleManager();
+    //
+    // Parameters:
+    //      pJobs - Optional job system. If NULL the cores job system is used, if it exists,
+    //              otherwise particles are updated on the calling thread
+    explicit prParticleManager(prJobSystem *pJobs = nullptr);
 
     // Method: ~prParticleManager
     //      Destructor.
@@ -57,17 +74,47 @@ public:
     //      Loads the particle emitter definitions
     //
     // Parameters:
-    //      filename - An xml file describing the emitter types
+    //      filename - An xml file or cooked file describing the emitter types
     bool Load(const char *filename);
 
+    // Method: Cook
+    //      Writes an xml particle file as a cooked particle file.
+    //
+    // Parameters:
+    //      pRoot       - The files root element
+    //      destination - The file to write
+    //
+    // Returns:
+    //      true on success
+    //
+    // Notes:
+    //      Normally called through <prCookAsset>.
+    static bool Cook(TiXmlElement *pRoot, const char *destination);
+
     // Method: Clear
     //      Clears the particle manager of all definitions
     void Clear();
 
     // Method: Update
     //      Updates the particle manager
+    //
+    // Notes:
+    //      Emitters are destroyed once their effects have finished.
+    //
+    //      The calling thread takes part in the update and blocks until it completes.
     void Update(f32 dt);
 
+    // Method: GetVertices
+    //      Returns the vertices written by the last <Update>
+    //
+    // Notes:
+    //      Vertices are grouped by emitter, in emitter ID order.
+    const prParticleVertex *GetVertices() const { return mVertices; }
+
+    // Method: GetVertexCount
+    //      Returns the number of vertices written by the last <Update>
+    u32 GetVertexCount() const { return mVertexCount; }
+
     // Method: Fire
     //      Fires off a particle effect
     //
@@ -85,15 +132,64 @@ public:
     //      *PLEASE REMEMBER THIS IS THE COUNT OF EMITTER TYPES, NOT ACTIVE EMITTERS*
     s32 GetEmitterDefinitionCount() const;
 
+    // Method: GetEmitterDefinitionByIndex
+    //      Returns an emitter definition, or NULL if the index is invalid
+    prEmitterDefinition *GetEmitterDefinitionByIndex(s32 index);
+
+    // Method: GetEmitterCount
+    //      Returns the number of active emitters
+    s32 GetEmitterCount() const { return (s32)mEmitters.size(); }
+
+    // Method: GetParticleCount
+    //      Returns the number of live particles across all emitters
+    u32 GetParticleCount() const;
+
+    // Method: SetSeed
+    //      Sets the random seed used by new emitters
     //
+    // Notes:
+    //      With the same seed, file and sequence of calls, particles are
+    //      emitted identically on every run.
+    void SetSeed(u32 seed) { mSeed = seed; mFired = 0; }
+
+    // Method: Benchmark
+    //      Measures the cost of simulating particles, without rendering
     //
-    prEmitterDefinition *GetEmitterDefinitionByIndex(s32 index);
+    // Parameters:
+    //      particles - The number of live particles to maintain
+    //      frames    - The number of frames to measure
+    //      threads   - The number of worker threads. Negative values use one less than the hardware thread count
+    //
+    // Returns:
+    //      The average frame time in milliseconds
+    //
+    // Notes:
+    //      Runs a private manager with a single emitter which keeps roughly the
+    //      requested number of particles alive, emitting and killing particles
+    //      every frame.
+    static f32 Benchmark(u32 particles, u32 frames, s32 threads = -1);
 
 
 private:
     static s32 sEmitterID;                                              // Used to give emitters a unique ID
 
 
+private:
+    // A chunk of an effects particles.
+    typedef struct prParticleJob
+    {
+        prEmitter  *pEmitter;
+        u32         effect;
+        u32         chunk;
+        u32         vertex;                                             // First vertex of the chunk
+
+    } prParticleJob;
+
+    // Job ranges.
+    struct SimulateRange;
+    struct OutputRange;
+
+
 private:
     // Parses a particle file.
     void ParseParticleFile(TiXmlNode* pParent);
@@ -107,9 +203,36 @@ private:
     // Parses a particle file.
     void ParseAttribs_Effect(TiXmlElement* pElement);
 
+    // Reads a cooked particle file.
+    void LoadCooked(prChunkReader &reader);
+
+    // Stores an emitter definition.
+    void AddEmitterDefinition(prEmitterDefinition *pDefinition);
+
+    // Validates and stores an effect definition.
+    void AddEffectDefinition(prEffectDefinition *pEffect);
+
+    // Builds a job for every chunk of every effect.
+    void BuildJobs();
+
+    // Stop passing by value and assignment.
+    prParticleManager(const prParticleManager&);
+    const prParticleManager& operator = (const prParticleManager&);
+
 
 private:    
     std::map<s32, prEmitter*>                       mEmitters;          // The active emitters
     std::map<std::string, prEmitterDefinition*>     mDefinitions;       // The definitions of the emitters
+    std::map<u64, prEffectDefinition*>              mEffects;           // The particle properties of the effects
+    prParticleChunkPool                             mPool;              // Particle storage shared by the emitters
+    prJobSystem                                    *mJobSystem;
+    prParticleJob                                  *mJobs;
+    u32                                             mJobCount;
+    u32                                             mJobCapacity;
+    prParticleVertex                               *mVertices;
+    u32                                             mVertexCount;
+    u32                                             mVertexCapacity;
+    u32                                             mSeed;              // Random seed for new emitters
+    u32                                             mFired;             // Emitters fired since the seed was set
     bool                                            mCorrectFileType;   // Used to ensure its the correct file type during loading.
 };
@@ -25,8 +25,24 @@
 /// ---------------------------------------------------------------------------
 /// Constructor
 /// ---------------------------------------------------------------------------
-prEmitterDefinition::prEmitterDefinition(const char *name) : mHash  (prStringHash(name))
+prEmitterDefinition::prEmitterDefinition(const char *name) : mHash  (prStringHash64(name))
                                                            , mName  (name)
 {
-    prTrace(prLogLevel::LogError, "New 'prEmitterDefinition' %s - %08x\n", mName.c_str(), mHash);
+    prTrace(prLogLevel::LogError, "New 'prEmitterDefinition' %s - %016llx\n", mName.c_str(), (unsigned long long)mHash);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Constructor
+/// ---------------------------------------------------------------------------
+prEffectDefinition::prEffectDefinition(const char *name) : mHash      (prStringHash64(name))
+                                                         , mName      (name)
+                                                         , mLifeMin   (1.0f)
+                                                         , mLifeMax   (1.0f)
+                                                         , mSpeedMin  (0.0f)
+                                                         , mSpeedMax  (0.0f)
+                                                         , mSpread    (180.0f)
+                                                         , mDirection (0.0f, 1.0f, 0.0f)
+                                                         , mGravity   (0.0f, 0.0f, 0.0f)
+{
 }
@@ -20,6 +20,7 @@
 
 
 #include "../core/prTypes.h"
+#include "../math/prVector3.h"
 #include <list>
 #include <string>
 
@@ -28,7 +29,7 @@
 //      This struct is used to hold an effect type for a defined emitter
 struct prEffectType
 {
-    u32  mHash;              // The identifying hash key
+    u64  mHash;              // The identifying hash key
     s32  mCount;             // The number of effects
     f32  mWaitTime;
     f32  mRunTime;
@@ -39,6 +40,33 @@ struct prEffectType
 typedef std::list<prEffectType>     prEffectTypeList;
 
 
+// Struct: prEffectDefinition
+//      This struct holds the particle properties of a named effect
+//
+// Notes:
+//      Effects are defined by the <effect> elements of a particle file, and
+//      are referenced by name from an emitters <effectType> elements.
+//
+//      Life and speed are chosen randomly between their minimum and maximum.
+//      Particles are fired within spread degrees of the direction.
+struct prEffectDefinition
+{
+    // Method: prEffectDefinition
+    //      Ctor
+    explicit prEffectDefinition(const char *name);
+
+    u64                         mHash;          // The identifying hash key
+    std::string                 mName;
+    f32                         mLifeMin;       // Particle life in seconds
+    f32                         mLifeMax;
+    f32                         mSpeedMin;      // Particle speed in units per second
+    f32                         mSpeedMax;
+    f32                         mSpread;        // Cone half angle in degrees
+    Proteus::Math::prVector3    mDirection;     // Normalised firing direction
+    Proteus::Math::prVector3    mGravity;       // Acceleration applied to all particles
+};
+
+
 // struct: prEmitterDefinition
 //      This is used to hold the definition data of a particle emitter
 //
@@ -59,7 +87,7 @@ struct prEmitterDefinition
 
     // Method: GetHash
     //      Gets the hash for this emitter definition
-    u32  GetHash() const { return mHash; }
+    u64  GetHash() const { return mHash; }
 
     // Method: GetName
     //      Gets the name for this emitter definition
@@ -69,11 +97,17 @@ struct prEmitterDefinition
     //      Gets the number of effects for this emitter
     u32 GetNumEffects() const { return (u32)mEffects.size(); }
 
+    // Method: GetEffectsList
+    //      Gets the effects used by this emitter
     prEffectTypeList &GetEffectsList() { return mEffects; }
 
+    // Method: GetEffectsList
+    //      Gets the effects used by this emitter
+    const prEffectTypeList &GetEffectsList() const { return mEffects; }
+
 
 private:
-    u32                 mHash;
+    u64                 mHash;
     std::string         mName;
     prEffectTypeList    mEffects;
 };
@@ -94,6 +94,7 @@
 #define ALLOW_GLEW                                      // Allows glew to be used
 #define STATIC_GLEW                                     // for glew static library
 #define PROTEUS_ALLOW_WATERMARK                         // Allow watermark?
+//#define ALLOW_ZSTD                                      // Allows zstd compressed archive entries. Requires the zstd library
 
 
 // Tools will always have min/max buttons and be resizeble
@@ -130,5 +131,7 @@
 
 // Optimizations
 #define PROTEUS_OPTIMISE_REMOVE_ISTEXTURE               // If defined this removes the IsTexture text in texture release
+#define PROTEUS_OPTIMISE_MAP_ARCHIVES                   // If defined archives are memory mapped, which allows zero copy reads of uncompressed files
 //#define PROTEUS_OPTIMISE_NO_VECTOR2_INIT                // If defined then the prVector2 class does not zero its members in the constructor
 //#define PROTEUS_OPTIMISE_NO_VECTOR3_INIT                // If defined then the prVector3 class does not zero its members in the constructor
+//#define PROTEUS_OPTIMISE_NO_SIMD                        // If defined the maths code uses its scalar versions, rather than SSE or NEON
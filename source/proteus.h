@@ -62,6 +62,7 @@
 #include "analytics/prAnalyticsFlurry.h"
 #include "audio/prSoundManager.h"
 #include "audio/prSoundManagerShared.h"
+#include "collision/prCollisionManager.h"
 #include "collision/prLine.h"
 #include "core/prApplication.h"
 #include "core/prApplication_Android.h"
@@ -75,6 +76,7 @@
 #include "core/prCore.h"
 #include "core/prCoreSystem.h"
 #include "core/prDefines.h"
+#include "core/prGameTime.h"
 #include "core/prList.h"
 #include "core/prMacros.h"
 #include "core/prMessage.h"
@@ -103,9 +105,11 @@
 #include "debug/prDebug.h"
 #include "debug/prException.h"
 #include "debug/prFps.h"
+#include "debug/prLogWriter.h"
 #include "debug/prOnScreenLogger.h"
 #include "debug/prProfileEntry.h"
 #include "debug/prProfileManager.h"
+#include "debug/prProfiler.h"
 #include "debug/prTrace.h"
 #include "display/prBackground.h"
 #include "display/prBackgroundLayer.h"
@@ -129,10 +133,13 @@
 #include "display/prSprite.h"
 #include "display/prSpriteAnimation.h"
 #include "display/prSpriteAnimationSequence.h"
+#include "display/prSpriteBatch.h"
 #include "display/prSpriteManager.h"
 #include "display/prTexture.h"
 #include "display/prTrueTypeFont.h"
 #include "editor/prEditor.h"
+#include "file/prAssetCooker.h"
+#include "file/prChunkFile.h"
 #include "file/prFile.h"
 #include "file/prFileManager.h"
 #include "file/prFileShared.h"
@@ -180,14 +187,17 @@
 #include "math/prRandom.h"
 #include "math/prRect.h"
 //#include "math/prRectF.h"
+#include "math/prSimd.h"
 #include "math/prSinCos.h"
 #include "math/prVector2.h"
 #include "math/prVector3.h"
 #include "memory/prMemory.h"
 #include "memory/prLinkedHeap.h"
+#include "memory/prConcurrentPool.h"
 #include "memory/prMemoryPool.h"
 #include "memory/prSpritePointerPool.h"
 #include "memory/prStackHeap.h"
+#include "memory/prTLSFHeap.h"
 #include "mesh/prAnimation.h"
 #include "mesh/prAnimation_MD2.h"
 #include "mesh/prMD2.h"
@@ -207,6 +217,7 @@
 #include "online/prWeb.h"
 #include "particle/prEmitter.h"
 #include "particle/prParticle.h"
+#include "particle/prParticleBuffer.h"
 #include "particle/prParticleManager.h"
 #include "particle/prParticleShared.h"
 #include "persistence/prEncryption.h"
@@ -231,6 +242,7 @@
 #include "system/prSystem.h"
 #include "thread/prMutex.h"
 #include "thread/prThread.h"
+#include "thread/prJobSystem.h"
 #include "utf8proc/utf8proc.h"
 #include "util/prUtility_PC.h"
 #include "util/prDictionarySearch.h"
@@ -18,9 +18,12 @@
 
 
 #include "prScene.h"
+#include "../core/prMacros.h"
 #include "../core/prStringUtil.h"
 #include "../tinyxml/tinyxml.h"
 #include "../debug/prAssert.h"
+#include "../file/prChunkFile.h"
+#include "../file/prFileShared.h"
 
 
 namespace Scene
@@ -52,6 +55,13 @@ namespace Scene
         // Parse the document
         if (pFilename && *pFilename) 
         {
+            // Cooked scenes hold no data yet.
+            prChunkReader reader;
+            if (reader.Load(pFilename, PRFILE_TYPE_SC, PRCOOKED_VERSION_SC))
+            {
+                return;
+            }
+
             TiXmlDocument* doc = new TiXmlDocument(pFilename);
             if (doc)
             {
@@ -72,6 +82,20 @@ namespace Scene
     }
 
 
+    /// ---------------------------------------------------------------------------
+    /// Writes an xml scene file as a cooked scene file
+    /// ---------------------------------------------------------------------------
+    bool prScene::Cook(TiXmlElement *pRoot, const char *destination)
+    {
+        PRASSERT(pRoot);
+        PRASSERT(destination && *destination);
+        PRUNUSED(pRoot);
+
+        prChunkWriter writer(PRFILE_TYPE_SC, PRCOOKED_VERSION_SC);
+        return writer.Save(destination);
+    }
+
+
     /// ---------------------------------------------------------------------------
     /// Unloads the current scene and frees all the objects
     /// ---------------------------------------------------------------------------
@@ -48,9 +48,24 @@ namespace Scene {
         //      Loads the scene file specified by the filename
         //
         // Parameters:
-        //      pFilename - A scene file
+        //      pFilename - A scene file. Either a cooked file or an xml file
         void Load(const char *pFilename);
 
+        // Method: Cook
+        //      Writes an xml scene file as a cooked scene file.
+        //
+        // Parameters:
+        //      pRoot       - The files root element
+        //      destination - The file to write
+        //
+        // Returns:
+        //      true on success
+        //
+        // Notes:
+        //      Scenes don't load any data yet, so only the file header is
+        //      cooked. Normally called through <prCookAsset>.
+        static bool Cook(TiXmlElement *pRoot, const char *destination);
+
         // Method: Unload
         //     Unloads the current scene and frees all the objects
         void Unload();
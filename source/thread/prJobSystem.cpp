@@ -0,0 +1,593 @@
+/**
+ * prJobSystem.cpp
+ *
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "prJobSystem.h"
+#include "../core/prCore.h"
+#include "../core/prMacros.h"
+#include "../debug/prAssert.h"
+#include "../debug/prTrace.h"
+#include "../debug/prProfiler.h"
+
+
+// A Chase-Lev work stealing queue.
+//
+// The owning thread pushes and pops at the bottom. Other threads steal
+// from the top. Sequentially consistent operations stand in for the
+// fences of the published algorithm.
+struct prJobQueue
+{
+    prJobQueue() : top(0), bottom(0)
+    {
+        for (u32 i = 0; i < PRJOBSYSTEM_QUEUE_SIZE; i++)
+        {
+            jobs[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    // Owner only. Returns false if the queue is full.
+    bool Push(prJob *pJob)
+    {
+        s64 b = bottom.load(std::memory_order_relaxed);
+        s64 t = top.load(std::memory_order_acquire);
+
+        if (b - t >= PRJOBSYSTEM_QUEUE_SIZE)
+        {
+            return false;
+        }
+
+        jobs[b & (PRJOBSYSTEM_QUEUE_SIZE - 1)].store(pJob, std::memory_order_relaxed);
+        bottom.store(b + 1);
+        return true;
+    }
+
+    // Owner only.
+    prJob *Pop()
+    {
+        s64 b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b);
+        s64 t = top.load();
+
+        prJob *pJob = nullptr;
+
+        if (t <= b)
+        {
+            pJob = jobs[b & (PRJOBSYSTEM_QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+
+            // Last job. Race the thieves for it.
+            if (t == b)
+            {
+                if (!top.compare_exchange_strong(t, t + 1))
+                {
+                    pJob = nullptr;
+                }
+
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+        }
+        else
+        {
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        return pJob;
+    }
+
+    // Any thread.
+    prJob *Steal()
+    {
+        s64 t = top.load();
+        s64 b = bottom.load();
+
+        if (t < b)
+        {
+            prJob *pJob = jobs[t & (PRJOBSYSTEM_QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+
+            if (top.compare_exchange_strong(t, t + 1))
+            {
+                return pJob;
+            }
+        }
+
+        return nullptr;
+    }
+
+    std::atomic<s64>        top;
+    u8                      padding[64];                // Keeps the thieves off the owner's cache line
+    std::atomic<s64>        bottom;
+    std::atomic<prJob *>    jobs[PRJOBSYSTEM_QUEUE_SIZE];
+};
+
+
+// Splits a range and runs a piece of it.
+class prJobSystem::RangeJob : public prJob
+{
+public:
+    RangeJob(prJobSystem *pSystem, prJobRange *pRange, prJobCounter *pCounter, u32 begin, u32 end, u32 grain) : m_pSystem  (pSystem)
+                                                                                                              , m_pRange   (pRange)
+                                                                                                              , m_pGroup   (pCounter)
+                                                                                                              , m_begin    (begin)
+                                                                                                              , m_end      (end)
+                                                                                                              , m_grain    (grain)
+    {
+    }
+
+    void Execute() override
+    {
+        // Give away the upper half until the rest is small enough to run.
+        while ((m_end - m_begin) > m_grain)
+        {
+            u32 middle = m_begin + ((m_end - m_begin) >> 1);
+
+            RangeJob *pJob = m_pSystem->m_rangeJobs->Pop(m_pSystem, m_pRange, m_pGroup, middle, m_end, m_grain);
+            if (pJob == nullptr)
+            {
+                break;
+            }
+
+            m_pSystem->Submit(pJob, m_pGroup);
+            m_end = middle;
+        }
+
+        m_pRange->Run(m_begin, m_end);
+    }
+
+    void Finish() override
+    {
+        m_pSystem->m_rangeJobs->Push(this);
+    }
+
+
+private:
+    prJobSystem    *m_pSystem;
+    prJobRange     *m_pRange;
+    prJobCounter   *m_pGroup;                          // Counts the pieces of the range
+    u32             m_begin;
+    u32             m_end;
+    u32             m_grain;
+};
+
+
+// Local data
+namespace
+{
+    // The job system the calling thread belongs to, and its index.
+    thread_local const prJobSystem *threadSystem = nullptr;
+    thread_local u32                threadIndex  = PRJOBSYSTEM_MAX_THREADS;
+
+    // Spins before a worker goes to sleep.
+    const u32 SPIN_COUNT = 64;
+}
+
+
+// Local functions
+namespace
+{
+    // Claims one sleeping worker. Returns false if none are left unclaimed.
+    bool ClaimSleeper(std::atomic<s32> &sleeping)
+    {
+        s32 count = sleeping.load();
+        while (count > 0)
+        {
+            if (sleeping.compare_exchange_weak(count, count - 1))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Dtor
+/// ---------------------------------------------------------------------------
+prJobCounter::~prJobCounter()
+{
+    PRASSERT(m_count.load() == 0, "A job counter was destroyed before its jobs completed");
+
+    // A counter used only as a dependency is never waited on, so a thread
+    // may still be finishing its release after the dependent jobs have run.
+    while (m_busy.load() != 0)
+    {
+        prThreadYield();
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Ctor
+/// ---------------------------------------------------------------------------
+prJobSystem::prJobSystem(s32 threads) : prCoreSystem(PRSYSTEM_JOBSYSTEM, "prJobSystem")
+                                      , m_wake(0)
+{
+    if (threads < 0)
+    {
+        threads = (s32)prThreadHardwareCount() - 1;
+    }
+
+    m_threadCount = PRCLAMP((u32)threads + 1, 1, PRJOBSYSTEM_MAX_THREADS);
+    m_queues      = new prJobQueue[m_threadCount];
+    m_rangeJobs   = new prConcurrentPool<RangeJob>(256, true, "prJobSystem");
+    m_pSharedHead = nullptr;
+    m_pSharedTail = nullptr;
+
+    m_sharedCount.store(0);
+    m_sleeping.store(0);
+    m_started.store(1);
+    m_exit.store(false);
+
+    for (u32 i = 0; i < PRJOBSYSTEM_MAX_THREADS; i++)
+    {
+        m_threads[i] = nullptr;
+    }
+
+    // The creating thread is thread zero.
+    m_pOuterSystem = threadSystem;
+    m_outerIndex   = threadIndex;
+    threadSystem   = this;
+    threadIndex    = 0;
+
+    for (u32 i = 1; i < m_threadCount; i++)
+    {
+        m_threads[i] = new prThread(WorkerThread, this, false);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Dtor
+/// ---------------------------------------------------------------------------
+prJobSystem::~prJobSystem()
+{
+    m_exit.store(true);
+    m_wake.Signal(m_threadCount - 1);
+
+    for (u32 i = 1; i < m_threadCount; i++)
+    {
+        m_threads[i]->Join();
+        PRSAFE_DELETE(m_threads[i]);
+    }
+
+    PRASSERT(m_pSharedHead == nullptr, "Jobs were still queued when the job system was destroyed");
+
+    if (threadSystem == this)
+    {
+        threadSystem = m_pOuterSystem;
+        threadIndex  = m_outerIndex;
+    }
+
+    PRSAFE_DELETE(m_rangeJobs);
+    PRSAFE_DELETE_ARRAY(m_queues);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Queues a job.
+/// ---------------------------------------------------------------------------
+void prJobSystem::Submit(prJob *pJob, prJobCounter *pCounter, prJobCounter *pDependency)
+{
+    PRASSERT(pJob);
+
+    pJob->m_pCounter = pCounter;
+    pJob->m_pNext    = nullptr;
+
+    if (pCounter)
+    {
+        pCounter->m_count.fetch_add(1);
+    }
+
+    // Park the job until its dependency completes.
+    if (pDependency)
+    {
+        pDependency->m_lock.Lock();
+
+        if (pDependency->m_count.load() > 0)
+        {
+            pJob->m_pNext            = pDependency->m_pWaiting;
+            pDependency->m_pWaiting  = pJob;
+            pDependency->m_lock.Unlock();
+            return;
+        }
+
+        pDependency->m_lock.Unlock();
+    }
+
+    Enqueue(pJob);
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Runs jobs until a counter reaches zero.
+/// ---------------------------------------------------------------------------
+void prJobSystem::Wait(prJobCounter &counter)
+{
+    u32 index = ThreadIndex();
+
+    while (!counter.IsComplete())
+    {
+        prJob *pJob = FindJob(index);
+        if (pJob)
+        {
+            Run(pJob);
+        }
+        else
+        {
+            prThreadYield();
+        }
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Splits a range of indices into jobs and waits for them to complete.
+/// ---------------------------------------------------------------------------
+void prJobSystem::ParallelFor(u32 count, u32 grain, prJobRange &range)
+{
+    grain = PRMAX(grain, 1u);
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Not worth splitting.
+    if (count <= grain || m_threadCount == 1)
+    {
+        range.Run(0, count);
+        return;
+    }
+
+    prJobCounter counter;
+
+    RangeJob *pJob = m_rangeJobs->Pop(this, &range, &counter, 0, count, grain);
+    if (pJob)
+    {
+        Submit(pJob, &counter);
+        Wait(counter);
+    }
+    else
+    {
+        range.Run(0, count);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// The worker thread function.
+/// ---------------------------------------------------------------------------
+PRTHREAD_RETVAL PRTHREAD_CALLCONV prJobSystem::WorkerThread(void *pData)
+{
+    PRASSERT(pData);
+    prJobSystem *pSystem = static_cast<prJobSystem *>(pData);
+
+    u32 index    = pSystem->m_started.fetch_add(1);
+    threadSystem = pSystem;
+    threadIndex  = index;
+
+    PRPROFILE_THREAD_NAME("Job worker");
+
+    u32 spins = 0;
+
+    for (;;)
+    {
+        prJob *pJob = pSystem->FindJob(index);
+        if (pJob)
+        {
+            pSystem->Run(pJob);
+            spins = 0;
+            continue;
+        }
+
+        if (pSystem->m_exit.load())
+        {
+            break;
+        }
+
+        if (++spins < SPIN_COUNT)
+        {
+            prThreadYield();
+            continue;
+        }
+
+        // Announce the sleep, then look once more, so a job submitted
+        // in between is never missed. A sleeper is woken by whoever
+        // claims it, so the count only holds unclaimed sleepers.
+        pSystem->m_sleeping.fetch_add(1);
+
+        pJob = pSystem->FindJob(index);
+        if (pJob || pSystem->m_exit.load())
+        {
+            // Take back the announcement. If every sleeper has been
+            // claimed, a wake is on its way for this one, so consume it.
+            if (!ClaimSleeper(pSystem->m_sleeping))
+            {
+                pSystem->m_wake.Wait();
+            }
+        }
+        else
+        {
+            pSystem->m_wake.Wait();
+        }
+
+        if (pJob)
+        {
+            pSystem->Run(pJob);
+        }
+
+        spins = 0;
+    }
+
+    return 0;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Queues a job which is ready to run.
+/// ---------------------------------------------------------------------------
+void prJobSystem::Enqueue(prJob *pJob)
+{
+    u32 index = ThreadIndex();
+
+    if (index < m_threadCount)
+    {
+        // The queue is full, so run it now.
+        if (!m_queues[index].Push(pJob))
+        {
+            Run(pJob);
+            return;
+        }
+    }
+    else
+    {
+        m_sharedLock.Lock();
+
+        if (m_pSharedTail)
+        {
+            m_pSharedTail->m_pNext = pJob;
+        }
+        else
+        {
+            m_pSharedHead = pJob;
+        }
+
+        m_pSharedTail = pJob;
+        m_sharedCount.fetch_add(1);
+        m_sharedLock.Unlock();
+    }
+
+    // Only wake a worker which is asleep and not already being woken.
+    if (ClaimSleeper(m_sleeping))
+    {
+        m_wake.Signal();
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Finds a job to run for a thread.
+/// ---------------------------------------------------------------------------
+prJob *prJobSystem::FindJob(u32 index)
+{
+    prJob *pJob = nullptr;
+
+    if (index < m_threadCount)
+    {
+        // Own work first.
+        pJob = m_queues[index].Pop();
+        if (pJob)
+        {
+            return pJob;
+        }
+
+        // Then steal, starting with the next thread along.
+        for (u32 i = 1; i < m_threadCount; i++)
+        {
+            pJob = m_queues[(index + i) % m_threadCount].Steal();
+            if (pJob)
+            {
+                return pJob;
+            }
+        }
+    }
+
+    // Then jobs from other threads.
+    if (m_sharedCount.load() > 0)
+    {
+        m_sharedLock.Lock();
+
+        pJob = m_pSharedHead;
+        if (pJob)
+        {
+            m_pSharedHead = pJob->m_pNext;
+            if (m_pSharedHead == nullptr)
+            {
+                m_pSharedTail = nullptr;
+            }
+
+            pJob->m_pNext = nullptr;
+            m_sharedCount.fetch_sub(1);
+        }
+
+        m_sharedLock.Unlock();
+    }
+
+    return pJob;
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Runs a job and releases its counter.
+/// ---------------------------------------------------------------------------
+void prJobSystem::Run(prJob *pJob)
+{
+    // The job may be gone after Finish.
+    prJobCounter *pCounter = pJob->m_pCounter;
+
+    {
+        PRPROFILE_ZONE("Job");
+        pJob->Execute();
+        pJob->Finish();
+    }
+
+    if (pCounter)
+    {
+        Release(pCounter);
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Decrements a counter, releasing its waiting jobs at zero.
+/// ---------------------------------------------------------------------------
+void prJobSystem::Release(prJobCounter *pCounter)
+{
+    // Waiters see the counter as busy until we are done with it.
+    pCounter->m_busy.fetch_add(1);
+
+    prJob *pJob = nullptr;
+    if (pCounter->m_count.fetch_sub(1) == 1)
+    {
+        pCounter->m_lock.Lock();
+        pJob = pCounter->m_pWaiting;
+        pCounter->m_pWaiting = nullptr;
+        pCounter->m_lock.Unlock();
+    }
+
+    // Done with the counter. The waiting jobs must be queued after this, as
+    // their owner may destroy the counter as soon as they have run.
+    pCounter->m_busy.fetch_sub(1);
+
+    while (pJob)
+    {
+        prJob *pNext = pJob->m_pNext;
+        pJob->m_pNext = nullptr;
+        Enqueue(pJob);
+        pJob = pNext;
+    }
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Returns the calling thread's index.
+/// ---------------------------------------------------------------------------
+u32 prJobSystem::ThreadIndex() const
+{
+    return (threadSystem == this) ? threadIndex : PRJOBSYSTEM_MAX_THREADS;
+}
@@ -0,0 +1,247 @@
+// File: prJobSystem.h
+//      A work stealing job scheduler.
+//
+// Notes:
+//      Each thread owns a double ended job queue. A thread pushes and pops
+//      jobs at one end of its own queue, while idle threads steal from the
+//      other end of everyone else's, so busy threads rarely contend.
+/**
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+
+#include <atomic>
+#include "../core/prTypes.h"
+#include "../core/prCoreSystem.h"
+#include "../memory/prConcurrentPool.h"
+#include "prMutex.h"
+#include "prSemaphore.h"
+#include "prThread.h"
+
+
+// Defines
+#define PRJOBSYSTEM_MAX_THREADS     32                  // Maximum threads, including the thread which creates the system.
+#define PRJOBSYSTEM_QUEUE_SIZE      4096                // Jobs per thread queue. Must be a power of two.
+
+
+// Forward declarations
+class prJobCounter;
+class prJobSystem;
+struct prJobQueue;
+
+
+// Class: prJob
+//      The base class for a unit of work.
+//
+// Notes:
+//      The job system does not own jobs. A job must stay alive until it
+//      has run, which is usually ensured by waiting on its counter.
+class prJob
+{
+public:
+    // Method: prJob
+    //      Ctor
+    prJob() : m_pCounter(nullptr), m_pNext(nullptr) {}
+
+    // Method: ~prJob
+    //      Dtor
+    virtual ~prJob() {}
+
+    // Method: Execute
+    //      Performs the work. Called on any thread.
+    virtual void Execute() = 0;
+
+    // Method: Finish
+    //      Called after <Execute> on the same thread.
+    //
+    // Notes:
+    //      The job system does not touch the job after this returns,
+    //      so a job may release itself here.
+    virtual void Finish() {}
+
+
+private:
+    friend class prJobSystem;
+
+    prJobCounter   *m_pCounter;                         // Decremented when the job has run
+    prJob          *m_pNext;                            // Link used while the job is waiting
+};
+
+
+// Class: prJobCounter
+//      Counts outstanding jobs.
+//
+// Notes:
+//      Each job submitted with a counter increments it, and decrements it
+//      once run. Jobs can also depend on a counter, in which case they are
+//      not started until it reaches zero.
+class prJobCounter
+{
+public:
+    // Method: prJobCounter
+    //      Ctor
+    prJobCounter() : m_count(0), m_busy(0), m_pWaiting(nullptr) {}
+
+    // Method: ~prJobCounter
+    //      Dtor
+    ~prJobCounter();
+
+    // Method: IsComplete
+    //      Returns true when all the counted jobs have run.
+    bool IsComplete() const { return m_count.load() == 0 && m_busy.load() == 0; }
+
+
+private:
+    friend class prJobSystem;
+
+    // Stops passing by value and assignment.
+    prJobCounter(const prJobCounter&);
+    const prJobCounter& operator = (const prJobCounter&);
+
+    std::atomic<s32>    m_count;                        // Outstanding jobs
+    std::atomic<s32>    m_busy;                         // Threads still decrementing. Keeps the counter alive
+    prMutex             m_lock;                         // Protects the waiting list
+    prJob              *m_pWaiting;                     // Jobs which depend on this counter
+};
+
+
+// Class: prJobRange
+//      The work performed by <prJobSystem::ParallelFor>.
+class prJobRange
+{
+public:
+    // Method: ~prJobRange
+    //      Dtor
+    virtual ~prJobRange() {}
+
+    // Method: Run
+    //      Processes a range of indices. Called concurrently on any thread.
+    //
+    // Parameters:
+    //      begin - The first index
+    //      end   - One past the last index
+    virtual void Run(u32 begin, u32 end) = 0;
+};
+
+
+// Class: prJobSystem
+//      Runs jobs on a fixed pool of worker threads.
+//
+// Notes:
+//      The thread which creates the job system becomes thread zero and
+//      runs jobs whenever it waits. Other threads may submit jobs and wait,
+//      but only help by running jobs from the shared queue.
+//
+//      Jobs should not block on I/O, as that stalls a worker. Use the
+//      resource loader for file loading.
+class prJobSystem : public prCoreSystem
+{
+public:
+    // Method: prJobSystem
+    //      Ctor
+    //
+    // Parameters:
+    //      threads - The number of worker threads to create. Negative values use one less than the hardware thread count
+    explicit prJobSystem(s32 threads = -1);
+
+    // Method: ~prJobSystem
+    //      Dtor
+    //
+    // Notes:
+    //      All jobs must have completed.
+    ~prJobSystem();
+
+    // Method: Submit
+    //      Queues a job.
+    //
+    // Parameters:
+    //      pJob        - The job
+    //      pCounter    - Optional counter to increment until the job has run
+    //      pDependency - Optional counter which must reach zero before the job starts
+    void Submit(prJob *pJob, prJobCounter *pCounter = nullptr, prJobCounter *pDependency = nullptr);
+
+    // Method: Wait
+    //      Runs jobs until a counter reaches zero.
+    //
+    // Parameters:
+    //      counter - The counter
+    void Wait(prJobCounter &counter);
+
+    // Method: ParallelFor
+    //      Splits a range of indices into jobs and waits for them to complete.
+    //
+    // Parameters:
+    //      count - The number of indices
+    //      grain - The smallest number of indices worth a job of its own
+    //      range - The work to perform
+    //
+    // Notes:
+    //      The range is split in half repeatedly, so idle threads steal large
+    //      pieces of work first.
+    void ParallelFor(u32 count, u32 grain, prJobRange &range);
+
+    // Method: GetThreadCount
+    //      Returns the number of threads which run jobs, including thread zero.
+    u32 GetThreadCount() const { return m_threadCount; }
+
+
+private:
+    // Splits a range and runs a piece of it.
+    class RangeJob;
+
+    // The worker thread function.
+    static PRTHREAD_RETVAL PRTHREAD_CALLCONV WorkerThread(void *pData);
+
+    // Queues a job which is ready to run.
+    void Enqueue(prJob *pJob);
+
+    // Finds a job to run for a thread.
+    prJob *FindJob(u32 index);
+
+    // Runs a job and releases its counter.
+    void Run(prJob *pJob);
+
+    // Decrements a counter, releasing its waiting jobs at zero.
+    void Release(prJobCounter *pCounter);
+
+    // Returns the calling thread's index, or PRJOBSYSTEM_MAX_THREADS if it is not a job thread.
+    u32 ThreadIndex() const;
+
+
+private:
+    // Stops passing by value and assignment.
+    prJobSystem(const prJobSystem&);
+    const prJobSystem& operator = (const prJobSystem&);
+
+
+private:
+    prJobQueue                     *m_queues;           // One per thread
+    prThread                       *m_threads[PRJOBSYSTEM_MAX_THREADS];
+    prConcurrentPool<RangeJob>     *m_rangeJobs;
+    prJob                          *m_pSharedHead;      // Jobs from other threads. (Locked)
+    prJob                          *m_pSharedTail;
+    prMutex                         m_sharedLock;
+    std::atomic<s32>                m_sharedCount;
+    prSemaphore                     m_wake;             // Wakes sleeping workers
+    std::atomic<s32>                m_sleeping;
+    std::atomic<u32>                m_started;          // Used to hand out thread indices
+    std::atomic<bool>               m_exit;
+    u32                             m_threadCount;
+    const prJobSystem              *m_pOuterSystem;     // The creating thread's previous job system. Restored on destruction
+    u32                             m_outerIndex;
+};
@@ -18,16 +18,22 @@
 
 
 #include "prMutex.h"
+#include "../debug/prAssert.h"
 #include "../debug/prTrace.h"
 #include "../debug/prDebug.h"
 
 
+#if (defined(PLATFORM_ANDROID) || defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))
+#include <errno.h>
+#endif
+
+
 /// ---------------------------------------------------------------------------
 /// Ctor
 /// ---------------------------------------------------------------------------
 prMutex::prMutex()
 {
-#if defined(PLATFORM_ANDROID)
+#if (defined(PLATFORM_ANDROID) || defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))
     // Init lock.
     if (pthread_mutex_init(&m_mutex, 0) != 0)
     {
@@ -38,8 +44,6 @@ prMutex::prMutex()
     // Init lock.
     InitializeCriticalSection(&m_cs);
 
-#elif (defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))  
-    // Allows class to compile for the other platforms.
 
 #else
     #error unsupported platform
@@ -53,7 +57,7 @@ prMutex::prMutex()
 /// ---------------------------------------------------------------------------
 prMutex::~prMutex()
 {
-#if defined(PLATFORM_ANDROID)
+#if (defined(PLATFORM_ANDROID) || defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))
     // Destroy lock.
     pthread_mutex_destroy(&m_mutex);
 
@@ -61,8 +65,6 @@ prMutex::~prMutex()
     // Destroy lock.
     DeleteCriticalSection(&m_cs);
 
-#elif (defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))  
-    // Allows class to compile for the other platforms.
 
 #else
     #error unsupported platform
@@ -76,7 +78,7 @@ prMutex::~prMutex()
 /// ---------------------------------------------------------------------------
 void prMutex::Lock()
 {
-#if defined(PLATFORM_ANDROID)
+#if (defined(PLATFORM_ANDROID) || defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))
     // Lock
     pthread_mutex_lock(&m_mutex);
 
@@ -84,8 +86,6 @@ void prMutex::Lock()
     // Lock
     EnterCriticalSection(&m_cs);
 
-#elif (defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))  
-    // Allows class to compile for the other platforms.
 
 #else
     #error unsupported platform
@@ -101,32 +101,22 @@ bool prMutex::TryLock()
 {
     bool locked = false;
 
-#if defined(PLATFORM_ANDROID)
-    // Lock?
+#if (defined(PLATFORM_ANDROID) || defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))
+    // Lock? Busy is the expected failure.
     int result = pthread_mutex_trylock(&m_mutex);
     if (result == 0)
     {
         locked = true;
     }
-    else
+    else if (result != EBUSY)
     {
-        prTrace(LogError, "Failed to locked mutex\n");
+        prTrace(prLogLevel::LogError, "Failed to lock mutex: %i\n", result);
     }
 
 #elif defined(PLATFORM_PC)
     // Lock?
-    if (!TryEnterCriticalSection(&m_cs))
-    {
-        EnterCriticalSection(&m_cs);
-        locked = true;
-    }
-    else
-    {
-        prTrace(prLogLevel::LogError, "Failed to locked mutex\n");
-    }
+    locked = (TryEnterCriticalSection(&m_cs) != FALSE);
 
-#elif (defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))  
-    // Allows class to compile for the other platforms.
 
 #else
     #error unsupported platform
@@ -142,7 +132,7 @@ bool prMutex::TryLock()
 // ----------------------------------------------------------------------------
 void prMutex::Unlock()
 {
-#if defined(PLATFORM_ANDROID)
+#if (defined(PLATFORM_ANDROID) || defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))
     // Unlock
     pthread_mutex_unlock(&m_mutex);
 
@@ -150,8 +140,6 @@ void prMutex::Unlock()
     // Unlock
     LeaveCriticalSection(&m_cs);
 
-#elif (defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))  
-    // Allows class to compile for the other platforms.
 
 #else
     #error unsupported platform
@@ -22,15 +22,12 @@
 #include "../prConfig.h"
 
 
-#if defined(PLATFORM_ANDROID)
+#if (defined(PLATFORM_ANDROID) || defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))
     #include <pthread.h>
 
 #elif defined(PLATFORM_PC)
     #include <windows.h>
 
-#elif (defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))
-    // Allows class to compile for the other platforms.
-
 #else
     #error unsupported platform
 
@@ -56,6 +53,9 @@ public:
 
     // Method: TryLock
     //      Trys to lock a mutex
+    //
+    // Returns:
+    //      true if the mutex was locked. Never blocks
 	bool TryLock();
 
     // Method: Unlock
@@ -64,15 +64,12 @@ public:
 
 private:
 
-#if defined(PLATFORM_ANDROID)
+#if (defined(PLATFORM_ANDROID) || defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))
     pthread_mutex_t     m_mutex;
 
 #elif defined(PLATFORM_PC)
     CRITICAL_SECTION    m_cs;
 
-#elif (defined(PLATFORM_IOS) || defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))  
-    // Allows class to compile for the other platforms.
-
 #else
     #error unsupported platform
 
@@ -0,0 +1,120 @@
+/**
+ * prSemaphore.cpp
+ *
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include "prSemaphore.h"
+#include "../debug/prAssert.h"
+
+
+/// ---------------------------------------------------------------------------
+/// Ctor
+/// ---------------------------------------------------------------------------
+prSemaphore::prSemaphore(u32 count)
+{
+#if (defined(PLATFORM_ANDROID) || defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))
+    // Init lock and condition. (Unnamed semaphores are unsupported on iOS/Mac)
+    m_count = count;
+    if (pthread_mutex_init(&m_mutex, 0) != 0 ||
+        pthread_cond_init(&m_condition, 0) != 0)
+    {
+        PRPANIC("Failed to initialise semaphore");
+    }
+
+#elif defined(PLATFORM_PC)
+    m_semaphore = CreateSemaphore(NULL, count, 0x7FFFFFFF, NULL);
+    if (m_semaphore == NULL)
+    {
+        PRPANIC("Failed to initialise semaphore");
+    }
+
+#else
+    #error unsupported platform
+
+#endif
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Dtor
+/// ---------------------------------------------------------------------------
+prSemaphore::~prSemaphore()
+{
+#if (defined(PLATFORM_ANDROID) || defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))
+    pthread_cond_destroy(&m_condition);
+    pthread_mutex_destroy(&m_mutex);
+
+#elif defined(PLATFORM_PC)
+    CloseHandle(m_semaphore);
+
+#else
+    #error unsupported platform
+
+#endif
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Increments the count, waking waiting threads.
+/// ---------------------------------------------------------------------------
+void prSemaphore::Signal(u32 count)
+{
+#if (defined(PLATFORM_ANDROID) || defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))
+    pthread_mutex_lock(&m_mutex);
+    m_count += count;
+    if (count == 1)
+    {
+        pthread_cond_signal(&m_condition);
+    }
+    else
+    {
+        pthread_cond_broadcast(&m_condition);
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+#elif defined(PLATFORM_PC)
+    ReleaseSemaphore(m_semaphore, count, NULL);
+
+#else
+    #error unsupported platform
+
+#endif
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Waits until the count is above zero, then decrements it.
+/// ---------------------------------------------------------------------------
+void prSemaphore::Wait()
+{
+#if (defined(PLATFORM_ANDROID) || defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))
+    pthread_mutex_lock(&m_mutex);
+    while (m_count == 0)
+    {
+        pthread_cond_wait(&m_condition, &m_mutex);
+    }
+    m_count--;
+    pthread_mutex_unlock(&m_mutex);
+
+#elif defined(PLATFORM_PC)
+    WaitForSingleObject(m_semaphore, INFINITE);
+
+#else
+    #error unsupported platform
+
+#endif
+}
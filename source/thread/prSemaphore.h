@@ -0,0 +1,87 @@
+// File: prSemaphore.h
+/**
+ *  Copyright 2014 Paul Michael McNab
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+
+#include "../prConfig.h"
+#include "../core/prTypes.h"
+
+
+#if (defined(PLATFORM_ANDROID) || defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))
+    #include <pthread.h>
+
+#elif defined(PLATFORM_PC)
+    #include <windows.h>
+
+#else
+    #error unsupported platform
+
+#endif
+
+
+// Class: prSemaphore
+//      A basic counting semaphore class. Used to put worker threads to
+//      sleep until there is work to do.
+class prSemaphore
+{
+public:
+    // Method: prSemaphore
+    //      Ctor
+    //
+    // Parameters:
+    //      count - The initial count
+    explicit prSemaphore(u32 count = 0);
+
+    // Method: ~prSemaphore
+    //      Dtor
+    ~prSemaphore();
+
+    // Method: Signal
+    //      Increments the count, waking waiting threads.
+    //
+    // Parameters:
+    //      count - The amount to increment by
+    void Signal(u32 count = 1);
+
+    // Method: Wait
+    //      Waits until the count is above zero, then decrements it.
+    void Wait();
+
+
+private:
+    // Stops passing by value and assignment.
+    prSemaphore(const prSemaphore&);
+    const prSemaphore& operator = (const prSemaphore&);
+
+
+private:
+
+#if (defined(PLATFORM_ANDROID) || defined(PLATFORM_IOS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))
+    pthread_mutex_t     m_mutex;
+    pthread_cond_t      m_condition;
+    u32                 m_count;
+
+#elif defined(PLATFORM_PC)
+    HANDLE              m_semaphore;
+
+#else
+    #error unsupported platform
+
+#endif
+};
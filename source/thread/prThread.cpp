@@ -18,11 +18,18 @@
 
 
 #include "prThread.h"
+#include "../core/prMacros.h"
 
 
 // PC
 #if defined(PLATFORM_PC)
 #include <thread>
+
+#else
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
 #endif
 
 
@@ -45,9 +52,13 @@ prThread::prThread(prThreadFunc pThreadFunction, void *pThreadData, bool suspend
 
     mThread = CreateThread(NULL, 0, pThreadFunction, pThreadData, initFlag, &mThreadID);
 
-#elif defined(PLATFORM_ANDROID)
+#else
+
+    // pthreads cannot be created suspended.
+    PRUNUSED(suspended);
 
     int result = pthread_create(&mThread, NULL, pThreadFunction, pThreadData);
+    mCreated   = (result == 0);
     if (result)
     {
         //
@@ -111,13 +122,86 @@ void prThread::Sleep()
 
 
 /// ---------------------------------------------------------------------------
-/// 
+/// Waits for the thread to exit
 /// ---------------------------------------------------------------------------
 void prThread::Join()
 {
 #if defined(PLATFORM_PC)
 
-#elif defined(PLATFORM_ANDROID)
+    if (mThread)
+    {
+        WaitForSingleObject(mThread, INFINITE);
+        CloseHandle(mThread);
+        mThread = NULL;
+    }
+
+#else
+
+    if (mCreated)
+    {
+        pthread_join(mThread, NULL);
+        mCreated = false;
+    }
+
+#endif
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Suspends the calling thread.
+/// ---------------------------------------------------------------------------
+void prThreadSleep(u32 milliseconds)
+{
+#if defined(PLATFORM_PC)
+
+    ::Sleep(milliseconds);
+
+#else
+
+    timespec request;
+    request.tv_sec  = milliseconds / 1000;
+    request.tv_nsec = (milliseconds % 1000) * 1000000L;
+    nanosleep(&request, NULL);
+
+#endif
+}
+
+
+/// ---------------------------------------------------------------------------
+/// Gives up the remainder of the calling threads time slice.
+/// ---------------------------------------------------------------------------
+void prThreadYield()
+{
+#if defined(PLATFORM_PC)
+
+    SwitchToThread();
+
+#else
+
+    sched_yield();
 
 #endif
 }
+
+
+/// ---------------------------------------------------------------------------
+/// Gets the number of hardware threads available.
+/// ---------------------------------------------------------------------------
+u32 prThreadHardwareCount()
+{
+    s32 count = 1;
+
+#if defined(PLATFORM_PC)
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    count = (s32)info.dwNumberOfProcessors;
+
+#else
+
+    count = (s32)sysconf(_SC_NPROCESSORS_ONLN);
+
+#endif
+
+    return (count > 0) ? (u32)count : 1;
+}
@@ -52,6 +52,13 @@
   #define PRTHREAD_CALLCONV
   #define PRTHREAD_RETVAL   void*
 
+// Mac
+#elif defined(PLATFORM_MAC)
+  #include <pthread.h>
+
+  #define PRTHREAD_CALLCONV
+  #define PRTHREAD_RETVAL   void*
+
 #else
   #error Platform not supported
 
@@ -83,8 +90,30 @@ private:
     HANDLE      mThread;
     DWORD       mThreadID;
 
-#elif defined(PLATFORM_ANDROID)
+#else
     pthread_t   mThread;
+    bool        mCreated;
 
 #endif
 };
+
+
+// Function: prThreadSleep
+//      Suspends the calling thread.
+//
+// Parameters:
+//      milliseconds - The time to sleep for
+void prThreadSleep(u32 milliseconds);
+
+
+// Function: prThreadYield
+//      Gives up the remainder of the calling threads time slice.
+void prThreadYield();
+
+
+// Function: prThreadHardwareCount
+//      Gets the number of hardware threads available.
+//
+// Returns:
+//      The number of hardware threads. Always at least 1
+u32 prThreadHardwareCount();